@@ -0,0 +1,75 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>//Memory operations
+#include <stddef.h>//size_t
+
+/*Bump allocator for memory that all dies at the same time, like everything a level loads. Allocations come out
+of big blocks back to back and are never freed one by one, ResetArena drops all of them at once and keeps the
+blocks for the next level, UnloadArena gives the blocks back*/
+
+#define ARENA_ALIGNMENT 16 //Enough for SSE loads
+#define ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size; //Usable bytes after the header
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *first, *current;
+    size_t blockSize; //Size of new blocks, bigger allocations get a block of their own size
+} Arena;
+
+Arena InitArena(size_t blockSize) {
+    Arena arena = { 0 };
+    arena.blockSize = blockSize;
+    return arena;
+}
+
+//Never returns memory that overlaps an earlier allocation since the last reset, aligned to ARENA_ALIGNMENT
+void *ArenaAlloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaBlock *block = arena->current;
+    while (block != NULL && block->used + size > block->size && block->next != NULL) block = block->next; //Blocks kept from before a reset
+    if (block == NULL || block->used + size > block->size) {
+        size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+        ArenaBlock *fresh = (ArenaBlock *)malloc(ARENA_HEADER + blockSize);
+        fresh->size = blockSize;
+        fresh->used = 0;
+        fresh->next = NULL;
+        if (block != NULL) block->next = fresh;
+        else arena->first = fresh;
+        block = fresh;
+    }
+    arena->current = block;
+    void *memory = (char *)block + ARENA_HEADER + block->used;
+    block->used += size;
+    return memory;
+}
+
+//Everything allocated so far is gone, the blocks stay around for the next round
+void ResetArena(Arena *arena) {
+    for (ArenaBlock *block = arena->first; block != NULL; block = block->next) block->used = 0;
+    arena->current = arena->first;
+}
+
+//Bytes handed out since the last reset, padding included
+size_t ArenaUsed(const Arena *arena) {
+    size_t used = 0;
+    for (ArenaBlock *block = arena->first; block != NULL; block = block->next) used += block->used;
+    return used;
+}
+
+void UnloadArena(Arena *arena) {
+    ArenaBlock *block = arena->first;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first = arena->current = NULL;
+}
+
+#endif
@@ -0,0 +1,364 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "raylib.h"
+#include "collisions.h"
+#include "levelfile.h"
+#include "obj.h"
+#include "profiler.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>//Memory operations
+#include <string.h>
+#include <time.h>
+#include <unistd.h>//sysconf
+
+/*Background asset loading. Requests go into a priority queue and worker threads do the slow part off the main
+thread, reading files, decoding images, parsing OBJ meshes, cooking colliders and mapping level files. Finished
+ones wait in the upload queue until PumpAssets picks them up on the main thread once a frame, it does the GPU part
+for as many as fit in its time budget and calls their callbacks. raylib only lets the thread with the GL context
+touch the GPU, that is the only reason the upload is split off.
+The loader owns everything it loads, UnloadAsset or UnloadAssetLoader frees it, dont unload the textures or models yourself*/
+
+#define ASSET_MAX_WORKERS 8
+#define ASSET_PATH_LENGTH 256
+#define ASSET_PREFETCH_CHUNK (64 * 1024)
+
+typedef enum {
+    ASSET_TEXTURE, //Image decoded off thread
+    ASSET_CUBEMAP, //Image decoded off thread, the faces get cut out on upload
+    ASSET_SHADER, //Sources read off thread, compiled on upload
+    ASSET_OBJ, //Parsed off thread into a one mesh model, cooked for collision too if asked
+    ASSET_MODEL, //Anything else raylib loads (glb, gltf, iqm). raylib parses and uploads in one call, so only reading the file is off thread
+    ASSET_LEVEL //Cooked level file mapped off thread, nothing to upload
+} AssetType;
+
+typedef enum {
+    ASSET_PENDING, //Queued, loading or waiting for the upload
+    ASSET_READY,
+    ASSET_FAILED
+} AssetState;
+
+typedef struct Asset Asset;
+
+//Runs on the main thread from PumpAssets once the asset is ready or failed
+typedef void (*AssetCallback)(Asset *asset, void *user);
+
+struct Asset {
+    AssetType type;
+    AssetState state; //Only changes inside PumpAssets, so the main thread can read it any time
+    char path[ASSET_PATH_LENGTH]; //File, the vertex shader for shaders
+    char path2[ASSET_PATH_LENGTH]; //Fragment shader. Empty shader paths use raylibs default one like LoadShader does
+    int priority; //Higher goes first, on the workers and in the upload queue. Same priority goes in request order
+    long sequence;
+    AssetCallback callback;
+    void *user;
+
+    //Request options
+    int cubemapLayout;
+    bool cook; //OBJ, cook a collider shape with it
+    ColliderStore *store; //Level, where the shapes and colliders go. Dont touch the store until the level is ready
+
+    //Filled in by the worker
+    bool decoded;
+    Image image;
+    char *vertexCode, *fragmentCode;
+    Mesh mesh;
+
+    //Results
+    Texture2D texture; //Texture and cubemap
+    Shader shader;
+    Model model; //OBJ and model
+    CookedShape *cooked; //OBJ with cook set, NULL if the mesh had no hull. Own block, not in any store
+    LevelFile level;
+};
+
+typedef struct {
+    pthread_t threads[ASSET_MAX_WORKERS];
+    int numWorkers;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool quit;
+    Asset **pending; //Not picked up by a worker yet
+    int numPending, capPending;
+    Asset **decoded; //Waiting for PumpAssets
+    int numDecoded, capDecoded;
+    //Main thread only
+    Asset **assets; //Everything requested and not unloaded
+    int numAssets, capAssets;
+    int inFlight; //Requested and not through PumpAssets yet
+    long sequence;
+} AssetLoader;
+
+static double AssetNow(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void PushAsset(Asset ***list, int *count, int *cap, Asset *asset) {
+    if (*count == *cap) {
+        *cap = *cap ? *cap * 2 : 32;
+        *list = (Asset **)realloc(*list, *cap * sizeof(Asset *));
+    }
+    (*list)[(*count)++] = asset;
+}
+
+//Highest priority, oldest first. The queues only ever hold a few dozen so a scan is fine
+static Asset *TakeAsset(Asset **list, int *count) {
+    if (*count == 0) return NULL;
+    int best = 0;
+    for (int i = 1; i < *count; i++) {
+        if (list[i]->priority > list[best]->priority ||
+            (list[i]->priority == list[best]->priority && list[i]->sequence < list[best]->sequence)) best = i;
+    }
+    Asset *asset = list[best];
+    list[best] = list[--*count];
+    return asset;
+}
+
+//The whole file once, so raylib finds it in the page cache when it reads it again on the main thread
+static bool PrefetchFile(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    char *chunk = (char *)malloc(ASSET_PREFETCH_CHUNK);
+    while (fread(chunk, 1, ASSET_PREFETCH_CHUNK, file) == ASSET_PREFETCH_CHUNK) {}
+    free(chunk);
+    fclose(file);
+    return true;
+}
+
+//Worker side, nothing in here may touch the GPU
+static void DecodeAsset(Asset *a) {
+    switch (a->type) {
+    case ASSET_TEXTURE:
+    case ASSET_CUBEMAP:
+        a->image = LoadImage(a->path);
+        a->decoded = a->image.data != NULL;
+        break;
+    case ASSET_SHADER:
+        a->vertexCode = a->path[0] != '\0' ? LoadFileText(a->path) : NULL;
+        a->fragmentCode = a->path2[0] != '\0' ? LoadFileText(a->path2) : NULL;
+        a->decoded = (a->path[0] == '\0' || a->vertexCode != NULL) && (a->path2[0] == '\0' || a->fragmentCode != NULL);
+        break;
+    case ASSET_OBJ:
+        a->mesh = LoadObjMeshData(a->path);
+        a->decoded = a->mesh.vertexCount > 0;
+        if (a->decoded && a->cook) a->cooked = CookColliderMesh(a->mesh, NULL);
+        break;
+    case ASSET_MODEL:
+        a->decoded = PrefetchFile(a->path);
+        break;
+    case ASSET_LEVEL:
+        a->level = LoadLevelFile(a->path, a->store);
+        a->decoded = a->level.numColliders >= 0;
+        break;
+    }
+}
+
+//Main thread, the GPU half. Returns false if there was nothing usable
+static bool UploadAsset(Asset *a) {
+    switch (a->type) {
+    case ASSET_TEXTURE:
+        a->texture = LoadTextureFromImage(a->image);
+        UnloadImage(a->image);
+        a->image = (Image){ 0 };
+        return a->texture.id != 0;
+    case ASSET_CUBEMAP:
+        a->texture = LoadTextureCubemap(a->image, a->cubemapLayout);
+        UnloadImage(a->image);
+        a->image = (Image){ 0 };
+        return a->texture.id != 0;
+    case ASSET_SHADER:
+        a->shader = LoadShaderFromMemory(a->vertexCode, a->fragmentCode); //Falls back to the default shader if it doesnt compile, like LoadShader
+        UnloadFileText(a->vertexCode);
+        UnloadFileText(a->fragmentCode);
+        a->vertexCode = a->fragmentCode = NULL;
+        return true;
+    case ASSET_OBJ:
+        UploadMesh(&a->mesh, false);
+        a->model = LoadModelFromMesh(a->mesh); //The model owns the mesh arrays now
+        a->mesh = (Mesh){ 0 };
+        return true;
+    case ASSET_MODEL:
+        a->model = LoadModel(a->path);
+        return a->model.meshCount > 0;
+    case ASSET_LEVEL:
+        return true;
+    }
+    return false;
+}
+
+//Whatever a failed asset got to before it failed
+static void FreeDecodedAsset(Asset *a) {
+    if (a->image.data != NULL) UnloadImage(a->image);
+    if (a->vertexCode != NULL) UnloadFileText(a->vertexCode);
+    if (a->fragmentCode != NULL) UnloadFileText(a->fragmentCode);
+    if (a->mesh.vertices != NULL) UnloadObjMeshData(a->mesh);
+    free(a->cooked);
+    if (a->level.data != NULL) UnloadLevelFile(&a->level);
+    a->image = (Image){ 0 };
+    a->vertexCode = a->fragmentCode = NULL;
+    a->mesh = (Mesh){ 0 };
+    a->cooked = NULL;
+}
+
+static void *AssetWorkerMain(void *arg) {
+    AssetLoader *loader = (AssetLoader *)arg;
+    PROFILE_THREAD("assets");
+    pthread_mutex_lock(&loader->lock);
+    for (;;) {
+        while (loader->numPending == 0 && !loader->quit) pthread_cond_wait(&loader->wake, &loader->lock);
+        if (loader->quit) break;
+        Asset *asset = TakeAsset(loader->pending, &loader->numPending);
+        pthread_mutex_unlock(&loader->lock);
+        PROFILE_BEGIN("decode_asset");
+        DecodeAsset(asset);
+        PROFILE_END();
+        pthread_mutex_lock(&loader->lock);
+        PushAsset(&loader->decoded, &loader->numDecoded, &loader->capDecoded, asset);
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+//numWorkers 0 uses one less then the number of cores. The threads keep a pointer to loader, so it cant move until UnloadAssetLoader
+void InitAssetLoader(AssetLoader *loader, int numWorkers) {
+    if (numWorkers <= 0) numWorkers = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (numWorkers < 1) numWorkers = 1;
+    if (numWorkers > ASSET_MAX_WORKERS) numWorkers = ASSET_MAX_WORKERS;
+    *loader = (AssetLoader){ 0 };
+    loader->numWorkers = numWorkers;
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->wake, NULL);
+    for (int i = 0; i < numWorkers; i++) pthread_create(&loader->threads[i], NULL, AssetWorkerMain, loader);
+}
+
+//Everything a request has in common, the type specific options have to be set before it goes in the queue
+static Asset *NewAsset(AssetLoader *loader, AssetType type, const char *path, int priority, AssetCallback callback, void *user) {
+    Asset *asset = (Asset *)calloc(1, sizeof(Asset));
+    asset->type = type;
+    asset->state = ASSET_PENDING;
+    if (path != NULL) snprintf(asset->path, ASSET_PATH_LENGTH, "%s", path);
+    asset->priority = priority;
+    asset->sequence = loader->sequence++;
+    asset->callback = callback;
+    asset->user = user;
+    PushAsset(&loader->assets, &loader->numAssets, &loader->capAssets, asset);
+    return asset;
+}
+
+static Asset *QueueAsset(AssetLoader *loader, Asset *asset) {
+    loader->inFlight++;
+    pthread_mutex_lock(&loader->lock);
+    PushAsset(&loader->pending, &loader->numPending, &loader->capPending, asset);
+    pthread_cond_signal(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+    return asset;
+}
+
+Asset *LoadTextureAsync(AssetLoader *loader, const char *path, int priority, AssetCallback callback, void *user) {
+    return QueueAsset(loader, NewAsset(loader, ASSET_TEXTURE, path, priority, callback, user));
+}
+
+Asset *LoadCubemapAsync(AssetLoader *loader, const char *path, int layout, int priority, AssetCallback callback, void *user) {
+    Asset *asset = NewAsset(loader, ASSET_CUBEMAP, path, priority, callback, user);
+    asset->cubemapLayout = layout;
+    return QueueAsset(loader, asset);
+}
+
+//Either path can be NULL for raylibs default shader stage
+Asset *LoadShaderAsync(AssetLoader *loader, const char *vsPath, const char *fsPath, int priority, AssetCallback callback, void *user) {
+    Asset *asset = NewAsset(loader, ASSET_SHADER, vsPath, priority, callback, user);
+    if (fsPath != NULL) snprintf(asset->path2, ASSET_PATH_LENGTH, "%s", fsPath);
+    return QueueAsset(loader, asset);
+}
+
+//cook also builds the collider shape on the worker, for props that arent in a cooked level file
+Asset *LoadObjAsync(AssetLoader *loader, const char *path, bool cook, int priority, AssetCallback callback, void *user) {
+    Asset *asset = NewAsset(loader, ASSET_OBJ, path, priority, callback, user);
+    asset->cook = cook;
+    return QueueAsset(loader, asset);
+}
+
+Asset *LoadModelAsync(AssetLoader *loader, const char *path, int priority, AssetCallback callback, void *user) {
+    return QueueAsset(loader, NewAsset(loader, ASSET_MODEL, path, priority, callback, user));
+}
+
+Asset *LoadLevelAsync(AssetLoader *loader, const char *path, ColliderStore *store, int priority, AssetCallback callback, void *user) {
+    Asset *asset = NewAsset(loader, ASSET_LEVEL, path, priority, callback, user);
+    asset->store = store;
+    return QueueAsset(loader, asset);
+}
+
+/*Call once a frame on the main thread. Uploads finished assets and calls their callbacks until budget seconds are
+used up, at least one per call so big ones still get trough. Returns how many it finished*/
+int PumpAssets(AssetLoader *loader, double budget) {
+    double start = AssetNow();
+    int done = 0;
+    while (loader->inFlight > 0) {
+        pthread_mutex_lock(&loader->lock);
+        Asset *asset = TakeAsset(loader->decoded, &loader->numDecoded);
+        pthread_mutex_unlock(&loader->lock);
+        if (asset == NULL) break;
+        bool ready = asset->decoded && UploadAsset(asset);
+        if (!ready) FreeDecodedAsset(asset);
+        asset->state = ready ? ASSET_READY : ASSET_FAILED;
+        loader->inFlight--;
+        done++;
+        if (asset->callback != NULL) asset->callback(asset, asset->user);
+        if (AssetNow() - start >= budget) break;
+    }
+    return done;
+}
+
+//Requests that arent ready or failed yet
+int AssetsInFlight(const AssetLoader *loader) {
+    return loader->inFlight;
+}
+
+static void ReleaseAsset(Asset *asset) {
+    if (asset->state == ASSET_READY) {
+        switch (asset->type) {
+        case ASSET_TEXTURE:
+        case ASSET_CUBEMAP: UnloadTexture(asset->texture); break;
+        case ASSET_SHADER: UnloadShader(asset->shader); break;
+        case ASSET_OBJ:
+        case ASSET_MODEL: UnloadModel(asset->model); break;
+        case ASSET_LEVEL: break;
+        }
+    }
+    FreeDecodedAsset(asset); //The cooked shape and the level mapping
+    free(asset);
+}
+
+/*Free a ready or failed asset now instead of with the loader, like an old sky that got swapped out. Level
+colliders have to be out of their broadphase first*/
+void UnloadAsset(AssetLoader *loader, Asset *asset) {
+    if (asset == NULL || asset->state == ASSET_PENDING) return; //A worker might still have it
+    for (int i = 0; i < loader->numAssets; i++) {
+        if (loader->assets[i] != asset) continue;
+        loader->assets[i] = loader->assets[--loader->numAssets];
+        ReleaseAsset(asset);
+        return;
+    }
+}
+
+//Stops the workers and frees every asset, finished or not. Level colliders have to be out of their broadphase first
+void UnloadAssetLoader(AssetLoader *loader) {
+    pthread_mutex_lock(&loader->lock);
+    loader->quit = true;
+    pthread_cond_broadcast(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+    for (int i = 0; i < loader->numWorkers; i++) pthread_join(loader->threads[i], NULL);
+    for (int i = 0; i < loader->numAssets; i++) ReleaseAsset(loader->assets[i]);
+    free(loader->assets);
+    free(loader->pending);
+    free(loader->decoded);
+    pthread_cond_destroy(&loader->wake);
+    pthread_mutex_destroy(&loader->lock);
+    *loader = (AssetLoader){ 0 };
+}
+
+#endif
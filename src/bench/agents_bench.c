@@ -0,0 +1,151 @@
+// Headless benchmark for stepping crowds of agents on the job system, how it scales with the worker count
+// build: make bench, run: make run-bench. every worker count has to end with the same hash or it exits with 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../collisions.h"
+#include "../player.h"
+#include "../jobs.h"
+
+#define AGENT_STEPS 240 // 2 seconds at 120 Hz
+#define NUM_PROPS 2000
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same world
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static unsigned long long HashBytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for(size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+typedef struct {
+    Collider *colliders;
+    int numColliders;
+    Broadphase broadphase;
+    float extent;
+} World;
+
+// floor with props scattered over it, the same kind of clutter the player bench walks trough
+static World SetupWorld(void) {
+    World world = { 0 };
+    world.numColliders = NUM_PROPS + 1;
+    world.colliders = malloc(world.numColliders * sizeof(Collider));
+    world.extent = sqrtf((float)NUM_PROPS) * 3.0f;
+    SetupColliderBox(&world.colliders[0], (Vector3){ 0.0f, -0.5f, 0.0f }, (Vector3){ 1000.0f, 0.5f, 1000.0f });
+    Mesh mesh = { 0 };
+    mesh.vertexCount = 64;
+    mesh.triangleCount = 21;
+    mesh.vertices = malloc(64 * 3 * sizeof(float));
+    for(int i = 0; i < 64 * 3; i++) mesh.vertices[i] = RandomFloat(-0.8f, 0.8f);
+    for(int i = 1; i < world.numColliders; i++) {
+        SetupColliderMesh(&world.colliders[i], mesh);
+        SetColliderTransform(&world.colliders[i], MatrixMultiply(MatrixRotateY(RandomFloat(0.0f, 6.28f)),
+                             MatrixTranslate(RandomFloat(-world.extent, world.extent), RandomFloat(0.0f, 0.5f), RandomFloat(-world.extent, world.extent))));
+    }
+    free(mesh.vertices);
+    world.broadphase = InitBroadphase(4.0f, world.numColliders);
+    for(int i = 0; i < world.numColliders; i++) RegisterCollider(&world.broadphase, &world.colliders[i], i);
+    return world;
+}
+
+static void UnloadWorld(World *world) {
+    for(int i = 0; i < world->numColliders; i++) UnloadCollider(&world->colliders[i]);
+    UnloadBroadphase(&world->broadphase);
+    free(world->colliders);
+}
+
+// every agent walks its own loose circle and jumps now and then, the input only depends on the agent and the step
+static void AgentInput(int agent, int step, unsigned int *keys, Vector3 *forward, bool *jump) {
+    float yaw = agent * 0.7f + step * 0.01f * (agent & 1 ? 1.0f : -1.0f);
+    *forward = (Vector3){ sinf(yaw), 0.0f, cosf(yaw) };
+    *keys = PLAYER_KEY_FORWARD;
+    if((agent + step / 120) % 3 == 0) *keys |= PLAYER_KEY_SPRINT;
+    if((agent + step / 60) % 5 == 0) *keys |= PLAYER_KEY_LEFT;
+    *jump = (step + agent * 7) % 180 == 0;
+}
+
+static unsigned long long RunAgents(World *world, int numAgents, int numWorkers, double *timeOut) {
+    JobSystem jobs;
+    InitJobSystem(&jobs, numWorkers);
+    PlayerBatch batch = InitPlayerBatch(&jobs);
+
+    Player *agents = calloc(numAgents, sizeof(Player));
+    unsigned int *keys = malloc(numAgents * sizeof(unsigned int));
+    Vector3 *forwards = malloc(numAgents * sizeof(Vector3));
+    unsigned int agentSeed = 777; // same spawn points for every worker count
+    for(int i = 0; i < numAgents; i++) {
+        agentSeed = agentSeed * 1664525u + 1013904223u;
+        float x = ((float)(agentSeed >> 8) / 16777216.0f * 2.0f - 1.0f) * world->extent;
+        agentSeed = agentSeed * 1664525u + 1013904223u;
+        float z = ((float)(agentSeed >> 8) / 16777216.0f * 2.0f - 1.0f) * world->extent;
+        Collider capsule;
+        SetupColliderCapsule(&capsule, (Vector3){ 0.0f, -1.0f, 0.0f }, 0.4f, 0.6f);
+        SetupPlayerPhysics(&agents[i], (Vector3){ x, 3.0f, z }, capsule);
+    }
+
+    double t0 = Now();
+    for(int step = 0; step < AGENT_STEPS; step++) {
+        for(int i = 0; i < numAgents; i++) {
+            bool jump;
+            AgentInput(i, step, &keys[i], &forwards[i], &jump);
+            if(jump) agents[i].jumpQueued = true;
+        }
+        StepPlayerBatch(&batch, agents, keys, forwards, numAgents, world->numColliders, world->colliders, &world->broadphase);
+    }
+    *timeOut = Now() - t0;
+
+    unsigned long long hash = 14695981039346656037ull;
+    for(int i = 0; i < numAgents; i++) {
+        hash = HashBytes(hash, &agents[i].position, sizeof(Vector3));
+        hash = HashBytes(hash, &agents[i].velocity, sizeof(Vector3));
+        UnloadPlayerPhysics(&agents[i]);
+    }
+    free(agents);
+    free(keys);
+    free(forwards);
+    UnloadPlayerBatch(&batch);
+    UnloadJobSystem(&jobs);
+    return hash;
+}
+
+int main(void) {
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int maxWorkers = cores > 2 ? cores : 2; // always run at least two so the threaded path gets checked
+    World world = SetupWorld();
+    bool deterministic = true;
+    int sizes[] = { 256, 1024 };
+    for(int s = 0; s < 2; s++) {
+        int numAgents = sizes[s];
+        double baseTime = 0.0;
+        unsigned long long baseHash = 0;
+        RunAgents(&world, numAgents, 1, &baseTime); // warm up so the first measurement isnt the only cold one
+        for(int workers = 1; workers <= maxWorkers; workers = workers * 2 > maxWorkers && workers != maxWorkers ? maxWorkers : workers * 2) {
+            double time;
+            unsigned long long hash = RunAgents(&world, numAgents, workers, &time);
+            if(workers == 1) {
+                baseTime = time;
+                baseHash = hash;
+            }
+            if(hash != baseHash) deterministic = false;
+            double speedup = baseTime / time;
+            printf("agents op=step agents=%d workers=%d cores=%d steps=%d ns_per_agent_step=%.1f agent_steps_per_sec=%.0f speedup=%.2f efficiency=%.2f hash=%016llx\n",
+                   numAgents, workers, cores, AGENT_STEPS, time * 1e9 / ((double)numAgents * AGENT_STEPS),
+                   (double)numAgents * AGENT_STEPS / time, speedup, speedup / workers, hash);
+        }
+    }
+    printf("agents op=check deterministic=%d\n", deterministic);
+    UnloadWorld(&world);
+    return deterministic ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// Headless broadphase benchmark, query time against collider count
+// build: make bench (no window, GPU or raylib library needed, only the headers). exits with 1 if huge, infinite or NaN
+// boxes, or removing and growing, make a query disagree with testing every box
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../broadphase.h"
+
+#define NUM_QUERIES 100000
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same world
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void RunBench(int numColliders) {
+    // props keep the same density no matter the count, like a bigger level would
+    float extent = sqrtf((float)numColliders) * 4.0f;
+    Vector3 *mins = malloc(numColliders * sizeof(Vector3));
+    Vector3 *maxs = malloc(numColliders * sizeof(Vector3));
+    for(int i = 0; i < numColliders; i++) {
+        Vector3 p = { RandomFloat(-extent, extent), RandomFloat(0.0f, 4.0f), RandomFloat(-extent, extent) };
+        Vector3 half = { RandomFloat(0.25f, 2.0f), RandomFloat(0.25f, 2.0f), RandomFloat(0.25f, 2.0f) };
+        mins[i] = Vector3Subtract(p, half);
+        maxs[i] = Vector3Add(p, half);
+    }
+
+    double t0 = Now();
+    Broadphase bp = InitBroadphase(4.0f, numColliders);
+    for(int i = 0; i < numColliders; i++) BroadphaseInsert(&bp, mins[i], maxs[i], i);
+    double insertTime = Now() - t0;
+
+    // player sized boxes at random spots
+    Vector3 *queries = malloc(NUM_QUERIES * sizeof(Vector3));
+    for(int i = 0; i < NUM_QUERIES; i++) queries[i] = (Vector3){ RandomFloat(-extent, extent), RandomFloat(0.0f, 4.0f), RandomFloat(-extent, extent) };
+    Vector3 half = { 0.5f, 1.0f, 0.5f };
+
+    int out[256];
+    long candidates = 0;
+    t0 = Now();
+    for(int i = 0; i < NUM_QUERIES; i++)
+        candidates += BroadphaseQuery(&bp, Vector3Subtract(queries[i], half), Vector3Add(queries[i], half), out, 256);
+    double queryTime = Now() - t0;
+
+    // the read only version the worker threads use, can report a proxy twice so the average can come out a bit higher
+    long sharedCandidates = 0;
+    t0 = Now();
+    for(int i = 0; i < NUM_QUERIES; i++)
+        sharedCandidates += BroadphaseQueryShared(&bp, Vector3Subtract(queries[i], half), Vector3Add(queries[i], half), out, 256);
+    double sharedTime = Now() - t0;
+
+    // what UpdatePlayer did before, test every collider
+    int bruteQueries = numColliders > 10000 ? NUM_QUERIES / 100 : NUM_QUERIES;
+    long bruteCandidates = 0;
+    t0 = Now();
+    for(int i = 0; i < bruteQueries; i++) {
+        Vector3 qmin = Vector3Subtract(queries[i], half), qmax = Vector3Add(queries[i], half);
+        for(int j = 0; j < numColliders; j++)
+            if(!(maxs[j].x < qmin.x || mins[j].x > qmax.x || maxs[j].y < qmin.y || mins[j].y > qmax.y || maxs[j].z < qmin.z || mins[j].z > qmax.z)) bruteCandidates++;
+    }
+    double bruteTime = Now() - t0;
+
+    printf("broadphase colliders=%d insert_ms=%.3f query_ns=%.1f shared_query_ns=%.1f brute_ns=%.1f avg_candidates=%.2f shared_avg_candidates=%.2f brute_avg_candidates=%.2f\n",
+           numColliders, insertTime * 1e3, queryTime * 1e9 / NUM_QUERIES, sharedTime * 1e9 / NUM_QUERIES, bruteTime * 1e9 / bruteQueries,
+           (double)candidates / NUM_QUERIES, (double)sharedCandidates / NUM_QUERIES, (double)bruteCandidates / bruteQueries);
+
+    UnloadBroadphase(&bp);
+    free(queries);
+    free(mins);
+    free(maxs);
+}
+
+#define CHECK_BOXES 512
+#define CHECK_QUERIES 256
+
+// both queries against testing every live box. the NaN box overlaps nothing for the brute force, the grid may still
+// hand it out as a candidate so it gets left out of the comparison
+static int CompareQuery(Broadphase *bp, const Vector3 *mins, const Vector3 *maxs, const bool *live, int nanId, Vector3 min, Vector3 max) {
+    static int out[CHECK_BOXES * 4];
+    bool expected[CHECK_BOXES], found[CHECK_BOXES], shared[CHECK_BOXES];
+    for(int i = 0; i < CHECK_BOXES; i++)
+        expected[i] = live[i] && i != nanId && !(maxs[i].x < min.x || mins[i].x > max.x || maxs[i].y < min.y || mins[i].y > max.y || maxs[i].z < min.z || mins[i].z > max.z);
+    memset(found, 0, sizeof(found));
+    memset(shared, 0, sizeof(shared));
+    int count = BroadphaseQuery(bp, min, max, out, CHECK_BOXES * 4);
+    for(int i = 0; i < count; i++) found[out[i]] = true;
+    count = BroadphaseQueryShared(bp, min, max, out, CHECK_BOXES * 4);
+    for(int i = 0; i < count; i++) shared[out[i]] = true;
+    int mismatches = 0;
+    for(int i = 0; i < CHECK_BOXES; i++) if(i != nanId && (found[i] != expected[i] || shared[i] != expected[i])) mismatches++;
+    return mismatches;
+}
+
+// normal props mixed with boxes out at 1e30, infinite ones and a NaN one, some removed again while the free list is
+// empty and then enough inserted to grow the buckets. queried with normal, huge, infinite and NaN boxes
+static bool CheckExtremes(void) {
+    Vector3 mins[CHECK_BOXES], maxs[CHECK_BOXES];
+    bool live[CHECK_BOXES] = { 0 };
+    int proxies[CHECK_BOXES];
+    float inf = INFINITY, nan = NAN;
+    Broadphase bp = InitBroadphase(4.0f, 1);
+    int nanId = CHECK_BOXES - 1;
+    for(int i = 0; i < CHECK_BOXES; i++) {
+        Vector3 p = { RandomFloat(-100.0f, 100.0f), RandomFloat(0.0f, 4.0f), RandomFloat(-100.0f, 100.0f) };
+        Vector3 half = { RandomFloat(0.25f, 2.0f), RandomFloat(0.25f, 2.0f), RandomFloat(0.25f, 2.0f) };
+        mins[i] = Vector3Subtract(p, half);
+        maxs[i] = Vector3Add(p, half);
+        if(i % 64 == 1) { mins[i].x = 1e30f; maxs[i].x = 2e30f; }
+        if(i % 64 == 2) { mins[i].x = -inf; maxs[i].x = inf; }
+        if(i % 64 == 3) { mins[i].z = -3e9f; maxs[i].z = 3e9f; }
+        if(i == nanId) mins[i].y = nan;
+    }
+    int half = CHECK_BOXES / 2;
+    for(int i = 0; i < half; i++) { proxies[i] = BroadphaseInsert(&bp, mins[i], maxs[i], i); live[i] = true; }
+    for(int i = 0; i < half; i += 7) { BroadphaseRemove(&bp, proxies[i]); live[i] = false; } // the first one lands on an empty free list
+    for(int i = half; i < CHECK_BOXES; i++) { proxies[i] = BroadphaseInsert(&bp, mins[i], maxs[i], i); live[i] = true; }
+
+    int mismatches = 0;
+    for(int q = 0; q < CHECK_QUERIES; q++) {
+        Vector3 c = { RandomFloat(-110.0f, 110.0f), RandomFloat(-2.0f, 6.0f), RandomFloat(-110.0f, 110.0f) };
+        Vector3 size = { RandomFloat(0.5f, 20.0f), RandomFloat(0.5f, 4.0f), RandomFloat(0.5f, 20.0f) };
+        mismatches += CompareQuery(&bp, mins, maxs, live, nanId, Vector3Subtract(c, size), Vector3Add(c, size));
+    }
+    mismatches += CompareQuery(&bp, mins, maxs, live, nanId, (Vector3){ -1e30f, -1e30f, -1e30f }, (Vector3){ 1e30f, 1e30f, 1e30f });
+    mismatches += CompareQuery(&bp, mins, maxs, live, nanId, (Vector3){ -inf, -inf, -inf }, (Vector3){ inf, inf, inf });
+    mismatches += CompareQuery(&bp, mins, maxs, live, nanId, (Vector3){ 1.5e30f, 0.0f, 0.0f }, (Vector3){ 1.6e30f, 4.0f, 4.0f });
+    int out[CHECK_BOXES * 4];
+    BroadphaseQuery(&bp, (Vector3){ nan, 0.0f, 0.0f }, (Vector3){ 10.0f, nan, 10.0f }, out, CHECK_BOXES * 4); // only has to come back
+    BroadphaseQueryShared(&bp, (Vector3){ nan, 0.0f, 0.0f }, (Vector3){ 10.0f, nan, 10.0f }, out, CHECK_BOXES * 4);
+    printf("broadphase op=check boxes=%d queries=%d oversized=%d mismatches=%d ok=%d\n", CHECK_BOXES, CHECK_QUERIES + 3, bp.numOversized, mismatches, mismatches == 0);
+    UnloadBroadphase(&bp);
+    return mismatches == 0;
+}
+
+int main(void) {
+    RunBench(10);
+    RunBench(1000);
+    RunBench(100000);
+    return CheckExtremes() ? 0 : 1;
+}
@@ -0,0 +1,356 @@
+// Headless benchmark for collisions.h and the player physics step
+// build: make bench, run: make run-bench (no window, GPU or raylib library needed, only the headers). exits with 1 if a query allocates
+// every result is one line of key=value pairs so CI can diff them against the last run
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// count every allocation the headers make, has to come before they are included.
+// every block gets a 16 byte header with its size so the bytes still in use can be tracked too
+static long benchAllocs, benchBytes, benchLive;
+static void *CountMalloc(size_t size) {
+    benchAllocs++;
+    benchBytes += size;
+    benchLive += size;
+    size_t *block = malloc(size + 16);
+    block[0] = size;
+    return (char *)block + 16;
+}
+static void CountFree(void *ptr) {
+    if(ptr == NULL) return;
+    size_t *block = (size_t *)((char *)ptr - 16);
+    benchLive -= block[0];
+    free(block);
+}
+static void *CountCalloc(size_t count, size_t size) { return memset(CountMalloc(count * size), 0, count * size); }
+static void *CountRealloc(void *ptr, size_t size) {
+    void *fresh = CountMalloc(size);
+    if(ptr != NULL) {
+        size_t old = ((size_t *)((char *)ptr - 16))[0];
+        memcpy(fresh, ptr, old < size ? old : size);
+        CountFree(ptr);
+    }
+    return fresh;
+}
+#define malloc(size) CountMalloc(size)
+#define calloc(count, size) CountCalloc(count, size)
+#define realloc(ptr, size) CountRealloc(ptr, size)
+#define free(ptr) CountFree(ptr)
+
+#include "../collisions.h"
+#include "../levelfile.h"
+#include "../player.h"
+
+#define BENCH_MIN_TIME 0.2 // seconds a measurement has to run for
+#define BENCH_MAX_ITERATIONS (1 << 24)
+#define PLAYER_STEPS 120000 // 1000 seconds of play at 120 Hz
+#define LEVEL_PROPS 10000
+#define LEVEL_MESHES 8 // unique meshes the props are instances of
+#define LEVEL_SWEEPS 20
+#define LEVEL_FILE_PATH "collisions_bench.lvl" // written and removed again by the level bench
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same meshes
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef void (*BenchFunction)(void *context, int iteration);
+
+static int allocatingQueries; // query ops that allocate, a query on colliders that are set up never should
+
+// run fn with more and more iterations until it takes BENCH_MIN_TIME, then print the last batch. returns the allocs per op
+static double Measure(const char *op, int vertices, int hullPoints, BenchFunction fn, void *context) {
+    fn(context, 0); // warm up
+    double time = 0.0;
+    int iterations = 1;
+    for(;;) {
+        benchAllocs = benchBytes = 0;
+        double t0 = Now();
+        for(int i = 0; i < iterations; i++) fn(context, i);
+        time = Now() - t0;
+        if(time >= BENCH_MIN_TIME || iterations >= BENCH_MAX_ITERATIONS) break;
+        iterations *= 2;
+    }
+    printf("collisions op=%s vertices=%d hull_points=%d iterations=%d ns_per_op=%.1f ops_per_sec=%.0f allocs_per_op=%.2f bytes_per_op=%.0f\n",
+           op, vertices, hullPoints, iterations, time * 1e9 / iterations, iterations / time,
+           (double)benchAllocs / iterations, (double)benchBytes / iterations);
+    return (double)benchAllocs / iterations;
+}
+
+static void MeasureQuery(const char *op, int vertices, int hullPoints, BenchFunction fn, void *context) {
+    if(Measure(op, vertices, hullPoints, fn, context) > 0.0) allocatingQueries++;
+}
+
+// triangle soup with the points spread trough a lumpy ellipsoid, like a detailed prop the hull only keeps the outer ones
+static Mesh GenBenchMesh(int vertices) {
+    Mesh mesh = { 0 };
+    mesh.vertexCount = vertices;
+    mesh.triangleCount = vertices / 3;
+    mesh.vertices = (float *)malloc(vertices * 3 * sizeof(float));
+    for(int i = 0; i < vertices; i++) {
+        Vector3 p;
+        do p = (Vector3){ RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f) };
+        while(Vector3LengthSqr(p) > 1.0f);
+        mesh.vertices[i * 3] = p.x * 1.0f;
+        mesh.vertices[i * 3 + 1] = p.y * 0.7f;
+        mesh.vertices[i * 3 + 2] = p.z * 0.45f;
+    }
+    return mesh;
+}
+
+typedef struct {
+    Mesh mesh;
+    Collider a, b;
+    PairCache cache;
+    Vector3 axes[64];
+    float sink; // results go here so the compiler cant drop the calls
+} MeshBench;
+
+static void BenchSetupMesh(void *context, int iteration) {
+    MeshBench *bench = context;
+    Collider c;
+    SetupColliderMesh(&c, bench->mesh);
+    UnloadCollider(&c);
+}
+
+static void BenchUpdateCollider(void *context, int iteration) {
+    MeshBench *bench = context;
+    UpdateCollider((Vector3){ (float)(iteration & 1), 0.0f, 0.0f }, &bench->a); // alternate so it never hits the no change shortcut
+}
+
+static void BenchGetMinMax(void *context, int iteration) {
+    MeshBench *bench = context;
+    float min, max;
+    GetMinMax(bench->a, bench->axes[iteration & 63], &min, &max);
+    bench->sink += max - min;
+}
+
+static void BenchCheckCollision(void *context, int iteration) {
+    MeshBench *bench = context;
+    Vector3 normal;
+    if(CheckCollision(&bench->a, &bench->b, &normal)) bench->sink += normal.x;
+}
+
+static void BenchCheckCollisionPair(void *context, int iteration) {
+    MeshBench *bench = context;
+    Vector3 normal;
+    if(CheckCollisionPair(&bench->a, &bench->b, COLLISION_METHOD_AUTO, &normal)) bench->sink += normal.x;
+}
+
+// a circles b a bit further out then touching, a little further every call like a frame of the game
+static void OrbitBench(MeshBench *bench, int iteration) {
+    float angle = iteration * 0.001f;
+    UpdateCollider((Vector3){ 2.5f * cosf(angle), 0.0f, 2.5f * sinf(angle) }, &bench->a);
+}
+
+static void BenchOrbitPair(void *context, int iteration) {
+    MeshBench *bench = context;
+    Vector3 normal;
+    OrbitBench(bench, iteration);
+    if(CheckCollisionPair(&bench->a, &bench->b, COLLISION_METHOD_AUTO, &normal)) bench->sink += normal.x;
+}
+
+static void BenchOrbitCached(void *context, int iteration) {
+    MeshBench *bench = context;
+    Vector3 normal;
+    OrbitBench(bench, iteration);
+    if(CheckCollisionCached(&bench->cache, &bench->a, &bench->b, COLLISION_METHOD_AUTO, &normal)) bench->sink += normal.x;
+}
+
+static void RunMeshBench(int vertices) {
+    MeshBench bench = { 0 };
+    bench.mesh = GenBenchMesh(vertices);
+    for(int i = 0; i < 64; i++) bench.axes[i] = Vector3Normalize((Vector3){ RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1) });
+    SetupColliderMesh(&bench.a, bench.mesh);
+    SetupColliderMesh(&bench.b, bench.mesh);
+    int hullPoints = bench.a.cooked != NULL ? bench.a.cooked->numPoints : 0;
+
+    Measure("setup_mesh", vertices, hullPoints, BenchSetupMesh, &bench);
+    Measure("update_collider", vertices, hullPoints, BenchUpdateCollider, &bench);
+    MeasureQuery("get_min_max", vertices, hullPoints, BenchGetMinMax, &bench);
+
+    // overlapping is the worst case, every axis gets tested
+    SetColliderTransform(&bench.a, MatrixMultiply(MatrixRotateY(0.3f), MatrixTranslate(0.5f, 0.2f, 0.0f)));
+    MeasureQuery("check_collision_hit", vertices, hullPoints, BenchCheckCollision, &bench);
+    MeasureQuery("check_collision_pair_hit", vertices, hullPoints, BenchCheckCollisionPair, &bench);
+    UpdateCollider((Vector3){ 3.0f, 0.0f, 0.0f }, &bench.a);
+    MeasureQuery("check_collision_miss", vertices, hullPoints, BenchCheckCollision, &bench);
+    MeasureQuery("check_collision_pair_miss", vertices, hullPoints, BenchCheckCollisionPair, &bench);
+    MeasureQuery("check_collision_pair_orbit", vertices, hullPoints, BenchOrbitPair, &bench);
+    MeasureQuery("check_collision_cached_orbit", vertices, hullPoints, BenchOrbitCached, &bench);
+    printf("collisions op=pair_cache vertices=%d hull_points=%d queries=%ld found=%ld early_outs=%ld hit_rate=%.3f\n",
+           vertices, hullPoints, bench.cache.queries, bench.cache.found, bench.cache.earlyOuts, PairCacheHitRate(&bench.cache));
+    UnloadPairCache(&bench.cache);
+
+    UnloadCollider(&bench.a);
+    UnloadCollider(&bench.b);
+    free(bench.mesh.vertices);
+}
+
+// player walking around a floor full of props, what a frame of the game costs minus the rendering
+// it wanders in loose circles, the floor is big enough that it never walks off
+static void RunPlayerBench(int numProps) {
+    int numColliders = numProps + 1;
+    Collider *colliders = malloc(numColliders * sizeof(Collider));
+    float extent = sqrtf((float)numProps) * 3.0f;
+    SetupColliderBox(&colliders[0], (Vector3){ 0.0f, -0.5f, 0.0f }, (Vector3){ 1000.0f, 0.5f, 1000.0f });
+    Mesh mesh = GenBenchMesh(64);
+    for(int i = 1; i < numColliders; i++) {
+        SetupColliderMesh(&colliders[i], mesh);
+        SetColliderTransform(&colliders[i], MatrixMultiply(MatrixRotateY(RandomFloat(0.0f, 6.28f)),
+                             MatrixTranslate(RandomFloat(-extent, extent), RandomFloat(0.0f, 0.5f), RandomFloat(-extent, extent))));
+    }
+    free(mesh.vertices);
+    Broadphase broadphase = InitBroadphase(4.0f, numColliders);
+    for(int i = 0; i < numColliders; i++) RegisterCollider(&broadphase, &colliders[i], i);
+
+    Player player = { 0 };
+    Collider capsule;
+    SetupColliderCapsule(&capsule, (Vector3){ 0.0f, -1.0f, 0.0f }, 0.4f, 0.6f);
+    SetupPlayerPhysics(&player, (Vector3){ 0.0f, 3.0f, 0.0f }, capsule);
+
+    benchAllocs = benchBytes = 0;
+    double t0 = Now();
+    for(int i = 0; i < PLAYER_STEPS; i++) {
+        // scripted input, turn slowly, run in bursts and jump now and then
+        float yaw = i * 0.002f;
+        unsigned int keys = PLAYER_KEY_FORWARD;
+        if((i / 600) & 1) keys |= PLAYER_KEY_SPRINT;
+        if((i / 900) % 3 == 2) keys |= PLAYER_KEY_LEFT;
+        if(i % 240 == 0) player.jumpQueued = true;
+        player.previousPosition = player.position;
+        StepPlayer(&player, keys, (Vector3){ sinf(yaw), 0.0f, cosf(yaw) }, colliders, &broadphase);
+    }
+    double time = Now() - t0;
+    // the end position doubles as a determinism check, it has to match between runs of the same build
+    printf("player op=step props=%d steps=%d ns_per_op=%.1f ops_per_sec=%.0f allocs_per_op=%.2f bytes_per_op=%.0f pairs_per_step=%.2f pair_hit_rate=%.3f final_x=%.6f final_y=%.6f final_z=%.6f\n",
+           numProps, PLAYER_STEPS, time * 1e9 / PLAYER_STEPS, PLAYER_STEPS / time, (double)benchAllocs / PLAYER_STEPS,
+           (double)benchBytes / PLAYER_STEPS, (double)player.pairs.queries / PLAYER_STEPS, PairCacheHitRate(&player.pairs),
+           player.position.x, player.position.y, player.position.z);
+
+    for(int i = 0; i < numColliders; i++) UnloadCollider(&colliders[i]);
+    UnloadBroadphase(&broadphase);
+    UnloadPlayerPhysics(&player);
+    free(colliders);
+}
+
+typedef enum {
+    LEVEL_HEAP, // SetupColliderMesh per prop
+    LEVEL_STORE, // shared cooked meshes from a ColliderStore
+    LEVEL_FILE // the same level cooked to a file and mapped
+} LevelLayout;
+
+static const char *levelLayoutNames[] = { "heap", "store", "file" };
+
+// props cooked into store, every other one rotated so it needs its own world axes
+static Collider *SetupLevelProps(ColliderStore *store, Collider *colliders, const Mesh meshes[], bool shared) {
+    for(int i = 0; i < LEVEL_PROPS; i++) {
+        if(shared) SetupColliderInstance(store, &colliders[i], meshes[i % LEVEL_MESHES]);
+        else SetupColliderMesh(&colliders[i], meshes[i % LEVEL_MESHES]);
+        Matrix transform = MatrixTranslate((float)(i % 100) * 3.0f, 0.0f, (float)(i / 100) * 3.0f);
+        if(i & 1) transform = MatrixMultiply(MatrixRotateY(i * 0.1f), transform);
+        SetColliderTransform(&colliders[i], transform);
+        PrepareCollider(&colliders[i]);
+    }
+    return colliders;
+}
+
+static long MinorFaults(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+// a level full of instanced props, each mesh cooked per prop, shared from a ColliderStore, or mapped from a cooked file.
+// setup of the file layout is only the load, the page faults show what it costs. sweep projects every prop once like a
+// broad query would, the first pass is where the file layout pays for its pages. sink has to be the same for all three
+static void RunLevelBench(LevelLayout layout) {
+    Mesh meshes[LEVEL_MESHES];
+    seed = 777; // same meshes for every layout
+    for(int i = 0; i < LEVEL_MESHES; i++) meshes[i] = GenBenchMesh(64 + i * 64);
+    ColliderStore store = InitColliderStore();
+    if(layout == LEVEL_FILE) {
+        Collider *colliders = SetupLevelProps(&store, AllocColliders(&store, LEVEL_PROPS), meshes, true);
+        const CookedShape *shapes[LEVEL_MESHES];
+        int colliderShapes[LEVEL_PROPS];
+        for(int i = 0; i < LEVEL_MESHES; i++) shapes[i] = GetCookedShape(&store, meshes[i]);
+        for(int i = 0; i < LEVEL_PROPS; i++) colliderShapes[i] = i % LEVEL_MESHES;
+        SaveLevelFile(LEVEL_FILE_PATH, shapes, LEVEL_MESHES, colliders, colliderShapes, LEVEL_PROPS);
+        ResetColliderStore(&store);
+    }
+    long live = benchLive;
+    long faults = MinorFaults();
+    benchAllocs = benchBytes = 0;
+
+    double t0 = Now();
+    LevelFile level = { 0 };
+    Collider *colliders;
+    if(layout == LEVEL_FILE) {
+        level = LoadLevelFile(LEVEL_FILE_PATH, &store);
+        colliders = level.colliders;
+    } else {
+        colliders = layout == LEVEL_STORE ? AllocColliders(&store, LEVEL_PROPS) : malloc(LEVEL_PROPS * sizeof(Collider));
+        SetupLevelProps(&store, colliders, meshes, layout == LEVEL_STORE);
+    }
+    double setupTime = Now() - t0;
+    long allocs = benchAllocs;
+    long liveBytes = benchLive - live;
+    faults = MinorFaults() - faults;
+
+    Vector3 axes[4] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0.577f, 0.577f, 0.577f } };
+    float sink = 0.0f;
+    double firstSweepTime = 0.0;
+    t0 = Now();
+    for(int pass = 0; pass <= LEVEL_SWEEPS; pass++) {
+        for(int i = 0; i < LEVEL_PROPS; i++) {
+            float mins[4], maxs[4];
+            GetMinMaxAxes(&colliders[i], axes, 4, mins, maxs);
+            sink += maxs[0] - mins[3];
+        }
+        if(pass == 0) {// cold pass on its own
+            firstSweepTime = Now() - t0;
+            t0 = Now();
+        }
+    }
+    double sweepTime = Now() - t0;
+
+    t0 = Now();
+    if(layout == LEVEL_FILE) {
+        UnloadLevelFile(&level);
+        ResetColliderStore(&store);
+    } else if(layout == LEVEL_STORE) {
+        ResetColliderStore(&store);
+    } else {
+        for(int i = 0; i < LEVEL_PROPS; i++) UnloadCollider(&colliders[i]);
+        free(colliders);
+    }
+    double teardownTime = Now() - t0;
+    UnloadColliderStore(&store);
+    if(layout == LEVEL_FILE) remove(LEVEL_FILE_PATH);
+
+    printf("level layout=%s props=%d meshes=%d setup_ms=%.2f allocs=%ld live_bytes=%ld bytes_per_prop=%.0f faults=%ld first_sweep_ms=%.2f sweep_ns_per_prop=%.1f teardown_ms=%.3f sink=%.0f\n",
+           levelLayoutNames[layout], LEVEL_PROPS, LEVEL_MESHES, setupTime * 1e3, allocs, liveBytes, (double)liveBytes / LEVEL_PROPS, faults,
+           firstSweepTime * 1e3, sweepTime * 1e9 / ((double)LEVEL_PROPS * LEVEL_SWEEPS), teardownTime * 1e3, sink);
+    for(int i = 0; i < LEVEL_MESHES; i++) free(meshes[i].vertices);
+}
+
+int main(void) {
+    int sizes[] = { 8, 64, 512, 4096, 50000 };
+    for(int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) RunMeshBench(sizes[i]);
+    RunPlayerBench(10);
+    RunPlayerBench(1000);
+    RunLevelBench(LEVEL_HEAP);
+    RunLevelBench(LEVEL_STORE);
+    RunLevelBench(LEVEL_FILE);
+    printf("collisions op=check allocating_queries=%d ok=%d\n", allocatingQueries, allocatingQueries == 0);
+    return allocatingQueries == 0 ? 0 : 1;
+}
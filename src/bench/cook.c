@@ -0,0 +1,163 @@
+// Offline level cooker, turns a layout file into the level file the game maps at startup (see levelfile.h)
+// build: make bench, run: ./bench/cook <layout.txt> <out.lvl>, make level does it for every level in LEVELS.
+// ./bench/cook -sectors <size> <layout.txt> <out.wld> cuts it into sectors for streaming instead (see sectors.h)
+// layout: one collider per line, model x y z [yaw degrees] [scale] [texture=path] [tint=RRGGBB], # starts a comment.
+// model and texture paths are relative to the layout file, every model only gets loaded and cooked once.
+// texture and tint are only for how the prop looks, a plain level ignores them
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../collisions.h"
+#include "../levelfile.h"
+#include "../sectors.h"
+#include "../obj.h"
+
+#define COOK_MAX_PATH 512
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    float sectorSize = 0.0f;
+    if(argc > 2 && strcmp(argv[1], "-sectors") == 0) {
+        sectorSize = (float)atof(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+    if(argc < 3 || sectorSize < 0.0f) {
+        fprintf(stderr, "usage: cook [-sectors <size>] <layout.txt> <out.lvl or out.wld>\n");
+        return 1;
+    }
+    FILE *layout = fopen(argv[1], "r");
+    if(layout == NULL) {
+        fprintf(stderr, "cook: cant read %s\n", argv[1]);
+        return 1;
+    }
+    // model paths start from the folder the layout is in
+    char folder[COOK_MAX_PATH] = "";
+    const char *slash = strrchr(argv[1], '/');
+    if(slash != NULL) snprintf(folder, sizeof(folder), "%.*s", (int)(slash - argv[1] + 1), argv[1]);
+
+    double t0 = Now();
+    char (*models)[COOK_MAX_PATH] = NULL;
+    CookedShape **shapes = NULL;
+    BoundingBox *shapeBounds = NULL; // of the model, what the prop gets culled with
+    int numShapes = 0, capShapes = 0;
+    Collider *colliders = NULL;
+    int *colliderShapes = NULL;
+    WorldObject *objects = NULL; // one per collider, only for -sectors
+    char (*textures)[COOK_MAX_PATH] = NULL;
+    int numColliders = 0, capColliders = 0;
+    char line[1024];
+    int lineNumber = 0;
+    while(fgets(line, sizeof(line), layout)) {
+        lineNumber++;
+        char model[256];
+        float x, y, z, yaw = 0.0f, scale = 1.0f;
+        char *comment = strchr(line, '#');
+        if(comment != NULL) *comment = '\0';
+        int read = sscanf(line, "%255s %f %f %f %f %f", model, &x, &y, &z, &yaw, &scale);
+        if(read <= 0) continue; // blank line
+        if(read < 4) {
+            fprintf(stderr, "cook: %s:%d: expected model x y z [yaw] [scale] [texture=path] [tint=RRGGBB]\n", argv[1], lineNumber);
+            return 1;
+        }
+        char texture[COOK_MAX_PATH] = "";
+        Color tint = WHITE;
+        const char *option = strstr(line, "texture=");
+        if(option != NULL) {
+            char name[256];
+            if(sscanf(option + 8, "%255s", name) == 1) snprintf(texture, sizeof(texture), "%s%s", folder, name);
+        }
+        option = strstr(line, "tint=");
+        if(option != NULL) {
+            unsigned int rgb = (unsigned int)strtoul(option + 5, NULL, 16);
+            tint = (Color){ (rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF, 255 };
+        }
+
+        char path[COOK_MAX_PATH];
+        snprintf(path, sizeof(path), "%s%s", folder, model);
+        int shape = 0;
+        while(shape < numShapes && strcmp(models[shape], path) != 0) shape++;
+        if(shape == numShapes) {
+            Mesh mesh = LoadObjMeshData(path);
+            if(mesh.vertexCount == 0) {
+                fprintf(stderr, "cook: %s:%d: cant load %s\n", argv[1], lineNumber, path);
+                return 1;
+            }
+            if(numShapes == capShapes) {
+                capShapes = capShapes ? capShapes * 2 : 16;
+                models = realloc(models, capShapes * sizeof(*models));
+                shapes = realloc(shapes, capShapes * sizeof(CookedShape *));
+                shapeBounds = realloc(shapeBounds, capShapes * sizeof(BoundingBox));
+            }
+            snprintf(models[numShapes], COOK_MAX_PATH, "%s", path);
+            BoundingBox bounds = { { mesh.vertices[0], mesh.vertices[1], mesh.vertices[2] }, { mesh.vertices[0], mesh.vertices[1], mesh.vertices[2] } };
+            for(int v = 1; v < mesh.vertexCount; v++) {
+                Vector3 p = { mesh.vertices[3 * v], mesh.vertices[3 * v + 1], mesh.vertices[3 * v + 2] };
+                bounds.min = Vector3Min(bounds.min, p);
+                bounds.max = Vector3Max(bounds.max, p);
+            }
+            shapeBounds[numShapes] = bounds;
+            shapes[numShapes++] = CookColliderMesh(mesh, NULL);
+            UnloadObjMeshData(mesh);
+        }
+
+        if(numColliders == capColliders) {
+            capColliders = capColliders ? capColliders * 2 : 64;
+            colliders = realloc(colliders, capColliders * sizeof(Collider));
+            colliderShapes = realloc(colliderShapes, capColliders * sizeof(int));
+            objects = realloc(objects, capColliders * sizeof(WorldObject));
+            textures = realloc(textures, capColliders * sizeof(*textures));
+        }
+        Collider *c = &colliders[numColliders];
+        SetupColliderShape(c, shapes[shape], NULL);
+        // plain translation when there is no yaw or scale so the numbers are exactly what UpdateCollider makes
+        Matrix transform = MatrixTranslate(x, y, z);
+        if(yaw != 0.0f || scale != 1.0f)
+            transform = MatrixMultiply(MatrixMultiply(MatrixScale(scale, scale, scale), MatrixRotateY(yaw * DEG2RAD)), transform);
+        SetColliderTransform(c, transform);
+        PrepareCollider(c); // world axes of rotated colliders go in the file
+        snprintf(textures[numColliders], COOK_MAX_PATH, "%s", texture);
+        objects[numColliders] = (WorldObject){ shape, transform, NULL, NULL, tint, shapeBounds[shape] };
+        colliderShapes[numColliders++] = shape;
+    }
+    fclose(layout);
+
+    bool saved;
+    if(sectorSize > 0.0f) {
+        // the paths only now, models and textures moved while the arrays grew
+        for(int i = 0; i < numColliders; i++) {
+            objects[i].model = models[objects[i].shape];
+            objects[i].texture = textures[i][0] != '\0' ? textures[i] : NULL;
+        }
+        saved = SaveWorldFile(argv[2], sectorSize, (const CookedShape *const *)shapes, numShapes, objects, numColliders);
+    }
+    else saved = SaveLevelFile(argv[2], (const CookedShape *const *)shapes, numShapes, colliders, colliderShapes, numColliders);
+    if(!saved) {
+        fprintf(stderr, "cook: cant write %s\n", argv[2]);
+        return 1;
+    }
+    FILE *out = fopen(argv[2], "rb");
+    fseek(out, 0, SEEK_END);
+    long bytes = ftell(out);
+    fclose(out);
+    printf("cook op=%s layout=%s shapes=%d colliders=%d bytes=%ld ms=%.1f file=%s\n", sectorSize > 0.0f ? "world" : "level",
+           argv[1], numShapes, numColliders, bytes, (Now() - t0) * 1e3, argv[2]);
+
+    for(int i = 0; i < numColliders; i++) UnloadCollider(&colliders[i]);
+    for(int i = 0; i < numShapes; i++) free(shapes[i]);
+    free(colliders);
+    free(colliderShapes);
+    free(objects);
+    free(textures);
+    free(shapes);
+    free(shapeBounds);
+    free(models);
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Checks ProjectPointsSoA against a plain C reference on random point clouds padded the way CookColliderMesh pads them.
+// min and max have to be bit equal, GetMinMaxAxes relies on every SIMD width projecting exactly like Vector3DotProduct.
+// make check-simd runs it built for the scalar, SSE and AVX widths. exits with 1 on any mismatch
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../collisions.h"
+
+#define KERNEL_CLOUDS 2000
+#define KERNEL_MAX_POINTS 300
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every width checks the same clouds
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+// some coordinates exactly 0 and some axes along a world axis, the cases where the sign of a zero could go either way
+static float RandomCoordinate(float range) {
+    return RandomFloat(0.0f, 1.0f) < 0.1f ? 0.0f : RandomFloat(-range, range);
+}
+
+static Vector3 RandomAxis(void) {
+    float pick = RandomFloat(0.0f, 1.0f);
+    if(pick < 0.1f) return (Vector3){ pick < 0.05f ? 1.0f : -1.0f, 0.0f, 0.0f };
+    if(pick < 0.2f) return (Vector3){ 0.0f, 0.0f, pick < 0.15f ? 1.0f : -1.0f };
+    return Vector3Normalize((Vector3){ RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1) });
+}
+
+int main(void) {
+    static float xs[KERNEL_MAX_POINTS + COLLISION_PAD_WIDTH], ys[KERNEL_MAX_POINTS + COLLISION_PAD_WIDTH], zs[KERNEL_MAX_POINTS + COLLISION_PAD_WIDTH];
+    static Vector3 points[KERNEL_MAX_POINTS];
+    int mismatches = 0;
+    for(int cloud = 0; cloud < KERNEL_CLOUDS; cloud++) {
+        int count = 1 + (int)RandomFloat(0.0f, KERNEL_MAX_POINTS);
+        if(count > KERNEL_MAX_POINTS) count = KERNEL_MAX_POINTS;
+        float range = cloud % 2 == 0 ? 1.0f : 1000.0f;
+        for(int i = 0; i < count; i++) points[i] = (Vector3){ RandomCoordinate(range), RandomCoordinate(range), RandomCoordinate(range) };
+        int padded = (count + COLLISION_PAD_WIDTH - 1) / COLLISION_PAD_WIDTH * COLLISION_PAD_WIDTH;
+        for(int i = 0; i < padded; i++) { // same layout as the cooked shape, the tail repeats the last point
+            Vector3 p = points[i < count ? i : count - 1];
+            xs[i] = p.x;
+            ys[i] = p.y;
+            zs[i] = p.z;
+        }
+        Vector3 axes[COLLISION_AXIS_BATCH];
+        for(int k = 0; k < COLLISION_AXIS_BATCH; k++) axes[k] = RandomAxis();
+
+        float mins[COLLISION_AXIS_BATCH], maxs[COLLISION_AXIS_BATCH];
+        ProjectPointsSoA(xs, ys, zs, padded, axes, mins, maxs);
+        for(int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+            float min = Vector3DotProduct(points[0], axes[k]), max = min;
+            for(int i = 1; i < count; i++) {
+                float dot = Vector3DotProduct(points[i], axes[k]);
+                if(dot < min) min = dot;
+                if(dot > max) max = dot;
+            }
+            min += 0.0f; // the kernel returns -0 as 0
+            max += 0.0f;
+            if(memcmp(&min, &mins[k], sizeof(float)) != 0 || memcmp(&max, &maxs[k], sizeof(float)) != 0) {
+                if(mismatches == 0) printf("kernel op=mismatch cloud=%d count=%d axis=%d min=%a/%a max=%a/%a\n", cloud, count, k, mins[k], min, maxs[k], max);
+                mismatches++;
+            }
+        }
+    }
+    printf("kernel op=check simd_width=%d clouds=%d mismatches=%d ok=%d\n", COLLISION_SIMD_WIDTH, KERNEL_CLOUDS, mismatches, mismatches == 0);
+    return mismatches == 0 ? 0 : 1;
+}
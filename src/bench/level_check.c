@@ -0,0 +1,206 @@
+// Checks cooked level files between builds of different SIMD widths. Cooks the same hulls and a flat quad every time,
+// ./bench/level_check write file saves them as a level and ./bench/level_check read file maps one and compares it
+// bit for bit with what this build cooks itself. Without arguments it does both on a temp file and also makes sure
+// records with missing arrays or bad padding get refused. make check-levels runs it across the scalar, SSE and AVX
+// builds, every one reading the level of every other. exits with 1 on any difference
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../levelfile.h"
+
+#define CHECK_PATH "/tmp/level_check.lvl"
+#define CORRUPT_PATH "/tmp/level_check_corrupt.lvl"
+#define NUM_SHAPES 12
+#define NUM_AXES 16
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every build cooks the same shapes
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+// point clouds of different sizes so the hulls end on every padding remainder, the last shape is a flat quad
+static Mesh GenCheckMesh(int index) {
+    Mesh mesh = { 0 };
+    if(index == NUM_SHAPES - 1) {
+        static float quad[] = { -1, 0, -1, 1, 0, -1, 1, 0, 1, -1, 0, -1, 1, 0, 1, -1, 0, 1 };
+        mesh.vertexCount = 6;
+        mesh.triangleCount = 2;
+        mesh.vertices = malloc(sizeof(quad));
+        memcpy(mesh.vertices, quad, sizeof(quad));
+        return mesh;
+    }
+    mesh.vertexCount = 9 + index * 23;
+    mesh.triangleCount = mesh.vertexCount / 3;
+    mesh.vertices = malloc(mesh.vertexCount * 3 * sizeof(float));
+    for(int i = 0; i < mesh.vertexCount; i++) {
+        Vector3 p;
+        do p = (Vector3){ RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f) };
+        while(Vector3LengthSqr(p) > 1.0f);
+        mesh.vertices[i * 3] = p.x;
+        mesh.vertices[i * 3 + 1] = p.y * 0.6f;
+        mesh.vertices[i * 3 + 2] = p.z * 0.8f;
+    }
+    return mesh;
+}
+
+// every other collider turned and scaled so its world axes go in the file too
+static Matrix CheckTransform(int index) {
+    Matrix move = MatrixTranslate(index * 3.0f, 0.5f, -index * 1.5f);
+    if(index % 2 == 0) return move;
+    return MatrixMultiply(MatrixMultiply(MatrixScale(1.0f, 1.5f, 0.75f), MatrixRotateXYZ((Vector3){ 0.3f * index, 0.7f, -0.2f * index })), move);
+}
+
+typedef struct {
+    CookedShape *shapes[NUM_SHAPES];
+    Collider colliders[NUM_SHAPES];
+} CheckLevel;
+
+static void CookCheckLevel(CheckLevel *level) {
+    seed = 12345;
+    for(int i = 0; i < NUM_SHAPES; i++) {
+        Mesh mesh = GenCheckMesh(i);
+        level->shapes[i] = CookColliderMesh(mesh, NULL);
+        free(mesh.vertices);
+        SetupColliderShape(&level->colliders[i], level->shapes[i], NULL);
+        SetColliderTransform(&level->colliders[i], CheckTransform(i));
+        PrepareCollider(&level->colliders[i]);
+    }
+}
+
+static void UnloadCheckLevel(CheckLevel *level) {
+    for(int i = 0; i < NUM_SHAPES; i++) {
+        UnloadCollider(&level->colliders[i]);
+        free(level->shapes[i]);
+    }
+}
+
+static bool SameBytes(const void *a, const void *b, size_t bytes) {
+    if(bytes == 0) return true;
+    return a != NULL && b != NULL && memcmp(a, b, bytes) == 0;
+}
+
+// the mapped shape against the one cooked here, then both colliders projected on the same axes
+static int CompareCollider(const Collider *loaded, const Collider *cooked) {
+    int differences = 0;
+    const CookedShape *a = loaded->cooked, *b = cooked->cooked;
+    if((a == NULL) != (b == NULL) || loaded->primitive.shape != cooked->primitive.shape) return 1;
+    if(a != NULL) {
+        if(a->numPoints != b->numPoints || a->numNormals != b->numNormals || a->numEdges != b->numEdges || a->numPadded != b->numPadded) return 1;
+        if(!SameBytes(a->notTransformed, b->notTransformed, a->numPoints * sizeof(Vector3))) differences++;
+        if(!SameBytes(a->soaX, b->soaX, 3 * a->numPadded * sizeof(float))) differences++;
+        if(!SameBytes(a->normals, b->normals, a->numNormals * sizeof(Vector3))) differences++;
+        if(!SameBytes(a->edges, b->edges, a->numEdges * sizeof(Vector3))) differences++;
+        if((a->edgeNormals == NULL) != (b->edgeNormals == NULL)) differences++;
+        else if(a->edgeNormals != NULL && !SameBytes(a->edgeNormals, b->edgeNormals, a->numEdges * 2 * sizeof(Vector3))) differences++;
+        if(!SameBytes(loaded->worldNormals, cooked->worldNormals, a->numNormals * sizeof(Vector3))) differences++;
+    }
+    seed = 777;
+    Vector3 axes[NUM_AXES];
+    for(int k = 0; k < NUM_AXES; k++) axes[k] = Vector3Normalize((Vector3){ RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1) });
+    for(int k = 0; k < NUM_AXES; k += COLLISION_AXIS_BATCH) {
+        float min1[COLLISION_AXIS_BATCH], max1[COLLISION_AXIS_BATCH], min2[COLLISION_AXIS_BATCH], max2[COLLISION_AXIS_BATCH];
+        GetMinMaxAxes(loaded, &axes[k], COLLISION_AXIS_BATCH, min1, max1);
+        GetMinMaxAxes(cooked, &axes[k], COLLISION_AXIS_BATCH, min2, max2);
+        if(memcmp(min1, min2, sizeof(min1)) != 0 || memcmp(max1, max2, sizeof(max1)) != 0) differences++;
+    }
+    return differences;
+}
+
+static bool WriteCheckLevel(const char *path) {
+    CheckLevel level;
+    CookCheckLevel(&level);
+    int colliderShapes[NUM_SHAPES];
+    for(int i = 0; i < NUM_SHAPES; i++) colliderShapes[i] = i;
+    bool ok = SaveLevelFile(path, (const CookedShape *const *)level.shapes, NUM_SHAPES, level.colliders, colliderShapes, NUM_SHAPES);
+    UnloadCheckLevel(&level);
+    return ok;
+}
+
+static int ReadCheckLevel(const char *path) {
+    CheckLevel level;
+    CookCheckLevel(&level);
+    ColliderStore store = InitColliderStore();
+    LevelFile file = LoadLevelFile(path, &store);
+    int differences = 0;
+    if(file.numColliders != NUM_SHAPES) differences = -1;
+    for(int i = 0; i < file.numColliders && differences >= 0; i++) differences += CompareCollider(&file.colliders[i], &level.colliders[i]);
+    UnloadLevelFile(&file);
+    UnloadColliderStore(&store);
+    UnloadCheckLevel(&level);
+    return differences;
+}
+
+// a copy of the level with one shape record broken, it has to be refused like a wrong header
+typedef enum {
+    CORRUPT_NORMALS, // normals counted but no array
+    CORRUPT_EDGES,
+    CORRUPT_SOA,
+    CORRUPT_EDGE_NORMALS, // hasEdgeNormals without the array
+    CORRUPT_EDGE_NORMALS_FLAG, // the array without hasEdgeNormals
+    CORRUPT_PADDING, // not a multiple of COLLISION_PAD_WIDTH
+    CORRUPT_COUNT
+} Corruption;
+
+static bool RefusesCorrupted(const char *path, Corruption corruption) {
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc(size);
+    bool read = fread(data, 1, size, file) == (size_t)size;
+    fclose(file);
+    const LevelFileHeader *header = (const LevelFileHeader *)data;
+    LevelShapeRecord *records = (LevelShapeRecord *)(data + header->shapes);
+    LevelShapeRecord *r = NULL;
+    for(uint32_t i = 0; i < header->numShapes && r == NULL; i++) if(records[i].hasEdgeNormals && records[i].numPoints % COLLISION_PAD_WIDTH != 0) r = &records[i];
+    if(!read || r == NULL) {
+        free(data);
+        return false;
+    }
+    switch(corruption) {
+        case CORRUPT_NORMALS: r->normals = 0; break;
+        case CORRUPT_EDGES: r->edges = 0; break;
+        case CORRUPT_SOA: r->soa = 0; break;
+        case CORRUPT_EDGE_NORMALS: r->edgeNormals = 0; break;
+        case CORRUPT_EDGE_NORMALS_FLAG: r->hasEdgeNormals = 0; break;
+        case CORRUPT_PADDING: r->numPadded = r->numPoints; break;
+        default: break;
+    }
+    file = fopen(CORRUPT_PATH, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    free(data);
+    ColliderStore store = InitColliderStore();
+    LevelFile level = LoadLevelFile(CORRUPT_PATH, &store);
+    bool refused = level.numColliders < 0;
+    UnloadLevelFile(&level);
+    UnloadColliderStore(&store);
+    remove(CORRUPT_PATH);
+    return refused;
+}
+
+int main(int argc, char **argv) {
+    if(argc == 3 && strcmp(argv[1], "write") == 0) {
+        bool ok = WriteCheckLevel(argv[2]);
+        printf("level_check op=write simd_width=%d path=%s ok=%d\n", COLLISION_SIMD_WIDTH, argv[2], ok);
+        return ok ? 0 : 1;
+    }
+    if(argc == 3 && strcmp(argv[1], "read") == 0) {
+        int differences = ReadCheckLevel(argv[2]);
+        printf("level_check op=read simd_width=%d path=%s differences=%d ok=%d\n", COLLISION_SIMD_WIDTH, argv[2], differences, differences == 0);
+        return differences == 0 ? 0 : 1;
+    }
+
+    bool written = WriteCheckLevel(CHECK_PATH);
+    int differences = written ? ReadCheckLevel(CHECK_PATH) : -1;
+    int accepted = 0;
+    for(int c = 0; c < CORRUPT_COUNT; c++) if(!RefusesCorrupted(CHECK_PATH, (Corruption)c)) accepted++;
+    remove(CHECK_PATH);
+    bool ok = differences == 0 && accepted == 0;
+    printf("level_check op=check simd_width=%d pad_width=%d differences=%d corrupted_accepted=%d ok=%d\n",
+           COLLISION_SIMD_WIDTH, COLLISION_PAD_WIDTH, differences, accepted, ok);
+    return ok ? 0 : 1;
+}
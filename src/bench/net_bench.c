@@ -0,0 +1,187 @@
+// Headless load test for net.h, a server and 64 to 512 clients in one process talking over UDP on loopback. the
+// clients are bots walking around the test level with prediction on, a few percent of the packets get dropped.
+// reports the server tick time and the traffic per client, run it from src/ after make level.
+// build: make bench, run: make run-bench. exits with 1 if a client cant connect or decodes a snapshot wrong
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../collisions.h"
+#include "../player.h"
+#include "../scene.h"
+#include "../jobs.h"
+#include "../net.h"
+
+#define BROADPHASE_CELL_SIZE 4.0f // same as the game
+#define WARMUP_TICKS 120 // a second to connect and fill the baselines
+#define TICKS 480 // 4 seconds at 120 Hz
+#define PACKET_LOSS 0.02f // each way
+#define PUMP_EVERY 64 // clients between server reads while the input goes out, like it would trickle in
+#define UDP_HEADER 28 // IPv4 and UDP, on top of every payload
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same bots
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// wanders like the synthetic replay session, turning back to the middle once it gets a few meters out
+typedef struct {
+    unsigned int keys;
+    float wander, nextChange;
+} Bot;
+
+static NetCommand BotCommand(Bot *bot, Player *player, float time) {
+    if(time >= bot->nextChange) {
+        bot->keys = PLAYER_KEY_FORWARD | ((unsigned int)RandomFloat(0.0f, 32.0f) & (PLAYER_KEY_LEFT | PLAYER_KEY_RIGHT | PLAYER_KEY_SPRINT));
+        if(RandomFloat(0.0f, 1.0f) < 0.2f) bot->keys |= PLAYER_KEY_CROUCH;
+        bot->wander = RandomFloat(-3.0f, 3.0f);
+        bot->nextChange = time + RandomFloat(0.2f, 0.8f);
+    }
+    float turn = bot->wander;
+    if(player->position.x * player->position.x + player->position.z * player->position.z > 9.0f) {
+        float error = atan2f(-player->position.x, -player->position.z) - player->yaw;
+        error = atan2f(sinf(error), cosf(error));
+        turn = Clamp(-error / PLAYER_LOOK_SENSITIVITY, -10.0f, 10.0f);
+    }
+    player->yaw -= turn * PLAYER_LOOK_SENSITIVITY;
+    return MakeNetCommand(bot->keys, RandomFloat(0.0f, 1.0f) < 0.01f ? PLAYER_PRESS_JUMP : 0, player->yaw, player->pitch);
+}
+
+static bool SameSnapshot(const NetSnapshot *a, const NetSnapshot *b) {
+    if(a->sequence != b->sequence || a->lastCommand != b->lastCommand || a->numPlayers != b->numPlayers) return false;
+    for(int i = 0; i < a->numPlayers; i++) {
+        const NetPlayerState *x = &a->players[i], *y = &b->players[i];
+        if(x->id != y->id || x->yaw != y->yaw || x->pitch != y->pitch || !SameNetPlayer(x, y)) return false;
+    }
+    return true;
+}
+
+static int CompareDoubles(const void *x, const void *y) {
+    double a = *(const double *)x, b = *(const double *)y;
+    return a < b ? -1 : a > b;
+}
+
+static bool RunLoad(int numClients, LevelFile *level, Broadphase *broadphase, JobSystem *jobs) {
+    NetServer server = InitNetServer(0, numClients, jobs);
+    if(server.socket < 0) {
+        fprintf(stderr, "net_bench: cant open a udp socket\n");
+        return false;
+    }
+    NetClient *clients = malloc(numClients * sizeof(NetClient));
+    Player *players = calloc(numClients, sizeof(Player));
+    Bot *bots = calloc(numClients, sizeof(Bot));
+    for(int i = 0; i < numClients; i++) {
+        clients[i] = InitNetClient("127.0.0.1", server.port);
+        clients[i].loss = PACKET_LOSS;
+    }
+
+    double *tickTimes = malloc(TICKS * sizeof(double));
+    NetServerStats start = { 0 };
+    long long snapshotBytes = 0, fullBytes = 0;
+    long sampled = 0;
+    int decodeMismatches = 0, decodeChecks = 0;
+    NetPacket full;
+    for(int tick = 0; tick < WARMUP_TICKS + TICKS; tick++) {
+        double now = tick * NET_TICK_DT;
+        if(tick == WARMUP_TICKS) {
+            start = server.stats;
+            for(int i = 0; i < numClients; i++) clients[i].stats = (NetClientStats){ 0 };
+        }
+        for(int i = 0; i < numClients; i++) {
+            if(clients[i].connected) SendNetCommand(&clients[i], &players[i], BotCommand(&bots[i], &players[i], (float)now), level->colliders, broadphase);
+            if(i % PUMP_EVERY == PUMP_EVERY - 1) NetServerReceive(&server, now);
+        }
+        double t0 = Now();
+        NetServerTick(&server, now, level->numColliders, level->colliders, broadphase);
+        double t1 = Now();
+        for(int i = 0; i < numClients; i++) PumpNetClient(&clients[i], &players[i], now, level->colliders, broadphase);
+        if(tick < WARMUP_TICKS) continue;
+        tickTimes[tick - WARMUP_TICKS] = t1 - t0;
+        if(server.tick % NET_SNAPSHOT_TICKS != 0) continue;
+
+        // what went out against what the same snapshots would have cost without a baseline
+        for(int k = 0; k < server.numActive; k += 4) {
+            NetServerClient *client = &server.clients[server.active[k]];
+            WriteNetSnapshot(&full, NetSnapshotSlot(client->sent, server.tick), NULL);
+            snapshotBytes += client->packet.size;
+            fullBytes += full.size;
+            sampled++;
+        }
+        // every client has to end up with exactly what the server put in its newest snapshot
+        for(int i = 0; i < numClients; i++) {
+            const NetSnapshot *received = NetClientSnapshot(&clients[i]);
+            if(received == NULL) continue;
+            const NetSnapshot *sent = NetSnapshotSlot(server.clients[clients[i].id - 1].sent, received->sequence);
+            if(sent->sequence != received->sequence) continue; // already overwritten
+            decodeChecks++;
+            if(!SameSnapshot(sent, received)) decodeMismatches++;
+        }
+    }
+
+    int connected = 0;
+    NetClientStats total = { 0 };
+    for(int i = 0; i < numClients; i++) {
+        if(clients[i].connected) connected++;
+        total.snapshots += clients[i].stats.snapshots;
+        total.staleSnapshots += clients[i].stats.staleSnapshots;
+        total.checked += clients[i].stats.checked;
+        total.corrections += clients[i].stats.corrections;
+        if(clients[i].stats.maxError > total.maxError) total.maxError = clients[i].stats.maxError;
+    }
+    double seconds = TICKS * NET_TICK_DT, tickSum = 0.0;
+    for(int t = 0; t < TICKS; t++) tickSum += tickTimes[t];
+    qsort(tickTimes, TICKS, sizeof(double), CompareDoubles);
+    long packetsOut = server.stats.packetsSent - start.packetsSent, packetsIn = server.stats.packetsReceived - start.packetsReceived;
+    long snapshots = server.stats.snapshots - start.snapshots;
+    printf("net clients=%d ticks=%d tick_us=%.1f p99_tick_us=%.1f max_tick_us=%.1f server_load=%.3f down_kbps_per_client=%.2f up_kbps_per_client=%.2f\n",
+           numClients, TICKS, tickSum * 1e6 / TICKS, tickTimes[TICKS * 99 / 100] * 1e6, tickTimes[TICKS - 1] * 1e6, tickSum / seconds,
+           (server.stats.bytesSent - start.bytesSent + (double)UDP_HEADER * packetsOut) * 8e-3 / seconds / numClients,
+           (server.stats.bytesReceived - start.bytesReceived + (double)UDP_HEADER * packetsIn) * 8e-3 / seconds / numClients);
+    printf("net clients=%d snapshot_bytes=%.1f full_snapshot_bytes=%.1f delta_share=%.3f commands_per_client_tick=%.3f loss=%.2f\n",
+           numClients, (double)snapshotBytes / (sampled > 0 ? sampled : 1), (double)fullBytes / (sampled > 0 ? sampled : 1),
+           snapshots > 0 ? (double)(server.stats.deltaSnapshots - start.deltaSnapshots) / snapshots : 0.0,
+           (double)(server.stats.commands - start.commands) / ((double)TICKS * numClients), PACKET_LOSS);
+    printf("net clients=%d check connected=%d decode_checks=%d decode_mismatches=%d predictions_checked=%ld corrections=%ld max_error=%.4f stale_snapshots=%ld\n",
+           numClients, connected, decodeChecks, decodeMismatches, total.checked, total.corrections, total.maxError, total.staleSnapshots);
+
+    for(int i = 0; i < numClients; i++) {
+        UnloadNetClient(&clients[i]);
+        UnloadPlayerPhysics(&players[i]);
+    }
+    UnloadNetServer(&server);
+    free(clients);
+    free(players);
+    free(bots);
+    free(tickTimes);
+    return connected == numClients && decodeMismatches == 0;
+}
+
+int main(void) {
+    ColliderStore store = InitColliderStore();
+    Broadphase broadphase = InitBroadphase(BROADPHASE_CELL_SIZE, 16);
+    LevelFile level = SetupSceneColliders(&store, &broadphase);
+    if(level.numColliders < 0) {
+        fprintf(stderr, "net_bench: cant load %s, run make level\n", SCENE_LEVEL_PATH);
+        return 1;
+    }
+    JobSystem jobs;
+    InitJobSystem(&jobs, 0);
+    bool ok = true;
+    for(int numClients = 64; numClients <= 512; numClients *= 2)
+        if(!RunLoad(numClients, &level, &broadphase, &jobs)) ok = false;
+    printf("net op=check workers=%d ok=%d\n", jobs.numWorkers, ok);
+
+    UnloadJobSystem(&jobs);
+    UnloadBroadphase(&broadphase);
+    UnloadLevelFile(&level);
+    UnloadColliderStore(&store);
+    return ok ? 0 : 1;
+}
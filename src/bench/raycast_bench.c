@@ -0,0 +1,237 @@
+// Headless benchmark for scenequery.h, rays per second through the test meshes placed all over a field, one ray at a
+// time and in packets, against testing every triangle. colliders swept trough it against casting at every triangle.
+// build: make bench, run: make run-bench. exits with 1 if the BVH or the packets disagree with the brute force answer
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../obj.h"
+#include "../scenequery.h"
+
+#define FIELD_SIDE 32 // instances per side of the field
+#define FIELD_SPACING 4.0f
+#define NUM_RAYS (1 << 18)
+#define BRUTE_RAYS 2048 // brute force is thousands of times slower, only a slice of the rays gets checked
+#define RAY_LENGTH 500.0f
+#define CAMERA_SIDE 512 // camera rays are CAMERA_SIDE * CAMERA_SIDE pixels
+#define NUM_SWEEPS 8192
+#define BRUTE_SWEEPS 64
+
+static const char *meshPaths[] = {
+    "../assets/models/cube.obj", "../assets/models/cylinder.obj", "../assets/models/sphere.obj", "../assets/models/Ramp.obj"
+};
+#define NUM_MESHES (int)(sizeof(meshPaths) / sizeof(meshPaths[0]))
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same field and rays
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// every triangle of every instance, what the BVH answer gets checked against
+static SceneRayHit BruteForceRaycast(const SceneQuery *scene, Ray ray, float maxDistance) {
+    SceneTrace trace = { maxDistance, -1, -1 };
+    for(int i = 0; i < scene->numInstances; i++) {
+        const SceneInstance *instance = &scene->instances[i];
+        Vector3 o = Vector3Transform(ray.position, instance->inverse), d = SceneToLocalDirection(instance->inverse, ray.direction);
+        for(int t = 0; t < instance->mesh->numTriangles; t++) {
+            float dist;
+            if(RayTriangle(&instance->mesh->triangles[t], o, d, trace.distance, &dist)) {
+                trace.distance = dist;
+                trace.instance = i;
+                trace.triangle = t;
+            }
+        }
+    }
+    return SceneTraceHit(scene, ray, &trace);
+}
+
+// same hit, or the same distance when two triangles meet right where the ray goes trough
+static bool SameHit(SceneRayHit a, SceneRayHit b) {
+    if(a.hit != b.hit) return false;
+    if(!a.hit) return true;
+    return fabsf(a.distance - b.distance) <= 1e-4f * (1.0f + a.distance);
+}
+
+// every triangle of every instance cast against, what SweepColliderScene gets checked against
+static SceneSweepHit BruteForceSweep(const SceneQuery *scene, Collider *collider, Vector3 motion) {
+    SceneSweepHit best = { false, 1.0f, { 0, 0, 0 }, -1 };
+    for(int i = 0; i < scene->numInstances; i++) {
+        const SceneInstance *instance = &scene->instances[i];
+        for(int t = 0; t < instance->mesh->numTriangles; t++) {
+            const BvhTriangle *tri = &instance->mesh->triangles[t];
+            SceneSweepTriangle world = { {
+                Vector3Transform(tri->v0, instance->transform), Vector3Transform(Vector3Add(tri->v0, tri->e1), instance->transform),
+                Vector3Transform(Vector3Add(tri->v0, tri->e2), instance->transform)
+            } };
+            SupportShape shape = { &world, SceneTriangleSupport, world.points[0] };
+            float toi;
+            Vector3 normal;
+            if(CastColliderShape(collider, motion, &shape, 0.0f, &toi, &normal, NULL) && (!best.hit || toi < best.toi))
+                best = (SceneSweepHit){ true, toi, normal, instance->id };
+        }
+    }
+    return best;
+}
+
+// a pinhole camera above the field looking down at it at an angle, rays go out in 4x2 pixel tiles so every packet is a
+// little block of the image
+static void CameraRays(Ray *rays) {
+    Vector3 eye = { -20.0f, 30.0f, -20.0f };
+    Vector3 target = { FIELD_SIDE * FIELD_SPACING * 0.5f, 0.0f, FIELD_SIDE * FIELD_SPACING * 0.5f };
+    Vector3 forward = Vector3Normalize(Vector3Subtract(target, eye));
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, (Vector3){ 0.0f, 1.0f, 0.0f }));
+    Vector3 up = Vector3CrossProduct(right, forward);
+    int n = 0;
+    for(int ty = 0; ty < CAMERA_SIDE; ty += 2)
+        for(int tx = 0; tx < CAMERA_SIDE; tx += 4)
+            for(int y = ty; y < ty + 2; y++)
+                for(int x = tx; x < tx + 4; x++) {
+                    float u = (x + 0.5f) / CAMERA_SIDE * 2.0f - 1.0f, v = (y + 0.5f) / CAMERA_SIDE * 2.0f - 1.0f;
+                    Vector3 d = Vector3Add(forward, Vector3Add(Vector3Scale(right, u * 0.6f), Vector3Scale(up, v * 0.6f)));
+                    rays[n++] = (Ray){ eye, Vector3Normalize(d) };
+                }
+}
+
+// rays from anywhere in the field going anywhere, nothing for a packet to share
+static void RandomRays(Ray *rays) {
+    float side = FIELD_SIDE * FIELD_SPACING;
+    for(int i = 0; i < NUM_RAYS; i++) {
+        Vector3 o = { RandomFloat(-4.0f, side + 4.0f), RandomFloat(0.0f, 6.0f), RandomFloat(-4.0f, side + 4.0f) };
+        Vector3 d = { RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f) };
+        if(Vector3LengthSqr(d) < 1e-4f) d.y = -1.0f;
+        rays[i] = (Ray){ o, Vector3Normalize(d) };
+    }
+}
+
+static void RunRays(const SceneQuery *scene, const char *name, const Ray *rays, SceneRayHit *single, SceneRayHit *packet, bool *ok) {
+    double t0 = Now();
+    for(int i = 0; i < NUM_RAYS; i++) single[i] = RaycastScene(scene, rays[i], RAY_LENGTH);
+    double singleTime = Now() - t0;
+    t0 = Now();
+    RaycastSceneRays(scene, rays, NUM_RAYS, RAY_LENGTH, packet);
+    double packetTime = Now() - t0;
+
+    int hits = 0, packetMismatch = 0;
+    for(int i = 0; i < NUM_RAYS; i++) {
+        if(single[i].hit) hits++;
+        if(!SameHit(single[i], packet[i])) packetMismatch++;
+    }
+    int bruteMismatch = 0, step = NUM_RAYS / BRUTE_RAYS;
+    t0 = Now();
+    for(int i = 0; i < NUM_RAYS; i += step)
+        if(!SameHit(single[i], BruteForceRaycast(scene, rays[i], RAY_LENGTH))) bruteMismatch++;
+    double bruteTime = Now() - t0;
+
+    printf("raycast rays=%s count=%d hit_rate=%.3f single_mrays_per_sec=%.2f packet_mrays_per_sec=%.2f brute_mrays_per_sec=%.4f packet_width=%d\n",
+           name, NUM_RAYS, (double)hits / NUM_RAYS, NUM_RAYS / singleTime * 1e-6, NUM_RAYS / packetTime * 1e-6,
+           BRUTE_RAYS / bruteTime * 1e-6, SCENE_PACKET_WIDTH);
+    printf("raycast rays=%s check brute_mismatches=%d packet_mismatches=%d\n", name, bruteMismatch, packetMismatch);
+    if(bruteMismatch > 0 || packetMismatch > 0) *ok = false;
+}
+
+// spheres, capsules and boxes moving a few meters trough the field in any direction, what a character or a thrown
+// thing would ask. every BRUTE_SWEEPS-th gets checked against casting at every triangle
+static void RunSweeps(const SceneQuery *scene, bool *ok) {
+    float side = FIELD_SIDE * FIELD_SPACING;
+    Collider colliders[3];
+    SetupColliderSphere(&colliders[0], (Vector3){ 0, 0, 0 }, 0.4f);
+    SetupColliderCapsule(&colliders[1], (Vector3){ 0, 0, 0 }, 0.3f, 0.6f);
+    SetupColliderBox(&colliders[2], (Vector3){ 0, 0, 0 }, (Vector3){ 0.3f, 0.5f, 0.3f });
+    Vector3 *starts = malloc(NUM_SWEEPS * sizeof(Vector3)), *motions = malloc(NUM_SWEEPS * sizeof(Vector3));
+    SceneSweepHit *hits = malloc(NUM_SWEEPS * sizeof(SceneSweepHit));
+    for(int i = 0; i < NUM_SWEEPS; i++) {
+        starts[i] = (Vector3){ RandomFloat(-4.0f, side + 4.0f), RandomFloat(0.0f, 6.0f), RandomFloat(-4.0f, side + 4.0f) };
+        motions[i] = (Vector3){ RandomFloat(-4.0f, 4.0f), RandomFloat(-4.0f, 4.0f), RandomFloat(-4.0f, 4.0f) };
+    }
+    double t0 = Now();
+    for(int i = 0; i < NUM_SWEEPS; i++) {
+        Collider *c = &colliders[i % 3];
+        SetColliderTransform(c, MatrixTranslate(starts[i].x, starts[i].y, starts[i].z));
+        hits[i] = SweepColliderScene(scene, c, motions[i]);
+    }
+    double sweepTime = Now() - t0;
+
+    int numHits = 0, bruteMismatch = 0, step = NUM_SWEEPS / BRUTE_SWEEPS;
+    for(int i = 0; i < NUM_SWEEPS; i++) if(hits[i].hit) numHits++;
+    t0 = Now();
+    for(int i = 0; i < NUM_SWEEPS; i += step) {
+        Collider *c = &colliders[i % 3];
+        SetColliderTransform(c, MatrixTranslate(starts[i].x, starts[i].y, starts[i].z));
+        SceneSweepHit brute = BruteForceSweep(scene, c, motions[i]);
+        if(brute.hit != hits[i].hit || (brute.hit && fabsf(brute.toi - hits[i].toi) > 1e-3f)) bruteMismatch++;
+    }
+    double bruteTime = Now() - t0;
+    printf("raycast op=sweep count=%d hit_rate=%.3f sweeps_per_sec=%.0f brute_sweeps_per_sec=%.1f\n",
+           NUM_SWEEPS, (double)numHits / NUM_SWEEPS, NUM_SWEEPS / sweepTime, BRUTE_SWEEPS / bruteTime);
+    printf("raycast op=sweep check brute_mismatches=%d\n", bruteMismatch);
+    if(bruteMismatch > 0) *ok = false;
+    free(starts);
+    free(motions);
+    free(hits);
+}
+
+int main(void) {
+    MeshBvh meshes[NUM_MESHES];
+    for(int m = 0; m < NUM_MESHES; m++) {
+        Mesh mesh = LoadObjMeshData(meshPaths[m]);
+        double t0 = Now();
+        meshes[m] = BuildMeshBvh(mesh);
+        double buildTime = Now() - t0;
+        int leaves = 0;
+        for(int i = 0; i < meshes[m].numNodes; i++) if(meshes[m].nodes[i].count > 0) leaves++;
+        printf("raycast op=build_mesh mesh=%s triangles=%d nodes=%d leaves=%d build_us=%.1f\n",
+               strrchr(meshPaths[m], '/') + 1, meshes[m].numTriangles, meshes[m].numNodes, leaves, buildTime * 1e6);
+        UnloadObjMeshData(mesh);
+    }
+
+    // a field of randomly picked, turned and scaled meshes, a few of them floating
+    SceneQuery scene = InitSceneQuery(FIELD_SIDE * FIELD_SIDE);
+    for(int z = 0; z < FIELD_SIDE; z++)
+        for(int x = 0; x < FIELD_SIDE; x++) {
+            int m = (int)RandomFloat(0.0f, NUM_MESHES - 0.001f);
+            float scale = RandomFloat(0.5f, 1.8f);
+            Matrix transform = MatrixMultiply(MatrixMultiply(MatrixScale(scale, scale, scale), MatrixRotateY(RandomFloat(0.0f, 2.0f * PI))),
+                                              MatrixTranslate(x * FIELD_SPACING, RandomFloat(0.0f, 1.0f) < 0.2f ? RandomFloat(1.0f, 4.0f) : 0.0f, z * FIELD_SPACING));
+            AddSceneInstance(&scene, &meshes[m], transform, z * FIELD_SIDE + x);
+        }
+    double t0 = Now();
+    BuildSceneQuery(&scene);
+    printf("raycast op=build_scene instances=%d nodes=%d build_us=%.1f\n", scene.numInstances, scene.numNodes, (Now() - t0) * 1e6);
+
+    Ray *rays = malloc(NUM_RAYS * sizeof(Ray));
+    SceneRayHit *single = malloc(NUM_RAYS * sizeof(SceneRayHit)), *packet = malloc(NUM_RAYS * sizeof(SceneRayHit));
+    bool ok = true;
+    CameraRays(rays);
+    RunRays(&scene, "camera", rays, single, packet, &ok);
+    RandomRays(rays);
+    RunRays(&scene, "random", rays, single, packet, &ok);
+
+    // line of sight between random points has to agree with a closest hit query
+    int losMismatch = 0;
+    for(int i = 0; i < 4096; i++) {
+        Vector3 from = rays[i].position, to = rays[i + 4096].position;
+        Vector3 d = Vector3Subtract(to, from);
+        float length = Vector3Length(d);
+        SceneRayHit hit = RaycastScene(&scene, (Ray){ from, Vector3Scale(d, 1.0f / length) }, length - SCENE_RAY_EPSILON);
+        if(SceneLineOfSight(&scene, from, to) == hit.hit) losMismatch++;
+    }
+    printf("raycast op=line_of_sight checks=4096 mismatches=%d\n", losMismatch);
+    if(losMismatch > 0) ok = false;
+    RunSweeps(&scene, &ok);
+    printf("raycast op=check ok=%d\n", ok);
+
+    free(rays);
+    free(single);
+    free(packet);
+    UnloadSceneQuery(&scene);
+    for(int m = 0; m < NUM_MESHES; m++) UnloadMeshBvh(&meshes[m]);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+// Headless benchmark for renderlist.h, what culling, sorting and batching a big field of objects costs per frame and how
+// many draw calls are left of it. no GPU, the meshes and materials are only there to be told apart.
+// build: make bench, run: make run-bench. exits with 1 if the SIMD cull or the batches disagree with the plain versions
+// or a batch mixes meshes once there are more of them than slots
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../renderlist.h"
+
+#define NUM_OBJECTS 32768
+#define NUM_MESHES 8
+#define NUM_MATERIALS 4 // the first two have an instancing shader
+#define FIELD_HALF 200.0f
+#define FRAMES 240
+#define TARGET_ASPECT (640.0f / 480.0f) // the low res target the game renders into
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same field
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    int mesh, material;
+    Matrix transform;
+} Object;
+
+// the game camera walking around the field and turning, looking a bit down
+static Camera FrameCamera(int frame) {
+    float t = (float)frame / FRAMES * 2.0f * PI;
+    Camera camera = { 0 };
+    camera.position = (Vector3){ sinf(t) * FIELD_HALF * 0.5f, 6.0f, cosf(t) * FIELD_HALF * 0.5f };
+    float yaw = t * 3.0f;
+    camera.target = Vector3Add(camera.position, (Vector3){ sinf(yaw), -0.2f, cosf(yaw) });
+    camera.up = (Vector3){ 0.0f, 1.0f, 0.0f };
+    camera.fovy = 100.0f;
+    camera.projection = CAMERA_PERSPECTIVE;
+    return camera;
+}
+
+// one box at a time against the planes, what the SIMD cull has to agree with
+static int CullReference(const Frustum *f, const RenderList *list, int *visible) {
+    int n = 0;
+    for(int i = 0; i < list->numItems; i++) {
+        bool out = false;
+        for(int k = 0; k < 6 && !out; k++) {
+            const FrustumPlane *p = &f->planes[k];
+            float dist = list->centerX[i] * p->normal.x + list->centerY[i] * p->normal.y + list->centerZ[i] * p->normal.z + p->distance;
+            float radius = list->extentX[i] * fabsf(p->normal.x) + list->extentY[i] * fabsf(p->normal.y) + list->extentZ[i] * fabsf(p->normal.z);
+            out = dist + radius < 0.0f;
+        }
+        if(!out) visible[n++] = i;
+    }
+    return n;
+}
+
+static int CompareKeys(const void *x, const void *y) {
+    uint64_t a = *(const uint64_t *)x, b = *(const uint64_t *)y;
+    return a < b ? -1 : a > b;
+}
+
+// the batches cover the visible items in one piece each and every item in a batch has its mesh and material
+static int CheckBatches(const RenderList *list, int numVisible) {
+    int mismatches = 0, covered = 0;
+    for(int b = 0; b < list->numBatches; b++) {
+        const RenderBatch *batch = &list->batches[b];
+        if(batch->first != covered) mismatches++;
+        covered += batch->count;
+        for(int i = batch->first; i < batch->first + batch->count; i++) {
+            const RenderItem *item = &list->items[list->keys[i] & 0xFFFFFFFFu];
+            if(item->mesh != batch->mesh || item->material != batch->material) { mismatches++; break; }
+        }
+    }
+    if(covered != numVisible) mismatches++;
+    return mismatches;
+}
+
+int main(void) {
+    Mesh meshes[NUM_MESHES] = { 0 };
+    BoundingBox bounds[NUM_MESHES];
+    for(int m = 0; m < NUM_MESHES; m++) {
+        float size = 0.5f + m * 0.25f;
+        bounds[m] = (BoundingBox){ { -size, 0.0f, -size }, { size, size * 2.0f, size } };
+    }
+    Material materials[NUM_MATERIALS] = { 0 };
+    for(int m = 0; m < NUM_MATERIALS; m++) materials[m].shader.id = 3 + m;
+
+    Object *objects = malloc(NUM_OBJECTS * sizeof(Object));
+    for(int i = 0; i < NUM_OBJECTS; i++) {
+        float scale = RandomFloat(0.5f, 2.0f);
+        objects[i].mesh = (int)RandomFloat(0.0f, NUM_MESHES - 0.001f);
+        objects[i].material = (int)RandomFloat(0.0f, NUM_MATERIALS - 0.001f);
+        objects[i].transform = MatrixMultiply(MatrixMultiply(MatrixScale(scale, scale, scale), MatrixRotateY(RandomFloat(0.0f, 2.0f * PI))),
+                                              MatrixTranslate(RandomFloat(-FIELD_HALF, FIELD_HALF), RandomFloat(0.0f, 2.0f), RandomFloat(-FIELD_HALF, FIELD_HALF)));
+    }
+
+    RenderList list = InitRenderList();
+    AllowRenderInstancing(&list, materials[0].shader);
+    AllowRenderInstancing(&list, materials[1].shader);
+    int *reference = malloc(NUM_OBJECTS * sizeof(int));
+    uint64_t *sorted = malloc(NUM_OBJECTS * sizeof(uint64_t));
+    double addTime = 0.0, cullTime = 0.0, sortTime = 0.0, referenceTime = 0.0, qsortTime = 0.0;
+    long visible = 0, culled = 0, batches = 0, drawCalls = 0;
+    int cullMismatch = 0, sortMismatch = 0;
+    for(int frame = -16; frame < FRAMES; frame++) { // the first frames warm up and grow the list
+        Camera camera = FrameCamera(frame < 0 ? 0 : frame);
+        Frustum frustum = CameraFrustum(camera, TARGET_ASPECT);
+        double t0 = Now();
+        BeginRenderList(&list);
+        for(int i = 0; i < NUM_OBJECTS; i++)
+            AddRenderItem(&list, &meshes[objects[i].mesh], &materials[objects[i].material], objects[i].transform, bounds[objects[i].mesh]);
+        double t1 = Now();
+        int numVisible = CullRenderList(&list, &frustum);
+        double t2 = Now();
+        // keys before the sort, for checking it against qsort
+        memcpy(sorted, list.keys, numVisible * sizeof(uint64_t));
+        double t3 = Now();
+        SortRenderList(&list);
+        double t4 = Now();
+        int numReference = CullReference(&frustum, &list, reference);
+        double t5 = Now();
+        // both culls keep the item order, the copied keys still are in it
+        if(numReference != numVisible) cullMismatch++;
+        else for(int v = 0; v < numVisible; v++) if((int)(sorted[v] & 0xFFFFFFFFu) != reference[v]) { cullMismatch++; break; }
+        double t6 = Now();
+        qsort(sorted, numVisible, sizeof(uint64_t), CompareKeys);
+        double t7 = Now();
+        if(frame < 0) continue;
+
+        addTime += t1 - t0;
+        cullTime += t2 - t1;
+        sortTime += t4 - t3;
+        referenceTime += t5 - t4;
+        qsortTime += t7 - t6;
+        visible += numVisible;
+        culled += list.stats.culled;
+        batches += list.stats.batches;
+        drawCalls += list.stats.drawCalls;
+
+        // every visible item exactly once, in key order, and the batches cover them in one piece each
+        for(int v = 0; v < numVisible; v++) if(list.keys[v] != sorted[v]) { sortMismatch++; break; }
+        sortMismatch += CheckBatches(&list, numVisible);
+    }
+
+    // more meshes than a frame has slots, the ones past the limit share a key and still may not end up in one batch
+    int slotMismatch = 0;
+    Mesh *manyMeshes = calloc(RENDER_MAX_SLOTS + 64, sizeof(Mesh));
+    Camera camera = FrameCamera(0);
+    Frustum frustum = CameraFrustum(camera, TARGET_ASPECT);
+    Vector3 ahead = Vector3Add(camera.position, Vector3Scale(Vector3Normalize(Vector3Subtract(camera.target, camera.position)), 10.0f));
+    BeginRenderList(&list);
+    for(int i = 0; i < 2 * (RENDER_MAX_SLOTS + 64); i++)
+        AddRenderItem(&list, &manyMeshes[i % (RENDER_MAX_SLOTS + 64)], &materials[2], MatrixTranslate(ahead.x, ahead.y, ahead.z), bounds[0]);
+    int numVisible = CullRenderList(&list, &frustum);
+    SortRenderList(&list);
+    if(numVisible != list.numItems || list.numBatches < RENDER_MAX_SLOTS + 64) slotMismatch++;
+    slotMismatch += CheckBatches(&list, numVisible);
+    free(manyMeshes);
+    printf("render op=add objects=%d ns_per_object=%.2f\n", NUM_OBJECTS, addTime * 1e9 / ((double)FRAMES * NUM_OBJECTS));
+    printf("render op=cull objects=%d simd_width=%d ns_per_object=%.2f reference_ns_per_object=%.2f visible_per_frame=%.0f culled_per_frame=%.0f\n",
+           NUM_OBJECTS, RENDER_SIMD_WIDTH, cullTime * 1e9 / ((double)FRAMES * NUM_OBJECTS), referenceTime * 1e9 / ((double)FRAMES * NUM_OBJECTS),
+           (double)visible / FRAMES, (double)culled / FRAMES);
+    printf("render op=sort ns_per_visible=%.2f qsort_ns_per_visible=%.2f\n", sortTime * 1e9 / visible, qsortTime * 1e9 / visible);
+    printf("render op=frame us_per_frame=%.1f draws_before=%.0f batches=%.0f draw_calls=%.0f\n",
+           (addTime + cullTime + sortTime) * 1e6 / FRAMES, (double)visible / FRAMES, (double)batches / FRAMES, (double)drawCalls / FRAMES);
+    bool ok = cullMismatch == 0 && sortMismatch == 0 && slotMismatch == 0;
+    printf("render op=check cull_mismatches=%d sort_mismatches=%d slot_mismatches=%d ok=%d\n", cullMismatch, sortMismatch, slotMismatch, ok);
+
+    free(objects);
+    free(reference);
+    free(sorted);
+    UnloadRenderList(&list);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// Headless replayer for input recordings, runs the controller and collision code as fast as it can
+// build: make bench, record: ./game -record session.rec, play: ./bench/replay session.rec [runs]
+// every run prints one key=value line with a hash of the player state after each frame, the hashes of
+// all runs have to match or it exits with 1. run it from src/ after make level so the cooked scene is found
+// ./bench/replay -synth out.rec seconds writes a scripted session instead, for soak tests without a recording
+// built with make PROFILE=1, ./bench/replay session.rec runs trace.json saves the zones and counters of the last frames
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../collisions.h"
+#include "../player.h"
+#include "../scene.h"
+#include "../replay.h"
+
+#define BROADPHASE_CELL_SIZE 4.0f // same as the game
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// FNV-1a over the bytes, any difference in the float bits shows up
+static unsigned long long HashBytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for(size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) {
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+// fresh colliders for every run so they all start from the same state
+static LevelFile LoadReplayScene(ColliderStore *store, Broadphase *broadphase) {
+    LevelFile level = SetupSceneColliders(store, broadphase);
+    if(level.numColliders < 0) {
+        fprintf(stderr, "replay: cant load %s, run make level\n", SCENE_LEVEL_PATH);
+        exit(1);
+    }
+    return level;
+}
+
+// wandering player, keys change every half second or so, frame times jitter around 60 fps with the odd hitch.
+// the player gets simulated while writing so the mouse can steer it back before it walks off the level
+static int WriteSyntheticRecording(const char *path, float seconds) {
+    ColliderStore store = InitColliderStore();
+    Broadphase broadphase = InitBroadphase(BROADPHASE_CELL_SIZE, 16);
+    LevelFile level = LoadReplayScene(&store, &broadphase);
+    Player player = { 0 };
+    Collider capsule;
+    SetupColliderCapsule(&capsule, (Vector3){ 0.0f, -1.0f, 0.0f }, 0.4f, 0.6f);
+    SetupPlayerPhysics(&player, (Vector3){ 0.0f, 6.0f, 0.0f }, capsule);
+    InputRecording rec = StartInputRecording(path, &player);
+    if(rec.file == NULL) {
+        fprintf(stderr, "replay: cant write %s\n", path);
+        return 1;
+    }
+    PlayerInput input = { 0 };
+    float time = 0.0f, nextChange = 0.0f, wander = 0.0f;
+    while(time < seconds) {
+        input.frameTime = RandomFloat(0.0f, 1.0f) < 0.01f ? RandomFloat(0.05f, 0.2f) : RandomFloat(0.014f, 0.019f);
+        if(time >= nextChange) {
+            input.keys = PLAYER_KEY_FORWARD | ((unsigned int)RandomFloat(0.0f, 32.0f) & (PLAYER_KEY_LEFT | PLAYER_KEY_RIGHT | PLAYER_KEY_SPRINT));
+            if(RandomFloat(0.0f, 1.0f) < 0.2f) input.keys |= PLAYER_KEY_CROUCH;
+            wander = RandomFloat(-6.0f, 6.0f);
+            nextChange = time + RandomFloat(0.2f, 0.8f);
+        }
+        // turn towards the middle once outside a few meters, wander otherwise
+        float turn = wander;
+        if(player.position.x * player.position.x + player.position.z * player.position.z > 9.0f) {
+            float error = atan2f(-player.position.x, -player.position.z) - player.yaw;
+            error = atan2f(sinf(error), cosf(error));
+            turn = Clamp(-error / PLAYER_LOOK_SENSITIVITY, -20.0f, 20.0f);
+        }
+        input.mouseDelta = (Vector2){ turn, RandomFloat(-2.0f, 2.0f) };
+        input.pressed = RandomFloat(0.0f, 1.0f) < 0.02f ? PLAYER_PRESS_JUMP : 0;
+        RecordInput(&rec, input);
+        UpdatePlayer(&player, input, level.colliders, &broadphase);
+        time += input.frameTime;
+    }
+    printf("replay op=synth frames=%ld seconds=%.1f file=%s final_y=%.3f\n", rec.frames, time, path, player.position.y);
+    StopInputRecording(&rec);
+    UnloadPlayerPhysics(&player);
+    UnloadBroadphase(&broadphase);
+    UnloadLevelFile(&level);
+    UnloadColliderStore(&store);
+    return 0;
+}
+
+static unsigned long long RunReplay(const InputReplay *replay) {
+    ColliderStore store = InitColliderStore();
+    Broadphase broadphase = InitBroadphase(BROADPHASE_CELL_SIZE, 16);
+    LevelFile level = LoadReplayScene(&store, &broadphase);
+    Player player;
+    SetupReplayPlayer(&player, replay);
+
+    unsigned long long hash = 14695981039346656037ull;
+    double simTime = 0.0;
+    double t0 = Now();
+    for(int i = 0; i < replay->numFrames; i++) {
+        UpdatePlayer(&player, replay->frames[i], level.colliders, &broadphase);
+        PROFILE_FRAME();
+        hash = HashBytes(hash, &player.position, sizeof(player.position));
+        hash = HashBytes(hash, &player.velocity, sizeof(player.velocity));
+        simTime += replay->frames[i].frameTime;
+    }
+    double wall = Now() - t0;
+    printf("replay op=run frames=%d sim_seconds=%.1f wall_ms=%.1f speedup=%.0f ns_per_frame=%.1f hash=%016llx final_x=%.6f final_y=%.6f final_z=%.6f\n",
+           replay->numFrames, simTime, wall * 1e3, simTime / wall, wall * 1e9 / (replay->numFrames > 0 ? replay->numFrames : 1),
+           hash, player.position.x, player.position.y, player.position.z);
+
+    UnloadBroadphase(&broadphase);
+    UnloadLevelFile(&level);
+    UnloadColliderStore(&store);
+    UnloadPlayerPhysics(&player);
+    return hash;
+}
+
+int main(int argc, char **argv) {
+    bool synth = argc > 3 && strcmp(argv[1], "-synth") == 0;
+    if(argc < 2) {
+        fprintf(stderr, "usage: replay <recording> [runs] [trace.json]\n       replay -synth <recording> <seconds>\n");
+        return 1;
+    }
+    if(synth) return WriteSyntheticRecording(argv[2], (float)atof(argv[3]));
+
+    int runs = argc > 2 ? atoi(argv[2]) : 2;
+    InputReplay replay = LoadInputReplay(argv[1]);
+    if(replay.numFrames < 0) {
+        fprintf(stderr, "replay: %s is not a recording\n", argv[1]);
+        return 1;
+    }
+
+    unsigned long long first = 0;
+    bool deterministic = true;
+    for(int r = 0; r < runs; r++) {
+        unsigned long long hash = RunReplay(&replay);
+        if(r == 0) first = hash;
+        else if(hash != first) deterministic = false;
+    }
+    printf("replay op=check runs=%d deterministic=%d\n", runs, deterministic);
+    if(argc > 3) {
+#ifdef PROFILER
+        const ProfileFrame *last = ProfileGetFrame(0);
+        for(int c = 0; last != NULL && c < profiler.numCounters; c++)
+            printf("replay op=profile counter=%s last_frame=%lld total=%lld\n", profiler.counterNames[c], (long long)last->counters[c], (long long)profiler.counterTotals[c]);
+        if(!ProfilerWriteTrace(argv[3])) fprintf(stderr, "replay: cant write %s\n", argv[3]);
+#else
+        fprintf(stderr, "replay: built without the profiler, make PROFILE=1 for %s\n", argv[3]);
+#endif
+    }
+
+    UnloadInputReplay(&replay);
+    return deterministic ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// Headless benchmark for rigidbody.h, 1k to 10k crates and balls on a floor: half stand in stacks, the rest gets
+// dropped into piles. reports the step time while things move and once everything settled, how many bodies are
+// awake, the islands and the contacts. build: make bench, run: make run-bench. exits with 1 if a body falls trough
+// the floor, a stack tips over, something is still awake at the end or two worker counts end differently
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../collisions.h"
+#include "../jobs.h"
+#include "../rigidbody.h"
+
+#define STEP_DT (1.0f / 60.0f)
+#define STEPS 720 // 12 seconds, the big piles need almost 10 to settle
+#define RESTING_STEPS 60 // timed at the end, when all of it should be asleep
+#define STACK_HEIGHT 6
+#define PILE_SIZE 32
+#define SPACING 3.0f // between stacks and piles
+#define PILE_GAP 4 // empty rows between the stacks and the piles, so the balls rolling off a pile dont run into a stack
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same piles
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static unsigned long long HashBytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for(size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+typedef struct {
+    int *tops; // top crate of every stack
+    Vector3 *topStarts;
+    int numStacks;
+} Scene;
+
+// stacks on the front of a grid, piles behind them, the drop heights and spins come from the LCG
+static Scene SetupBodies(RigidWorld *world, int numBodies) {
+    Scene scene = { 0 };
+    int numStacks = numBodies / 2 / STACK_HEIGHT;
+    int numPiles = (numBodies - numStacks * STACK_HEIGHT + PILE_SIZE - 1) / PILE_SIZE;
+    int side = (int)ceilf(sqrtf((float)(numStacks + numPiles)));
+    scene.tops = malloc(numStacks * sizeof(int));
+    scene.topStarts = malloc(numStacks * sizeof(Vector3));
+    seed = 12345;
+    int placed = 0;
+    for(int cell = 0; placed < numBodies; cell++) {
+        int row = cell / side + (cell < numStacks ? 0 : PILE_GAP);
+        float x = (cell % side - side * 0.5f) * SPACING, z = (row - side * 0.5f) * SPACING;
+        if(cell < numStacks) {
+            for(int k = 0; k < STACK_HEIGHT; k++) {
+                // a little off so the stacks arent perfect
+                Vector3 p = { x + RandomFloat(-0.02f, 0.02f), 0.25f + k * 0.5f, z + RandomFloat(-0.02f, 0.02f) };
+                int body = AddRigidBox(world, p, QuaternionFromAxisAngle((Vector3){ 0, 1, 0 }, RandomFloat(-0.1f, 0.1f)), (Vector3){ 0.25f, 0.25f, 0.25f }, 1.0f);
+                placed++;
+                scene.tops[cell] = body;
+                scene.topStarts[cell] = p;
+            }
+            continue;
+        }
+        for(int k = 0; k < PILE_SIZE && placed < numBodies; k++) {
+            Vector3 p = { x + RandomFloat(-0.5f, 0.5f), 0.5f + k * 0.6f, z + RandomFloat(-0.5f, 0.5f) };
+            if(k % 3 == 2) AddRigidSphere(world, p, RandomFloat(0.15f, 0.25f), 0.5f);
+            else {
+                Quaternion spin = QuaternionFromEuler(RandomFloat(0.0f, PI), RandomFloat(0.0f, PI), RandomFloat(0.0f, PI));
+                AddRigidBox(world, p, spin, (Vector3){ RandomFloat(0.1f, 0.3f), RandomFloat(0.1f, 0.2f), RandomFloat(0.1f, 0.3f) }, 1.0f);
+            }
+            placed++;
+        }
+    }
+    scene.numStacks = numStacks;
+    return scene;
+}
+
+static bool RunScene(int numBodies, int numWorkers, Collider *floor, Broadphase *level, unsigned long long *hashOut) {
+    JobSystem jobs;
+    InitJobSystem(&jobs, numWorkers);
+    RigidWorld world;
+    InitRigidWorld(&world, (Vector3){ 0.0f, -9.81f, 0.0f }, &jobs);
+    Scene scene = SetupBodies(&world, numBodies);
+
+    double movingTime = 0.0, restingTime = 0.0, maxStep = 0.0;
+    int movingSteps = 0, settledStep = -1, maxIslands = 0, largestIsland = 0, maxManifolds = 0, maxPoints = 0;
+    long warmStarted = 0, points = 0;
+    for(int step = 0; step < STEPS; step++) {
+        double t0 = Now();
+        StepRigidWorld(&world, STEP_DT, 1, floor, level);
+        double time = Now() - t0;
+        if(time > maxStep) maxStep = time;
+        if(step >= STEPS - RESTING_STEPS) restingTime += time;
+        else if(world.stats.awake > 0 || step == 0) {
+            movingTime += time;
+            movingSteps++;
+        }
+        if(world.stats.awake == 0 && settledStep < 0) settledStep = step;
+        if(world.stats.awake > 0) settledStep = -1;
+        if(world.stats.islands > maxIslands) maxIslands = world.stats.islands;
+        if(world.stats.largestIsland > largestIsland) largestIsland = world.stats.largestIsland;
+        if(world.stats.manifolds > maxManifolds) maxManifolds = world.stats.manifolds;
+        if(world.stats.points > maxPoints) maxPoints = world.stats.points;
+        warmStarted += world.stats.warmStarted;
+        points += world.stats.points;
+    }
+
+    int fell = 0, tipped = 0;
+    unsigned long long hash = 14695981039346656037ull;
+    for(int i = 0; i < world.numBodies; i++) {
+        const RigidBody *body = &world.bodies[i];
+        if(body->position.y < -0.1f) fell++;
+        hash = HashBytes(hash, &body->position, sizeof(Vector3));
+        hash = HashBytes(hash, &body->orientation, sizeof(Quaternion));
+    }
+    for(int s = 0; s < scene.numStacks; s++) {
+        Vector3 p = world.bodies[scene.tops[s]].position, start = scene.topStarts[s];
+        if(fabsf(p.x - start.x) > 0.1f || fabsf(p.z - start.z) > 0.1f || p.y < start.y - 0.1f) tipped++;
+    }
+    *hashOut = hash;
+    bool ok = fell == 0 && tipped == 0 && world.stats.awake == 0;
+    printf("rigid bodies=%d workers=%d steps=%d moving_steps=%d moving_step_us=%.1f max_step_us=%.1f resting_step_us=%.2f settled_at_s=%.2f\n",
+           numBodies, jobs.numWorkers, STEPS, movingSteps, movingSteps > 0 ? movingTime * 1e6 / movingSteps : 0.0, maxStep * 1e6,
+           restingTime * 1e6 / RESTING_STEPS, settledStep >= 0 ? (settledStep + 1) * STEP_DT : -1.0f);
+    printf("rigid bodies=%d workers=%d max_islands=%d largest_island=%d max_manifolds=%d max_points=%d warm_started=%.3f\n",
+           numBodies, jobs.numWorkers, maxIslands, largestIsland, maxManifolds, maxPoints, points > 0 ? (double)warmStarted / points : 0.0);
+    printf("rigid bodies=%d workers=%d check stacks=%d tipped=%d fell_trough=%d awake=%d sleeping=%d hash=%016llx ok=%d\n",
+           numBodies, jobs.numWorkers, scene.numStacks, tipped, fell, world.stats.awake, world.stats.sleeping, hash, ok);
+
+    UnloadRigidWorld(&world);
+    UnloadJobSystem(&jobs);
+    free(scene.tops);
+    free(scene.topStarts);
+    return ok;
+}
+
+int main(void) {
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int maxWorkers = cores > 2 ? cores : 2; // always run at least two so the threaded path gets checked
+    Collider floor;
+    SetupColliderBox(&floor, (Vector3){ 0.0f, -0.5f, 0.0f }, (Vector3){ 1000.0f, 0.5f, 1000.0f });
+    Broadphase level = InitBroadphase(4.0f, 1);
+    RegisterCollider(&level, &floor, 0);
+
+    bool ok = true, deterministic = true;
+    int sizes[] = { 1000, 2500, 10000 };
+    for(int s = 0; s < 3; s++) {
+        unsigned long long hash, threadedHash;
+        ok = RunScene(sizes[s], 1, &floor, &level, &hash) && ok;
+        if(s != 0) continue; // the big ones only once, the worker counts have to agree on the small one
+        ok = RunScene(sizes[s], maxWorkers, &floor, &level, &threadedHash) && ok;
+        if(hash != threadedHash) deterministic = false;
+    }
+    printf("rigid op=check deterministic=%d ok=%d\n", deterministic, ok && deterministic);
+
+    UnloadCollider(&floor);
+    UnloadBroadphase(&level);
+    return ok && deterministic ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// Headless benchmark for sectors.h, cooks a big world into /tmp and flies the focus across it the way a player
+// would, once with a budget the whole load radius fits in and once with a tight one. reports how much is resident,
+// how many colliders the broadphase holds and what a player sized query sees, and how long the loads take.
+// build: make bench, run: make run-bench (from src/, it reads the test models). exits with 1 if the budget gets
+// broken, the sectors around the focus dont come in or the broadphase holds a collider of a dropped sector
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../collisions.h"
+#include "../obj.h"
+#include "../sectors.h"
+
+#define WORLD_PATH "/tmp/stream_bench.wld"
+#define BROADPHASE_CELL_SIZE 4.0f // same as the game
+#define SECTOR_SIZE 32.0f
+#define WORLD_SECTORS 40 // per side, 1280 m
+#define OBJECTS_PER_SECTOR 24
+#define NUM_TEXTURES 8 // the sky pngs stand in for textures, only their size matters here
+#define LOAD_RADIUS 96.0f
+#define HYSTERESIS 24.0f
+#define FLY_SPEED 40.0f // m/s, faster then the player sprints
+#define FRAME_DT (1.0f / 60.0f)
+#define FRAMES 3600
+#define SETTLE_EVERY 300 // frames between the checks that wait for the loads
+
+static const char *modelPaths[] = { "../assets/models/cube.obj", "../assets/models/cylinder.obj", "../assets/models/Ramp.obj", "../assets/models/sphere.obj" };
+#define NUM_MODELS (int)(sizeof(modelPaths) / sizeof(modelPaths[0]))
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same world
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// what the game does with the callback, here only the balance of acquires and releases gets checked
+typedef struct {
+    int *refs;
+    int live, bad;
+} ResourceLog;
+
+static void LogResource(int resource, bool acquire, void *user) {
+    ResourceLog *log = user;
+    if(acquire) {
+        if(log->refs[resource]++ != 0) log->bad++;
+        log->live++;
+    } else {
+        if(--log->refs[resource] != 0) log->bad++;
+        log->live--;
+    }
+}
+
+// loops around the world and cuts trough the middle now and then, starts in the middle
+static Vector3 FlyPath(int frame) {
+    float t = frame * FRAME_DT * FLY_SPEED / (WORLD_SECTORS * SECTOR_SIZE * 0.35f);
+    float half = WORLD_SECTORS * SECTOR_SIZE * 0.5f;
+    return (Vector3){ sinf(t) * half * 0.8f, 2.0f, sinf(t * 0.7f) * cosf(t * 1.3f) * half * 0.8f };
+}
+
+static bool SaveBenchWorld(void) {
+    CookedShape *shapes[NUM_MODELS];
+    BoundingBox bounds[NUM_MODELS];
+    for(int m = 0; m < NUM_MODELS; m++) {
+        Mesh mesh = LoadObjMeshData(modelPaths[m]);
+        if(mesh.vertexCount == 0) return false;
+        bounds[m] = (BoundingBox){ { mesh.vertices[0], mesh.vertices[1], mesh.vertices[2] }, { mesh.vertices[0], mesh.vertices[1], mesh.vertices[2] } };
+        for(int v = 1; v < mesh.vertexCount; v++) {
+            Vector3 p = { mesh.vertices[3 * v], mesh.vertices[3 * v + 1], mesh.vertices[3 * v + 2] };
+            bounds[m].min = Vector3Min(bounds[m].min, p);
+            bounds[m].max = Vector3Max(bounds[m].max, p);
+        }
+        shapes[m] = CookColliderMesh(mesh, NULL);
+        UnloadObjMeshData(mesh);
+    }
+    char textures[NUM_TEXTURES][64];
+    for(int i = 0; i < NUM_TEXTURES; i++) snprintf(textures[i], sizeof(textures[i]), "../assets/cubemaps/Cubemap_Sky_%02d-512x512.png", i + 1);
+    Color tints[] = { GRAY, RED, GREEN, BLUE };
+
+    int numObjects = WORLD_SECTORS * WORLD_SECTORS * OBJECTS_PER_SECTOR;
+    WorldObject *objects = malloc(numObjects * sizeof(WorldObject));
+    float half = WORLD_SECTORS * SECTOR_SIZE * 0.5f;
+    for(int i = 0; i < numObjects; i++) {
+        int shape = (int)RandomFloat(0.0f, NUM_MODELS - 0.001f);
+        float x = RandomFloat(-half, half), z = RandomFloat(-half, half), scale = RandomFloat(0.5f, 2.0f);
+        Matrix transform = MatrixMultiply(MatrixMultiply(MatrixScale(scale, scale, scale), MatrixRotateY(RandomFloat(0.0f, 2.0f * PI))), MatrixTranslate(x, 0.0f, z));
+        // the texture goes by the region so only the ones around the focus are needed
+        int region = ((int)((x + half) / (half * 0.5f)) + 4 * (int)((z + half) / (half * 0.5f))) % NUM_TEXTURES;
+        objects[i] = (WorldObject){ shape, transform, modelPaths[shape], textures[region], tints[i % 4], bounds[shape] };
+        if(i % 16 == 15) objects[i].shape = -1; // some only for show
+    }
+    bool ok = SaveWorldFile(WORLD_PATH, SECTOR_SIZE, (const CookedShape *const *)shapes, NUM_MODELS, objects, numObjects);
+    for(int m = 0; m < NUM_MODELS; m++) free(shapes[m]);
+    free(objects);
+    return ok;
+}
+
+// keeps updating at the same spot until nothing new gets asked for
+static void Settle(SectorStreamer *streamer, Vector3 focus) {
+    long loads;
+    do {
+        loads = streamer->stats.loads;
+        UpdateSectorStreamer(streamer, focus);
+        FinishSectorLoads(streamer);
+    } while(streamer->stats.loads != loads || streamer->stats.sectorsLoading > 0);
+}
+
+static bool RunFlight(const char *name, size_t budget, bool wholeRadius) {
+    Broadphase broadphase = InitBroadphase(BROADPHASE_CELL_SIZE, 16);
+    SectorStreamer streamer;
+    ResourceLog log = { 0 };
+    if(!InitSectorStreamer(&streamer, WORLD_PATH, &broadphase, budget, LOAD_RADIUS, HYSTERESIS, LogResource, &log)) {
+        fprintf(stderr, "stream_bench: cant open %s\n", WORLD_PATH);
+        return false;
+    }
+    log.refs = calloc(streamer.numResources, sizeof(int));
+    CollisionScratch scratch = { 0 };
+
+    double updateTime = 0.0, maxUpdate = 0.0;
+    long candidates = 0, liveColliders = 0, maxLive = 0, overBudget = 0, missing = 0, extra = 0, stale = 0, checks = 0;
+    for(int frame = 0; frame < FRAMES; frame++) {
+        Vector3 focus = FlyPath(frame);
+        double t0 = Now();
+        UpdateSectorStreamer(&streamer, focus);
+        double t1 = Now();
+        updateTime += t1 - t0;
+        if(t1 - t0 > maxUpdate) maxUpdate = t1 - t0;
+        if(streamer.stats.residentBytes > budget) overBudget++;
+
+        // what a player at the focus would test against
+        int numCandidates = QueryColliders(&broadphase, Vector3Subtract(focus, (Vector3){ 2, 2, 2 }), Vector3Add(focus, (Vector3){ 2, 2, 2 }), &scratch);
+        candidates += numCandidates;
+        long live = streamer.numColliders - streamer.numFree;
+        liveColliders += live;
+        if(live > maxLive) maxLive = live;
+
+        if(frame % SETTLE_EVERY != SETTLE_EVERY - 1) continue;
+        // once the loads caught up every sector in reach has to be in (when the budget lets it), none past the
+        // hysteresis band, and the broadphase only holds colliders of sectors that are in
+        Settle(&streamer, focus);
+        checks++;
+        int focusSector = -1;
+        long inColliders = 0;
+        for(int i = 0; i < streamer.numSectors; i++) {
+            const Sector *sector = &streamer.sectors[i];
+            float distance = SectorDistance(&streamer, sector->record, focus);
+            if(sector->state == SECTOR_IN) inColliders += sector->record->numColliders;
+            if(distance == 0.0f) focusSector = i;
+            if(sector->state == SECTOR_IN && distance > streamer.evictRadius) extra++;
+            if(sector->state != SECTOR_IN && distance <= LOAD_RADIUS && (wholeRadius || distance == 0.0f)) missing++;
+        }
+        if(focusSector < 0) missing++;
+        if(inColliders != streamer.numColliders - streamer.numFree) stale++;
+        Vector3 reach = { LOAD_RADIUS + HYSTERESIS + SECTOR_SIZE, 100.0f, LOAD_RADIUS + HYSTERESIS + SECTOR_SIZE };
+        int numReach = QueryColliders(&broadphase, Vector3Subtract(focus, reach), Vector3Add(focus, reach), &scratch);
+        for(int k = 0; k < numReach; k++) {
+            int id = scratch.candidates[k];
+            if(id >= streamer.numColliders || streamer.colliders[id].broadphase != &broadphase) { stale++; break; }
+        }
+    }
+    int resources = log.live;
+    bool ok = overBudget == 0 && missing == 0 && extra == 0 && stale == 0 && log.bad == 0;
+    printf("stream budget=%s sectors=%d props=%d resources=%d budget_mb=%.1f peak_mb=%.2f resident_mb=%.2f sectors_in=%d live_resources=%d\n",
+           name, streamer.numSectors, streamer.numProps, streamer.numResources, budget / 1048576.0, streamer.stats.peakBytes / 1048576.0,
+           streamer.stats.residentBytes / 1048576.0, streamer.stats.sectorsIn, resources);
+    printf("stream budget=%s frames=%d update_us=%.1f max_update_us=%.1f live_colliders=%.0f max_live_colliders=%ld candidates_per_query=%.2f\n",
+           name, FRAMES, updateTime * 1e6 / FRAMES, maxUpdate * 1e6, (double)liveColliders / FRAMES, maxLive, (double)candidates / FRAMES);
+    printf("stream budget=%s loads=%ld evictions=%ld failures=%ld budget_stalls=%ld load_ms=%.2f max_load_ms=%.2f\n",
+           name, streamer.stats.loads, streamer.stats.evictions, streamer.stats.failures, streamer.stats.budgetStalls,
+           streamer.stats.loads > 0 ? streamer.stats.loadTime * 1e3 / streamer.stats.loads : 0.0, streamer.stats.maxLoadTime * 1e3);
+    printf("stream budget=%s check checks=%ld over_budget=%ld missing=%ld past_hysteresis=%ld stale=%ld bad_resource_calls=%d ok=%d\n",
+           name, checks, overBudget, missing, extra, stale, log.bad, ok);
+
+    UnloadSectorStreamer(&streamer);
+    UnloadBroadphase(&broadphase);
+    UnloadCollisionScratch(&scratch);
+    free(log.refs);
+    return ok;
+}
+
+int main(void) {
+    double t0 = Now();
+    if(!SaveBenchWorld()) {
+        fprintf(stderr, "stream_bench: cant cook %s, run it from src/\n", WORLD_PATH);
+        return 1;
+    }
+    printf("stream op=cook sectors_per_side=%d objects=%d ms=%.1f\n", WORLD_SECTORS, WORLD_SECTORS * WORLD_SECTORS * OBJECTS_PER_SECTOR, (Now() - t0) * 1e3);
+    bool ok = RunFlight("roomy", 64u << 20, true);
+    ok = RunFlight("tight", 4u << 20, false) && ok;
+    printf("stream op=check ok=%d\n", ok);
+    remove(WORLD_PATH);
+    return ok ? 0 : 1;
+}
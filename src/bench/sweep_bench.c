@@ -0,0 +1,124 @@
+// Headless benchmark for the swept player movement against substepping, how many agents end up on the wrong side
+// of thin geometry and what a simulated second costs at every physics rate.
+// build: make bench, run: make run-bench. exits with 1 if the continuous movement lets anything trough
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../collisions.h"
+#include "../player.h"
+
+#define SWEEP_AGENTS 512
+#define SWEEP_SECONDS 3.0f
+#define ARENA_HALF 12.0f // walls stand this far out from the middle
+#define SLAB_HALF 0.02f // half thickness of the floor, the walls and the ramp, thinner then a step at speed
+#define CAPSULE_FOOT 2.0f // position to the bottom of the capsule
+
+static unsigned int seed = 12345;
+static float RandomFloat(float min, float max) { // small LCG so every run uses the same world and agents
+    seed = seed * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    Collider colliders[8];
+    int numColliders;
+    Broadphase broadphase;
+} World;
+
+// thin floor, four thin walls around it and a thin ramp leaning against one of them
+static World SetupWorld(void) {
+    World world = { 0 };
+    float wallHeight = 25.0f; // half height, taller then the highest drop so nothing can go over
+    SetupColliderBox(&world.colliders[world.numColliders++], (Vector3){ 0.0f, -SLAB_HALF, 0.0f }, (Vector3){ ARENA_HALF, SLAB_HALF, ARENA_HALF });
+    for(int i = 0; i < 4; i++) {
+        Collider *wall = &world.colliders[world.numColliders++];
+        SetupColliderBox(wall, (Vector3){ 0.0f, wallHeight, ARENA_HALF }, (Vector3){ ARENA_HALF, wallHeight, SLAB_HALF });
+        SetColliderTransform(wall, MatrixRotateY(i * PI * 0.5f));
+    }
+    Collider *ramp = &world.colliders[world.numColliders++];
+    SetupColliderBox(ramp, (Vector3){ 0 }, (Vector3){ 3.0f, SLAB_HALF, 5.0f });
+    SetColliderTransform(ramp, MatrixMultiply(MatrixRotateX(-25.0f * DEG2RAD), MatrixTranslate(0.0f, 2.0f, 6.0f)));
+    world.broadphase = InitBroadphase(4.0f, world.numColliders);
+    for(int i = 0; i < world.numColliders; i++) RegisterCollider(&world.broadphase, &world.colliders[i], i);
+    return world;
+}
+
+// the floor is at 0, anything with its feet under it or outside the walls went trough something
+static bool Tunneled(const Player *player) {
+    Vector3 p = player->position;
+    return p.y - CAPSULE_FOOT < -0.5f || fabsf(p.x) > ARENA_HALF || fabsf(p.z) > ARENA_HALF;
+}
+
+typedef struct {
+    int rate;
+    bool continuous;
+} SweepConfig;
+
+// agents dropped from up to 40 m or thrown down at the floor, then walking and sprinting into the walls and the ramp
+static void RunConfig(World *world, SweepConfig config, int *tunneledOut, double *nsOut) {
+    Player *agents = calloc(SWEEP_AGENTS, sizeof(Player));
+    seed = 777; // same agents for every config
+    for(int i = 0; i < SWEEP_AGENTS; i++) {
+        Collider capsule;
+        SetupColliderCapsule(&capsule, (Vector3){ 0.0f, -1.0f, 0.0f }, 0.4f, 0.6f);
+        Vector3 start = { RandomFloat(-ARENA_HALF + 1.0f, ARENA_HALF - 1.0f), RandomFloat(CAPSULE_FOOT + 1.0f, 40.0f), RandomFloat(-ARENA_HALF + 1.0f, ARENA_HALF - 1.0f) };
+        SetupPlayerPhysics(&agents[i], start, capsule);
+        agents[i].velocity.y = i % 2 ? RandomFloat(-60.0f, 0.0f) : 0.0f;
+        agents[i].stepTime = 1.0f / config.rate;
+        agents[i].continuous = config.continuous;
+        agents[i].yaw = RandomFloat(0.0f, 2.0f * PI);
+    }
+
+    int steps = (int)(SWEEP_SECONDS * config.rate);
+    double t0 = Now();
+    for(int step = 0; step < steps; step++) {
+        float time = (float)step / config.rate;
+        for(int i = 0; i < SWEEP_AGENTS; i++) {
+            float yaw = agents[i].yaw + time * (i & 1 ? 0.5f : -0.5f);
+            unsigned int keys = PLAYER_KEY_FORWARD;
+            if((i + (int)time) % 2 == 0) keys |= PLAYER_KEY_SPRINT;
+            if((int)(time * 2.0f) % 5 == i % 5) agents[i].jumpQueued = true;
+            StepPlayer(&agents[i], keys, (Vector3){ sinf(yaw), 0.0f, cosf(yaw) }, world->colliders, &world->broadphase);
+        }
+    }
+    double time = Now() - t0;
+
+    int tunneled = 0;
+    for(int i = 0; i < SWEEP_AGENTS; i++) {
+        if(Tunneled(&agents[i])) tunneled++;
+        UnloadPlayerPhysics(&agents[i]);
+    }
+    free(agents);
+    *tunneledOut = tunneled;
+    *nsOut = time * 1e9 / ((double)SWEEP_AGENTS * SWEEP_SECONDS);
+}
+
+int main(void) {
+    World world = SetupWorld();
+    SweepConfig configs[] = {
+        { 30, false }, { 60, false }, { 120, false }, { 240, false }, { 480, false },
+        { 30, true }, { 60, true }, { 120, true }
+    };
+    int numConfigs = sizeof(configs) / sizeof(configs[0]);
+    bool contained = true;
+    int tunneled;
+    double ns;
+    RunConfig(&world, configs[0], &tunneled, &ns); // warm up
+    for(int c = 0; c < numConfigs; c++) {
+        RunConfig(&world, configs[c], &tunneled, &ns);
+        if(configs[c].continuous && tunneled > 0) contained = false;
+        printf("sweep op=%s rate=%d agents=%d seconds=%.1f ns_per_agent_second=%.0f tunneled=%d\n",
+               configs[c].continuous ? "continuous" : "discrete", configs[c].rate, SWEEP_AGENTS, SWEEP_SECONDS, ns, tunneled);
+    }
+    printf("sweep op=check contained=%d\n", contained);
+    for(int i = 0; i < world.numColliders; i++) UnloadCollider(&world.colliders[i]);
+    UnloadBroadphase(&world.broadphase);
+    return contained ? 0 : 1;
+}
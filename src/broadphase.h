@@ -0,0 +1,285 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include "raylib.h" //Vector3
+#include "raymath.h"//Vector math
+
+#include <stdlib.h>//Memory operations
+#include <math.h>//floorf
+
+/*Uniform hash grid broadphase. Every proxy is an AABB stored in all the grid cells it touches,
+a query walks the cells of the query box and returns the ids of the overlapping proxies.
+Anything that would cover more than BROADPHASE_MAX_CELLS cells (big floors and so on) is kept
+in a separate list that every query checks, so huge objects dont flood the grid. A query box over more cells
+then there are proxies tests the proxies one by one instead of walking the cells.*/
+
+#define BROADPHASE_MAX_CELLS 64 //Cells a proxy can cover before it counts as oversized
+#define BROADPHASE_FREE_END -2 //Ends the proxy free list, so a removed proxy never looks like one in use
+#define BROADPHASE_CELL_LIMIT (1 << 20) //Cell coordinates get clamped to +-this, huge, infinite and NaN coordinates end up in the edge cells
+
+typedef struct {
+    Vector3 min, max; //World AABB
+    int userId;       //Id handed back by queries, usually the collider index
+    int cellMin[3], cellMax[3]; //Cells the proxy is currently in
+    int oversized;    //1 if the proxy lives in the oversized list
+    unsigned int stamp; //Last query that visited this proxy, stops duplicates
+    int nextFree;     //Free list link, -1 when the proxy is in use and BROADPHASE_FREE_END after the last free one
+} BroadphaseProxy;
+
+typedef struct {
+    int proxy; //Proxy index
+    int next;  //Next entry in the bucket or the free list
+} BroadphaseEntry;
+
+typedef struct Broadphase {
+    float cellSize;
+    float invCellSize;
+
+    int *buckets;   //Head entry of every bucket, -1 if empty
+    int numBuckets; //Always a power of two
+
+    BroadphaseEntry *entries;
+    int numEntries, capEntries, freeEntry;
+
+    BroadphaseProxy *proxies;
+    int numProxies, capProxies, freeProxy;
+
+    int *oversized; //Proxies that skip the grid
+    int numOversized, capOversized;
+
+    unsigned int stamp; //Query counter
+} Broadphase;
+
+Broadphase InitBroadphase(float cellSize, int expectedProxies) {
+    Broadphase bp = { 0 };
+    bp.cellSize = cellSize;
+    bp.invCellSize = 1.0f / cellSize;
+    bp.numBuckets = 64;
+    while (bp.numBuckets < expectedProxies * 2) bp.numBuckets *= 2; //Keep the chains short
+    bp.buckets = (int *)malloc(bp.numBuckets * sizeof(int));
+    for (int i = 0; i < bp.numBuckets; i++) bp.buckets[i] = -1;
+    bp.freeEntry = -1;
+    bp.freeProxy = BROADPHASE_FREE_END;
+    return bp;
+}
+
+void UnloadBroadphase(Broadphase *bp) {
+    free(bp->buckets);
+    free(bp->entries);
+    free(bp->proxies);
+    free(bp->oversized);
+    *bp = (Broadphase){ 0 };
+}
+
+//Clamped before the cast, a float out of the int range would be undefined. NaN goes to the low edge
+static inline int BroadphaseCell(const Broadphase *bp, float v) {
+    float cell = floorf(v * bp->invCellSize);
+    if (!(cell > -BROADPHASE_CELL_LIMIT)) return -BROADPHASE_CELL_LIMIT;
+    if (cell > BROADPHASE_CELL_LIMIT) return BROADPHASE_CELL_LIMIT;
+    return (int)cell;
+}
+
+//Cells the box between the two corner cells covers, as a double so the whole clamped range doesnt overflow
+static inline double BroadphaseCellCount(const int *cellMin, const int *cellMax) {
+    return (double)(cellMax[0] - cellMin[0] + 1) * (cellMax[1] - cellMin[1] + 1) * (cellMax[2] - cellMin[2] + 1);
+}
+
+static inline int BroadphaseHash(Broadphase *bp, int x, int y, int z) {
+    unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u;
+    return (int)(h & (unsigned int)(bp->numBuckets - 1));
+}
+
+static void BroadphaseLink(Broadphase *bp, int bucket, int proxy) {
+    int e = bp->freeEntry;
+    if (e != -1) {//Reuse a free entry
+        bp->freeEntry = bp->entries[e].next;
+    } else {
+        if (bp->numEntries == bp->capEntries) {
+            bp->capEntries = bp->capEntries ? bp->capEntries * 2 : 256;
+            bp->entries = (BroadphaseEntry *)realloc(bp->entries, bp->capEntries * sizeof(BroadphaseEntry));
+        }
+        e = bp->numEntries++;
+    }
+    bp->entries[e].proxy = proxy;
+    bp->entries[e].next = bp->buckets[bucket];
+    bp->buckets[bucket] = e;
+}
+
+static void BroadphaseUnlink(Broadphase *bp, int bucket, int proxy) {
+    int *link = &bp->buckets[bucket];
+    while (*link != -1) {
+        int e = *link;
+        if (bp->entries[e].proxy == proxy) {//Pop it and put it on the free list
+            *link = bp->entries[e].next;
+            bp->entries[e].next = bp->freeEntry;
+            bp->freeEntry = e;
+            return;
+        }
+        link = &bp->entries[e].next;
+    }
+}
+
+//Put the proxy in its cells, or in the oversized list if it covers too many of them
+static void BroadphaseAttach(Broadphase *bp, int id) {
+    BroadphaseProxy *p = &bp->proxies[id];
+    p->cellMin[0] = BroadphaseCell(bp, p->min.x); p->cellMax[0] = BroadphaseCell(bp, p->max.x);
+    p->cellMin[1] = BroadphaseCell(bp, p->min.y); p->cellMax[1] = BroadphaseCell(bp, p->max.y);
+    p->cellMin[2] = BroadphaseCell(bp, p->min.z); p->cellMax[2] = BroadphaseCell(bp, p->max.z);
+
+    p->oversized = BroadphaseCellCount(p->cellMin, p->cellMax) > BROADPHASE_MAX_CELLS;
+    if (p->oversized) {
+        if (bp->numOversized == bp->capOversized) {
+            bp->capOversized = bp->capOversized ? bp->capOversized * 2 : 16;
+            bp->oversized = (int *)realloc(bp->oversized, bp->capOversized * sizeof(int));
+        }
+        bp->oversized[bp->numOversized++] = id;
+        return;
+    }
+    for (int x = p->cellMin[0]; x <= p->cellMax[0]; x++)
+        for (int y = p->cellMin[1]; y <= p->cellMax[1]; y++)
+            for (int z = p->cellMin[2]; z <= p->cellMax[2]; z++)
+                BroadphaseLink(bp, BroadphaseHash(bp, x, y, z), id);
+}
+
+static void BroadphaseDetach(Broadphase *bp, int id) {
+    BroadphaseProxy *p = &bp->proxies[id];
+    if (p->oversized) {//Swap remove from the oversized list
+        for (int i = 0; i < bp->numOversized; i++) {
+            if (bp->oversized[i] == id) {
+                bp->oversized[i] = bp->oversized[--bp->numOversized];
+                break;
+            }
+        }
+        return;
+    }
+    for (int x = p->cellMin[0]; x <= p->cellMax[0]; x++)
+        for (int y = p->cellMin[1]; y <= p->cellMax[1]; y++)
+            for (int z = p->cellMin[2]; z <= p->cellMax[2]; z++)
+                BroadphaseUnlink(bp, BroadphaseHash(bp, x, y, z), id);
+}
+
+//Double the bucket count and rehash every live proxy
+static void BroadphaseGrow(Broadphase *bp) {
+    for (int i = 0; i < bp->numProxies; i++)
+        if (bp->proxies[i].nextFree == -1) BroadphaseDetach(bp, i);
+    bp->numBuckets *= 2;
+    bp->buckets = (int *)realloc(bp->buckets, bp->numBuckets * sizeof(int));
+    for (int i = 0; i < bp->numBuckets; i++) bp->buckets[i] = -1;
+    for (int i = 0; i < bp->numProxies; i++)
+        if (bp->proxies[i].nextFree == -1) BroadphaseAttach(bp, i);
+}
+
+//Add an AABB, returns the proxy id used by BroadphaseMove and BroadphaseRemove
+int BroadphaseInsert(Broadphase *bp, Vector3 min, Vector3 max, int userId) {
+    int id = bp->freeProxy;
+    if (id != BROADPHASE_FREE_END) {
+        bp->freeProxy = bp->proxies[id].nextFree;
+    } else {
+        if (bp->numProxies == bp->capProxies) {
+            bp->capProxies = bp->capProxies ? bp->capProxies * 2 : 64;
+            bp->proxies = (BroadphaseProxy *)realloc(bp->proxies, bp->capProxies * sizeof(BroadphaseProxy));
+        }
+        id = bp->numProxies++;
+    }
+    bp->proxies[id] = (BroadphaseProxy){ .min = min, .max = max, .userId = userId, .nextFree = -1 };
+    BroadphaseAttach(bp, id);
+    if (bp->numEntries > bp->numBuckets * 2) BroadphaseGrow(bp);
+    return id;
+}
+
+void BroadphaseRemove(Broadphase *bp, int id) {
+    BroadphaseDetach(bp, id);
+    bp->proxies[id].nextFree = bp->freeProxy;
+    bp->freeProxy = id;
+}
+
+//Update the AABB of a proxy, only touches the buckets if the covered cells changed
+void BroadphaseMove(Broadphase *bp, int id, Vector3 min, Vector3 max) {
+    BroadphaseProxy *p = &bp->proxies[id];
+    p->min = min;
+    p->max = max;
+    if (!p->oversized &&
+        BroadphaseCell(bp, min.x) == p->cellMin[0] && BroadphaseCell(bp, max.x) == p->cellMax[0] &&
+        BroadphaseCell(bp, min.y) == p->cellMin[1] && BroadphaseCell(bp, max.y) == p->cellMax[1] &&
+        BroadphaseCell(bp, min.z) == p->cellMin[2] && BroadphaseCell(bp, max.z) == p->cellMax[2]) return;
+    BroadphaseDetach(bp, id);
+    BroadphaseAttach(bp, id);
+}
+
+static inline int BroadphaseVisit(Broadphase *bp, int id, Vector3 min, Vector3 max, int *out, int count, int maxOut) {
+    BroadphaseProxy *p = &bp->proxies[id];
+    if (p->stamp == bp->stamp) return count; //Already seen in another cell
+    p->stamp = bp->stamp;
+    if (p->max.x < min.x || p->min.x > max.x || p->max.y < min.y || p->min.y > max.y || p->max.z < min.z || p->min.z > max.z) return count;
+    if (count < maxOut) out[count] = p->userId;
+    return count + 1;
+}
+
+/*Write the userIds of every proxy whose AABB overlaps min/max into out.
+Returns the number of candidates, which can be bigger then maxOut if out was too small*/
+int BroadphaseQuery(Broadphase *bp, Vector3 min, Vector3 max, int *out, int maxOut) {
+    int count = 0;
+    if (++bp->stamp == 0) {//Counter wrapped, clear the stamps so nothing gets skipped
+        for (int i = 0; i < bp->numProxies; i++) bp->proxies[i].stamp = 0;
+        bp->stamp = 1;
+    }
+    for (int i = 0; i < bp->numOversized; i++) count = BroadphaseVisit(bp, bp->oversized[i], min, max, out, count, maxOut);
+
+    int q0[3] = { BroadphaseCell(bp, min.x), BroadphaseCell(bp, min.y), BroadphaseCell(bp, min.z) };
+    int q1[3] = { BroadphaseCell(bp, max.x), BroadphaseCell(bp, max.y), BroadphaseCell(bp, max.z) };
+    if (BroadphaseCellCount(q0, q1) > bp->numProxies) {//Fewer proxies then cells, test them all
+        for (int i = 0; i < bp->numProxies; i++)
+            if (bp->proxies[i].nextFree == -1 && !bp->proxies[i].oversized) count = BroadphaseVisit(bp, i, min, max, out, count, maxOut);
+        return count;
+    }
+    for (int x = q0[0]; x <= q1[0]; x++)
+        for (int y = q0[1]; y <= q1[1]; y++)
+            for (int z = q0[2]; z <= q1[2]; z++)
+                for (int e = bp->buckets[BroadphaseHash(bp, x, y, z)]; e != -1; e = bp->entries[e].next)
+                    count = BroadphaseVisit(bp, bp->entries[e].proxy, min, max, out, count, maxOut);
+    return count;
+}
+
+/*Same as BroadphaseQuery but nothing gets written, so any number of threads can query at once.
+Without the stamps a proxy is only reported from the first cell it shares with the query box,
+if two of its cells land in the same bucket it can still show up twice so sort and drop repeats*/
+int BroadphaseQueryShared(const Broadphase *bp, Vector3 min, Vector3 max, int *out, int maxOut) {
+    int count = 0;
+    for (int i = 0; i < bp->numOversized; i++) {
+        const BroadphaseProxy *p = &bp->proxies[bp->oversized[i]];
+        if (p->max.x < min.x || p->min.x > max.x || p->max.y < min.y || p->min.y > max.y || p->max.z < min.z || p->min.z > max.z) continue;
+        if (count < maxOut) out[count] = p->userId;
+        count++;
+    }
+
+    int q0[3] = { BroadphaseCell(bp, min.x), BroadphaseCell(bp, min.y), BroadphaseCell(bp, min.z) };
+    int q1[3] = { BroadphaseCell(bp, max.x), BroadphaseCell(bp, max.y), BroadphaseCell(bp, max.z) };
+    if (BroadphaseCellCount(q0, q1) > bp->numProxies) {
+        for (int i = 0; i < bp->numProxies; i++) {
+            const BroadphaseProxy *p = &bp->proxies[i];
+            if (p->nextFree != -1 || p->oversized) continue;
+            if (p->max.x < min.x || p->min.x > max.x || p->max.y < min.y || p->min.y > max.y || p->max.z < min.z || p->min.z > max.z) continue;
+            if (count < maxOut) out[count] = p->userId;
+            count++;
+        }
+        return count;
+    }
+    for (int x = q0[0]; x <= q1[0]; x++)
+        for (int y = q0[1]; y <= q1[1]; y++)
+            for (int z = q0[2]; z <= q1[2]; z++) {
+                unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u;
+                for (int e = bp->buckets[h & (unsigned int)(bp->numBuckets - 1)]; e != -1; e = bp->entries[e].next) {
+                    const BroadphaseProxy *p = &bp->proxies[bp->entries[e].proxy];
+                    //First shared cell, also filters out proxies that only hashed into this bucket from somewhere else
+                    if (x != (p->cellMin[0] > q0[0] ? p->cellMin[0] : q0[0]) ||
+                        y != (p->cellMin[1] > q0[1] ? p->cellMin[1] : q0[1]) ||
+                        z != (p->cellMin[2] > q0[2] ? p->cellMin[2] : q0[2])) continue;
+                    if (p->max.x < min.x || p->min.x > max.x || p->max.y < min.y || p->min.y > max.y || p->max.z < min.z || p->min.z > max.z) continue;
+                    if (count < maxOut) out[count] = p->userId;
+                    count++;
+                }
+            }
+    return count;
+}
+
+#endif
@@ -3,132 +3,1505 @@
 
 #include "raylib.h" //Accsess the mesh data
 #include "raymath.h"//Vector mathh
+#include "broadphase.h"//Spatial index the colliders register into
+#include "hull.h"//Convex hull for cooking the meshes
+#include "gjk.h"//GJK/EPA narrowphase
+#include "arena.h"//Level memory for colliders
+#include "profiler.h"//Counters, empty unless PROFILER is defined
 
 #include <stdlib.h>//Memory operations
 #include <float.h>//FLT_MAX
+#include <string.h>//memcpy
+#include <stdint.h>//uintptr_t
 
+//Pick the widest vector unit the compiler targets, define COLLISION_SCALAR to force the plain C kernel
+#if !defined(COLLISION_SCALAR) && defined(__AVX__)
+    #include <immintrin.h>
+    #define COLLISION_SIMD_WIDTH 8
+#elif !defined(COLLISION_SCALAR) && (defined(__SSE__) || defined(_M_X64))
+    #include <xmmintrin.h>
+    #define COLLISION_SIMD_WIDTH 4
+#else
+    #define COLLISION_SIMD_WIDTH 1
+#endif
+#define COLLISION_PAD_WIDTH 8 //The SoA points get padded for the widest kernel in every build, so a cooked level loads in all of them
+#if COLLISION_PAD_WIDTH % COLLISION_SIMD_WIDTH != 0
+    #error "COLLISION_PAD_WIDTH has to be a multiple of the SIMD width"
+#endif
+#define COLLISION_AXIS_BATCH 4 //How many axes get projected in one pass over the points
+#define COLLISION_PARALLEL_EPSILON 1e-6f //Axes closer then this to (anti)parallel count as the same axis, kept tight so nearly flat faces keep their own axes
+#define COLLIDER_FIT_TOLERANCE 0.05f //A mesh becomes a primitive if its hull is at most this fraction smaller then the fitted shape
 
+//What kind of shape the collider is. Hulls keep their points, the rest are stored as a few numbers and get closed form tests
+typedef enum {
+    COLLIDER_HULL,
+    COLLIDER_SPHERE,
+    COLLIDER_CAPSULE,
+    COLLIDER_BOX, //Oriented box
+    COLLIDER_CYLINDER,
+    COLLIDER_SHAPE_COUNT
+} ColliderShape;
+
+typedef struct {
+    ColliderShape shape;
+    Vector3 center;
+    Vector3 axes[3]; //Orthonormal frame, the box axes. Capsules and cylinders run along axes[1]
+    Vector3 halfExtents; //Box
+    float radius; //Sphere, capsule and cylinder
+    float halfHeight; //Half the capsule segment or half the cylinder height
+} ColliderPrimitive;
+
+//What SetupColliderMesh cooks out of a mesh. Nothing in here changes after cooking, so every collider made
+//from the same mesh can point at one copy. The struct and all its arrays are a single block
 typedef struct {
-    Vector3 *transformedPoints;// Array of points definig the transofrmed collider
-    Vector3 *notTransformed;// Array of points defining the collider
+    ColliderPrimitive primitive; //COLLIDER_HULL, or the primitive the mesh turned out to be and then the arrays are empty
+    Vector3 *notTransformed;// Array of points defining the collider, in local space
     int numPoints;      // Number of points in the array
-	Vector3 *normals; //Normal array, helps with detection
-	int numNormals; //Number of normals
+    Vector3 *normals; //Unique face axes of the hull, parallel and antiparallel faces share one
+    int numNormals; //Number of normals
+    Vector3 *edges; //Hull edge directions, crossed with the other colliders edges for the edge-edge axes
+    Vector3 *edgeNormals; //The two face normals next to every edge, 2 per edge. NULL for flat colliders
+    int numEdges; //Number of edges
+    //Hull vertex adjacency for the hill climbing support search, the neighbours of point i are
+    //neighbors[neighborStart[i]] up to neighbors[neighborStart[i + 1]]. NULL for flat colliders
+    int *neighbors;
+    int *neighborStart;
+    //Structure of arrays copy of the local points for the SIMD kernel. The points never get transformed,
+    //queries move the axis into local space instead
+    float *soaX, *soaY, *soaZ;
+    int numPadded; //numPoints rounded up to COLLISION_PAD_WIDTH, the tail repeats the last point
+    Vector3 localMin, localMax; //Local AABB of the points
+    Vector3 localCenter; //Average of the points, GJK starts searching from it
+} CookedShape;
+
+//One placed collider. Hulls point at shared cooked data and only own their transform, bounds and world axes
+typedef struct {
+    ColliderPrimitive primitive; //Shape and local space parameters, shape is COLLIDER_HULL for mesh colliders
+    const CookedShape *cooked; //Points and axes of a hull, NULL for primitives
+    bool ownsCooked; //Made by SetupColliderMesh, UnloadCollider frees the cooked data with it
+    Arena *arena; //Where the world axes come from, NULL for the heap
+    //World space copies of the cooked axes, only rebuilt when the rotation or scale changes. They point
+    //straight at the cooked ones while the collider isnt rotated or scaled, worldAxes is the own copy once it is
+    Vector3 *worldNormals;
+    Vector3 *worldEdges;
+    Vector3 *worldEdgeNormals;
+    Vector3 *worldAxes;
+    bool axesDirty; //Rotation or scale changed since the world axes were built
+    int supportHint; //Point the last support search ended on, the next one starts there
+    Vector3 localMin, localMax; //Local AABB of the shape
+    Vector3 localCenter; //Any point inside, GJK starts searching from it
+    Matrix transform; //Local to world, rotation scale and translation
+    Vector3 boundsMin, boundsMax; //World AABB, the local box transformed so it can be a bit loose when rotated
+    Broadphase *broadphase; //Broadphase the collider is registered in, NULL if none
+    int proxy; //Proxy id inside the broadphase
 } Collider;
 
-void GetNormals(Mesh mesh,Vector3 * normals) {
-    for (int i = 0; i < mesh.vertexCount; i+=3) {//Loop trough the normals and add them to the array
-        normals[i/3] = (Vector3){mesh.normals[i],mesh.normals[i+1],mesh.normals[i+2]};
+//Add the axis unless it (or its opposite) is already in the array, returns the new count
+int AddUniqueAxis(Vector3 *axes, int count, Vector3 axis) {
+    for (int i = 0; i < count; i++) {
+        if (fabsf(Vector3DotProduct(axes[i], axis)) > 1.0f - COLLISION_PARALLEL_EPSILON) return count;
     }
+    axes[count] = axis;
+    return count + 1;
 }
 
-//Fogot to add a check to check if the mesh inst empty :P
-void SetupColliderMesh(Collider *c, Mesh mesh) {
-    c->numPoints = mesh.vertexCount; //Set the numPoints as num vertices
-    c->notTransformed = (Vector3 *)malloc(mesh.vertexCount * sizeof(Vector3));//Init the non transofrmed array
-    c->transformedPoints = (Vector3 *)malloc(mesh.vertexCount * sizeof(Vector3));//Init the transofrmed array
+typedef struct {
+    int a, b; //Vertex indices, a < b
+    int triangle; //Triangle the edge belongs to
+} HullEdgeKey;
+
+static int CompareHullEdges(const void *x, const void *y) {
+    const HullEdgeKey *p = (const HullEdgeKey *)x, *q = (const HullEdgeKey *)y;
+    if (p->a != q->a) return p->a - q->a;
+    return p->b - q->b;
+}
+
+//Face axes and edges of a closed hull. Coplanar triangles collapse into one axis and the diagonals between them are skipped
+void CookHullAxes(CookedShape *c, const ConvexHull *hull) {
+    Vector3 *triNormals = (Vector3 *)malloc(hull->numTriangles * sizeof(Vector3));
+    c->normals = (Vector3 *)malloc(hull->numTriangles * sizeof(Vector3));
+    c->numNormals = 0;
+    for (int t = 0; t < hull->numTriangles; t++) {
+        Vector3 p0 = hull->points[hull->triangles[t * 3]];
+        Vector3 p1 = hull->points[hull->triangles[t * 3 + 1]];
+        Vector3 p2 = hull->points[hull->triangles[t * 3 + 2]];
+        triNormals[t] = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(p1, p0), Vector3Subtract(p2, p0)));
+        c->numNormals = AddUniqueAxis(c->normals, c->numNormals, triNormals[t]);
+    }
+    c->normals = (Vector3 *)realloc(c->normals, c->numNormals * sizeof(Vector3));
+
+    //Every edge of a closed hull is shared by exactly two triangles, sorting puts the two next to each other
+    int numKeys = hull->numTriangles * 3;
+    HullEdgeKey *keys = (HullEdgeKey *)malloc(numKeys * sizeof(HullEdgeKey));
+    for (int t = 0; t < hull->numTriangles; t++) {
+        for (int e = 0; e < 3; e++) {
+            int a = hull->triangles[t * 3 + e], b = hull->triangles[t * 3 + (e + 1) % 3];
+            keys[t * 3 + e] = (HullEdgeKey){ a < b ? a : b, a < b ? b : a, t };
+        }
+    }
+    qsort(keys, numKeys, sizeof(HullEdgeKey), CompareHullEdges);
+
+    c->edges = (Vector3 *)malloc(numKeys / 2 * sizeof(Vector3));
+    c->edgeNormals = (Vector3 *)malloc(numKeys * sizeof(Vector3));
+    c->numEdges = 0;
+    for (int i = 0; i + 1 < numKeys; i++) {
+        if (keys[i].a != keys[i + 1].a || keys[i].b != keys[i + 1].b) continue;
+        Vector3 n1 = triNormals[keys[i].triangle], n2 = triNormals[keys[i + 1].triangle];
+        i++;
+        if (Vector3DotProduct(n1, n2) > 1.0f - COLLISION_PARALLEL_EPSILON) continue; //Diagonal of a flat face
+        c->edges[c->numEdges] = Vector3Normalize(Vector3Subtract(hull->points[keys[i].b], hull->points[keys[i].a]));
+        c->edgeNormals[c->numEdges * 2] = n1;
+        c->edgeNormals[c->numEdges * 2 + 1] = n2;
+        c->numEdges++;
+    }
+    free(keys);
+    free(triNormals);
+
+    //Every directed edge a -> b of the triangles makes b a neighbour of a, the twin b -> a covers the other way
+    c->neighborStart = (int *)calloc(hull->numPoints + 1, sizeof(int));
+    c->neighbors = (int *)malloc(hull->numTriangles * 3 * sizeof(int));
+    for (int i = 0; i < hull->numTriangles * 3; i++) c->neighborStart[hull->triangles[i] + 1]++;
+    for (int i = 0; i < hull->numPoints; i++) c->neighborStart[i + 1] += c->neighborStart[i];
+    int *fill = (int *)malloc(hull->numPoints * sizeof(int));
+    memcpy(fill, c->neighborStart, hull->numPoints * sizeof(int));
+    for (int t = 0; t < hull->numTriangles; t++) {
+        for (int e = 0; e < 3; e++) {
+            int a = hull->triangles[t * 3 + e], b = hull->triangles[t * 3 + (e + 1) % 3];
+            c->neighbors[fill[a]++] = b;
+        }
+    }
+    free(fill);
+}
+
+//Half the width of the primitive along the unit axis n, every primitive is symmetric around its center
+static float PrimitiveHalfWidth(const ColliderPrimitive *p, Vector3 n) {
+    switch (p->shape) {
+        case COLLIDER_SPHERE: return p->radius;
+        case COLLIDER_CAPSULE: return p->halfHeight * fabsf(Vector3DotProduct(p->axes[1], n)) + p->radius;
+        case COLLIDER_BOX:
+            return p->halfExtents.x * fabsf(Vector3DotProduct(p->axes[0], n)) +
+                   p->halfExtents.y * fabsf(Vector3DotProduct(p->axes[1], n)) +
+                   p->halfExtents.z * fabsf(Vector3DotProduct(p->axes[2], n));
+        case COLLIDER_CYLINDER: {
+            float along = Vector3DotProduct(p->axes[1], n);
+            return p->halfHeight * fabsf(along) + p->radius * sqrtf(fmaxf(0.0f, 1.0f - along * along));
+        }
+        default: return 0.0f;
+    }
+}
+
+//Some unit vector at right angles to the unit vector v
+static Vector3 AnyPerpendicular(Vector3 v) {
+    Vector3 other = fabsf(v.x) < 0.57f ? (Vector3){1, 0, 0} : (Vector3){0, 1, 0};
+    return Vector3Normalize(Vector3CrossProduct(v, other));
+}
+
+//Collider without any points, only the primitive and its bounds. The transform starts at the identity like SetupColliderMesh
+void SetupColliderPrimitive(Collider *c, ColliderPrimitive primitive) {
+    *c = (Collider){ 0 };
+    c->primitive = primitive;
+    c->localCenter = primitive.center;
+    Vector3 extent = {
+        PrimitiveHalfWidth(&primitive, (Vector3){1, 0, 0}),
+        PrimitiveHalfWidth(&primitive, (Vector3){0, 1, 0}),
+        PrimitiveHalfWidth(&primitive, (Vector3){0, 0, 1})
+    };
+    c->localMin = Vector3Subtract(primitive.center, extent);
+    c->localMax = Vector3Add(primitive.center, extent);
+    c->transform = MatrixIdentity();
+    c->boundsMin = c->localMin;
+    c->boundsMax = c->localMax;
+    c->proxy = -1;
+}
+
+void SetupColliderSphere(Collider *c, Vector3 center, float radius) {
+    SetupColliderPrimitive(c, (ColliderPrimitive){ .shape = COLLIDER_SPHERE, .center = center, .axes = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, .radius = radius });
+}
+
+//Upright capsule, the segment runs halfHeight up and down from center along local y
+void SetupColliderCapsule(Collider *c, Vector3 center, float radius, float halfHeight) {
+    SetupColliderPrimitive(c, (ColliderPrimitive){ .shape = COLLIDER_CAPSULE, .center = center, .axes = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, .radius = radius, .halfHeight = halfHeight });
+}
+
+void SetupColliderBox(Collider *c, Vector3 center, Vector3 halfExtents) {
+    SetupColliderPrimitive(c, (ColliderPrimitive){ .shape = COLLIDER_BOX, .center = center, .axes = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, .halfExtents = halfExtents });
+}
+
+//Upright cylinder along local y
+void SetupColliderCylinder(Collider *c, Vector3 center, float radius, float halfHeight) {
+    SetupColliderPrimitive(c, (ColliderPrimitive){ .shape = COLLIDER_CYLINDER, .center = center, .axes = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, .radius = radius, .halfHeight = halfHeight });
+}
+
+//Furthest any hull point gets from center along n
+static float HullReach(const CookedShape *c, Vector3 center, Vector3 n) {
+    float reach = -FLT_MAX;
+    for (int i = 0; i < c->numPoints; i++) reach = fmaxf(reach, Vector3DotProduct(Vector3Subtract(c->notTransformed[i], center), n));
+    return reach;
+}
+
+/*Check if a cooked hull is really a box, sphere or cylinder. The hull has to fit inside the primitive and
+every face has to be within COLLIDER_FIT_TOLERANCE of its surface, so a low poly sphere still counts
+but a six sided prism stays a hull instead of turning into a noticeably fatter cylinder*/
+bool FitColliderPrimitive(const CookedShape *c, ColliderPrimitive *out) {
+    Vector3 min = c->notTransformed[0], max = c->notTransformed[0];
+    for (int i = 1; i < c->numPoints; i++) {
+        min = Vector3Min(min, c->notTransformed[i]);
+        max = Vector3Max(max, c->notTransformed[i]);
+    }
+    Vector3 center = Vector3Scale(Vector3Add(min, max), 0.5f);
+    float flat = Vector3Distance(min, max) * 1e-4f; //How far a point can be off a cap and still be on it
+    *out = (ColliderPrimitive){ .shape = COLLIDER_HULL, .center = center, .axes = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}} };
+
+    //Box, three face directions all at right angles
+    if (c->numPoints == 8 && c->numNormals == 3 &&
+        fabsf(Vector3DotProduct(c->normals[0], c->normals[1])) < 1e-4f &&
+        fabsf(Vector3DotProduct(c->normals[0], c->normals[2])) < 1e-4f &&
+        fabsf(Vector3DotProduct(c->normals[1], c->normals[2])) < 1e-4f) {
+        float half[3];
+        out->center = (Vector3){0, 0, 0};
+        for (int i = 0; i < 3; i++) {
+            float hi = HullReach(c, (Vector3){0, 0, 0}, c->normals[i]), lo = -HullReach(c, (Vector3){0, 0, 0}, Vector3Negate(c->normals[i]));
+            out->center = Vector3Add(out->center, Vector3Scale(c->normals[i], (hi + lo) * 0.5f));
+            out->axes[i] = c->normals[i];
+            half[i] = (hi - lo) * 0.5f;
+        }
+        out->shape = COLLIDER_BOX;
+        out->halfExtents = (Vector3){ half[0], half[1], half[2] };
+        return true;
+    }
+
+    //Sphere, every face close to the sphere trough the furthest point
+    float radius = 0.0f;
+    for (int i = 0; i < c->numPoints; i++) radius = fmaxf(radius, Vector3Distance(c->notTransformed[i], center));
+    bool sphere = true;
+    for (int i = 0; i < c->numNormals && sphere; i++) {
+        sphere = HullReach(c, center, c->normals[i]) >= radius * (1.0f - COLLIDER_FIT_TOLERANCE) &&
+                 HullReach(c, center, Vector3Negate(c->normals[i])) >= radius * (1.0f - COLLIDER_FIT_TOLERANCE);
+    }
+    if (sphere) {
+        out->shape = COLLIDER_SPHERE;
+        out->radius = radius;
+        return true;
+    }
+
+    //Cylinder, one face direction with every point on its two caps and the sides close to the round surface
+    for (int k = 0; k < c->numNormals; k++) {
+        Vector3 axis = c->normals[k];
+        float hi = HullReach(c, (Vector3){0, 0, 0}, axis), lo = -HullReach(c, (Vector3){0, 0, 0}, Vector3Negate(axis));
+        bool caps = true;
+        for (int i = 0; i < c->numPoints && caps; i++) {
+            float along = Vector3DotProduct(c->notTransformed[i], axis);
+            caps = fabsf(along - hi) < flat || fabsf(along - lo) < flat;
+        }
+        if (!caps) continue;
+        Vector3 base = Vector3Add(center, Vector3Scale(axis, (hi + lo) * 0.5f - Vector3DotProduct(center, axis))); //Center on the axis
+        radius = 0.0f;
+        for (int i = 0; i < c->numPoints; i++) {
+            Vector3 d = Vector3Subtract(c->notTransformed[i], base);
+            radius = fmaxf(radius, Vector3Length(Vector3Subtract(d, Vector3Scale(axis, Vector3DotProduct(d, axis)))));
+        }
+        bool round = true;
+        for (int i = 0; i < c->numNormals && round; i++) {
+            if (i == k) continue;
+            round = fabsf(Vector3DotProduct(c->normals[i], axis)) < 1e-4f &&
+                    HullReach(c, base, c->normals[i]) >= radius * (1.0f - COLLIDER_FIT_TOLERANCE) &&
+                    HullReach(c, base, Vector3Negate(c->normals[i])) >= radius * (1.0f - COLLIDER_FIT_TOLERANCE);
+        }
+        if (!round) continue;
+        out->shape = COLLIDER_CYLINDER;
+        out->center = base;
+        out->axes[1] = axis;
+        out->axes[0] = AnyPerpendicular(axis);
+        out->axes[2] = Vector3CrossProduct(out->axes[0], axis);
+        out->radius = radius;
+        out->halfHeight = (hi - lo) * 0.5f;
+        return true;
+    }
+    return false;
+}
+
+//Move a freshly cooked shape with its heap arrays into one block from the arena (or one malloc without an arena)
+static CookedShape *PackCookedShape(CookedShape *temp, Arena *arena) {
+    //Every array in order, a NULL array takes no room
+    void *arrays[7] = { temp->notTransformed, temp->normals, temp->edges, temp->edgeNormals, temp->neighbors, temp->neighborStart, temp->soaX };
+    size_t bytes[7] = {
+        temp->numPoints * sizeof(Vector3),
+        temp->numNormals * sizeof(Vector3),
+        temp->numEdges * sizeof(Vector3),
+        temp->edgeNormals != NULL ? temp->numEdges * 2 * sizeof(Vector3) : 0,
+        temp->neighbors != NULL ? temp->neighborStart[temp->numPoints] * sizeof(int) : 0,
+        temp->neighborStart != NULL ? (temp->numPoints + 1) * sizeof(int) : 0,
+        3 * temp->numPadded * sizeof(float)
+    };
+    size_t header = (sizeof(CookedShape) + 15) & ~(size_t)15, total = header;
+    for (int i = 0; i < 7; i++) total += (bytes[i] + 15) & ~(size_t)15; //Keep every array aligned for the SIMD loads
+    char *block = arena != NULL ? (char *)ArenaAlloc(arena, total) : (char *)malloc(total);
+
+    CookedShape *shape = (CookedShape *)block;
+    *shape = *temp;
+    char *at = block + header;
+    for (int i = 0; i < 7; i++) {
+        void *copy = NULL;
+        if (arrays[i] != NULL && bytes[i] > 0) {
+            memcpy(at, arrays[i], bytes[i]);
+            copy = at;
+            at += (bytes[i] + 15) & ~(size_t)15;
+        }
+        free(arrays[i]);
+        arrays[i] = copy;
+    }
+    shape->notTransformed = (Vector3 *)arrays[0];
+    shape->normals = (Vector3 *)arrays[1];
+    shape->edges = (Vector3 *)arrays[2];
+    shape->edgeNormals = (Vector3 *)arrays[3];
+    shape->neighbors = (int *)arrays[4];
+    shape->neighborStart = (int *)arrays[5];
+    shape->soaX = (float *)arrays[6];
+    shape->soaY = shape->soaX != NULL ? shape->soaX + shape->numPadded : NULL;
+    shape->soaZ = shape->soaX != NULL ? shape->soaY + shape->numPadded : NULL;
+    return shape;
+}
+
+//Hull, axes and adjacency of the mesh in one block, from arena or from the heap if arena is NULL.
+//A mesh without vertices cooks to a sphere of radius 0 at the origin, so it can be set up and tested like any other
+CookedShape *CookColliderMesh(Mesh mesh, Arena *arena) {
+    CookedShape temp = { 0 };
+    CookedShape *c = &temp; //Cooked on the heap first, the final sizes arent known until the end
+    if (mesh.vertexCount <= 0 || mesh.vertices == NULL) {
+        c->primitive = (ColliderPrimitive){ .shape = COLLIDER_SPHERE, .axes = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}} };
+        return PackCookedShape(c, arena);
+    }
+    Vector3 *points = (Vector3 *)malloc(mesh.vertexCount * sizeof(Vector3));
     int vertex = 0; //Init vertex counter
-    for (int i = 0; i < c->numPoints; i++) {
-        c->notTransformed[i] = (Vector3){mesh.vertices[vertex], mesh.vertices[vertex + 1], mesh.vertices[vertex + 2]}; // Create the vertex position using mesh data
+    for (int i = 0; i < mesh.vertexCount; i++) {
+        points[i] = (Vector3){mesh.vertices[vertex], mesh.vertices[vertex + 1], mesh.vertices[vertex + 2]}; // Create the vertex position using mesh data
         vertex += 3; // Add 3 since raylib uses a float array for vertices instead of Vector3, each float is either x, y or z 
     }
-   
-    /*The tirangle and normal count are the same, for this case, otherwise when using smoothshading
-    i recommend to use sizeof function on the normals array*/
-    c->numNormals = mesh.triangleCount; 
-    c->normals = (Vector3 *)malloc(mesh.triangleCount * sizeof(Vector3)); //Init normal array
-    GetNormals(mesh,*&c->normals);//Set the normal data
+    int numWelded = WeldPoints(points, mesh.vertexCount); //A triangle soup repeats every shared vertex
+
+    ConvexHull hull;
+    if (BuildConvexHull(points, numWelded, &hull)) {
+        //Only the hull vertices matter for SAT, the interior and duplicate points are dropped
+        free(points);
+        c->numPoints = hull.numPoints;
+        c->notTransformed = hull.points;
+        CookHullAxes(c, &hull);
+        free(hull.triangles);
+        ColliderPrimitive primitive;
+        if (FitColliderPrimitive(c, &primitive)) {//Closed form tests beat any point cloud, the cooked data isnt needed
+            free(c->notTransformed);
+            free(c->normals);
+            free(c->edges);
+            free(c->edgeNormals);
+            free(c->neighbors);
+            free(c->neighborStart);
+            temp = (CookedShape){ 0 };
+            c->primitive = primitive;
+            return PackCookedShape(c, arena);
+        }
+    } else {
+        //Flat mesh (a plane or a single triangle), keep the welded points and the triangle normals
+        c->numPoints = numWelded;
+        c->notTransformed = (Vector3 *)realloc(points, numWelded * sizeof(Vector3));
+        c->normals = (Vector3 *)malloc((mesh.triangleCount * 4 + 1) * sizeof(Vector3));
+        c->numNormals = 0;
+        c->edges = (Vector3 *)malloc((mesh.triangleCount * 3 + 1) * sizeof(Vector3));
+        c->numEdges = 0;
+        for (int t = 0; t < mesh.triangleCount; t++) {
+            int i0 = t * 3, i1 = t * 3 + 1, i2 = t * 3 + 2;
+            if (mesh.indices != NULL) { i0 = mesh.indices[i0]; i1 = mesh.indices[i1]; i2 = mesh.indices[i2]; }
+            Vector3 p0 = {mesh.vertices[i0 * 3], mesh.vertices[i0 * 3 + 1], mesh.vertices[i0 * 3 + 2]};
+            Vector3 p1 = {mesh.vertices[i1 * 3], mesh.vertices[i1 * 3 + 1], mesh.vertices[i1 * 3 + 2]};
+            Vector3 p2 = {mesh.vertices[i2 * 3], mesh.vertices[i2 * 3 + 1], mesh.vertices[i2 * 3 + 2]};
+            Vector3 n = Vector3CrossProduct(Vector3Subtract(p1, p0), Vector3Subtract(p2, p0));
+            if (Vector3Length(n) == 0.0f) continue;
+            n = Vector3Normalize(n);
+            c->numNormals = AddUniqueAxis(c->normals, c->numNormals, n);
+            //A flat shape has no side faces, so the in plane normals of its edges and the edges themselves stand in for them
+            Vector3 corners[3] = { p0, p1, p2 };
+            for (int e = 0; e < 3; e++) {
+                Vector3 edge = Vector3Normalize(Vector3Subtract(corners[(e + 1) % 3], corners[e]));
+                c->numNormals = AddUniqueAxis(c->normals, c->numNormals, Vector3Normalize(Vector3CrossProduct(n, edge)));
+                c->numEdges = AddUniqueAxis(c->edges, c->numEdges, edge);
+            }
+        }
+        c->edgeNormals = NULL; //No gauss map to prune with, every edge pair gets tested
+        c->neighbors = NULL; //No adjacency, the support search walks every point
+        c->neighborStart = NULL;
+    }
+    //Padded SoA copy, the padding repeats the last point so it never changes the min/max
+    c->numPadded = (c->numPoints + COLLISION_PAD_WIDTH - 1) / COLLISION_PAD_WIDTH * COLLISION_PAD_WIDTH;
+    c->soaX = (float *)malloc(3 * c->numPadded * sizeof(float));//One block for all three arrays
+    c->soaY = c->soaX + c->numPadded;
+    c->soaZ = c->soaY + c->numPadded;
+    for (int i = 0; i < c->numPadded; i++) {
+        Vector3 p = c->notTransformed[i < c->numPoints ? i : c->numPoints - 1];
+        c->soaX[i] = p.x;
+        c->soaY[i] = p.y;
+        c->soaZ[i] = p.z;
+    }
+
+    //Local bounds and center, the world ones are derived from these
+    c->localMin = c->localMax = c->notTransformed[0];
+    Vector3 sum = {0, 0, 0};
+    for (int i = 0; i < c->numPoints; i++) {
+        c->localMin = Vector3Min(c->localMin, c->notTransformed[i]);
+        c->localMax = Vector3Max(c->localMax, c->notTransformed[i]);
+        sum = Vector3Add(sum, c->notTransformed[i]);
+    }
+    c->localCenter = Vector3Scale(sum, 1.0f / c->numPoints);
+    c->primitive = (ColliderPrimitive){ .shape = COLLIDER_HULL };
+    return PackCookedShape(c, arena);
 }
 
+/*Place a cooked shape, nothing gets copied or allocated. The shape has to outlive the collider and arena is where
+the world axes go once the collider gets rotated (NULL for the heap). Starts at the identity like every other setup*/
+void SetupColliderShape(Collider *c, const CookedShape *shape, Arena *arena) {
+    if (shape->primitive.shape != COLLIDER_HULL) {//Fitted primitive, the numbers are all there is
+        SetupColliderPrimitive(c, shape->primitive);
+        return;
+    }
+    *c = (Collider){ 0 };
+    c->primitive = shape->primitive;
+    c->cooked = shape;
+    c->arena = arena;
+    c->worldNormals = shape->normals; //Identity, the cooked axes are the world axes
+    c->worldEdges = shape->edges;
+    c->worldEdgeNormals = shape->edgeNormals;
+    c->localMin = shape->localMin;
+    c->localMax = shape->localMax;
+    c->localCenter = shape->localCenter;
+    c->transform = MatrixIdentity();
+    c->boundsMin = c->localMin;
+    c->boundsMax = c->localMax;
+    c->broadphase = NULL; //Not registered until RegisterCollider
+    c->proxy = -1;
+}
 
-void GetMinMax(Collider b, Vector3 axis, float *min, float *max) {
-    *min = Vector3DotProduct(b.transformedPoints[0], axis); //Initialize min as the first vertex
-    *max = *min;  // Initialize max with the same value as min
+//Collider with its own copy of the cooked mesh, fine for a handful of props. Levels should share through a ColliderStore
+void SetupColliderMesh(Collider *c, Mesh mesh) {
+    CookedShape *shape = CookColliderMesh(mesh, NULL);
+    SetupColliderShape(c, shape, NULL);
+    if (c->cooked == NULL) free(shape); //Became a primitive, nothing points into it
+    else c->ownsCooked = true;
+}
+
+//Transpose of the rotation/scale part times v. Moves a world axis into local space, dot(M * p, v) = dot(p, this) + dot(translation, v)
+static inline Vector3 TransformTransposed(Matrix m, Vector3 v) {
+    return (Vector3){
+        m.m0 * v.x + m.m1 * v.y + m.m2 * v.z,
+        m.m4 * v.x + m.m5 * v.y + m.m6 * v.z,
+        m.m8 * v.x + m.m9 * v.y + m.m10 * v.z
+    };
+}
+
+//Rotation/scale part times v, no translation
+static inline Vector3 TransformDirection(Matrix m, Vector3 v) {
+    return (Vector3){
+        m.m0 * v.x + m.m4 * v.y + m.m8 * v.z,
+        m.m1 * v.x + m.m5 * v.y + m.m9 * v.z,
+        m.m2 * v.x + m.m6 * v.y + m.m10 * v.z
+    };
+}
+
+//Rebuild the world axes if the rotation or scale changed, normals go through the inverse transpose so scaling keeps them perpendicular.
+//Without any rotation or scale the cooked axes are used as they are, the own copy only gets made the first time it is needed
+void PrepareCollider(Collider *c) {
+    if (!c->axesDirty) return;
+    c->axesDirty = false;
+    const CookedShape *s = c->cooked;
+    if (s == NULL) return; //Primitives get moved to world space per query
+    Matrix m = c->transform;
+    if (m.m0 == 1.0f && m.m1 == 0.0f && m.m2 == 0.0f && m.m4 == 0.0f && m.m5 == 1.0f && m.m6 == 0.0f &&
+        m.m8 == 0.0f && m.m9 == 0.0f && m.m10 == 1.0f) {
+        c->worldNormals = s->normals;
+        c->worldEdges = s->edges;
+        c->worldEdgeNormals = s->edgeNormals;
+        return;
+    }
+    if (c->worldAxes == NULL) {//One block for all three
+        size_t count = s->numNormals + s->numEdges + (s->edgeNormals != NULL ? s->numEdges * 2 : 0);
+        c->worldAxes = (Vector3 *)(c->arena != NULL ? ArenaAlloc(c->arena, count * sizeof(Vector3)) : malloc(count * sizeof(Vector3)));
+    }
+    c->worldNormals = c->worldAxes;
+    c->worldEdges = c->worldNormals + s->numNormals;
+    c->worldEdgeNormals = s->edgeNormals != NULL ? c->worldEdges + s->numEdges : NULL;
+    Matrix inverse = MatrixInvert(m);
+    for (int i = 0; i < s->numNormals; i++) c->worldNormals[i] = Vector3Normalize(TransformTransposed(inverse, s->normals[i]));
+    for (int i = 0; i < s->numEdges; i++) {
+        c->worldEdges[i] = Vector3Normalize(TransformDirection(m, s->edges[i]));
+        if (s->edgeNormals == NULL) continue;
+        c->worldEdgeNormals[i * 2] = Vector3Normalize(TransformTransposed(inverse, s->edgeNormals[i * 2]));
+        c->worldEdgeNormals[i * 2 + 1] = Vector3Normalize(TransformTransposed(inverse, s->edgeNormals[i * 2 + 1]));
+    }
+}
+
+Vector3 ColliderCenter(const Collider *c) {
+    return Vector3Transform(c->localCenter, c->transform);
+}
 
-    for (int i = 1; i < b.numPoints; i++) { //Loop trough the vertices
-        //Find the dot product between the vertex and the axis
-        float dot = Vector3DotProduct(b.transformedPoints[i], axis);
-        //Check if the dot is smaller then min, if it is set the new min
-        if (dot < *min) {
-            *min = dot;
+//Project count points (count must be a multiple of COLLISION_SIMD_WIDTH) onto COLLISION_AXIS_BATCH axes in one pass.
+//Every path computes x*ax + y*ay + z*az in the same order as Vector3DotProduct so the results are bit identical.
+//Only the sign of a zero isnt, -0 and 0 tie and which one wins depends on the lane it was in, so both come out as 0
+void ProjectPointsSoA(const float *xs, const float *ys, const float *zs, int count, const Vector3 *axes, float *mins, float *maxs) {
+#if COLLISION_SIMD_WIDTH == 8
+    __m256 ax[COLLISION_AXIS_BATCH], ay[COLLISION_AXIS_BATCH], az[COLLISION_AXIS_BATCH];
+    __m256 vmin[COLLISION_AXIS_BATCH], vmax[COLLISION_AXIS_BATCH];
+    for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {//Broadcast the axes and init the accumulators
+        ax[k] = _mm256_set1_ps(axes[k].x);
+        ay[k] = _mm256_set1_ps(axes[k].y);
+        az[k] = _mm256_set1_ps(axes[k].z);
+        vmin[k] = _mm256_set1_ps(FLT_MAX);
+        vmax[k] = _mm256_set1_ps(-FLT_MAX);
+    }
+    for (int i = 0; i < count; i += 8) {//Load 8 points once and reuse them for every axis
+        __m256 x = _mm256_loadu_ps(xs + i), y = _mm256_loadu_ps(ys + i), z = _mm256_loadu_ps(zs + i);
+        for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+            __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, ax[k]), _mm256_mul_ps(y, ay[k])), _mm256_mul_ps(z, az[k]));
+            vmin[k] = _mm256_min_ps(vmin[k], dot);
+            vmax[k] = _mm256_max_ps(vmax[k], dot);
         }
-        //Check if the dot is bigger then max, if it is set the new max
-        if (dot > *max) {
-            *max = dot;
+    }
+    for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {//Horizontal reduction, min/max is exact so the order doesnt matter (up to the sign of 0)
+        float lo[8], hi[8];
+        _mm256_storeu_ps(lo, vmin[k]);
+        _mm256_storeu_ps(hi, vmax[k]);
+        mins[k] = lo[0]; maxs[k] = hi[0];
+        for (int j = 1; j < 8; j++) {
+            if (lo[j] < mins[k]) mins[k] = lo[j];
+            if (hi[j] > maxs[k]) maxs[k] = hi[j];
         }
+        mins[k] += 0.0f; //-0 to 0
+        maxs[k] += 0.0f;
     }
+#elif COLLISION_SIMD_WIDTH == 4
+    __m128 ax[COLLISION_AXIS_BATCH], ay[COLLISION_AXIS_BATCH], az[COLLISION_AXIS_BATCH];
+    __m128 vmin[COLLISION_AXIS_BATCH], vmax[COLLISION_AXIS_BATCH];
+    for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+        ax[k] = _mm_set1_ps(axes[k].x);
+        ay[k] = _mm_set1_ps(axes[k].y);
+        az[k] = _mm_set1_ps(axes[k].z);
+        vmin[k] = _mm_set1_ps(FLT_MAX);
+        vmax[k] = _mm_set1_ps(-FLT_MAX);
+    }
+    for (int i = 0; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(xs + i), y = _mm_loadu_ps(ys + i), z = _mm_loadu_ps(zs + i);
+        for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+            __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, ax[k]), _mm_mul_ps(y, ay[k])), _mm_mul_ps(z, az[k]));
+            vmin[k] = _mm_min_ps(vmin[k], dot);
+            vmax[k] = _mm_max_ps(vmax[k], dot);
+        }
+    }
+    for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+        float lo[4], hi[4];
+        _mm_storeu_ps(lo, vmin[k]);
+        _mm_storeu_ps(hi, vmax[k]);
+        mins[k] = lo[0]; maxs[k] = hi[0];
+        for (int j = 1; j < 4; j++) {
+            if (lo[j] < mins[k]) mins[k] = lo[j];
+            if (hi[j] > maxs[k]) maxs[k] = hi[j];
+        }
+        mins[k] += 0.0f;
+        maxs[k] += 0.0f;
+    }
+#else
+    //Scalar fallback, same loop structure without the vector registers
+    for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+        mins[k] = FLT_MAX;
+        maxs[k] = -FLT_MAX;
+    }
+    for (int i = 0; i < count; i++) {
+        for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+            float dot = xs[i] * axes[k].x + ys[i] * axes[k].y + zs[i] * axes[k].z;
+            if (dot < mins[k]) mins[k] = dot;
+            if (dot > maxs[k]) maxs[k] = dot;
+        }
+    }
+    for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+        mins[k] += 0.0f;
+        maxs[k] += 0.0f;
+    }
+#endif
 }
 
-Vector3 GetMiddlePoint(Vector3 *vertices,int numVertices){
-	float x=0,y=0,z=0;//Init variables
-	for(int i = 0; i < numVertices;i++){//Iterate trought the vertices and get the sum
-       //Add all the vertex values togerher
-       x+= vertices[i].x; 
-       y+= vertices[i].y;
-       z+= vertices[i].z;
-	}
-	return(Vector3){x/numVertices,y/numVertices,z/numVertices}; //Divide the values to get the average(Middle)
-} 
+//A scale of (nearly) 0 squashes the primitive flat and leaves that axis without a direction. Rebuild it from the
+//axes that still have one, scale is 0 for the lost ones
+static void RepairPrimitiveAxes(Vector3 axes[3], const float scale[3]) {
+    int keep = 0;
+    while (keep < 3 && scale[keep] == 0.0f) keep++;
+    if (keep == 3) {//Squashed to a point, any frame does
+        axes[0] = (Vector3){ 1, 0, 0 };
+        axes[1] = (Vector3){ 0, 1, 0 };
+        axes[2] = (Vector3){ 0, 0, 1 };
+        return;
+    }
+    int a = (keep + 1) % 3, b = (keep + 2) % 3;
+    if (scale[a] == 0.0f && scale[b] == 0.0f) {//A line, any perpendicular
+        Vector3 helper = fabsf(axes[keep].x) < 0.9f ? (Vector3){ 1, 0, 0 } : (Vector3){ 0, 1, 0 };
+        axes[a] = Vector3Normalize(Vector3CrossProduct(axes[keep], helper));
+    } else if (scale[a] == 0.0f) {
+        axes[a] = Vector3Normalize(Vector3CrossProduct(axes[b], axes[keep]));
+    }
+    if (scale[b] == 0.0f) axes[b] = Vector3Normalize(Vector3CrossProduct(axes[keep], axes[a]));
+}
 
-bool CheckCollision(Collider a, Collider b, Vector3 *normal) {
-    *normal = (Vector3){0, 0, 0}; //Init normal vector
-    float depth = FLT_MAX; //Init depth as the max value it can be
+//Local primitive to world. Shear cant be represented, the radius takes the biggest scale across it so the shape only grows
+ColliderPrimitive TransformPrimitive(const ColliderPrimitive *local, Matrix transform) {
+    ColliderPrimitive world = *local;
+    float scale[3];
+    bool flat = false;
+    world.center = Vector3Transform(local->center, transform);
+    for (int i = 0; i < 3; i++) {
+        Vector3 axis = TransformDirection(transform, local->axes[i]);
+        scale[i] = Vector3Length(axis);
+        if (scale[i] > COLLISION_PARALLEL_EPSILON) {
+            world.axes[i] = Vector3Scale(axis, 1.0f / scale[i]);
+        } else {
+            scale[i] = 0.0f;
+            flat = true;
+        }
+    }
+    if (flat) RepairPrimitiveAxes(world.axes, scale);
+    world.halfExtents = (Vector3){ local->halfExtents.x * scale[0], local->halfExtents.y * scale[1], local->halfExtents.z * scale[2] };
+    float radial = fmaxf(scale[0], scale[2]);
+    world.radius = local->radius * (local->shape == COLLIDER_SPHERE ? fmaxf(radial, scale[1]) : radial);
+    world.halfHeight = local->halfHeight * scale[1];
+    return world;
+}
+
+//Get the min and max projection of the collider on up to COLLISION_AXIS_BATCH world axes.
+//The axes get moved into local space so the points never have to be transformed. Primitives have no points, their
+//center gets projected and their half width goes either way
+void GetMinMaxAxes(const Collider *b, const Vector3 *axes, int numAxes, float *mins, float *maxs) {
+    if (b->cooked == NULL) {
+        ColliderPrimitive world = TransformPrimitive(&b->primitive, b->transform);
+        for (int k = 0; k < numAxes; k++) {
+            float length = Vector3Length(axes[k]);
+            float center = Vector3DotProduct(world.center, axes[k]);
+            float half = length > 0.0f ? PrimitiveHalfWidth(&world, Vector3Scale(axes[k], 1.0f / length)) * length : 0.0f;
+            mins[k] = center - half;
+            maxs[k] = center + half;
+        }
+        return;
+    }
+    Vector3 batch[COLLISION_AXIS_BATCH];
+    float offset[COLLISION_AXIS_BATCH];
+    float lo[COLLISION_AXIS_BATCH], hi[COLLISION_AXIS_BATCH];
+    Vector3 translation = { b->transform.m12, b->transform.m13, b->transform.m14 };
+    for (int k = 0; k < COLLISION_AXIS_BATCH; k++) {
+        //Fill the unused slots with the last axis so the kernel always runs a full batch
+        Vector3 axis = axes[k < numAxes ? k : numAxes - 1];
+        batch[k] = TransformTransposed(b->transform, axis);
+        offset[k] = Vector3DotProduct(translation, axis);
+    }
+    ProjectPointsSoA(b->cooked->soaX, b->cooked->soaY, b->cooked->soaZ, b->cooked->numPadded, batch, lo, hi);
+    PROFILE_COUNT("points_projected", b->cooked->numPadded);
+    for (int k = 0; k < numAxes; k++) {
+        mins[k] = lo[k] + offset[k];
+        maxs[k] = hi[k] + offset[k];
+    }
+}
 
-    for (int i = 0; i < a.numNormals; i++) {
-        float min1, max1, min2, max2;
-       GetMinMax(a, a.normals[i], &min2, &max2);
-       GetMinMax(b, a.normals[i], &min1, &max1);
+void GetMinMax(Collider b, Vector3 axis, float *min, float *max) {
+    GetMinMaxAxes(&b, &axis, 1, min, max);
+}
 
-        if (max1 < min2 || max2 < min1) {
+//Project both colliders on a batch of axes and test them in order. Returns false as soon as one axis separates them,
+//separating then gets that axis turned to point from b to a (pass NULL if it doesnt matter)
+bool TestAxisBatch(const Collider *a, const Collider *b, const Vector3 *axes, int count, float *depth, Vector3 *normal, Vector3 *separating) {
+    float min1[COLLISION_AXIS_BATCH], max1[COLLISION_AXIS_BATCH], min2[COLLISION_AXIS_BATCH], max2[COLLISION_AXIS_BATCH];
+    GetMinMaxAxes(a, axes, count, min2, max2);
+    GetMinMaxAxes(b, axes, count, min1, max1);
+
+    for (int k = 0; k < count; k++) {
+        if (max1[k] < min2[k] || max2[k] < min1[k]) {
+            if (separating != NULL) *separating = max1[k] < min2[k] ? axes[k] : Vector3Negate(axes[k]);
             return false;  // No collision on this axis
         } else {
-            float axisDepth = fminf(max2 - min1, max1 - min2);
-            if (axisDepth < depth) {
-                depth = axisDepth;
-                *normal = a.normals[i];
+            //Push a whichever way is shorter along this axis, the sign comes from the overlap itself
+            float pushPositive = max1[k] - min2[k], pushNegative = max2[k] - min1[k];
+            float axisDepth = fminf(pushNegative, pushPositive);
+            if (axisDepth < *depth) {
+                *depth = axisDepth;
+                *normal = pushPositive <= pushNegative ? axes[k] : Vector3Negate(axes[k]);
             }
         }
     }
+    return true;
+}
 
-    for (int i = 0; i < b.numNormals; i++) {
-        float min1, max1, min2, max2;
-        GetMinMax(a, b.normals[i], &min2, &max2);
-        GetMinMax(b, b.normals[i], &min1, &max1);
+/*Two edges only need an axis if their arcs on the gauss map cross, meaning they form a face of the
+minkowski difference. a, b are the normals next to the first edge, c, d the negated normals of the second*/
+bool IsMinkowskiFace(Vector3 a, Vector3 b, Vector3 c, Vector3 d) {
+    Vector3 bxa = Vector3CrossProduct(b, a);
+    Vector3 dxc = Vector3CrossProduct(d, c);
+    float cba = Vector3DotProduct(c, bxa);
+    float dba = Vector3DotProduct(d, bxa);
+    float adc = Vector3DotProduct(a, dxc);
+    float bdc = Vector3DotProduct(b, dxc);
+    return cba * dba < 0.0f && adc * bdc < 0.0f && cba * bdc > 0.0f;
+}
 
-        if (max1 < min2 || max2 < min1) {
-            return false;  // No collision on this axis
+//SAT on the world axes, call PrepareCollider on both first. separating is the axis that split them when they dont touch.
+//Hulls only, primitives have no face and edge axes to test (CheckCollisionPair picks their test) and count as a miss
+bool CheckCollisionSAT(const Collider *a, const Collider *b, Vector3 *normal, Vector3 *separating) {
+    *normal = (Vector3){0, 0, 0}; //Init normal vector
+    if (a->cooked == NULL || b->cooked == NULL) {
+        if (separating != NULL) *separating = (Vector3){ 0, 0, 0 };
+        return false;
+    }
+    float depth = FLT_MAX; //Init depth as the max value it can be
+    int numAxes = a->cooked->numNormals + b->cooked->numNormals; //Normals of a first, then the normals of b
+    Vector3 axes[COLLISION_AXIS_BATCH];
+
+    //Face axes, projected a batch per pass
+    for (int first = 0; first < numAxes; first += COLLISION_AXIS_BATCH) {
+        int count = numAxes - first < COLLISION_AXIS_BATCH ? numAxes - first : COLLISION_AXIS_BATCH;
+        for (int k = 0; k < count; k++) {
+            int i = first + k;
+            axes[k] = i < a->cooked->numNormals ? a->worldNormals[i] : b->worldNormals[i - a->cooked->numNormals];
+        }
+        if (!TestAxisBatch(a, b, axes, count, &depth, normal, separating)) return false;
+    }
+
+    //Edge-edge axes, only for the pairs that form a face of the minkowski difference
+    int count = 0;
+    for (int i = 0; i < a->cooked->numEdges; i++) {
+        for (int j = 0; j < b->cooked->numEdges; j++) {
+            if (a->cooked->edgeNormals != NULL && b->cooked->edgeNormals != NULL &&
+                !IsMinkowskiFace(a->worldEdgeNormals[i * 2], a->worldEdgeNormals[i * 2 + 1],
+                                 Vector3Negate(b->worldEdgeNormals[j * 2]), Vector3Negate(b->worldEdgeNormals[j * 2 + 1]))) continue;
+            Vector3 axis = Vector3CrossProduct(a->worldEdges[i], b->worldEdges[j]);
+            float length = Vector3Length(axis);
+            if (length < COLLISION_PARALLEL_EPSILON) continue; //Parallel edges, the face axes already cover it
+            axes[count++] = Vector3Scale(axis, 1.0f / length);
+            if (count == COLLISION_AXIS_BATCH) {
+                if (!TestAxisBatch(a, b, axes, count, &depth, normal, separating)) return false;
+                count = 0;
+            }
+        }
+    }
+    if (count > 0 && !TestAxisBatch(a, b, axes, count, &depth, normal, separating)) return false;
+
+    *normal = Vector3Scale(*normal, depth); //Already points from b to a
+    return true;
+}
+
+//State of the support searches of one query, the climb hint lives here so the collider itself is only read
+typedef struct {
+    const Collider *collider;
+    int hint; //Point the last support search ended on, the next one starts there
+    ColliderPrimitive world; //Primitives moved to world space
+} ColliderSupportState;
+
+//Furthest transformed point along dir. Climbs the hull from the last result, on a convex hull a vertex
+//with no better neighbour is the furthest one, so it usually only looks at a handful of points
+Vector3 ColliderSupport(void *shape, Vector3 dir) {
+    ColliderSupportState *state = (ColliderSupportState *)shape;
+    const Collider *c = state->collider;
+    const CookedShape *s = c->cooked;
+    Vector3 localDir = TransformTransposed(c->transform, dir); //Same ordering as dir in world space
+    int best = state->hint;
+    float bestDot = Vector3DotProduct(s->notTransformed[best], localDir);
+    if (s->neighbors == NULL) {//Flat collider, check them all
+        for (int i = 0; i < s->numPoints; i++) {
+            float dot = Vector3DotProduct(s->notTransformed[i], localDir);
+            if (dot > bestDot) { bestDot = dot; best = i; }
+        }
+        return Vector3Transform(s->notTransformed[best], c->transform);
+    }
+    for (bool improved = true; improved;) {
+        improved = false;
+        for (int n = s->neighborStart[best]; n < s->neighborStart[best + 1]; n++) {
+            float dot = Vector3DotProduct(s->notTransformed[s->neighbors[n]], localDir);
+            if (dot > bestDot) {
+                bestDot = dot;
+                best = s->neighbors[n];
+                improved = true;
+            }
+        }
+    }
+    state->hint = best;
+    return Vector3Transform(s->notTransformed[best], c->transform);
+}
+
+//Furthest point of a world space primitive along dir
+Vector3 PrimitiveSupport(void *shape, Vector3 dir) {
+    const ColliderPrimitive *p = (const ColliderPrimitive *)shape;
+    Vector3 n = Vector3Normalize(dir);
+    switch (p->shape) {
+        case COLLIDER_SPHERE: return Vector3Add(p->center, Vector3Scale(n, p->radius));
+        case COLLIDER_CAPSULE: {
+            Vector3 end = Vector3Scale(p->axes[1], Vector3DotProduct(p->axes[1], dir) >= 0.0f ? p->halfHeight : -p->halfHeight);
+            return Vector3Add(Vector3Add(p->center, end), Vector3Scale(n, p->radius));
+        }
+        case COLLIDER_BOX: {
+            Vector3 corner = p->center;
+            float half[3] = { p->halfExtents.x, p->halfExtents.y, p->halfExtents.z };
+            for (int i = 0; i < 3; i++) corner = Vector3Add(corner, Vector3Scale(p->axes[i], Vector3DotProduct(p->axes[i], dir) >= 0.0f ? half[i] : -half[i]));
+            return corner;
+        }
+        case COLLIDER_CYLINDER: {
+            float along = Vector3DotProduct(p->axes[1], n);
+            Vector3 rim = Vector3Add(p->center, Vector3Scale(p->axes[1], along >= 0.0f ? p->halfHeight : -p->halfHeight));
+            Vector3 radial = Vector3Subtract(n, Vector3Scale(p->axes[1], along));
+            float length = Vector3Length(radial);
+            if (length > 1e-6f) rim = Vector3Add(rim, Vector3Scale(radial, p->radius / length)); //Straight along the axis any cap point will do
+            return rim;
+        }
+        default: return p->center;
+    }
+}
+
+//Closest point to p on the segment a-b
+static Vector3 ClosestPointOnSegment(Vector3 a, Vector3 b, Vector3 p) {
+    Vector3 ab = Vector3Subtract(b, a);
+    float lengthSqr = Vector3DotProduct(ab, ab);
+    if (lengthSqr < 1e-12f) return a;
+    return Vector3Add(a, Vector3Scale(ab, Clamp(Vector3DotProduct(Vector3Subtract(p, a), ab) / lengthSqr, 0.0f, 1.0f)));
+}
+
+//Closest points between the segments p1-q1 and p2-q2, from Real-Time Collision Detection 5.1.9
+static void ClosestPointsSegments(Vector3 p1, Vector3 q1, Vector3 p2, Vector3 q2, Vector3 *c1, Vector3 *c2) {
+    Vector3 d1 = Vector3Subtract(q1, p1), d2 = Vector3Subtract(q2, p2), r = Vector3Subtract(p1, p2);
+    float a = Vector3DotProduct(d1, d1), e = Vector3DotProduct(d2, d2), f = Vector3DotProduct(d2, r);
+    float s = 0.0f, t = 0.0f;
+    if (a < 1e-12f && e < 1e-12f) {//Both are points
+    } else if (a < 1e-12f) {
+        t = Clamp(f / e, 0.0f, 1.0f);
+    } else {
+        float c = Vector3DotProduct(d1, r);
+        if (e < 1e-12f) {
+            s = Clamp(-c / a, 0.0f, 1.0f);
         } else {
-            float axisDepth = fminf(max2 - min1, max1 - min2);
-            if (axisDepth < depth) {
-                depth = axisDepth;
-                *normal = b.normals[i];
+            float b = Vector3DotProduct(d1, d2);
+            float denom = a * e - b * b;
+            if (denom > 1e-12f) s = Clamp((b * f - c * e) / denom, 0.0f, 1.0f); //Parallel segments pick s = 0
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = Clamp(-c / a, 0.0f, 1.0f);
+            } else if (t > 1.0f) {
+                t = 1.0f;
+                s = Clamp((b - c) / a, 0.0f, 1.0f);
             }
         }
     }
+    *c1 = Vector3Add(p1, Vector3Scale(d1, s));
+    *c2 = Vector3Add(p2, Vector3Scale(d2, t));
+}
 
-    // Simplify direction calculation
-    Vector3 direction = Vector3Subtract(GetMiddlePoint(a.transformedPoints, a.numPoints), GetMiddlePoint(b.transformedPoints,b.numPoints));
+//Closest point of the box to p, points inside map to themselves
+static Vector3 ClosestPointOnBox(const ColliderPrimitive *box, Vector3 p) {
+    Vector3 d = Vector3Subtract(p, box->center), q = box->center;
+    float half[3] = { box->halfExtents.x, box->halfExtents.y, box->halfExtents.z };
+    for (int i = 0; i < 3; i++) q = Vector3Add(q, Vector3Scale(box->axes[i], Clamp(Vector3DotProduct(d, box->axes[i]), -half[i], half[i])));
+    return q;
+}
 
-    if (Vector3DotProduct(direction, *normal) < 0.0f) {
-        *normal = Vector3Negate(*normal);
+//Spheres of the given combined radius around pa (on a) and pb (on b). fallback is the push direction when the points are the same
+static bool CollidePoints(Vector3 pa, Vector3 pb, float radius, Vector3 fallback, Vector3 *normal) {
+    Vector3 d = Vector3Subtract(pa, pb);
+    float dist = Vector3Length(d);
+    if (dist > radius) return false;
+    Vector3 n = dist > 1e-6f ? Vector3Scale(d, 1.0f / dist) : fallback;
+    *normal = Vector3Scale(n, radius - dist);
+    return true;
+}
+
+//One SAT axis between two primitives, same rules as TestAxisBatch. n has to be unit length
+static bool PrimitiveTestAxis(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 n, float *depth, Vector3 *best) {
+    float ca = Vector3DotProduct(a->center, n), ra = PrimitiveHalfWidth(a, n);
+    float cb = Vector3DotProduct(b->center, n), rb = PrimitiveHalfWidth(b, n);
+    float pushPositive = cb + rb - (ca - ra), pushNegative = ca + ra - (cb - rb);
+    if (pushPositive < 0.0f || pushNegative < 0.0f) return false;
+    float axisDepth = fminf(pushPositive, pushNegative);
+    if (axisDepth < *depth) {
+        *depth = axisDepth;
+        *best = pushPositive <= pushNegative ? n : Vector3Negate(n);
+    }
+    return true;
+}
+
+//Cross product of two axes as a SAT axis, false if they are parallel
+static bool CrossAxis(Vector3 u, Vector3 v, Vector3 *axis) {
+    Vector3 cross = Vector3CrossProduct(u, v);
+    float length = Vector3Length(cross);
+    if (length < COLLISION_PARALLEL_EPSILON) return false;
+    *axis = Vector3Scale(cross, 1.0f / length);
+    return true;
+}
+
+/*Closed form pair tests, all in world space with the CheckCollision convention: normal pushes a out of b
+and is scaled by the depth*/
+typedef bool (*CollisionPairFunction)(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal);
+
+static bool CollideSphereSphere(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal) {
+    return CollidePoints(a->center, b->center, a->radius + b->radius, (Vector3){0, 1, 0}, normal);
+}
+
+static bool CollideSphereCapsule(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal) {
+    Vector3 end = Vector3Scale(b->axes[1], b->halfHeight);
+    Vector3 closest = ClosestPointOnSegment(Vector3Subtract(b->center, end), Vector3Add(b->center, end), a->center);
+    return CollidePoints(a->center, closest, a->radius + b->radius, AnyPerpendicular(b->axes[1]), normal);
+}
+
+static bool CollideCapsuleCapsule(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal) {
+    Vector3 endA = Vector3Scale(a->axes[1], a->halfHeight), endB = Vector3Scale(b->axes[1], b->halfHeight);
+    Vector3 onA, onB;
+    ClosestPointsSegments(Vector3Subtract(a->center, endA), Vector3Add(a->center, endA),
+                          Vector3Subtract(b->center, endB), Vector3Add(b->center, endB), &onA, &onB);
+    //Crossing segments, push along their common perpendicular
+    Vector3 fallback;
+    if (!CrossAxis(a->axes[1], b->axes[1], &fallback)) fallback = AnyPerpendicular(a->axes[1]);
+    if (Vector3DotProduct(fallback, Vector3Subtract(a->center, b->center)) < 0.0f) fallback = Vector3Negate(fallback);
+    return CollidePoints(onA, onB, a->radius + b->radius, fallback, normal);
+}
+
+static bool CollideSphereBox(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal) {
+    Vector3 closest = ClosestPointOnBox(b, a->center);
+    if (Vector3Distance(closest, a->center) > 1e-6f) return CollidePoints(a->center, closest, a->radius, (Vector3){0, 1, 0}, normal);
+    //Center inside the box, leave trough the nearest face
+    Vector3 d = Vector3Subtract(a->center, b->center);
+    float half[3] = { b->halfExtents.x, b->halfExtents.y, b->halfExtents.z };
+    float gap = FLT_MAX;
+    for (int i = 0; i < 3; i++) {
+        float along = Vector3DotProduct(d, b->axes[i]);
+        if (half[i] - fabsf(along) < gap) {
+            gap = half[i] - fabsf(along);
+            *normal = along >= 0.0f ? b->axes[i] : Vector3Negate(b->axes[i]);
+        }
     }
-    *normal = Vector3Scale(*normal, depth);
+    *normal = Vector3Scale(*normal, gap + a->radius);
     return true;
 }
 
-//Not optimal, doesn't include rotation and scaling, it's a simple demo
+static bool CollideSphereCylinder(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal) {
+    Vector3 d = Vector3Subtract(a->center, b->center);
+    float along = Vector3DotProduct(d, b->axes[1]);
+    Vector3 radial = Vector3Subtract(d, Vector3Scale(b->axes[1], along));
+    float distance = Vector3Length(radial);
+    Vector3 out = distance > 1e-6f ? Vector3Scale(radial, 1.0f / distance) : AnyPerpendicular(b->axes[1]);
+    if (fabsf(along) > b->halfHeight || distance > b->radius) {//Center outside, push away from the closest point
+        Vector3 closest = Vector3Add(b->center, Vector3Scale(b->axes[1], Clamp(along, -b->halfHeight, b->halfHeight)));
+        closest = Vector3Add(closest, Vector3Scale(out, fminf(distance, b->radius)));
+        return CollidePoints(a->center, closest, a->radius, out, normal);
+    }
+    float capGap = b->halfHeight - fabsf(along), sideGap = b->radius - distance;
+    if (capGap < sideGap) *normal = Vector3Scale(b->axes[1], along >= 0.0f ? capGap + a->radius : -(capGap + a->radius));
+    else *normal = Vector3Scale(out, sideGap + a->radius);
+    return true;
+}
+
+//Squared distance from the point t along the segment s0 + t * d to the box
+static float SegmentBoxDistanceSqr(const ColliderPrimitive *box, Vector3 s0, Vector3 d, float t) {
+    Vector3 p = Vector3Add(s0, Vector3Scale(d, t));
+    return Vector3DistanceSqr(p, ClosestPointOnBox(box, p));
+}
+
+static bool CollideCapsuleBox(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal) {
+    Vector3 end = Vector3Scale(a->axes[1], a->halfHeight);
+    Vector3 s0 = Vector3Subtract(a->center, end), d = Vector3Scale(end, 2.0f);
+    //The distance to a convex shape is convex along the segment, golden section search finds the closest point
+    float lo = 0.0f, hi = 1.0f;
+    for (int i = 0; i < 32; i++) {
+        float t0 = hi - (hi - lo) * 0.618034f, t1 = lo + (hi - lo) * 0.618034f;
+        if (SegmentBoxDistanceSqr(b, s0, d, t0) < SegmentBoxDistanceSqr(b, s0, d, t1)) hi = t1;
+        else lo = t0;
+    }
+    Vector3 onSegment = Vector3Add(s0, Vector3Scale(d, (lo + hi) * 0.5f));
+    Vector3 onBox = ClosestPointOnBox(b, onSegment);
+    if (Vector3Distance(onSegment, onBox) > 1e-6f) return CollidePoints(onSegment, onBox, a->radius, (Vector3){0, 1, 0}, normal);
+
+    //Segment goes into the box, SAT on the box faces and the segment crossed with the box edges is exact for the
+    //segment and the radius just adds the same amount on every axis
+    float depth = FLT_MAX;
+    Vector3 best = {0, 0, 0}, axis;
+    for (int i = 0; i < 3; i++) {
+        if (!PrimitiveTestAxis(a, b, b->axes[i], &depth, &best)) return false;
+        if (CrossAxis(a->axes[1], b->axes[i], &axis) && !PrimitiveTestAxis(a, b, axis, &depth, &best)) return false;
+    }
+    *normal = Vector3Scale(best, depth);
+    return true;
+}
+
+static bool CollideBoxBox(const ColliderPrimitive *a, const ColliderPrimitive *b, Vector3 *normal) {
+    float depth = FLT_MAX;
+    Vector3 best = {0, 0, 0}, axis;
+    for (int i = 0; i < 3; i++) {
+        if (!PrimitiveTestAxis(a, b, a->axes[i], &depth, &best)) return false;
+        if (!PrimitiveTestAxis(a, b, b->axes[i], &depth, &best)) return false;
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (CrossAxis(a->axes[i], b->axes[j], &axis) && !PrimitiveTestAxis(a, b, axis, &depth, &best)) return false;
+        }
+    }
+    *normal = Vector3Scale(best, depth);
+    return true;
+}
+
+//Closed form test for every primitive pair that has one, only [a][b] with a <= b is filled and the other half is
+//found by swapping. Empty slots (and anything with a hull) go to GJK on the support functions
+static const CollisionPairFunction collisionPairTable[COLLIDER_SHAPE_COUNT][COLLIDER_SHAPE_COUNT] = {
+    [COLLIDER_SPHERE][COLLIDER_SPHERE] = CollideSphereSphere,
+    [COLLIDER_SPHERE][COLLIDER_CAPSULE] = CollideSphereCapsule,
+    [COLLIDER_SPHERE][COLLIDER_BOX] = CollideSphereBox,
+    [COLLIDER_SPHERE][COLLIDER_CYLINDER] = CollideSphereCylinder,
+    [COLLIDER_CAPSULE][COLLIDER_CAPSULE] = CollideCapsuleCapsule,
+    [COLLIDER_CAPSULE][COLLIDER_BOX] = CollideCapsuleBox,
+    [COLLIDER_BOX][COLLIDER_BOX] = CollideBoxBox,
+};
+
+//Support shape for any collider, state has to outlive the result. The hull climb starts from the collider's last hint
+SupportShape ColliderSupportShape(const Collider *c, ColliderSupportState *state) {
+    state->collider = c;
+    state->hint = c->supportHint;
+    if (c->primitive.shape == COLLIDER_HULL) return (SupportShape){ state, ColliderSupport, ColliderCenter(c) };
+    state->world = TransformPrimitive(&c->primitive, c->transform);
+    return (SupportShape){ &state->world, PrimitiveSupport, state->world.center };
+}
+
+//GJK starting along start, between the centers if it is NULL. separating like GjkIntersectFrom
+static bool CheckCollisionGJKFrom(Collider *a, const Collider *b, const Vector3 *start, Vector3 *normal, Vector3 *separating) {
+    ColliderSupportState stateA, stateB;
+    SupportShape sa = ColliderSupportShape(a, &stateA), sb = ColliderSupportShape(b, &stateB);
+    bool hit = GjkIntersectFrom(&sa, &sb, start != NULL ? *start : Vector3Subtract(sa.center, sb.center), normal, separating);
+    a->supportHint = stateA.hint;
+    return hit;
+}
+
+//Same result convention as CheckCollision, normal is the push from b to a scaled by the depth
+//Only a keeps its hint for next time, b is just read so any number of threads can test against it at once
+bool CheckCollisionGJK(Collider *a, const Collider *b, Vector3 *normal) {
+    return CheckCollisionGJKFrom(a, b, NULL, normal, NULL);
+}
+
+#define COLLISION_CAST_SKIN 0.005f //Casts stop this far before touching, so the next one starts out separated
+#define COLLISION_CAST_TOLERANCE 1e-4f //How exact the distances of a cast are
+#define COLLISION_CAST_ITERATIONS 32 //Advancement steps before a cast gives up and reports a hit where it got to
+
+//b shape moved by offset, the cast moves a along its motion without touching the collider
+typedef struct {
+    SupportShape shape;
+    Vector3 offset;
+} MovedSupportState;
+
+static Vector3 MovedSupport(void *shape, Vector3 dir) {
+    MovedSupportState *state = (MovedSupportState *)shape;
+    return Vector3Add(state->shape.support(state->shape.shape, dir), state->offset);
+}
+
+//Spheres and capsules are cast as their center point or segment with the radius kept aside, GJK converges
+//much faster on the core and the radius just comes off the distance
+static SupportShape CastSupportShape(const Collider *c, ColliderSupportState *state, float *margin) {
+    SupportShape shape = ColliderSupportShape(c, state);
+    *margin = 0.0f;
+    if (c->primitive.shape == COLLIDER_SPHERE || c->primitive.shape == COLLIDER_CAPSULE) {
+        *margin = state->world.radius;
+        state->world.radius = 0.0f;
+    }
+    return shape;
+}
+
+//CastCollider against any support shape, marginB is a radius kept aside from it like CastSupportShape does (0 for
+//plain shapes). How scenequery.h casts against its triangles
+bool CastColliderShape(Collider *a, Vector3 motion, SupportShape *sb, float marginB, float *toi, Vector3 *normal, Vector3 *separating) {
+    ColliderSupportState stateA;
+    float marginA;
+    MovedSupportState moved = { CastSupportShape(a, &stateA, &marginA), { 0, 0, 0 } };
+    SupportShape sa = { &moved, MovedSupport, moved.shape.center };
+    float margin = marginA + marginB;
+    float t = 0.0f;
+    bool hit = false;
+    if (separating != NULL) *separating = (Vector3){ 0, 0, 0 };
+    for (int iteration = 0; iteration < COLLISION_CAST_ITERATIONS; iteration++) {
+        moved.offset = Vector3Scale(motion, t);
+        sa.center = Vector3Add(moved.shape.center, moved.offset);
+        Vector3 separation;
+        float distance = GjkDistance(&sa, sb, COLLISION_CAST_TOLERANCE, &separation);
+        if (distance <= 0.0f) {//Cores overlap, deeper then the discrete push outs leave things. Take the push direction from EPA
+            if (!GjkIntersect(&sa, sb, &separation) || Vector3LengthSqr(separation) < 1e-12f) break;
+            *normal = Vector3Normalize(separation);
+            hit = Vector3DotProduct(motion, *normal) < 0.0f;
+            *toi = t;
+            break;
+        }
+        Vector3 n = Vector3Scale(separation, 1.0f / distance);
+        float gap = distance - margin;
+        if (iteration == 0 && gap > 0.0f && separating != NULL) *separating = n;
+        float closing = -Vector3DotProduct(motion, n); //How fast the gap shrinks, per whole motion
+        if (closing <= 1e-6f * Vector3Length(motion)) break; //Moving apart or along, the distance of convex shapes cant drop again
+        if (gap <= COLLISION_CAST_SKIN || iteration == COLLISION_CAST_ITERATIONS - 1) {
+            *normal = n;
+            *toi = t;
+            hit = true;
+            break;
+        }
+        t += (gap - COLLISION_CAST_SKIN * 0.5f) / closing; //Lands in the middle of the skin so the next step ends the cast
+        if (t > 1.0f) break; //Doesnt get there this motion
+    }
+    a->supportHint = stateA.hint;
+    return hit;
+}
+
+/*Time of impact of a moving by motion (without rotating) against b, conservative advancement on the GJK distance.
+Every step moves a as far as it can go without the shapes getting closer then the skin, which they cant as long as it
+doesnt go further then distance / closing speed. Returns true if they meet within the motion, toi is the fraction of
+the motion up to the contact and normal the unit contact normal from b to a. Already touching counts as a hit at 0
+only when moving into b, so something resting on a surface can still slide along it. Only a is written (its hint).
+If they start out apart separating gets the direction between them before moving, an axis that splits them.
+Zero otherwise, pass NULL if it doesnt matter*/
+bool CastCollider(Collider *a, Vector3 motion, const Collider *b, float *toi, Vector3 *normal, Vector3 *separating) {
+    ColliderSupportState stateB;
+    float marginB;
+    SupportShape sb = CastSupportShape(b, &stateB, &marginB);
+    return CastColliderShape(a, motion, &sb, marginB, toi, normal, separating);
+}
+
+typedef enum {
+    COLLISION_METHOD_AUTO, //GJK once either collider has COLLISION_GJK_MIN_POINTS points, SAT otherwise
+    COLLISION_METHOD_SAT,
+    COLLISION_METHOD_GJK
+} CollisionMethod;
+
+#define COLLISION_GJK_MIN_POINTS 32 //SAT cost grows with the point count, GJK barely does
+
+/*CheckCollisionPair where GJK starts its search along start (NULL for between the centers) and separating gets the
+unit axis from b to a that split them when they dont touch. The closed form primitive tests dont find one, separating
+is zero then. Pass NULL if it doesnt matter*/
+bool CheckCollisionPairFrom(Collider *a, Collider *b, CollisionMethod method, const Vector3 *start, Vector3 *normal, Vector3 *separating) {
+    ColliderShape shapeA = a->primitive.shape, shapeB = b->primitive.shape;
+    if (separating != NULL) *separating = (Vector3){ 0, 0, 0 };
+    PROFILE_COUNT("pair_tests", 1);
+    if (shapeA != COLLIDER_HULL || shapeB != COLLIDER_HULL) {
+        bool swapped = collisionPairTable[shapeA][shapeB] == NULL;
+        CollisionPairFunction test = swapped ? collisionPairTable[shapeB][shapeA] : collisionPairTable[shapeA][shapeB];
+        if (test == NULL) return CheckCollisionGJKFrom(a, b, start, normal, separating);
+        ColliderPrimitive worldA = TransformPrimitive(&a->primitive, a->transform);
+        ColliderPrimitive worldB = TransformPrimitive(&b->primitive, b->transform);
+        *normal = (Vector3){0, 0, 0};
+        if (!swapped) return test(&worldA, &worldB, normal);
+        bool hit = test(&worldB, &worldA, normal);
+        *normal = Vector3Negate(*normal);
+        return hit;
+    }
+    if (method == COLLISION_METHOD_AUTO) {
+        bool big = a->cooked->numPoints >= COLLISION_GJK_MIN_POINTS || b->cooked->numPoints >= COLLISION_GJK_MIN_POINTS;
+        method = big ? COLLISION_METHOD_GJK : COLLISION_METHOD_SAT;
+    }
+    if (method == COLLISION_METHOD_GJK) return CheckCollisionGJKFrom(a, b, start, normal, separating);
+    PrepareCollider(a);
+    PrepareCollider(b);
+    return CheckCollisionSAT(a, b, normal, separating);
+}
+
+//Narrowphase for any two colliders. Primitive pairs use their closed form test, method only picks between SAT and GJK for two hulls.
+//Once PrepareCollider has run on b nothing here writes to it, so threads can share the same b
+bool CheckCollisionPair(Collider *a, Collider *b, CollisionMethod method, Vector3 *normal) {
+    return CheckCollisionPairFrom(a, b, method, NULL, normal, NULL);
+}
+
+//SAT only. Takes the colliders themselves, a copy would rebuild (and allocate) its world axes on every call
+bool CheckCollision(Collider *a, Collider *b, Vector3 *normal) {
+    return CheckCollisionPair(a, b, COLLISION_METHOD_SAT, normal);
+}
+
+//Set the local to world transform. Only the world bounds are refreshed right away, the axes wait until the
+//next query and only if the rotation or scale changed, setting the same transform again costs nothing
+void SetColliderTransform(Collider *c, Matrix transform) {
+    if (memcmp(&transform, &c->transform, sizeof(Matrix)) == 0) return; //Nothing moved
+    Matrix old = c->transform;
+    c->transform = transform;
+    if (old.m0 != transform.m0 || old.m1 != transform.m1 || old.m2 != transform.m2 ||
+        old.m4 != transform.m4 || old.m5 != transform.m5 || old.m6 != transform.m6 ||
+        old.m8 != transform.m8 || old.m9 != transform.m9 || old.m10 != transform.m10) c->axesDirty = true;
+
+    //Transform the local box, the extent on every world axis is the sum of the absolute matrix row times the local extent
+    Vector3 center = Vector3Transform(Vector3Scale(Vector3Add(c->localMin, c->localMax), 0.5f), transform);
+    Vector3 half = Vector3Scale(Vector3Subtract(c->localMax, c->localMin), 0.5f);
+    Vector3 extent = {
+        fabsf(transform.m0) * half.x + fabsf(transform.m4) * half.y + fabsf(transform.m8) * half.z,
+        fabsf(transform.m1) * half.x + fabsf(transform.m5) * half.y + fabsf(transform.m9) * half.z,
+        fabsf(transform.m2) * half.x + fabsf(transform.m6) * half.y + fabsf(transform.m10) * half.z
+    };
+    c->boundsMin = Vector3Subtract(center, extent);
+    c->boundsMax = Vector3Add(center, extent);
+    if (c->broadphase != NULL) BroadphaseMove(c->broadphase, c->proxy, c->boundsMin, c->boundsMax);
+}
+
+//Translation only shortcut, what most of the game uses
 void UpdateCollider(Vector3 parent,Collider *c){
-    //Loop trough the points and add them to the 
-    for(int i = 0; i < c->numPoints;i++){
-        c->transformedPoints[i] = Vector3Add( c->notTransformed[i],parent);
+    SetColliderTransform(c, MatrixTranslate(parent.x, parent.y, parent.z));
+}
+
+//Add the collider to a broadphase, id is what BroadphaseQuery returns for it (usually the index in the collider array)
+void RegisterCollider(Broadphase *bp, Collider *c, int id) {
+    c->broadphase = bp;
+    c->proxy = BroadphaseInsert(bp, c->boundsMin, c->boundsMax, id);
+}
+
+//Memory a query needs that isnt worth allocating every time, keep one per thread and reuse it
+typedef struct {
+    int *candidates;
+    int capCandidates;
+} CollisionScratch;
+
+/*Ids of the registered colliders whose bounds overlap min/max, sorted and without repeats so they always get resolved
+in the same order. Only reads the broadphase, so threads with their own scratch can all query the same one*/
+int QueryColliders(const Broadphase *bp, Vector3 min, Vector3 max, CollisionScratch *scratch) {
+    int count = BroadphaseQueryShared(bp, min, max, scratch->candidates, scratch->capCandidates);
+    if (count > scratch->capCandidates) {//Didnt fit, grow and run it again
+        scratch->capCandidates = count > 32 ? count * 2 : 64;
+        scratch->candidates = (int *)realloc(scratch->candidates, scratch->capCandidates * sizeof(int));
+        count = BroadphaseQueryShared(bp, min, max, scratch->candidates, scratch->capCandidates);
+    }
+    int *ids = scratch->candidates;
+    for (int i = 1; i < count; i++) {//Insertion sort, there are only ever a handful
+        int id = ids[i];
+        int j = i - 1;
+        for (; j >= 0 && ids[j] > id; j--) ids[j + 1] = ids[j];
+        ids[j + 1] = id;
+    }
+    int unique = 0;
+    for (int i = 0; i < count; i++)
+        if (unique == 0 || ids[unique - 1] != ids[i]) ids[unique++] = ids[i];
+    PROFILE_COUNT("broadphase_candidates", unique);
+    return unique;
+}
+
+/*What the last query of a pair found, so the next one can start from it. Most pairs stay apart for a long time and
+the axis that split them last time usually still does, then one support point of each costs less then any full test.
+Keyed by the collider addresses, an entry left over from a collider that is gone only costs that one failed test since
+the cached axis is always checked for real before it is trusted. Keep one per moving collider (the player), it isnt shared*/
+typedef struct {
+    const Collider *a, *b; //NULL a is an empty slot
+    Vector3 axis; //Unit, from b to a. The axis the pair was apart on, or the last contact normal if it wasnt
+    bool separated; //axis split the pair last time
+    int hintA, hintB; //Where the support climbs ended on the axis last time
+    unsigned int lastUsed; //tick of the last lookup, entries that havent been used for a while get dropped when it grows
+} PairCacheEntry;
+
+typedef struct {
+    PairCacheEntry *entries;
+    int capacity; //Power of two, 0 until the first lookup
+    int count;
+    unsigned int tick; //Lookups so far, the clock for lastUsed
+    //Hit rate counters, nothing reads them so reset them whenever
+    long queries; //Pairs looked up
+    long found; //Pair was already in the cache
+    long earlyOuts; //Cached axis still split the pair, no full test ran
+} PairCache;
+
+#define PAIR_CACHE_MIN_CAPACITY 64
+
+static unsigned int PairHash(const Collider *a, const Collider *b) {
+    unsigned long long key = (unsigned long long)(uintptr_t)a * 0x9E3779B97F4A7C15ull ^ (unsigned long long)(uintptr_t)b * 0xC2B2AE3D27D4EB4Full;
+    return (unsigned int)(key >> 32);
+}
+
+static PairCacheEntry *FindPairSlot(PairCacheEntry *entries, int capacity, const Collider *a, const Collider *b) {
+    unsigned int i = PairHash(a, b) & (capacity - 1);
+    while (entries[i].a != NULL && (entries[i].a != a || entries[i].b != b)) i = (i + 1) & (capacity - 1);
+    return &entries[i];
+}
+
+//Rehash at half full, pairs nobody looked up for a full table worth of lookups stay behind (colliders that streamed out)
+static void GrowPairCache(PairCache *cache) {
+    int live = 0;
+    for (int i = 0; i < cache->capacity; i++)
+        if (cache->entries[i].a != NULL && cache->tick - cache->entries[i].lastUsed <= (unsigned int)cache->capacity) live++;
+    int capacity = cache->capacity ? cache->capacity : PAIR_CACHE_MIN_CAPACITY;
+    while (live * 2 >= capacity) capacity *= 2;
+    PairCacheEntry *entries = (PairCacheEntry *)calloc(capacity, sizeof(PairCacheEntry));
+    for (int i = 0; i < cache->capacity; i++) {
+        PairCacheEntry *e = &cache->entries[i];
+        if (e->a != NULL && cache->tick - e->lastUsed <= (unsigned int)cache->capacity) *FindPairSlot(entries, capacity, e->a, e->b) = *e;
+    }
+    free(cache->entries);
+    cache->entries = entries;
+    cache->capacity = capacity;
+    cache->count = live;
+}
+
+//Entry of the pair, a new one with nothing cached if it wasnt there. found tells which
+PairCacheEntry *LookupPair(PairCache *cache, const Collider *a, const Collider *b, bool *found) {
+    if ((cache->count + 1) * 2 > cache->capacity) GrowPairCache(cache);
+    PairCacheEntry *e = FindPairSlot(cache->entries, cache->capacity, a, b);
+    cache->queries++;
+    *found = e->a != NULL;
+    if (*found) cache->found++;
+    else {
+        *e = (PairCacheEntry){ .a = a, .b = b };
+        cache->count++;
+    }
+    e->lastUsed = ++cache->tick;
+    return e;
+}
+
+/*How far apart the pair is along the cached axis, one support point of each. Positive means the axis still splits
+them, which is a real answer and not a guess. The climbs start where they ended last time so hulls barely move*/
+float PairSeparation(PairCacheEntry *e, Collider *a, const Collider *b) {
+    ColliderSupportState stateA, stateB;
+    SupportShape sa = ColliderSupportShape(a, &stateA), sb = ColliderSupportShape(b, &stateB);
+    //A hint from a collider that used to live at the same address could be past the end
+    if (a->cooked != NULL && e->hintA < a->cooked->numPoints) stateA.hint = e->hintA;
+    if (b->cooked != NULL && e->hintB < b->cooked->numPoints) stateB.hint = e->hintB;
+    float separation = Vector3DotProduct(GjkSupport(&sa, &sb, Vector3Negate(e->axis)), e->axis);
+    e->hintA = stateA.hint;
+    e->hintB = stateB.hint;
+    return separation;
+}
+
+/*CheckCollisionPair that tries the pair's cached axis first. A pair that touched last time gets GJK started from the
+old normal instead. Pairs the closed form primitive tests split get their axis from a GJK run so the next query has one*/
+bool CheckCollisionCached(PairCache *cache, Collider *a, Collider *b, CollisionMethod method, Vector3 *normal) {
+    bool found;
+    PairCacheEntry *e = LookupPair(cache, a, b, &found);
+    if (found && e->separated && PairSeparation(e, a, b) > 0.0f) {
+        cache->earlyOuts++;
+        *normal = (Vector3){ 0, 0, 0 };
+        return false;
+    }
+    Vector3 separating;
+    bool hit = CheckCollisionPairFrom(a, b, method, found ? &e->axis : NULL, normal, &separating);
+    if (!hit && Vector3LengthSqr(separating) == 0.0f) {
+        ColliderSupportState stateA, stateB;
+        SupportShape sa = ColliderSupportShape(a, &stateA), sb = ColliderSupportShape(b, &stateB);
+        Vector3 mtv;
+        GjkIntersectFrom(&sa, &sb, Vector3Subtract(sa.center, sb.center), &mtv, &separating);
+    }
+    e->separated = !hit && Vector3LengthSqr(separating) > 0.0f;
+    if (e->separated) e->axis = separating;
+    else if (hit && Vector3LengthSqr(*normal) > 0.0f) e->axis = Vector3Normalize(*normal);
+    return hit;
+}
+
+//Share of lookups the cached axis answered alone
+float PairCacheHitRate(const PairCache *cache) {
+    return cache->queries > 0 ? (float)cache->earlyOuts / cache->queries : 0.0f;
+}
+
+//Forget every pair, for when the level changes. The counters stay
+void ClearPairCache(PairCache *cache) {
+    if (cache->entries != NULL) memset(cache->entries, 0, cache->capacity * sizeof(PairCacheEntry));
+    cache->count = 0;
+}
+
+void UnloadPairCache(PairCache *cache) {
+    free(cache->entries);
+    *cache = (PairCache){ 0 };
+}
+
+/*Earliest hit of a moving by motion against every registered collider it can reach, CastCollider against the ones
+in the bounds the whole move covers. hitId is the id of the collider it hits, pass NULL if it doesnt matter.
+With a cache (can be NULL) pairs whose cached axis keeps them further apart then the motion closes get skipped.
+Reads the broadphase and colliders like QueryColliders, so threads with their own scratch and cache can cast at once*/
+bool CastColliders(Collider *a, Vector3 motion, const Collider colliders[], const Broadphase *bp, CollisionScratch *scratch,
+                   PairCache *cache, float *toi, Vector3 *normal, int *hitId) {
+    Vector3 min = Vector3Min(a->boundsMin, Vector3Add(a->boundsMin, motion));
+    Vector3 max = Vector3Max(a->boundsMax, Vector3Add(a->boundsMax, motion));
+    int numCandidates = QueryColliders(bp, min, max, scratch);
+    bool hit = false;
+    *toi = 1.0f;
+    for (int c = 0; c < numCandidates; c++) {
+        int id = scratch->candidates[c];
+        PairCacheEntry *e = NULL;
+        if (cache != NULL) {
+            bool found;
+            e = LookupPair(cache, a, &colliders[id], &found);
+            //Along the axis the gap can shrink by at most the motion towards b
+            if (found && e->separated && PairSeparation(e, a, &colliders[id]) + fminf(Vector3DotProduct(motion, e->axis), 0.0f) > COLLISION_CAST_SKIN) {
+                cache->earlyOuts++;
+                continue;
+            }
+        }
+        float t;
+        Vector3 n, separating;
+        bool cast = CastCollider(a, motion, &colliders[id], &t, &n, &separating);
+        if (e != NULL) {
+            e->separated = Vector3LengthSqr(separating) > 0.0f;
+            if (e->separated) e->axis = separating;
+        }
+        if (cast && (!hit || t < *toi)) {
+            hit = true;
+            *toi = t;
+            *normal = n;
+            if (hitId != NULL) *hitId = id;
+        }
     }
+    return hit;
 }
 
+void UnloadCollisionScratch(CollisionScratch *scratch) {
+    free(scratch->candidates);
+    *scratch = (CollisionScratch){ 0 };
+}
+
+//Colliders from a ColliderStore only need this to leave the broadphase, their memory goes with the store
 void UnloadCollider(Collider *collider){
-    free(collider->normals);
-    free(collider->transformedPoints);
-    free(collider->notTransformed);
+    if (collider->broadphase != NULL) BroadphaseRemove(collider->broadphase, collider->proxy);
+    collider->broadphase = NULL;
+    if (collider->arena == NULL) free(collider->worldAxes);
+    if (collider->ownsCooked) free((void *)collider->cooked);
+    collider->worldAxes = NULL;
+    collider->cooked = NULL;
+    collider->ownsCooked = false;
 }
 
+/*Collision memory of a level. Colliders and their cooked meshes come out of one arena and every mesh gets cooked
+once no matter how many props use it, the props only point at it. Unloading the level is one ResetColliderStore,
+after the colliders left their broadphase (or the broadphase was unloaded)*/
+typedef struct {
+    Arena arena;
+    const float **meshes; //Vertex arrays cooked so far, props made from the same model share the array
+    const CookedShape **shapes; //Cooked shape of meshes[i]
+    int numShapes, capShapes;
+} ColliderStore;
+
+#define COLLIDER_STORE_BLOCK (1 << 20) //Arena block size, most test levels fit in one
+
+ColliderStore InitColliderStore(void) {
+    ColliderStore store = { 0 };
+    store.arena = InitArena(COLLIDER_STORE_BLOCK);
+    return store;
+}
+
+//Cooks the mesh the first time, after that every call with the same mesh returns the same shape
+const CookedShape *GetCookedShape(ColliderStore *store, Mesh mesh) {
+    for (int i = 0; i < store->numShapes; i++)
+        if (store->meshes[i] == mesh.vertices) return store->shapes[i];
+    if (store->numShapes == store->capShapes) {
+        store->capShapes = store->capShapes ? store->capShapes * 2 : 64;
+        store->meshes = (const float **)realloc(store->meshes, store->capShapes * sizeof(float *));
+        store->shapes = (const CookedShape **)realloc(store->shapes, store->capShapes * sizeof(CookedShape *));
+    }
+    store->meshes[store->numShapes] = mesh.vertices;
+    store->shapes[store->numShapes] = CookColliderMesh(mesh, &store->arena);
+    return store->shapes[store->numShapes++];
+}
+
+//count colliders next to each other in the arena, set them up with SetupColliderInstance
+Collider *AllocColliders(ColliderStore *store, int count) {
+    return (Collider *)ArenaAlloc(&store->arena, count * sizeof(Collider));
+}
+
+//SetupColliderMesh without the copy, the collider shares the cooked mesh with every other instance of it
+void SetupColliderInstance(ColliderStore *store, Collider *c, Mesh mesh) {
+    SetupColliderShape(c, GetCookedShape(store, mesh), &store->arena);
+}
+
+//Level unload, every collider and cooked shape from the store is gone. Keeps the arena blocks for the next level
+void ResetColliderStore(ColliderStore *store) {
+    ResetArena(&store->arena);
+    store->numShapes = 0;
+}
+
+void UnloadColliderStore(ColliderStore *store) {
+    UnloadArena(&store->arena);
+    free(store->meshes);
+    free(store->shapes);
+    *store = (ColliderStore){ 0 };
+}
 
 #endif
\ No newline at end of file
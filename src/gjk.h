@@ -0,0 +1,317 @@
+#ifndef GJK_H
+#define GJK_H
+
+#include "raylib.h" //Vector3
+#include "raymath.h"//Vector math
+
+#include <stdbool.h>
+#include <float.h>//FLT_MAX
+
+/*GJK intersection test with EPA for the penetration depth. Works on anything that can answer
+"which point of you is furthest along this direction", so the shapes only have to provide a support function.
+Based on the usual Casey Muratori / Kevin Moran formulation, the simplex is kept as a, b, c, d with a the newest point*/
+
+#define GJK_MAX_ITERATIONS 64
+#define EPA_MAX_ITERATIONS 64
+#define EPA_MAX_FACES 128
+#define EPA_MAX_LOOSE_EDGES 64
+#define EPA_TOLERANCE 0.0001f
+#define GJK_FACE_EPSILON 1e-6f //Relative, an origin this close to a face plane counts as being on it
+
+typedef Vector3 (*SupportFunction)(void *shape, Vector3 dir); //Furthest point of the shape along dir, in world space
+
+typedef struct {
+    void *shape;             //Whatever the support function needs
+    SupportFunction support;
+    Vector3 center;          //Any point inside the shape, used for the first search direction
+} SupportShape;
+
+//Support point of the minkowski difference a - b
+static inline Vector3 GjkSupport(SupportShape *a, SupportShape *b, Vector3 dir) {
+    return Vector3Subtract(a->support(a->shape, dir), b->support(b->shape, Vector3Negate(dir)));
+}
+
+//Triangle case, reduces to a line or keeps the triangle with the origin on the side of dir
+static void GjkUpdateSimplex3(Vector3 *a, Vector3 *b, Vector3 *c, Vector3 *d, int *dim, Vector3 *dir) {
+    Vector3 ab = Vector3Subtract(*b, *a), ac = Vector3Subtract(*c, *a);
+    Vector3 n = Vector3CrossProduct(ab, ac);
+    Vector3 ao = Vector3Negate(*a);
+    *dim = 2;
+    if (Vector3DotProduct(Vector3CrossProduct(ab, n), ao) > 0.0f) {//Closest to edge ab
+        *c = *a;
+        *dir = Vector3CrossProduct(Vector3CrossProduct(ab, ao), ab);
+        return;
+    }
+    if (Vector3DotProduct(Vector3CrossProduct(n, ac), ao) > 0.0f) {//Closest to edge ac
+        *b = *a;
+        *dir = Vector3CrossProduct(Vector3CrossProduct(ac, ao), ac);
+        return;
+    }
+    *dim = 3;
+    if (Vector3DotProduct(n, ao) > 0.0f) {//Above the triangle
+        *d = *c; *c = *b; *b = *a;
+        *dir = n;
+        return;
+    }
+    *d = *b; *b = *a; //Below the triangle, flip the winding
+    *dir = Vector3Negate(n);
+}
+
+/*True if the origin is clearly in front of the face with normal n trough a. Round shapes put the first two support
+points exactly opposite each other, so the origin sits on every face trough that edge and a plain > 0 test
+keeps flipping between them forever*/
+static inline bool GjkInFront(Vector3 n, Vector3 ao) {
+    return Vector3DotProduct(n, ao) > GJK_FACE_EPSILON * Vector3Length(n) * Vector3Length(ao);
+}
+
+//Tetrahedron case, returns true once the origin is inside
+static bool GjkUpdateSimplex4(Vector3 *a, Vector3 *b, Vector3 *c, Vector3 *d, int *dim, Vector3 *dir) {
+    Vector3 abc = Vector3CrossProduct(Vector3Subtract(*b, *a), Vector3Subtract(*c, *a));
+    Vector3 acd = Vector3CrossProduct(Vector3Subtract(*c, *a), Vector3Subtract(*d, *a));
+    Vector3 adb = Vector3CrossProduct(Vector3Subtract(*d, *a), Vector3Subtract(*b, *a));
+    Vector3 ao = Vector3Negate(*a);
+    *dim = 3;
+    //bcd was tested last iteration, only the three faces with a can have the origin in front
+    if (GjkInFront(abc, ao)) { *d = *c; *c = *b; *b = *a; *dir = abc; return false; }
+    if (GjkInFront(acd, ao)) { *b = *a; *dir = acd; return false; }
+    if (GjkInFront(adb, ao)) { *c = *d; *d = *b; *b = *a; *dir = adb; return false; }
+    return true;
+}
+
+typedef struct {
+    Vector3 p[3];
+    Vector3 n; //Outward unit normal
+} EpaFace;
+
+static void EpaSetFace(EpaFace *f, Vector3 p0, Vector3 p1, Vector3 p2) {
+    f->p[0] = p0; f->p[1] = p1; f->p[2] = p2;
+    f->n = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(p1, p0), Vector3Subtract(p2, p0)));
+}
+
+/*Expand the GJK tetrahedron towards the closest face of the minkowski difference.
+Returns the outward normal of that face scaled by its distance from the origin*/
+static Vector3 EpaPenetration(SupportShape *sa, SupportShape *sb, Vector3 a, Vector3 b, Vector3 c, Vector3 d) {
+    EpaFace faces[EPA_MAX_FACES];
+    Vector3 loose[EPA_MAX_LOOSE_EDGES][2];
+    int numFaces = 4;
+    EpaSetFace(&faces[0], a, b, c);
+    EpaSetFace(&faces[1], a, c, d);
+    EpaSetFace(&faces[2], a, d, b);
+    EpaSetFace(&faces[3], b, d, c);
+
+    int closest = 0;
+    float minDist = FLT_MAX;
+    for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++) {
+        //Face closest to the origin
+        minDist = FLT_MAX;
+        for (int i = 0; i < numFaces; i++) {
+            float dist = Vector3DotProduct(faces[i].p[0], faces[i].n);
+            if (dist < minDist) { minDist = dist; closest = i; }
+        }
+        Vector3 dir = faces[closest].n;
+        Vector3 p = GjkSupport(sa, sb, dir);
+        if (Vector3DotProduct(p, dir) - minDist < EPA_TOLERANCE) break; //Cant push the face out any further
+
+        //Remove every face p can see, keeping the edges that end up on the border of the hole
+        int numLoose = 0;
+        bool overflow = false;
+        for (int i = 0; i < numFaces; i++) {
+            if (Vector3DotProduct(faces[i].n, Vector3Subtract(p, faces[i].p[0])) <= 0.0f) continue;
+            for (int e = 0; e < 3; e++) {
+                Vector3 e0 = faces[i].p[e], e1 = faces[i].p[(e + 1) % 3];
+                bool found = false;
+                for (int k = 0; k < numLoose; k++) {//Shared with another removed face, so its not on the border
+                    if (Vector3Equals(loose[k][1], e0) && Vector3Equals(loose[k][0], e1)) {
+                        loose[k][0] = loose[numLoose - 1][0];
+                        loose[k][1] = loose[numLoose - 1][1];
+                        numLoose--;
+                        found = true;
+                        break;
+                    }
+                }
+                if (found) continue;
+                if (numLoose == EPA_MAX_LOOSE_EDGES) { overflow = true; break; }
+                loose[numLoose][0] = e0;
+                loose[numLoose][1] = e1;
+                numLoose++;
+            }
+            faces[i] = faces[--numFaces]; //Swap remove, look at the same slot again
+            i--;
+        }
+
+        //Patch the hole with faces to p
+        for (int k = 0; k < numLoose && numFaces < EPA_MAX_FACES; k++) {
+            EpaSetFace(&faces[numFaces], loose[k][0], loose[k][1], p);
+            if (Vector3DotProduct(faces[numFaces].p[0], faces[numFaces].n) < -EPA_TOLERANCE) {//Wound the wrong way
+                Vector3 t = faces[numFaces].p[0];
+                faces[numFaces].p[0] = faces[numFaces].p[1];
+                faces[numFaces].p[1] = t;
+                faces[numFaces].n = Vector3Negate(faces[numFaces].n);
+            }
+            numFaces++;
+        }
+        if (overflow || numFaces == EPA_MAX_FACES || numFaces == 0) break; //Out of room, use the best face so far
+    }
+    if (numFaces == 0) return (Vector3){ 0, 0, 0 };
+    //Faces might have changed since the last search if we ran out of room
+    minDist = FLT_MAX;
+    for (int i = 0; i < numFaces; i++) {
+        float dist = Vector3DotProduct(faces[i].p[0], faces[i].n);
+        if (dist < minDist) { minDist = dist; closest = i; }
+    }
+    return Vector3Scale(faces[closest].n, minDist);
+}
+
+/*GjkIntersect starting the search along dir (roughly from b to a) instead of between the centers, the last contact
+normal or separating axis of the pair makes a good start. When they dont overlap separating gets the direction that
+proved it, a unit vector from b to a that a and b lie on either side of. Pass NULL if it doesnt matter*/
+bool GjkIntersectFrom(SupportShape *sa, SupportShape *sb, Vector3 dir, Vector3 *mtv, Vector3 *separating) {
+    *mtv = (Vector3){ 0, 0, 0 };
+    Vector3 a, b, c, d = { 0 };
+    if (Vector3LengthSqr(dir) < 1e-12f) dir = (Vector3){ 1, 0, 0 };
+
+    c = GjkSupport(sa, sb, dir);
+    dir = Vector3Negate(c);
+    b = GjkSupport(sa, sb, dir);
+    if (Vector3DotProduct(b, dir) < 0.0f) {//Didnt reach the origin
+        if (separating != NULL) *separating = Vector3Normalize(Vector3Negate(dir));
+        return false;
+    }
+
+    Vector3 bc = Vector3Subtract(c, b);
+    dir = Vector3CrossProduct(Vector3CrossProduct(bc, Vector3Negate(b)), bc); //Towards the origin, perpendicular to bc
+    if (Vector3LengthSqr(dir) < 1e-12f) {//Origin is on the line, any perpendicular will do
+        dir = Vector3CrossProduct(bc, (Vector3){ 1, 0, 0 });
+        if (Vector3LengthSqr(dir) < 1e-12f) dir = Vector3CrossProduct(bc, (Vector3){ 0, 0, -1 });
+    }
+    int dim = 2;
+
+    for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++) {
+        a = GjkSupport(sa, sb, dir);
+        if (Vector3DotProduct(a, dir) < 0.0f) {//Separating axis found
+            if (separating != NULL) *separating = Vector3Normalize(Vector3Negate(dir));
+            return false;
+        }
+        dim++;
+        if (dim == 3) {
+            GjkUpdateSimplex3(&a, &b, &c, &d, &dim, &dir);
+        } else if (GjkUpdateSimplex4(&a, &b, &c, &d, &dim, &dir)) {
+            //The origin is inside a - b, push a back along the closest face
+            *mtv = Vector3Negate(EpaPenetration(sa, sb, a, b, c, d));
+            return true;
+        }
+    }
+    return false; //Didnt converge, treat it as touching but not overlapping
+}
+
+/*True if the shapes overlap. mtv is how far a has to move to stop touching b (pointing from b to a),
+the same convention CheckCollision uses*/
+bool GjkIntersect(SupportShape *sa, SupportShape *sb, Vector3 *mtv) {
+    return GjkIntersectFrom(sa, sb, Vector3Subtract(sa->center, sb->center), mtv, NULL);
+}
+
+/*Closest point to the origin on the simplex s[0..n), the simplex is cut down to the points that span it.
+Ericsons closest point on a segment/triangle with the origin as the query point*/
+static Vector3 GjkClosestSegment(Vector3 *s, int *n) {
+    Vector3 ab = Vector3Subtract(s[1], s[0]);
+    float lengthSqr = Vector3LengthSqr(ab);
+    float t = lengthSqr > 0.0f ? -Vector3DotProduct(s[0], ab) / lengthSqr : 0.0f;
+    if (t <= 0.0f) { *n = 1; return s[0]; }
+    if (t >= 1.0f) { s[0] = s[1]; *n = 1; return s[0]; }
+    *n = 2;
+    return Vector3Add(s[0], Vector3Scale(ab, t));
+}
+
+static Vector3 GjkClosestTriangle(Vector3 *s, int *n) {
+    Vector3 a = s[0], b = s[1], c = s[2];
+    Vector3 ab = Vector3Subtract(b, a), ac = Vector3Subtract(c, a);
+    float d1 = -Vector3DotProduct(ab, a), d2 = -Vector3DotProduct(ac, a);
+    if (d1 <= 0.0f && d2 <= 0.0f) { *n = 1; return a; }
+    float d3 = -Vector3DotProduct(ab, b), d4 = -Vector3DotProduct(ac, b);
+    if (d3 >= 0.0f && d4 <= d3) { s[0] = b; *n = 1; return b; }
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        *n = 2;
+        return Vector3Add(a, Vector3Scale(ab, d1 / (d1 - d3)));
+    }
+    float d5 = -Vector3DotProduct(ab, c), d6 = -Vector3DotProduct(ac, c);
+    if (d6 >= 0.0f && d5 <= d6) { s[0] = c; *n = 1; return c; }
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        s[1] = c;
+        *n = 2;
+        return Vector3Add(a, Vector3Scale(ac, d2 / (d2 - d6)));
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        s[0] = b;
+        s[1] = c;
+        *n = 2;
+        return Vector3Add(b, Vector3Scale(Vector3Subtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+    }
+    float denom = 1.0f / (va + vb + vc);
+    *n = 3;
+    return Vector3Add(a, Vector3Add(Vector3Scale(ab, vb * denom), Vector3Scale(ac, vc * denom)));
+}
+
+//Returns false if the origin is inside. A flat tetrahedron has no inside, all four faces get tried then
+static bool GjkClosestTetrahedron(Vector3 *s, int *n, Vector3 *closest) {
+    static const int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } }; //Three corners and the one left over
+    Vector3 e1 = Vector3Subtract(s[1], s[0]), e2 = Vector3Subtract(s[2], s[0]), e3 = Vector3Subtract(s[3], s[0]);
+    float volume = Vector3DotProduct(e1, Vector3CrossProduct(e2, e3));
+    float scale = Vector3LengthSqr(e1) + Vector3LengthSqr(e2) + Vector3LengthSqr(e3);
+    bool flat = fabsf(volume) <= GJK_FACE_EPSILON * scale * sqrtf(scale);
+    float best = FLT_MAX;
+    Vector3 bestSimplex[3];
+    int bestCount = 0;
+    for (int f = 0; f < 4; f++) {
+        Vector3 p0 = s[faces[f][0]], p1 = s[faces[f][1]], p2 = s[faces[f][2]];
+        Vector3 normal = Vector3CrossProduct(Vector3Subtract(p1, p0), Vector3Subtract(p2, p0));
+        float origin = -Vector3DotProduct(normal, p0), other = Vector3DotProduct(normal, Vector3Subtract(s[faces[f][3]], p0));
+        if (!flat && origin * other >= 0.0f) continue; //Origin on the inner side of this face
+        Vector3 triangle[3] = { p0, p1, p2 };
+        int count = 3;
+        Vector3 q = GjkClosestTriangle(triangle, &count);
+        if (Vector3LengthSqr(q) < best) {
+            best = Vector3LengthSqr(q);
+            *closest = q;
+            bestCount = count;
+            for (int i = 0; i < count; i++) bestSimplex[i] = triangle[i];
+        }
+    }
+    if (bestCount == 0) return false;
+    for (int i = 0; i < bestCount; i++) s[i] = bestSimplex[i];
+    *n = bestCount;
+    return true;
+}
+
+/*Distance between two shapes that dont overlap, 0 if they do. separation is the shortest vector from b to a
+(closest point of a - b to the origin), its length is the distance. Stops once a new support point gets the
+distance down by less then tolerance*/
+float GjkDistance(SupportShape *sa, SupportShape *sb, float tolerance, Vector3 *separation) {
+    Vector3 simplex[4];
+    int n = 1;
+    Vector3 dir = Vector3Subtract(sa->center, sb->center);
+    if (Vector3LengthSqr(dir) < 1e-12f) dir = (Vector3){ 1, 0, 0 };
+    simplex[0] = GjkSupport(sa, sb, dir);
+    Vector3 v = simplex[0];
+    *separation = (Vector3){ 0, 0, 0 };
+    for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++) {
+        float distanceSqr = Vector3LengthSqr(v);
+        if (distanceSqr < 1e-12f) return 0.0f; //Origin on the simplex, touching
+        Vector3 w = GjkSupport(sa, sb, Vector3Negate(v));
+        float distance = sqrtf(distanceSqr);
+        if (distance - Vector3DotProduct(v, w) / distance <= tolerance) break; //w cant get any closer, v is the closest point
+        simplex[n++] = w;
+        Vector3 closest = v;
+        if (n == 2) closest = GjkClosestSegment(simplex, &n);
+        else if (n == 3) closest = GjkClosestTriangle(simplex, &n);
+        else if (!GjkClosestTetrahedron(simplex, &n, &closest)) return 0.0f; //Origin inside, overlapping
+        if (Vector3LengthSqr(closest) >= distanceSqr) break; //No progress, rounding
+        v = closest;
+    }
+    *separation = v;
+    return Vector3Length(v);
+}
+
+#endif
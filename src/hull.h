@@ -0,0 +1,264 @@
+#ifndef HULL_H
+#define HULL_H
+
+#include "raylib.h" //Vector3
+#include "raymath.h"//Vector math
+
+#include <stdlib.h>//Memory operations
+#include <float.h>//FLT_MAX
+#include <stdbool.h>
+
+/*Quickhull for collision cooking. The input is a point cloud (an unindexed triangle soup is fine,
+duplicates get removed first), the output is the hull vertices and counter clockwise triangles.
+Runs once per mesh at load time so it favours simple over fast.*/
+
+typedef struct {
+    Vector3 *points;  //Hull vertices, only the ones the triangles use
+    int numPoints;
+    int *triangles;   //3 indices per triangle, counter clockwise seen from outside
+    int numTriangles;
+} ConvexHull;
+
+typedef struct {
+    int v[3];     //Vertex indices into the input points
+    int adj[3];   //Face on the other side of edge v[i] -> v[i + 1]
+    Vector3 n;    //Outward normal
+    float d;      //Plane offset, dot(n, p) = d for points on the face
+    int outside;  //First point of the outside list, -1 if empty
+    bool alive;
+} HullFace;
+
+static int HullComparePoints(const void *a, const void *b) {
+    const Vector3 *p = (const Vector3 *)a, *q = (const Vector3 *)b;
+    if (p->x != q->x) return p->x < q->x ? -1 : 1;
+    if (p->y != q->y) return p->y < q->y ? -1 : 1;
+    if (p->z != q->z) return p->z < q->z ? -1 : 1;
+    return 0;
+}
+
+//Sort and drop exact duplicates in place, a triangle soup repeats every shared vertex. Returns the new count
+int WeldPoints(Vector3 *points, int numPoints) {
+    if (numPoints == 0) return 0;
+    qsort(points, numPoints, sizeof(Vector3), HullComparePoints);
+    int count = 1;
+    for (int i = 1; i < numPoints; i++) {
+        if (HullComparePoints(&points[i], &points[count - 1]) != 0) points[count++] = points[i];
+    }
+    return count;
+}
+
+static int HullAddFace(HullFace **faces, int *numFaces, int *capFaces, const Vector3 *p, int a, int b, int c) {
+    if (*numFaces == *capFaces) {
+        *capFaces = *capFaces ? *capFaces * 2 : 64;
+        *faces = (HullFace *)realloc(*faces, *capFaces * sizeof(HullFace));
+    }
+    HullFace *f = &(*faces)[(*numFaces)++];
+    f->v[0] = a; f->v[1] = b; f->v[2] = c;
+    f->n = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(p[b], p[a]), Vector3Subtract(p[c], p[a])));
+    f->d = Vector3DotProduct(f->n, p[a]);
+    f->outside = -1;
+    f->alive = true;
+    return *numFaces - 1;
+}
+
+//Give the point to the face it is furthest in front of, points that are inside every face are dropped
+static void HullAssign(HullFace *faces, int firstFace, int numFaces, const Vector3 *p, int point, int *next, float eps) {
+    int best = -1;
+    float bestDist = eps;
+    for (int f = firstFace; f < numFaces; f++) {
+        if (!faces[f].alive) continue;
+        float dist = Vector3DotProduct(faces[f].n, p[point]) - faces[f].d;
+        if (dist > bestDist) {
+            bestDist = dist;
+            best = f;
+        }
+    }
+    if (best != -1) {
+        next[point] = faces[best].outside;
+        faces[best].outside = point;
+    }
+}
+
+//Returns false if the points are flat or there are less then 4 of them
+bool BuildConvexHull(const Vector3 *points, int numPoints, ConvexHull *hull) {
+    *hull = (ConvexHull){ 0 };
+    if (numPoints < 4) return false;
+
+    //Scale the tolerance to the size of the mesh
+    Vector3 lo = points[0], hi = points[0];
+    int extremes[6] = { 0 }; //min x, max x, min y, max y, min z, max z
+    for (int i = 1; i < numPoints; i++) {
+        if (points[i].x < points[extremes[0]].x) extremes[0] = i;
+        if (points[i].x > points[extremes[1]].x) extremes[1] = i;
+        if (points[i].y < points[extremes[2]].y) extremes[2] = i;
+        if (points[i].y > points[extremes[3]].y) extremes[3] = i;
+        if (points[i].z < points[extremes[4]].z) extremes[4] = i;
+        if (points[i].z > points[extremes[5]].z) extremes[5] = i;
+        lo = Vector3Min(lo, points[i]);
+        hi = Vector3Max(hi, points[i]);
+    }
+    Vector3 size = Vector3Subtract(hi, lo);
+    float eps = 1e-5f * (fabsf(size.x) + fabsf(size.y) + fabsf(size.z));
+
+    //Starting tetrahedron, the widest pair of extremes, then the point furthest from that line, then from that plane
+    int i0 = extremes[0], i1 = extremes[1];
+    for (int axis = 1; axis < 3; axis++) {
+        int a = extremes[axis * 2], b = extremes[axis * 2 + 1];
+        if (Vector3DistanceSqr(points[a], points[b]) > Vector3DistanceSqr(points[i0], points[i1])) { i0 = a; i1 = b; }
+    }
+    if (Vector3Distance(points[i0], points[i1]) <= eps) return false;
+
+    Vector3 lineDir = Vector3Normalize(Vector3Subtract(points[i1], points[i0]));
+    int i2 = -1;
+    float bestDist = eps;
+    for (int i = 0; i < numPoints; i++) {
+        Vector3 rel = Vector3Subtract(points[i], points[i0]);
+        float dist = Vector3Length(Vector3Subtract(rel, Vector3Scale(lineDir, Vector3DotProduct(rel, lineDir))));
+        if (dist > bestDist) { bestDist = dist; i2 = i; }
+    }
+    if (i2 == -1) return false; //All on a line
+
+    Vector3 planeN = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(points[i1], points[i0]), Vector3Subtract(points[i2], points[i0])));
+    int i3 = -1;
+    bestDist = eps;
+    for (int i = 0; i < numPoints; i++) {
+        float dist = fabsf(Vector3DotProduct(Vector3Subtract(points[i], points[i0]), planeN));
+        if (dist > bestDist) { bestDist = dist; i3 = i; }
+    }
+    if (i3 == -1) return false; //All on a plane
+
+    HullFace *faces = NULL;
+    int numFaces = 0, capFaces = 0;
+    int *next = (int *)malloc(numPoints * sizeof(int)); //Outside list links
+
+    //Wind the tetrahedron so every face points away from the fourth point
+    if (Vector3DotProduct(Vector3Subtract(points[i3], points[i0]), planeN) > 0.0f) { int t = i1; i1 = i2; i2 = t; }
+    HullAddFace(&faces, &numFaces, &capFaces, points, i0, i1, i2);
+    HullAddFace(&faces, &numFaces, &capFaces, points, i0, i3, i1);
+    HullAddFace(&faces, &numFaces, &capFaces, points, i1, i3, i2);
+    HullAddFace(&faces, &numFaces, &capFaces, points, i2, i3, i0);
+    for (int f = 0; f < 4; f++) {//Link the 4 faces, every edge a -> b has a twin b -> a
+        for (int e = 0; e < 3; e++) {
+            int a = faces[f].v[e], b = faces[f].v[(e + 1) % 3];
+            for (int g = 0; g < 4; g++)
+                for (int k = 0; k < 3; k++)
+                    if (faces[g].v[k] == b && faces[g].v[(k + 1) % 3] == a) faces[f].adj[e] = g;
+        }
+    }
+    for (int i = 0; i < numPoints; i++) {
+        if (i == i0 || i == i1 || i == i2 || i == i3) continue;
+        HullAssign(faces, 0, numFaces, points, i, next, eps);
+    }
+
+    int *visible = NULL, capVisible = 0;
+    int *horizon = NULL, capHorizon = 0; //Edge start, edge end and the hidden face across it
+    int scan = 0; //Faces before this one have no outside points, new points only ever go to new faces
+    for (;;) {
+        //Next face with points in front of it, take the furthest of them
+        while (scan < numFaces && !(faces[scan].alive && faces[scan].outside != -1)) scan++;
+        if (scan == numFaces) break;
+        int face = scan;
+        int eye = faces[face].outside;
+        float eyeDist = -FLT_MAX;
+        for (int p = faces[face].outside; p != -1; p = next[p]) {
+            float dist = Vector3DotProduct(faces[face].n, points[p]) - faces[face].d;
+            if (dist > eyeDist) { eyeDist = dist; eye = p; }
+        }
+
+        //Every face the eye can see gets replaced, flood filled from the starting face so the set stays connected
+        int numVisible = 0;
+        if (capVisible == 0) visible = (int *)malloc((capVisible = 32) * sizeof(int));
+        faces[face].alive = false; //Doubles as the visited flag, everything visible dies anyway
+        visible[numVisible++] = face;
+        int numHorizon = 0;
+        for (int i = 0; i < numVisible; i++) {
+            HullFace *f = &faces[visible[i]];
+            for (int e = 0; e < 3; e++) {
+                int g = f->adj[e];
+                if (!faces[g].alive) continue; //Already visible
+                //No tolerance here, hiding a face the eye is barely above folds the new faces inward
+                if (Vector3DotProduct(faces[g].n, points[eye]) - faces[g].d > 0.0f) {
+                    faces[g].alive = false;
+                    if (numVisible == capVisible) {
+                        capVisible *= 2;
+                        visible = (int *)realloc(visible, capVisible * sizeof(int));
+                    }
+                    visible[numVisible++] = g;
+                } else {//Hidden neighbour, the shared edge is on the horizon
+                    if (numHorizon * 3 + 3 > capHorizon) {
+                        capHorizon = capHorizon ? capHorizon * 2 : 96;
+                        horizon = (int *)realloc(horizon, capHorizon * sizeof(int));
+                    }
+                    horizon[numHorizon * 3] = f->v[e];
+                    horizon[numHorizon * 3 + 1] = f->v[(e + 1) % 3];
+                    horizon[numHorizon * 3 + 2] = g;
+                    numHorizon++;
+                }
+            }
+        }
+
+        //The visible faces are already dead, their outside points become orphans
+        int orphans = -1;
+        for (int i = 0; i < numVisible; i++) {
+            HullFace *f = &faces[visible[i]];
+            for (int p = f->outside, n; p != -1; p = n) {
+                n = next[p];
+                next[p] = orphans;
+                orphans = p;
+            }
+        }
+
+        //Fan the horizon to the eye, keeping the winding of the old faces
+        int firstNew = numFaces;
+        for (int i = 0; i < numHorizon; i++) {
+            int a = horizon[i * 3], b = horizon[i * 3 + 1], hidden = horizon[i * 3 + 2];
+            int f = HullAddFace(&faces, &numFaces, &capFaces, points, a, b, eye);
+            faces[f].adj[0] = hidden;
+            for (int k = 0; k < 3; k++) //Point the hidden face back at the new one
+                if (faces[hidden].v[k] == b && faces[hidden].v[(k + 1) % 3] == a) faces[hidden].adj[k] = f;
+        }
+        //Neighbouring new faces share the edge from a horizon vertex to the eye
+        for (int f = firstNew; f < numFaces; f++) {
+            for (int g = firstNew; g < numFaces; g++) {
+                if (faces[g].v[0] == faces[f].v[1]) { faces[f].adj[1] = g; faces[g].adj[2] = f; } //f: b -> eye, g: eye -> b
+            }
+        }
+        for (int p = orphans, n; p != -1; p = n) {
+            n = next[p];
+            if (p != eye) HullAssign(faces, firstNew, numFaces, points, p, next, eps);
+        }
+    }
+    free(visible);
+    free(horizon);
+
+    //Compact, keep only the vertices the surviving faces use
+    int *remap = next; //Reuse the link array
+    for (int i = 0; i < numPoints; i++) remap[i] = -1;
+    for (int f = 0; f < numFaces; f++) if (faces[f].alive) hull->numTriangles++;
+    hull->triangles = (int *)malloc(hull->numTriangles * 3 * sizeof(int));
+    hull->points = (Vector3 *)malloc(numPoints * sizeof(Vector3));
+    int t = 0;
+    for (int f = 0; f < numFaces; f++) {
+        if (!faces[f].alive) continue;
+        for (int k = 0; k < 3; k++) {
+            int v = faces[f].v[k];
+            if (remap[v] == -1) {
+                remap[v] = hull->numPoints;
+                hull->points[hull->numPoints++] = points[v];
+            }
+            hull->triangles[t++] = remap[v];
+        }
+    }
+    hull->points = (Vector3 *)realloc(hull->points, hull->numPoints * sizeof(Vector3));
+    free(next);
+    free(faces);
+    return true;
+}
+
+void UnloadConvexHull(ConvexHull *hull) {
+    free(hull->points);
+    free(hull->triangles);
+    *hull = (ConvexHull){ 0 };
+}
+
+#endif
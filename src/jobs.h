@@ -0,0 +1,157 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>//sysconf
+#include "profiler.h"
+
+/*Work stealing thread pool for parallel for loops. RunJobs splits 0..count into chunks of grain indices and
+deals them out evenly, every worker eats its own queue from the front and when that is empty steals single
+chunks from the back of the others, so uneven work still balances out. The calling thread works too as worker 0.
+fn gets the worker index so it can use per worker scratch memory, which index ends up on which worker changes
+from run to run, so results must only depend on the index. Not reentrant, dont call RunJobs from inside a job*/
+
+#define JOBS_MAX_WORKERS 64
+
+typedef void (*JobFunction)(void *data, int index, int worker);
+
+typedef struct {
+    pthread_mutex_t lock;
+    int begin, end; //Chunks not taken yet, the owner takes from begin and thieves from end
+    char pad[64]; //Keep queues off each others cache lines
+} JobQueue;
+
+typedef struct JobSystem JobSystem;
+
+typedef struct {
+    JobSystem *jobs;
+    int worker;
+} JobWorkerStart;
+
+struct JobSystem {
+    int numWorkers; //Including the thread that calls RunJobs
+    pthread_t threads[JOBS_MAX_WORKERS];
+    JobWorkerStart starts[JOBS_MAX_WORKERS];
+    JobQueue queues[JOBS_MAX_WORKERS];
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake, done;
+    unsigned int generation; //Bumped for every RunJobs, wakes the workers
+    int busy; //Workers still going on the current run
+    bool quit;
+
+    //Current run
+    JobFunction fn;
+    void *data;
+    int count, grain;
+};
+
+static int JobPop(JobQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    int chunk = q->begin < q->end ? q->begin++ : -1;
+    pthread_mutex_unlock(&q->lock);
+    return chunk;
+}
+
+static int JobSteal(JobQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    int chunk = q->begin < q->end ? --q->end : -1;
+    pthread_mutex_unlock(&q->lock);
+    return chunk;
+}
+
+//Work until every queue is empty
+static void JobDrain(JobSystem *jobs, int worker) {
+    for (;;) {
+        int chunk = JobPop(&jobs->queues[worker]);
+        for (int k = 1; chunk < 0 && k < jobs->numWorkers; k++) chunk = JobSteal(&jobs->queues[(worker + k) % jobs->numWorkers]);
+        if (chunk < 0) return;
+        int end = (chunk + 1) * jobs->grain;
+        if (end > jobs->count) end = jobs->count;
+        PROFILE_BEGIN("job");
+        for (int i = chunk * jobs->grain; i < end; i++) jobs->fn(jobs->data, i, worker);
+        PROFILE_END();
+    }
+}
+
+static void *JobWorkerMain(void *arg) {
+    JobWorkerStart *start = (JobWorkerStart *)arg;
+    JobSystem *jobs = start->jobs;
+    unsigned int seen = 0;
+    PROFILE_THREAD("jobs");
+    pthread_mutex_lock(&jobs->lock);
+    for (;;) {
+        while (jobs->generation == seen && !jobs->quit) pthread_cond_wait(&jobs->wake, &jobs->lock);
+        if (jobs->quit) break;
+        seen = jobs->generation;
+        pthread_mutex_unlock(&jobs->lock);
+        JobDrain(jobs, start->worker);
+        pthread_mutex_lock(&jobs->lock);
+        if (--jobs->busy == 0) pthread_cond_signal(&jobs->done);
+    }
+    pthread_mutex_unlock(&jobs->lock);
+    return NULL;
+}
+
+//numWorkers 0 uses one per core. The threads keep a pointer to jobs, so it cant move until UnloadJobSystem
+void InitJobSystem(JobSystem *jobs, int numWorkers) {
+    if (numWorkers <= 0) numWorkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (numWorkers < 1) numWorkers = 1;
+    if (numWorkers > JOBS_MAX_WORKERS) numWorkers = JOBS_MAX_WORKERS;
+    *jobs = (JobSystem){ 0 };
+    jobs->numWorkers = numWorkers;
+    pthread_mutex_init(&jobs->lock, NULL);
+    pthread_cond_init(&jobs->wake, NULL);
+    pthread_cond_init(&jobs->done, NULL);
+    for (int i = 0; i < numWorkers; i++) pthread_mutex_init(&jobs->queues[i].lock, NULL);
+    for (int i = 1; i < numWorkers; i++) {
+        jobs->starts[i] = (JobWorkerStart){ jobs, i };
+        pthread_create(&jobs->threads[i], NULL, JobWorkerMain, &jobs->starts[i]);
+    }
+}
+
+void UnloadJobSystem(JobSystem *jobs) {
+    pthread_mutex_lock(&jobs->lock);
+    jobs->quit = true;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+    for (int i = 1; i < jobs->numWorkers; i++) pthread_join(jobs->threads[i], NULL);
+    for (int i = 0; i < jobs->numWorkers; i++) pthread_mutex_destroy(&jobs->queues[i].lock);
+    pthread_cond_destroy(&jobs->wake);
+    pthread_cond_destroy(&jobs->done);
+    pthread_mutex_destroy(&jobs->lock);
+}
+
+//Calls fn(data, i, worker) for every i in 0..count and returns once all of them are done
+void RunJobs(JobSystem *jobs, JobFunction fn, void *data, int count, int grain) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    int chunks = (count + grain - 1) / grain;
+    if (jobs->numWorkers == 1 || chunks == 1) {//Not worth waking anyone
+        for (int i = 0; i < count; i++) fn(data, i, 0);
+        return;
+    }
+    //The workers are all asleep here, the lock below publishes the queues to them
+    for (int w = 0; w < jobs->numWorkers; w++) {
+        jobs->queues[w].begin = (int)((long)chunks * w / jobs->numWorkers);
+        jobs->queues[w].end = (int)((long)chunks * (w + 1) / jobs->numWorkers);
+    }
+    pthread_mutex_lock(&jobs->lock);
+    jobs->fn = fn;
+    jobs->data = data;
+    jobs->count = count;
+    jobs->grain = grain;
+    jobs->busy = jobs->numWorkers - 1;
+    jobs->generation++;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->lock);
+
+    JobDrain(jobs, 0);
+
+    pthread_mutex_lock(&jobs->lock);
+    while (jobs->busy > 0) pthread_cond_wait(&jobs->done, &jobs->lock);
+    pthread_mutex_unlock(&jobs->lock);
+}
+
+#endif
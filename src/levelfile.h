@@ -0,0 +1,282 @@
+#ifndef LEVELFILE_H
+#define LEVELFILE_H
+
+#include "raylib.h"
+#include "collisions.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>//open
+#include <unistd.h>//close
+#include <sys/mman.h>//mmap
+#include <sys/stat.h>//fstat
+
+/* Cooked level files, the colliders of a level in a form that gets used straight out of the page cache.
+ * header: "SCLV", version, shape and instance counts, offsets of the two tables and the size of the file
+ * shape table: one LevelShapeRecord per cooked mesh, the same as a CookedShape but with file offsets for pointers
+ * instance table: one LevelInstanceRecord per collider, transform, world bounds and the world axes if it is rotated
+ * after that the arrays, each one starting on a LEVEL_FILE_ALIGNMENT boundary so the SIMD loads work in place.
+ * Written by bench/cook from a layout file. Numbers are as they are in memory, little endian on everything we build for.
+ * Offsets count from the start of the level, so a level can also sit inside a bigger file (the sectors of a world file)
+ * Loading maps the file read only and fills in one CookedShape per mesh and one Collider per instance, nothing
+ * gets parsed or copied, the points and axes are only read from disk once a query touches them. Counts, offsets and
+ * indices get checked against the file, one that doesnt add up gets refused like a wrong header */
+
+#define LEVEL_FILE_MAGIC "SCLV"
+#define LEVEL_FILE_VERSION 2 //2 pads the points to COLLISION_PAD_WIDTH, 1 padded to the SIMD width of the build that cooked it
+#define LEVEL_FILE_ALIGNMENT 64 //Cache line, more then the SIMD loads need
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t numShapes, numInstances;
+    uint64_t shapes, instances; //Offsets of the tables
+    uint64_t size; //Of the whole file, a cut off file gets refused
+} LevelFileHeader;
+
+typedef struct {
+    ColliderPrimitive primitive; //COLLIDER_HULL, or the primitive the mesh was fitted to and then everything else is empty
+    int32_t numPoints, numNormals, numEdges, numPadded;
+    int32_t numNeighbors; //0 for flat shapes, they have no adjacency
+    int32_t hasEdgeNormals;
+    Vector3 localMin, localMax, localCenter;
+    uint64_t points, normals, edges, edgeNormals, neighbors, neighborStart, soa; //File offsets, 0 for an empty array
+} LevelShapeRecord;
+
+typedef struct {
+    Matrix transform;
+    Vector3 boundsMin, boundsMax;
+    int32_t shape; //Index in the shape table
+    int32_t numAxes; //World normals, edges and edge normals in one array, 0 if not rotated or scaled so the cooked ones are used
+    uint64_t axes;
+} LevelInstanceRecord;
+
+typedef struct {
+    const void *data; //The mapping, NULL if nothing is loaded
+    size_t size;
+    CookedShape *shapes; //In the store, the arrays point into the mapping
+    int numShapes;
+    Collider *colliders; //In the store, in the order of the layout file
+    int numColliders; //-1 if the file is missing or not a level
+} LevelFile;
+
+//Pads the file up to the alignment and writes the array there, returns its offset from base or 0 for an empty array
+static uint64_t WriteLevelArray(FILE *file, long base, const void *data, size_t bytes) {
+    static const char zeros[LEVEL_FILE_ALIGNMENT] = { 0 };
+    if (data == NULL || bytes == 0) return 0;
+    long at = ftell(file) - base;
+    long pad = (LEVEL_FILE_ALIGNMENT - at % LEVEL_FILE_ALIGNMENT) % LEVEL_FILE_ALIGNMENT;
+    fwrite(zeros, 1, pad, file);
+    fwrite(data, 1, bytes, file);
+    return (uint64_t)(at + pad);
+}
+
+/*Write colliders and the shapes they were set up from at the current position of file, colliderShapes[i] is the index
+of the shape collider i uses. The colliders need their transform set and PrepareCollider called so the world axes get
+saved with them. Leaves the file at the end of the level*/
+bool WriteLevelFile(FILE *file, const CookedShape *const shapes[], int numShapes, const Collider colliders[], const int colliderShapes[], int numColliders) {
+    long base = ftell(file);
+    LevelFileHeader header = { 0 };
+    memcpy(header.magic, LEVEL_FILE_MAGIC, 4);
+    header.version = LEVEL_FILE_VERSION;
+    header.numShapes = numShapes;
+    header.numInstances = numColliders;
+    //Zeroed tables first so the offsets are known, they get written again once the arrays are in
+    LevelShapeRecord *shapeRecords = (LevelShapeRecord *)calloc(numShapes + 1, sizeof(LevelShapeRecord));
+    LevelInstanceRecord *instanceRecords = (LevelInstanceRecord *)calloc(numColliders + 1, sizeof(LevelInstanceRecord));
+    fwrite(&header, sizeof(header), 1, file);
+    header.shapes = WriteLevelArray(file, base, shapeRecords, numShapes * sizeof(LevelShapeRecord));
+    header.instances = WriteLevelArray(file, base, instanceRecords, numColliders * sizeof(LevelInstanceRecord));
+
+    for (int i = 0; i < numShapes; i++) {
+        const CookedShape *s = shapes[i];
+        LevelShapeRecord *r = &shapeRecords[i];
+        r->primitive = s->primitive;
+        r->numPoints = s->numPoints;
+        r->numNormals = s->numNormals;
+        r->numEdges = s->numEdges;
+        r->numPadded = s->numPadded;
+        r->numNeighbors = s->neighbors != NULL ? s->neighborStart[s->numPoints] : 0;
+        r->hasEdgeNormals = s->edgeNormals != NULL;
+        r->localMin = s->localMin;
+        r->localMax = s->localMax;
+        r->localCenter = s->localCenter;
+        r->points = WriteLevelArray(file, base, s->notTransformed, s->numPoints * sizeof(Vector3));
+        r->normals = WriteLevelArray(file, base, s->normals, s->numNormals * sizeof(Vector3));
+        r->edges = WriteLevelArray(file, base, s->edges, s->numEdges * sizeof(Vector3));
+        r->edgeNormals = WriteLevelArray(file, base, s->edgeNormals, s->numEdges * 2 * sizeof(Vector3));
+        r->neighbors = WriteLevelArray(file, base, s->neighbors, r->numNeighbors * sizeof(int));
+        r->neighborStart = WriteLevelArray(file, base, s->neighborStart, (s->numPoints + 1) * sizeof(int));
+        r->soa = WriteLevelArray(file, base, s->soaX, 3 * s->numPadded * sizeof(float)); //X, Y and Z back to back like in the cooked block
+    }
+    for (int i = 0; i < numColliders; i++) {
+        const Collider *c = &colliders[i];
+        LevelInstanceRecord *r = &instanceRecords[i];
+        r->transform = c->transform;
+        r->boundsMin = c->boundsMin;
+        r->boundsMax = c->boundsMax;
+        r->shape = colliderShapes[i];
+        if (c->cooked != NULL && c->worldAxes != NULL && c->worldNormals == c->worldAxes) {//Rotated, has its own axes
+            const CookedShape *s = c->cooked;
+            r->numAxes = s->numNormals + s->numEdges + (s->edgeNormals != NULL ? s->numEdges * 2 : 0);
+            r->axes = WriteLevelArray(file, base, c->worldAxes, r->numAxes * sizeof(Vector3));
+        }
+    }
+    header.size = (uint64_t)(ftell(file) - base);
+
+    fseek(file, base, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fseek(file, base + (long)header.shapes, SEEK_SET);
+    fwrite(shapeRecords, sizeof(LevelShapeRecord), numShapes, file);
+    fseek(file, base + (long)header.instances, SEEK_SET);
+    fwrite(instanceRecords, sizeof(LevelInstanceRecord), numColliders, file);
+    fseek(file, base + (long)header.size, SEEK_SET);
+    free(shapeRecords);
+    free(instanceRecords);
+    return !ferror(file);
+}
+
+//A level file of its own, see WriteLevelFile
+bool SaveLevelFile(const char *path, const CookedShape *const shapes[], int numShapes, const Collider colliders[], const int colliderShapes[], int numColliders) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+    bool ok = WriteLevelFile(file, shapes, numShapes, colliders, colliderShapes, numColliders);
+    return fclose(file) == 0 && ok;
+}
+
+//Pointer to an array in the mapping, clears ok if it doesnt fit in the file or is missing while bytes says it has some
+static const void *LevelFileArray(const LevelFile *level, uint64_t offset, uint64_t bytes, bool *ok) {
+    if (offset == 0) {
+        if (bytes != 0) *ok = false;
+        return NULL;
+    }
+    if (offset % LEVEL_FILE_ALIGNMENT != 0 || offset > level->size || bytes > level->size - offset) *ok = false;
+    return (const char *)level->data + offset;
+}
+
+//Counts and indices the queries trust, a broken or hostile file would have them read outside the mapping. Reads the
+//adjacency, so that gets touched once at load
+static bool LevelShapeValid(const LevelShapeRecord *r, const CookedShape *s) {
+    if ((unsigned int)r->primitive.shape >= COLLIDER_SHAPE_COUNT) return false;
+    if (r->numPoints < 0 || r->numNormals < 0 || r->numEdges < 0 || r->numPadded < 0 || r->numNeighbors < 0) return false;
+    if (r->numPadded % COLLISION_PAD_WIDTH != 0 || r->numPadded < r->numPoints) return false;
+    if ((r->hasEdgeNormals != 0) != (s->edgeNormals != NULL)) return false;
+    if ((s->neighbors == NULL) != (s->neighborStart == NULL)) return false; //The hill climb needs both
+    if (s->neighborStart == NULL) return true;
+    if (s->neighborStart[0] != 0 || s->neighborStart[r->numPoints] != r->numNeighbors) return false;
+    for (int i = 0; i < r->numPoints; i++) if (s->neighborStart[i + 1] < s->neighborStart[i]) return false;
+    for (int i = 0; i < r->numNeighbors; i++) if (s->neighbors[i] < 0 || s->neighbors[i] >= r->numPoints) return false;
+    return true;
+}
+
+//Colliders have to be out of their broadphase first, their memory goes when the store gets reset
+void UnloadLevelFile(LevelFile *level) {
+    if (level->data != NULL) munmap((void *)level->data, level->size);
+    *level = (LevelFile){ 0 };
+    level->numColliders = -1;
+}
+
+/*Map a level that is size bytes at offset in the file, size 0 for the rest of the file. offset has to be a multiple
+of the page size, mmap wants that. Otherwise the same as LoadLevelFile*/
+LevelFile LoadLevelFileRange(const char *path, uint64_t offset, uint64_t size, ColliderStore *store) {
+    LevelFile level = { 0 };
+    level.numColliders = -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return level;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || offset > (uint64_t)info.st_size) {
+        close(fd);
+        return level;
+    }
+    if (size == 0) size = (uint64_t)info.st_size - offset;
+    if (size < sizeof(LevelFileHeader) || size > (uint64_t)info.st_size - offset) {
+        close(fd);
+        return level;
+    }
+    void *data = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+    close(fd); //The mapping keeps the file open
+    if (data == MAP_FAILED) return level;
+    level.data = data;
+    level.size = (size_t)size;
+
+    const LevelFileHeader *header = (const LevelFileHeader *)data;
+    bool ok = memcmp(header->magic, LEVEL_FILE_MAGIC, 4) == 0 && header->version == LEVEL_FILE_VERSION && header->size == level.size;
+    const LevelShapeRecord *shapeRecords = NULL;
+    const LevelInstanceRecord *instanceRecords = NULL;
+    if (ok) {
+        shapeRecords = (const LevelShapeRecord *)LevelFileArray(&level, header->shapes, (uint64_t)header->numShapes * sizeof(LevelShapeRecord), &ok);
+        instanceRecords = (const LevelInstanceRecord *)LevelFileArray(&level, header->instances, (uint64_t)header->numInstances * sizeof(LevelInstanceRecord), &ok);
+    }
+    if (!ok) {
+        UnloadLevelFile(&level);
+        return level;
+    }
+
+    level.numShapes = (int)header->numShapes;
+    level.shapes = (CookedShape *)ArenaAlloc(&store->arena, (level.numShapes + 1) * sizeof(CookedShape));
+    for (int i = 0; i < level.numShapes && ok; i++) {
+        const LevelShapeRecord *r = &shapeRecords[i];
+        CookedShape *s = &level.shapes[i];
+        *s = (CookedShape){ 0 };
+        s->primitive = r->primitive;
+        s->numPoints = r->numPoints;
+        s->numNormals = r->numNormals;
+        s->numEdges = r->numEdges;
+        s->numPadded = r->numPadded;
+        s->localMin = r->localMin;
+        s->localMax = r->localMax;
+        s->localCenter = r->localCenter;
+        //The cooked arrays are never written, pointing them at the read only mapping is fine
+        s->notTransformed = (Vector3 *)LevelFileArray(&level, r->points, (uint64_t)r->numPoints * sizeof(Vector3), &ok);
+        s->normals = (Vector3 *)LevelFileArray(&level, r->normals, (uint64_t)r->numNormals * sizeof(Vector3), &ok);
+        s->edges = (Vector3 *)LevelFileArray(&level, r->edges, (uint64_t)r->numEdges * sizeof(Vector3), &ok);
+        s->edgeNormals = r->hasEdgeNormals ? (Vector3 *)LevelFileArray(&level, r->edgeNormals, (uint64_t)r->numEdges * 2 * sizeof(Vector3), &ok) : NULL;
+        s->neighbors = (int *)LevelFileArray(&level, r->neighbors, (uint64_t)r->numNeighbors * sizeof(int), &ok);
+        s->neighborStart = (int *)LevelFileArray(&level, r->neighborStart, r->numNeighbors > 0 ? (uint64_t)(r->numPoints + 1) * sizeof(int) : 0, &ok); //Flat shapes have none
+        s->soaX = (float *)LevelFileArray(&level, r->soa, (uint64_t)r->numPadded * 3 * sizeof(float), &ok);
+        s->soaY = s->soaX != NULL ? s->soaX + s->numPadded : NULL;
+        s->soaZ = s->soaX != NULL ? s->soaY + s->numPadded : NULL;
+        if (s->primitive.shape == COLLIDER_HULL && (s->notTransformed == NULL || s->soaX == NULL)) ok = false;
+        if (ok && !LevelShapeValid(r, s)) ok = false;
+    }
+
+    int numColliders = (int)header->numInstances;
+    level.colliders = AllocColliders(store, numColliders + 1);
+    for (int i = 0; i < numColliders && ok; i++) {
+        const LevelInstanceRecord *r = &instanceRecords[i];
+        Collider *c = &level.colliders[i];
+        if (r->shape < 0 || r->shape >= level.numShapes || r->numAxes < 0) {
+            ok = false;
+            break;
+        }
+        SetupColliderShape(c, &level.shapes[r->shape], &store->arena);
+        c->transform = r->transform;
+        c->boundsMin = r->boundsMin;
+        c->boundsMax = r->boundsMax;
+        if (r->numAxes > 0 && c->cooked != NULL) {//Own world axes are in the file, worldAxes stays NULL so moving it later makes a copy instead of writing here
+            const CookedShape *s = c->cooked;
+            if (r->numAxes != s->numNormals + s->numEdges + (s->edgeNormals != NULL ? s->numEdges * 2 : 0)) ok = false;
+            c->worldNormals = (Vector3 *)LevelFileArray(&level, r->axes, (uint64_t)r->numAxes * sizeof(Vector3), &ok);
+            c->worldEdges = c->worldNormals + s->numNormals;
+            c->worldEdgeNormals = s->edgeNormals != NULL ? c->worldEdges + s->numEdges : NULL;
+        } else {
+            c->axesDirty = true; //The cooked axes if it isnt rotated, otherwise they get built on the first query
+        }
+    }
+    if (!ok) {//Whatever came from the store stays there until it gets reset
+        UnloadLevelFile(&level);
+        return level;
+    }
+    level.numColliders = numColliders;
+    return level;
+}
+
+/*Map a cooked level, the shapes and colliders come out of the store. The colliders start with the transforms and
+bounds from the file, and rotated ones with the world axes from it, only moving them again makes new ones (from the
+store arena). Teardown: colliders out of the broadphase, UnloadLevelFile, then reset the store*/
+LevelFile LoadLevelFile(const char *path, ColliderStore *store) {
+    return LoadLevelFileRange(path, 0, 0, store);
+}
+
+#endif
@@ -4,6 +4,14 @@
 #include "raymath.h"
 #include "rlgl.h"
 #include "collisions.h"
+#include "player.h"
+#include "replay.h"
+#include "levelfile.h"
+#include "assets.h"
+#include "profiler.h"
+#include "renderlist.h"
+#include "net.h"
+#include "sectors.h"
 
 #define GLSL_VERSION 330
 
@@ -12,60 +20,60 @@
 #define HIRENDER_WIDTH 1920
 #define HIRENDER_HEIGHT 1080
 
-typedef enum {
-    IDLE,
-    WALKING,
-    RUNNING,
-    CROUCHING,
-    JUMPING,
-    FALLING
-} MovementState;
-
-typedef struct Player {
-    MovementState movementState;
-
-    Camera3D camera;
-
-    Model model;
-
-    Vector3 velocity; 
-    bool isMoving;
-    bool isSprinting;
-    bool isCrouching;
-    bool isJumping;
-
-    float baseFOV;
-    float sprintFOV;
-    float crouchFOV;
-    float fovSpeed;// fov transition smoothing
-
-    float targetCrouchOffset;
-    float currentCrouchOffset;
-
-    float moveSpeed;
-    float sprintSpeed;
-    float crouchSpeed;
-    float acc; // acceleratio for smoothing between states
-    float g; // gravity
-    float jumpStrength;
-
-    float walkBobAmount;
-    float sprintBobAmount;
-    float crouchBobAmount;
-
-    Collider collider;
-
-    float bobbingTime;
-    float bobbingSpeed;
-    float bobbingAmount;
-    float swayAmount; // makes bobbing a bit more smooth
-} Player;
+#define BROADPHASE_CELL_SIZE 4.0f // grid cell size of the collision broadphase
+#define ASSET_UPLOAD_BUDGET 0.004 // seconds of GPU uploads per frame, the rest waits for the next one
+#define NUM_SKIES 25 // Cubemap_Sky_01 to 25
+#define PLAYER_SPAWN (Vector3){ 0.0f, 6.0f, 0.0f } // camera position of a new player
+
+// the world streams in around the camera (make level cooks it), a sector is in while it is closer then the load
+// radius and goes once it is past the hysteresis band on top of that
+#define WORLD_PATH "../assets/levels/test.wld"
+#define WORLD_BUDGET (256u << 20) // bytes of colliders, models and textures at once
+#define WORLD_LOAD_RADIUS 96.0f
+#define WORLD_HYSTERESIS 16.0f
+
+// the skybox cubemap, the next one streams in while the old one is still on screen
+typedef struct {
+    AssetLoader *assets;
+    Model *skybox;
+    Asset *current; // NULL until the first one is in
+    int number; // Cubemap_Sky_<number> requested last
+} Sky;
+
+// a model or texture of the world, asked for while a sector that is in uses it
+typedef struct {
+    AssetLoader *assets;
+    Asset *asset; // NULL when it isnt asked for
+    bool wanted; // false once the sectors let go of it, a load still going gets dropped when it comes in
+    Color tint;
+} StreamedResource;
+
+// what the sector streamer calls back into
+typedef struct {
+    SectorStreamer *streamer;
+    StreamedResource *resources; // one per resource of the world
+} StreamedWorld;
 
 
 Player InitPlayer(Model characterModel, Model collisionModel);
-void UpdatePlayer(Player *player, int cameraMode, const int NumColliders, Collider colliders[]);
-
-int main() {
+PlayerInput ReadPlayerInput(void);
+void LoadSkyAsync(Sky *sky, int priority);
+void SwapSky(Asset *asset, void *user);
+void SetupSkyboxShader(Asset *asset, void *user);
+void SetupCubemapShader(Asset *asset, void *user);
+void SetupInstancingShader(Asset *asset, void *user);
+void StreamResource(int resource, bool acquire, void *user);
+void StreamedResourceLoaded(Asset *asset, void *user);
+void AddWorldProps(RenderList *list, const SectorStreamer *streamer, const StreamedResource resources[], const Asset *instancing);
+#ifdef PROFILER
+void DrawProfilerOverlay(void);
+#endif
+
+// ./game -record session.rec saves the input of the session, bench/replay plays it back without a window
+// ./game -connect host[:port] plays on a server (make server), the player runs ahead and the server corrects it
+// built with make PROFILE=1 F3 shows the profiler overlay and F4 saves the last few seconds to profile.json (chrome://tracing)
+int main(int argc, char **argv) {
+    PROFILE_THREAD("main");
     SetConfigFlags(FLAG_MSAA_4X_HINT); 
     // initialise window
     InitWindow(1920, 1080, "slashcast");
@@ -74,103 +82,142 @@ int main() {
     SetWindowState(FLAG_FULLSCREEN_MODE);
 
 
-    // initialise base model
-    Model character = LoadModel("../assets/models/MaleBase.glb");
-    Model characterCollision = LoadModel("../assets/models/MaleBaseCollision.glb");
+    // everything loads in the background so the window is up right away, the game starts once the level and the
+    // player are in and the rest pops in when it is ready. higher priority loads first
+    AssetLoader assets;
+    InitAssetLoader(&assets, 0);
+
+    // the world, the colliders of the sectors around the player go in the broadphase so it only tests the ones near it.
+    // their models and textures come trough the asset loader
+    Broadphase broadphase = InitBroadphase(BROADPHASE_CELL_SIZE, 16);
+    SectorStreamer streamer;
+    StreamedWorld world = { &streamer, NULL };
+    bool worldOpen = InitSectorStreamer(&streamer, WORLD_PATH, &broadphase, WORLD_BUDGET, WORLD_LOAD_RADIUS, WORLD_HYSTERESIS, StreamResource, &world);
+    if(worldOpen) {
+        world.resources = calloc(streamer.numResources + 1, sizeof(StreamedResource));
+        for(int i = 0; i < streamer.numResources; i++) {
+            world.resources[i].assets = &assets;
+            world.resources[i].tint = streamer.resources[i].tint;
+        }
+    }
+
+    // base model, and the mesh the player capsule gets sized to
+    Asset *character = LoadModelAsync(&assets, "../assets/models/MaleBase.glb", 90, NULL, NULL);
+    Asset *characterCollision = LoadModelAsync(&assets, "../assets/models/MaleBaseCollision.glb", 90, NULL, NULL);
     // Texture2D texture = LoadTexture("assets/character_texture.png");
     // character.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture;
 
-    // initialise a new player
-    Player player = InitPlayer(character, characterCollision);
-    int cameraMode = CAMERA_FIRST_PERSON;
-    DisableCursor();
-
     // shaders
-    Shader posterization = LoadShader(0, TextFormat("../assets/shaders/posterization.fs", GLSL_VERSION));
-    Shader shader = LoadShader(TextFormat("../assets/shaders/skybox.vs", GLSL_VERSION),
-                                            TextFormat("../assets/shaders/skybox.fs", GLSL_VERSION));
-
-    // test objects
-    Model Cylinder = LoadModel("../assets/models/cylinder.obj");
-    Model Floor = LoadModel("../assets/models/cube.obj");
-    Model Ramp = LoadModel("../assets/models/Ramp.obj");
-    Model Sphere = LoadModel("../assets/models/sphere.obj");
-    //Cylinder material setup
-	//Cylinder.materials[0].shader = shader;
-	Cylinder.materials[0].maps[MATERIAL_MAP_DIFFUSE].color = BLUE;
-    //Floor material setup
-    //Floor.materials[0].shader = shader;
-    Floor.materials[0].maps[MATERIAL_MAP_DIFFUSE].color = GRAY;
-    //Ramp material setup
-    //Ramp.materials[0].shader = shader;
-    Ramp.materials[0].maps[MATERIAL_MAP_DIFFUSE].color = GREEN;
-    //Sphere material setup
-    //Sphere.materials[0].shader = shader;
-    Sphere.materials[0].maps[MATERIAL_MAP_DIFFUSE].color = RED;
-
-    // skybox stuff
+    Asset *posterization = LoadShaderAsync(&assets, NULL, "../assets/shaders/posterization.fs", 80, NULL, NULL);
+
+    // skybox stuff, the shader and the sky can come in either order
     Mesh cube = GenMeshCube(1.0f, 1.0f, 1.0f);
     Model skybox = LoadModelFromMesh(cube);
-    skybox.materials[0].shader = shader;
-    SetShaderValue(skybox.materials[0].shader, GetShaderLocation(skybox.materials[0].shader, "environmentMap"), (int[1]){ MATERIAL_MAP_CUBEMAP }, SHADER_UNIFORM_INT);
-    SetShaderValue(skybox.materials[0].shader, GetShaderLocation(skybox.materials[0].shader, "doGamma"), (int[1]) { 0 }, SHADER_UNIFORM_INT);
-    SetShaderValue(skybox.materials[0].shader, GetShaderLocation(skybox.materials[0].shader, "vflipped"), (int[1]){ 0 }, SHADER_UNIFORM_INT);
-    Shader shdrCubemap = LoadShader(TextFormat("../assets/shaders/cubemap.vs", GLSL_VERSION),
-                                    TextFormat("../assets/shaders/cubemap.fs", GLSL_VERSION));
-    SetShaderValue(shdrCubemap, GetShaderLocation(shdrCubemap, "equirectangularMap"), (int[1]){ 0 }, SHADER_UNIFORM_INT);
-    Image img = LoadImage("../assets/cubemaps/Cubemap_Sky_23-512x512.png");
-    skybox.materials[0].maps[MATERIAL_MAP_CUBEMAP].texture = LoadTextureCubemap(img, CUBEMAP_LAYOUT_AUTO_DETECT);    // CUBEMAP_LAYOUT_PANORAMA
-    UnloadImage(img);
+    Asset *skyboxShader = LoadShaderAsync(&assets, "../assets/shaders/skybox.vs", "../assets/shaders/skybox.fs", 70, SetupSkyboxShader, &skybox);
+    Sky sky = { &assets, &skybox, NULL, 23 };
+    LoadSkyAsync(&sky, 70);
+    LoadShaderAsync(&assets, "../assets/shaders/cubemap.vs", "../assets/shaders/cubemap.fs", 10, SetupCubemapShader, NULL);
+
+    RenderList renderList = InitRenderList(); // rebuilt every frame, only what the camera sees gets drawn
+    // the props draw with it once it is in, the same mesh and material all go out in one draw call
+    Asset *instancing = LoadShaderAsync(&assets, "../assets/shaders/instancing.vs", "../assets/shaders/instancing.fs", 70, SetupInstancingShader, &renderList);
 
     // initialise binds
     FILE *file = fopen("../config/keybinds.ini", "r");
     /*fscanf(file, "moveForward=%d\n", &keybinds.moveForward);
     repeat for other keys
     fclose(file);*/
-    
-    // collision
-    
-    const int NumColliders = 4;
-    Collider colliders[NumColliders]; // collider array
-    Vector3 positions[NumColliders]; // positions of colliders array
-    // set positions of the colliders
-    positions[0] = (Vector3){-2, 1.0f, -2};
-	positions[1] = (Vector3){2, 1, 2};
-	positions[2] = (Vector3){0, 2, 0};
-	positions[3] = (Vector3){2, 2, -1};
-    //Setup all the collider for the meshes
-	SetupColliderMesh(&colliders[0], Ramp.meshes[0]);
-	SetupColliderMesh(&colliders[1], Cylinder.meshes[0]);
-	SetupColliderMesh(&colliders[2], Floor.meshes[0]);
-	SetupColliderMesh(&colliders[3], Sphere.meshes[0]);
-    //Update the colliders
-    for(int i = 0; i < NumColliders;i++)UpdateCollider(positions[i],&colliders[i]);
+
+    Player player = { 0 };
+    bool playing = false; // sectors around the spawn and the player are in
+    InputRecording recording = { 0 };
+    NetClient client = { .socket = -1 };
+    bool online = false;
 
     RenderTexture2D renderTarget = LoadRenderTexture(LORENDER_WIDTH, LORENDER_HEIGHT);
+#ifdef PROFILER
+    bool showProfiler = false;
+#endif
     // main game loop
     while (!WindowShouldClose()) {
-        UpdatePlayer(&player, cameraMode, NumColliders, colliders);
+        PROFILE_BEGIN("pump_assets");
+        PumpAssets(&assets, ASSET_UPLOAD_BUDGET);
+        PROFILE_END();
+        if(!playing) {
+            if(!worldOpen || character->state == ASSET_FAILED || characterCollision->state == ASSET_FAILED) {
+                TraceLog(LOG_ERROR, "cant load the player or %s, run make level", WORLD_PATH);
+                break;
+            }
+            UpdateSectorStreamer(&streamer, PLAYER_SPAWN);
+            if(streamer.stats.sectorsLoading > 0 || character->state != ASSET_READY || characterCollision->state != ASSET_READY) {
+                BeginDrawing();
+                    ClearBackground(BLACK);
+                    DrawText(TextFormat("loading %d", AssetsInFlight(&assets) + streamer.stats.sectorsLoading), 20, 20, 20, RAYWHITE);
+                EndDrawing();
+                continue;
+            }
+            // initialise a new player
+            player = InitPlayer(character->model, characterCollision->model);
+            DisableCursor();
+            if(argc > 2 && TextIsEqual(argv[1], "-record")) recording = StartInputRecording(argv[2], &player);
+            if(argc > 2 && TextIsEqual(argv[1], "-connect")) {
+                char host[256];
+                int port = NET_DEFAULT_PORT;
+                snprintf(host, sizeof(host), "%s", argv[2]);
+                char *colon = strchr(host, ':');
+                if(colon != NULL) {
+                    *colon = '\0';
+                    port = atoi(colon + 1);
+                }
+                client = InitNetClient(host, (unsigned short)port);
+                online = client.socket >= 0;
+                if(!online) TraceLog(LOG_WARNING, "cant reach %s, playing offline", argv[2]);
+            }
+            playing = true;
+        }
+        if(IsKeyPressed(KEY_N)) { // next sky, it streams in while the old one stays up
+            sky.number = sky.number % NUM_SKIES + 1;
+            LoadSkyAsync(&sky, 10);
+        }
+#ifdef PROFILER
+        if(IsKeyPressed(KEY_F3)) showProfiler = !showProfiler;
+        if(IsKeyPressed(KEY_F4)) TraceLog(ProfilerWriteTrace("profile.json") ? LOG_INFO : LOG_WARNING, "profiler trace to profile.json");
+#endif
+        PROFILE_BEGIN("input");
+        PlayerInput input = ReadPlayerInput();
+        RecordInput(&recording, input);
+        PROFILE_END();
+        PROFILE_BEGIN("stream_sectors");
+        UpdateSectorStreamer(&streamer, player.camera.position); // can move the colliders, take them after
+        PROFILE_END();
+        if(online) UpdateNetPlayer(&client, &player, input, GetTime(), streamer.colliders, &broadphase);
+        else UpdatePlayer(&player, input, streamer.colliders, &broadphase);
+        PROFILE_BEGIN("render_lowres");
         BeginTextureMode(renderTarget);
             ClearBackground(BLACK);
             // draw map
             BeginMode3D(player.camera);
                 // skybox
-                rlDisableBackfaceCulling();
-                rlDisableDepthTest();
-                DrawModel(skybox, (Vector3){0, 0, 0}, 1.0f, WHITE);
-                rlEnableDepthTest();
-                rlEnableBackfaceCulling();
+                if(skyboxShader->state == ASSET_READY && sky.current != NULL) {
+                    rlDisableBackfaceCulling();
+                    rlDisableDepthTest();
+                    DrawModel(skybox, (Vector3){0, 0, 0}, 1.0f, WHITE);
+                    rlEnableDepthTest();
+                    rlEnableBackfaceCulling();
+                }
 
                 // Draw axis lines from origin
                 DrawLine3D((Vector3){0, 0, 0}, (Vector3){1, 0, 0}, RED);     // X-axis (right)
                 DrawLine3D((Vector3){0, 0, 0}, (Vector3){0, 1, 0}, GREEN);   // Y-axis (up)
                 DrawLine3D((Vector3){0, 0, 0}, (Vector3){0, 0, 1}, BLUE);    // Z-axis (forward)
 
-                // just some test models
-                DrawModel(Floor,(Vector3){0,0,0},1,WHITE);
-                DrawModel(Cylinder,(Vector3){2,0,2},1,WHITE);
-                DrawModel(Ramp,(Vector3){-2,0,-2},1,WHITE);
-                DrawModel(Sphere,(Vector3){2,0,-1},1,WHITE);
+                // the props of the sectors that are in, culled against the camera and drawn sorted by material
+                BeginRenderList(&renderList);
+                AddWorldProps(&renderList, &streamer, world.resources, instancing);
+                Frustum frustum = CameraFrustum(player.camera, (float)LORENDER_WIDTH / LORENDER_HEIGHT);
+                CullRenderList(&renderList, &frustum);
+                SortRenderList(&renderList);
+                DrawRenderList(&renderList);
 
                 // draw player
                 Vector3 bodyPos = player.camera.position;
@@ -184,12 +231,24 @@ int main() {
                 bodyPos = Vector3Add(bodyPos, Vector3Scale(forwardCam, -0.1)); //-0.1f puts camera on eyes instead of camera inside of head
                 float camYaw = atan2f(forwardCam.x, forwardCam.z) * RAD2DEG;
                 DrawModelEx(player.model, bodyPos, (Vector3){ 0.0f, 5.0f, 0.0f}, camYaw, (Vector3){ 1.0f, 1.0f, 1.0f }, BLACK);
+
+                // the other players as the newest snapshot has them
+                const NetSnapshot *snapshot = online ? NetClientSnapshot(&client) : NULL;
+                for(int i = 0; snapshot != NULL && i < snapshot->numPlayers; i++) {
+                    const NetPlayerState *other = &snapshot->players[i];
+                    if(other->id == client.id) continue;
+                    Vector3 otherPos = NetPlayerPosition(other);
+                    otherPos.y -= 2.0f;
+                    DrawModelEx(player.model, otherPos, (Vector3){ 0.0f, 1.0f, 0.0f }, other->yaw / NET_ANGLE_SCALE * RAD2DEG, (Vector3){ 1.0f, 1.0f, 1.0f }, DARKBLUE);
+                }
             EndMode3D();
         EndTextureMode();
+        PROFILE_END();
         // render
+        PROFILE_BEGIN("blit");
         BeginDrawing();
             ClearBackground(BLACK);
-            BeginShaderMode(posterization);
+            if(posterization->state == ASSET_READY) BeginShaderMode(posterization->shader);
                 DrawTexturePro(
                         renderTarget.texture,
                         (Rectangle){ 0, 0, (float)LORENDER_WIDTH, -(float)LORENDER_HEIGHT },
@@ -198,21 +257,28 @@ int main() {
                         0.0f,
                         WHITE
                 );
-            EndShaderMode();
+            if(posterization->state == ASSET_READY) EndShaderMode();
+#ifdef PROFILER
+            if(showProfiler) DrawProfilerOverlay();
+#endif
+        PROFILE_END();
+        PROFILE_BEGIN("end_drawing"); // swap and the wait for the target fps
         EndDrawing();
+        PROFILE_END();
+        PROFILE_FRAME();
     }
 
     UnloadRenderTexture(renderTarget);
-    //Clear up all the data
-    //Shaders
-    UnloadShader(shader);
-    //Models
-    UnloadModel(Floor);
-    UnloadModel(Cylinder);
-    UnloadModel(Ramp);
-    UnloadModel(Sphere);
-    //Free the colliders
-    for(int i = 0; i < NumColliders;i++)UnloadCollider(&colliders[i]);
+    UnloadRenderList(&renderList);
+    //Clear up all the data, the loader has the shaders, models and textures
+    //The sectors go first since their colliders are in the broadphase
+    UnloadSectorStreamer(&streamer);
+    UnloadBroadphase(&broadphase);
+    UnloadAssetLoader(&assets);
+    free(world.resources);
+    UnloadPlayerPhysics(&player);
+    StopInputRecording(&recording);
+    if(online) UnloadNetClient(&client);
     CloseWindow();
     return 0;
 }
@@ -220,7 +286,7 @@ Player InitPlayer(Model characterModel, Model collisionModel) {
     Player player = { 0 }; // create new player
 
     // initialise camera on player eyelevel
-    player.camera.position = (Vector3){ 0.0f, 6.0f, 0.0f }; // camera position
+    player.camera.position = PLAYER_SPAWN; // camera position
     player.camera.target = (Vector3){ 0.0f, 2.0f, 0.0f }; // camerea looking at point
     player.camera.up = (Vector3){ 0.0f, 1.0f, 0.0f }; // up vector (rotation towards target)
     player.camera.fovy = 100.0f;
@@ -243,173 +309,126 @@ Player InitPlayer(Model characterModel, Model collisionModel) {
     player.sprintBobAmount = 0.06;
     player.crouchBobAmount = 0.00;
 
-    player.moveSpeed = 5.0f;
-    player.sprintSpeed = 7.0f;
-    player.crouchSpeed = 4.0f;
-    player.acc = 40.0f;
-
     player.model = characterModel;
+    // collide as an upright capsule sized to the collision mesh, the narrow side so the arms dont make it as wide as the T pose
+    BoundingBox bounds = GetMeshBoundingBox(collisionModel.meshes[0]);
+    Vector3 size = Vector3Subtract(bounds.max, bounds.min);
+    float radius = fminf(size.x, size.z) * 0.5f;
     Collider playerCollider;
-    SetupColliderMesh(&playerCollider, collisionModel.meshes[0]);
-    player.collider = playerCollider;
-
-    player.g = 20.0f;
-    player.jumpStrength = 7.0f;
+    SetupColliderCapsule(&playerCollider, Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5f), radius, fmaxf(size.y * 0.5f - radius, 0.0f));
+    SetupPlayerPhysics(&player, player.camera.position, playerCollider);
 
     return player;
 }
-//TODO - when holding two or more keys while spam jumping theres a delay between jumps
-// 
-// slide down ramp when crouch
-//   
-void UpdatePlayer(Player *player, int cameraMode, const int NumColliders, Collider colliders[]) {
-    Vector3 oldPos = player->camera.position;
-    float dTime = GetFrameTime(); //time in seconds for last frame drawn (delta time)
-
-    // detect movement type (sprinting or crouch walking)
-    player->isSprinting = IsKeyDown(KEY_LEFT_SHIFT);
-    player->isCrouching = IsKeyDown(KEY_LEFT_CONTROL) && !player->isJumping;
-
-    // detect movement direction
-    Vector3 dir = { 0 }; // direction
-    if(IsKeyDown(KEY_W)) // dont use else if here because can press two movement keys at once
-        dir.z += 1.0f; // forwards
-    if(IsKeyDown(KEY_S))
-        dir.z -= 1.0f; // backwards
-    if(IsKeyDown(KEY_A))
-        dir.x -= 1.0f; // left
-    if(IsKeyDown(KEY_D))
-        dir.x += 1.0f;
-
-    // normalise direction
-    float length = sqrtf(dir.x * dir.x + dir.z*dir.z);
-    if(length > 0.0f) {
-        dir.x /= length;
-        dir.z /= length;
-    }
-
-    // detect speed and change fov accordingly
-    player->bobbingAmount = player->walkBobAmount;
-    float speed = player->moveSpeed;
-    float FOV = player->baseFOV;
-    if(player->isSprinting) {
-        speed = player->sprintSpeed;
-        if(player->isMoving) {
-            FOV = player->sprintFOV;
-            player->bobbingAmount = player->sprintBobAmount;
-        }
-    }
-    if(player->isCrouching) {
-        speed = player->crouchSpeed;
-        FOV = player->crouchFOV;
-        player->bobbingAmount = player->crouchBobAmount;
-    }
-
-    // get forward vector, use horizontal components for world vector so speed doesnt change with camera rotation and yaw
-    Vector3 forward = Vector3Normalize(Vector3Subtract(player->camera.target, player->camera.position));
-    Vector3 horizontalForward = Vector3Normalize((Vector3){
-        forward.x,
-        0.0f,
-        forward.z
-    });
-    // get correct horizontal value
-    Vector3 horizontalRight = Vector3Normalize(Vector3CrossProduct(horizontalForward, player->camera.up));
-    // calculate world direction using only horizontal components
-    Vector3 worldDirection = {
-        (horizontalRight.x * dir.x + horizontalForward.x * dir.z),
-        0.0f,
-        (horizontalRight.z * dir.x + horizontalForward.z * dir.z)
-    };
-    Vector3 targetVelocity = Vector3Scale(worldDirection, speed);
-
-    // make acceleration look nicer
-    player->velocity.x += (targetVelocity.x - player->velocity.x) * player->acc * dTime;
-    player->velocity.z += (targetVelocity.z - player->velocity.z) * player->acc * dTime;
-
-    // add gravity to movement
-    player->velocity.y -= player->g * dTime;
-
-
-    // smooth fov changing when changing movement speeds
-    player->camera.fovy += (FOV - player->camera.fovy) * player->fovSpeed * dTime;
-
-    // apply movement to camera based on collision
-    UpdateCollider(player->camera.position, &player->collider);
-    for(int i = 0; i < NumColliders; i++) {
-        Vector3 collisionNormal = {0};
-        if(CheckCollision(player->collider, colliders[i], &collisionNormal)) {
-            player->camera.position = Vector3Add(player->camera.position, collisionNormal);
-            UpdateCollider(player->camera.position, &player->collider);
-            if(collisionNormal.y > 0.0f) { //0.0f is 90 degree slope (wall) 
-                player->velocity.y = 0;
-                player->isJumping = false;
-            } else{
-                if(!player->isJumping) { //for some reason when spawned the collisionNormal.y is 0, this deals with that
-                    player->velocity.y = 0;
-                }
-            }
-        
-        }
+// everything the player needs from raylib this frame
+PlayerInput ReadPlayerInput(void) {
+    PlayerInput input = { 0 };
+    input.frameTime = GetFrameTime();
+    if(IsKeyDown(KEY_W)) input.keys |= PLAYER_KEY_FORWARD;
+    if(IsKeyDown(KEY_S)) input.keys |= PLAYER_KEY_BACK;
+    if(IsKeyDown(KEY_A)) input.keys |= PLAYER_KEY_LEFT;
+    if(IsKeyDown(KEY_D)) input.keys |= PLAYER_KEY_RIGHT;
+    if(IsKeyDown(KEY_LEFT_SHIFT)) input.keys |= PLAYER_KEY_SPRINT;
+    if(IsKeyDown(KEY_LEFT_CONTROL)) input.keys |= PLAYER_KEY_CROUCH;
+    if(IsKeyPressed(KEY_SPACE)) input.pressed |= PLAYER_PRESS_JUMP;
+    input.mouseDelta = GetMouseDelta();
+    return input;
+}
+// ask for Cubemap_Sky_<sky->number>, SwapSky puts it on the skybox once it is in
+void LoadSkyAsync(Sky *sky, int priority) {
+    LoadCubemapAsync(sky->assets, TextFormat("../assets/cubemaps/Cubemap_Sky_%02d-512x512.png", sky->number),
+                     CUBEMAP_LAYOUT_AUTO_DETECT, priority, SwapSky, sky); // CUBEMAP_LAYOUT_PANORAMA
+}
+void SwapSky(Asset *asset, void *user) {
+    Sky *sky = user;
+    if(asset->state != ASSET_READY) {
+        UnloadAsset(sky->assets, asset);
+        return;
     }
-
-        // jumping
-    if(IsKeyPressed(KEY_SPACE) && !(player->isJumping) && !(player->isCrouching)) {
-        player->velocity.y = player->jumpStrength;
-        player->isJumping = true;
+    sky->skybox->materials[0].maps[MATERIAL_MAP_CUBEMAP].texture = asset->texture;
+    UnloadAsset(sky->assets, sky->current);
+    sky->current = asset;
+}
+void SetupSkyboxShader(Asset *asset, void *user) {
+    Model *skybox = user;
+    if(asset->state != ASSET_READY) return;
+    skybox->materials[0].shader = asset->shader;
+    SetShaderValue(asset->shader, GetShaderLocation(asset->shader, "environmentMap"), (int[1]){ MATERIAL_MAP_CUBEMAP }, SHADER_UNIFORM_INT);
+    SetShaderValue(asset->shader, GetShaderLocation(asset->shader, "doGamma"), (int[1]) { 0 }, SHADER_UNIFORM_INT);
+    SetShaderValue(asset->shader, GetShaderLocation(asset->shader, "vflipped"), (int[1]){ 0 }, SHADER_UNIFORM_INT);
+}
+void SetupCubemapShader(Asset *asset, void *user) {
+    if(asset->state == ASSET_READY) SetShaderValue(asset->shader, GetShaderLocation(asset->shader, "equirectangularMap"), (int[1]){ 0 }, SHADER_UNIFORM_INT);
+}
+void SetupInstancingShader(Asset *asset, void *user) {
+    if(asset->state != ASSET_READY) return;
+    // the per instance transform goes where the model matrix would, like raylib's instancing example
+    asset->shader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(asset->shader, "instanceTransform");
+    AllowRenderInstancing(user, asset->shader);
+}
+// the streamer wants a model or texture of the world or is done with it
+void StreamResource(int resource, bool acquire, void *user) {
+    StreamedWorld *world = user;
+    StreamedResource *r = &world->resources[resource];
+    const char *path = SectorResourcePath(world->streamer, resource);
+    r->wanted = acquire;
+    if(acquire && r->asset == NULL) {
+        if(world->streamer->resources[resource].type == WORLD_RESOURCE_TEXTURE) r->asset = LoadTextureAsync(r->assets, path, 50, StreamedResourceLoaded, r);
+        else if(IsFileExtension(path, ".obj")) r->asset = LoadObjAsync(r->assets, path, false, 60, StreamedResourceLoaded, r);
+        else r->asset = LoadModelAsync(r->assets, path, 60, StreamedResourceLoaded, r);
     }
-
-    player->camera.position.x += player->velocity.x * dTime;
-    player->camera.position.y += player->velocity.y * dTime;
-    player->camera.position.z += player->velocity.z * dTime;
-
-    // apply crouch change to camera y position height
-    player->targetCrouchOffset = player->isCrouching ? -0.5f : 0.0f;
-    player->currentCrouchOffset += (player->targetCrouchOffset - player->currentCrouchOffset) * 10.0f * dTime;
-    player->camera.position.y += player->currentCrouchOffset;
-
-    // jumping
-    if(IsKeyPressed(KEY_SPACE) && !(player->isJumping) && !(player->isCrouching)) {
-        player->velocity.y = player->jumpStrength;
-        player->isJumping = true;
+    if(!acquire && r->asset != NULL && r->asset->state != ASSET_PENDING) { // a pending one cant go yet, its callback drops it
+        UnloadAsset(r->assets, r->asset);
+        r->asset = NULL;
     }
-
-    // detect movement
-    player->isMoving = IsKeyDown(KEY_W) || IsKeyDown(KEY_A) ||
-                        IsKeyDown(KEY_S) || IsKeyDown(KEY_D);
-    //UpdateCamera(&player->camera, cameraMode);
-
-    // calculate head bobbing
-    float bobOff = 0.0f;
-    float swayOff = 0.0f;
-
-    if(player->isMoving) {
-        player->bobbingTime += GetFrameTime() * player->bobbingSpeed;
-        bobOff = sinf(player->bobbingTime * 2.0f) * player->bobbingAmount;
-        swayOff = sinf(player->bobbingTime * 1.0f) * player->swayAmount;
+}
+void StreamedResourceLoaded(Asset *asset, void *user) {
+    StreamedResource *r = user;
+    if(!r->wanted) { // the sectors that wanted it went while it was loading
+        UnloadAsset(r->assets, asset);
+        r->asset = NULL;
+        return;
     }
-    else {
-        player->bobbingTime = 0.0f;
+    if(asset->state == ASSET_READY && asset->type != ASSET_TEXTURE) asset->model.materials[0].maps[MATERIAL_MAP_DIFFUSE].color = r->tint;
+}
+// every prop of the sectors that are in whose model is ready, with its texture once that is ready too and drawn
+// instanced once that shader is
+void AddWorldProps(RenderList *list, const SectorStreamer *streamer, const StreamedResource resources[], const Asset *instancing) {
+    for(int i = 0; i < streamer->numResident; i++) {
+        const Sector *sector = &streamer->sectors[streamer->resident[i]];
+        if(sector->state != SECTOR_IN) continue;
+        for(uint32_t p = sector->record->firstProp; p < sector->record->firstProp + sector->record->numProps; p++) {
+            const WorldPropRecord *prop = &streamer->props[p];
+            if(prop->resource < 0) continue;
+            Asset *model = resources[prop->resource].asset;
+            if(model == NULL || model->state != ASSET_READY) continue;
+            int texture = streamer->resources[prop->resource].texture;
+            if(texture >= 0 && resources[texture].asset != NULL && resources[texture].asset->state == ASSET_READY)
+                model->model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = resources[texture].asset->texture;
+            if(instancing->state == ASSET_READY)
+                for(int m = 0; m < model->model.materialCount; m++) model->model.materials[m].shader = instancing->shader;
+            AddRenderModel(list, &model->model, prop->transform, (BoundingBox){ prop->boundsMin, prop->boundsMax });
+        }
     }
-    // apply head bobbing and swaying
-    if(!(player->isJumping) && !(player->isCrouching)) {
-        player->camera.position.x += swayOff;
-        player->camera.position.y += bobOff;
+}
+#ifdef PROFILER
+// frame times of the kept frames as a graph (the line is 60 fps), then the zones and counters of the last frame
+void DrawProfilerOverlay(void) {
+    const ProfileFrame *last = ProfileGetFrame(0);
+    int x = 10, y = 10, width = 2 * PROFILER_MAX_FRAMES;
+    DrawRectangle(x - 5, y - 5, width + 10, 120 + 12 * (profiler.numFrameZones + profiler.numCounters), Fade(BLACK, 0.75f));
+    for(int i = 0; i < PROFILER_MAX_FRAMES; i++) {
+        const ProfileFrame *frame = ProfileGetFrame(i);
+        if(frame == NULL) break;
+        float ms = (frame->end - frame->begin) * 1e-6f;
+        int height = (int)fminf(ms * 3.0f, 100.0f); // 33 ms fills it
+        DrawRectangle(x + width - 2 * (i + 1), y + 100 - height, 2, height, ms > 17.0f ? RED : GREEN);
     }
-
-    // update where camera is looking
-    Vector2 mouseDelta = GetMouseDelta();
-    float sens = 0.003f; // looking sens change this for customisation
-
-    static float yaw = 0.0f, pitch = 0.0f;
-    yaw -= mouseDelta.x * sens;
-    pitch -= mouseDelta.y * sens;
-    pitch = Clamp(pitch, -89.0f*DEG2RAD, 89.0f*DEG2RAD);
-
-    Vector3 dirr = {
-        cosf(pitch) * sinf(yaw),
-        sinf(pitch),
-        cosf(pitch) * cosf(yaw)
-    };
-    // end of sprinting jumping crouching section
-    player->camera.target = Vector3Add(player->camera.position, dirr);
-}
\ No newline at end of file
+    DrawRectangle(x, y + 50, width, 1, YELLOW);
+    y += 108;
+    for(int i = 0; i < profiler.numFrameZones; i++, y += 12)
+        DrawText(TextFormat("%-16s %7.3f ms %5d", profiler.frameZones[i].name, profiler.frameZones[i].time * 1e-6, profiler.frameZones[i].calls), x, y, 10, RAYWHITE);
+    for(int i = 0; last != NULL && i < profiler.numCounters; i++, y += 12)
+        DrawText(TextFormat("%-24s %10lld", profiler.counterNames[i], (long long)last->counters[i]), x, y, 10, SKYBLUE);
+}
+#endif
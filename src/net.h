@@ -0,0 +1,952 @@
+#ifndef NET_H
+#define NET_H
+
+#include "raylib.h"
+#include "raymath.h"
+#include "collisions.h"
+#include "player.h"
+#include "jobs.h"
+#include "profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Authoritative multiplayer over UDP. The server runs every player with the same StepPlayerScratch the game does,
+ * one physics step per numbered client command, so a player only moves when its commands come in and the client can
+ * run the exact same steps ahead of the server (prediction). The state gets rounded to the snapshot precision after
+ * every step on both sides, a snapshot of the own player is then either exactly what the client predicted for that
+ * command or the client takes it and runs the newer commands again on top (reconciliation).
+ *
+ * client -> server
+ *   connect: type, protocol version
+ *   input: type, id, token, newest snapshot it has, number of the newest command, count, then count commands newest
+ *          first (keys, pressed, yaw, pitch, 6 bytes). every packet repeats the last few so a lost one costs nothing
+ *   disconnect: type, id, token
+ * server -> client
+ *   accept: type, id, token, tick, player capsule, spawn state
+ *   full: type, no free slot
+ *   snapshot: type, sequence (server tick), baseline sequence (0 for none), last command run for this client, count,
+ *             then the players sorted by id. every player is an id step, a byte of which fields changed against the
+ *             same player in the baseline snapshot and the changes as zigzag varints. positions are sent against where
+ *             the baseline velocity would have taken the player, walking in a straight line costs nothing
+ * the baseline is the newest snapshot the client said it has, so a lost snapshot only makes the next deltas bigger.
+ * numbers are little endian, floats in the accept packet go as their bits. players dont collide with each other */
+
+#define NET_PROTOCOL 1
+#define NET_DEFAULT_PORT 27960
+#define NET_TICK_DT PHYSICS_DT // a command is one physics step, the server ticks at PHYSICS_RATE
+#define NET_SNAPSHOT_TICKS 4 // ticks per snapshot, 30 a second
+#define NET_INPUT_TICKS 2 // commands per input packet sent, 60 packets a second
+#define NET_INPUT_REDUNDANCY 8 // commands in every input packet, newest first
+#define NET_MAX_COMMANDS_PER_TICK 4 // a client cant get ahead by sending faster, a late burst still catches up
+#define NET_COMMAND_HISTORY 128 // commands kept for replaying, power of two, about a second
+#define NET_SNAPSHOT_HISTORY 16 // snapshots kept as baselines, power of two
+#define NET_SNAPSHOT_MAX_PLAYERS 32 // other players per snapshot, the closest ones
+#define NET_RELEVANT_DISTANCE 60.0f // players further away then this arent sent at all
+#define NET_MAX_PACKET 1200 // stays under the usual MTU
+#define NET_POSITION_SCALE 1024.0f // steps per meter
+#define NET_VELOCITY_SCALE 1024.0f // steps per meter per second
+#define NET_ANGLE_SCALE (65536.0f / (2.0f * PI)) // steps per radian, yaw wraps around in 16 bits
+#define NET_CLIENT_TIMEOUT 5.0 // seconds without a packet before the server drops a client
+#define NET_CONNECT_RETRY 0.25 // seconds between connect requests
+#define NET_SERVER_GRAIN 8 // clients per job
+
+// player capsule on the server, the accept packet tells the clients
+#define NET_PLAYER_CENTER (Vector3){ 0.0f, -1.0f, 0.0f }
+#define NET_PLAYER_RADIUS 0.4f
+#define NET_PLAYER_HALF_HEIGHT 0.6f
+
+enum {
+    NET_PACKET_CONNECT = 1,
+    NET_PACKET_INPUT,
+    NET_PACKET_DISCONNECT,
+    NET_PACKET_ACCEPT,
+    NET_PACKET_FULL,
+    NET_PACKET_SNAPSHOT
+};
+
+#define NET_FLAG_JUMPING (1 << 0)
+#define NET_FLAG_CROUCHING (1 << 1)
+#define NET_FLAG_SPRINTING (1 << 2)
+#define NET_FLAG_MOVING (1 << 3)
+
+// what a client did in one physics step
+typedef struct {
+    unsigned int number; // counts up from 1 per client
+    unsigned char keys; // PLAYER_KEY_*
+    unsigned char pressed; // PLAYER_PRESS_*
+    unsigned short yaw; // look angles in NET_ANGLE_SCALE steps
+    short pitch;
+} NetCommand;
+
+// one player in a snapshot, already rounded to what goes over the wire
+typedef struct {
+    unsigned short id; // slot + 1
+    int position[3]; // NET_POSITION_SCALE steps
+    int velocity[3]; // NET_VELOCITY_SCALE steps
+    unsigned short yaw;
+    short pitch;
+    unsigned char flags; // NET_FLAG_*
+} NetPlayerState;
+
+typedef struct {
+    unsigned int sequence; // server tick it was taken on, 0 for an empty slot
+    unsigned int lastCommand; // newest command of the receiving client the server has run
+    int numPlayers;
+    NetPlayerState players[NET_SNAPSHOT_MAX_PLAYERS + 1]; // sorted by id, the receiving player is one of them
+} NetSnapshot;
+
+typedef struct {
+    unsigned char data[NET_MAX_PACKET];
+    int size;
+    bool overflow; // something didnt fit, the packet is cut off and shouldnt be sent
+} NetPacket;
+
+typedef struct {
+    const unsigned char *data;
+    int size, offset;
+    bool error; // read past the end or a bad value, the rest reads as zero
+} NetReader;
+
+// packet writing and reading
+static void NetWriteByte(NetPacket *p, unsigned int value) {
+    if (p->size >= NET_MAX_PACKET) {
+        p->overflow = true;
+        return;
+    }
+    p->data[p->size++] = (unsigned char)value;
+}
+
+static void NetWriteU16(NetPacket *p, unsigned int value) {
+    NetWriteByte(p, value & 0xFF);
+    NetWriteByte(p, (value >> 8) & 0xFF);
+}
+
+static void NetWriteU32(NetPacket *p, unsigned int value) {
+    NetWriteU16(p, value & 0xFFFF);
+    NetWriteU16(p, value >> 16);
+}
+
+static void NetWriteFloat(NetPacket *p, float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    NetWriteU32(p, bits);
+}
+
+// 7 bits a byte, the high bit says another one follows
+static void NetWriteVarint(NetPacket *p, unsigned int value) {
+    while (value >= 0x80) {
+        NetWriteByte(p, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    NetWriteByte(p, value);
+}
+
+// small negative numbers stay small, -1 is 1 and 1 is 2
+static void NetWriteSigned(NetPacket *p, int value) {
+    NetWriteVarint(p, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+static unsigned int NetReadByte(NetReader *r) {
+    if (r->offset >= r->size) {
+        r->error = true;
+        return 0;
+    }
+    return r->data[r->offset++];
+}
+
+static unsigned int NetReadU16(NetReader *r) {
+    unsigned int low = NetReadByte(r);
+    return low | NetReadByte(r) << 8;
+}
+
+static unsigned int NetReadU32(NetReader *r) {
+    unsigned int low = NetReadU16(r);
+    return low | NetReadU16(r) << 16;
+}
+
+static float NetReadFloat(NetReader *r) {
+    unsigned int bits = NetReadU32(r);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static unsigned int NetReadVarint(NetReader *r) {
+    unsigned int value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned int b = NetReadByte(r);
+        value |= (b & 0x7F) << shift;
+        if (!(b & 0x80)) return value;
+    }
+    r->error = true; // more then 5 bytes
+    return 0;
+}
+
+static int NetReadSigned(NetReader *r) {
+    unsigned int value = NetReadVarint(r);
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+// rounding to the wire precision
+static int NetQuantize(float value, float scale) {
+    return (int)floorf(value * scale + 0.5f);
+}
+
+static unsigned short NetQuantizeYaw(float yaw) {
+    return (unsigned short)(NetQuantize(yaw, NET_ANGLE_SCALE) & 0xFFFF);
+}
+
+static short NetQuantizePitch(float pitch) {
+    return (short)NetQuantize(pitch, NET_ANGLE_SCALE); // clamped to 89 degrees, fits
+}
+
+NetCommand MakeNetCommand(unsigned int keys, unsigned int pressed, float yaw, float pitch) {
+    return (NetCommand){ 0, (unsigned char)keys, (unsigned char)pressed, NetQuantizeYaw(yaw), NetQuantizePitch(pitch) };
+}
+
+NetPlayerState PackNetPlayer(const Player *player, int id) {
+    NetPlayerState s = { 0 };
+    s.id = (unsigned short)id;
+    s.position[0] = NetQuantize(player->position.x, NET_POSITION_SCALE);
+    s.position[1] = NetQuantize(player->position.y, NET_POSITION_SCALE);
+    s.position[2] = NetQuantize(player->position.z, NET_POSITION_SCALE);
+    s.velocity[0] = NetQuantize(player->velocity.x, NET_VELOCITY_SCALE);
+    s.velocity[1] = NetQuantize(player->velocity.y, NET_VELOCITY_SCALE);
+    s.velocity[2] = NetQuantize(player->velocity.z, NET_VELOCITY_SCALE);
+    s.yaw = NetQuantizeYaw(player->yaw);
+    s.pitch = NetQuantizePitch(player->pitch);
+    s.flags = (player->isJumping ? NET_FLAG_JUMPING : 0) | (player->isCrouching ? NET_FLAG_CROUCHING : 0) |
+              (player->isSprinting ? NET_FLAG_SPRINTING : 0) | (player->isMoving ? NET_FLAG_MOVING : 0);
+    return s;
+}
+
+Vector3 NetPlayerPosition(const NetPlayerState *s) {
+    return (Vector3){ s->position[0] / NET_POSITION_SCALE, s->position[1] / NET_POSITION_SCALE, s->position[2] / NET_POSITION_SCALE };
+}
+
+// puts the simulation state of a snapshot on the player, the look angles stay, the own ones are the clients to decide
+void UnpackNetPlayer(Player *player, const NetPlayerState *s) {
+    player->position = NetPlayerPosition(s);
+    player->velocity = (Vector3){ s->velocity[0] / NET_VELOCITY_SCALE, s->velocity[1] / NET_VELOCITY_SCALE, s->velocity[2] / NET_VELOCITY_SCALE };
+    player->isJumping = s->flags & NET_FLAG_JUMPING;
+    player->isCrouching = s->flags & NET_FLAG_CROUCHING;
+    player->isSprinting = s->flags & NET_FLAG_SPRINTING;
+    player->isMoving = s->flags & NET_FLAG_MOVING;
+}
+
+// what the server and the client can tell apart, the angles dont change the simulation
+static bool SameNetPlayer(const NetPlayerState *a, const NetPlayerState *b) {
+    return memcmp(a->position, b->position, sizeof(a->position)) == 0 && memcmp(a->velocity, b->velocity, sizeof(a->velocity)) == 0 &&
+           a->flags == b->flags;
+}
+
+// one physics step of a command, the same on the server and in the client prediction. the result gets rounded to
+// the snapshot precision so a snapshot holds the whole state and replaying from it lands where the server did
+void StepNetPlayer(Player *player, NetCommand command, Collider colliders[], const Broadphase *broadphase, CollisionScratch *scratch) {
+    float yaw = command.yaw / NET_ANGLE_SCALE, pitch = command.pitch / NET_ANGLE_SCALE;
+    Vector3 forward = { cosf(pitch) * sinf(yaw), sinf(pitch), cosf(pitch) * cosf(yaw) };
+    player->jumpQueued = command.pressed & PLAYER_PRESS_JUMP;
+    player->previousPosition = player->position;
+    StepPlayerScratch(player, command.keys, forward, colliders, broadphase, scratch);
+    NetPlayerState s = PackNetPlayer(player, 0);
+    UnpackNetPlayer(player, &s);
+}
+
+// snapshots
+static const NetPlayerState *FindNetPlayer(const NetSnapshot *snapshot, int id) {
+    for (int i = 0; i < snapshot->numPlayers; i++)
+        if (snapshot->players[i].id == id) return &snapshot->players[i];
+    return NULL;
+}
+
+// where base would be after ticks more at its velocity, integer math so both ends get the same
+static void ExtrapolateNetPlayer(int position[3], const NetPlayerState *base, unsigned int ticks) {
+    for (int k = 0; k < 3; k++) {
+        long long moved = (long long)base->velocity[k] * ticks * NET_POSITION_SCALE / NET_VELOCITY_SCALE;
+        position[k] = base->position[k] + (int)((moved + (moved < 0 ? -PHYSICS_RATE / 2 : PHYSICS_RATE / 2)) / PHYSICS_RATE);
+    }
+}
+
+// fields of s that differ from base, ticks after it, then the differences
+static void WriteNetPlayer(NetPacket *p, const NetPlayerState *s, const NetPlayerState *base, unsigned int ticks) {
+    int predicted[3];
+    ExtrapolateNetPlayer(predicted, base, ticks);
+    unsigned int mask = 0;
+    for (int k = 0; k < 3; k++) {
+        if (s->position[k] != predicted[k]) mask |= 1 << k;
+        if (s->velocity[k] != base->velocity[k]) mask |= 1 << (k + 3);
+    }
+    if (s->yaw != base->yaw || s->pitch != base->pitch) mask |= 1 << 6;
+    if (s->flags != base->flags) mask |= 1 << 7;
+    NetWriteByte(p, mask);
+    for (int k = 0; k < 3; k++)
+        if (mask & 1 << k) NetWriteSigned(p, s->position[k] - predicted[k]);
+    for (int k = 0; k < 3; k++)
+        if (mask & 1 << (k + 3)) NetWriteSigned(p, s->velocity[k] - base->velocity[k]);
+    if (mask & 1 << 6) { // the short way around for the yaw
+        NetWriteSigned(p, (short)(s->yaw - base->yaw));
+        NetWriteSigned(p, s->pitch - base->pitch);
+    }
+    if (mask & 1 << 7) NetWriteByte(p, s->flags);
+}
+
+static void ReadNetPlayer(NetReader *r, NetPlayerState *s, const NetPlayerState *base, unsigned int ticks) {
+    unsigned short id = s->id;
+    *s = *base;
+    s->id = id;
+    ExtrapolateNetPlayer(s->position, base, ticks);
+    unsigned int mask = NetReadByte(r);
+    for (int k = 0; k < 3; k++)
+        if (mask & 1 << k) s->position[k] += NetReadSigned(r);
+    for (int k = 0; k < 3; k++)
+        if (mask & 1 << (k + 3)) s->velocity[k] += NetReadSigned(r);
+    if (mask & 1 << 6) {
+        s->yaw = (unsigned short)(s->yaw + NetReadSigned(r));
+        s->pitch = (short)(s->pitch + NetReadSigned(r));
+    }
+    if (mask & 1 << 7) s->flags = (unsigned char)NetReadByte(r);
+}
+
+static NetSnapshot *NetSnapshotSlot(NetSnapshot history[], unsigned int sequence) {
+    return &history[(sequence / NET_SNAPSHOT_TICKS) & (NET_SNAPSHOT_HISTORY - 1)];
+}
+
+// snapshot as a delta against baseline, NULL sends everything. players missing from the baseline go against zero
+void WriteNetSnapshot(NetPacket *p, const NetSnapshot *snapshot, const NetSnapshot *baseline) {
+    static const NetPlayerState zero = { 0 };
+    p->size = 0;
+    p->overflow = false;
+    NetWriteByte(p, NET_PACKET_SNAPSHOT);
+    NetWriteU32(p, snapshot->sequence);
+    NetWriteU32(p, baseline ? baseline->sequence : 0);
+    NetWriteU32(p, snapshot->lastCommand);
+    NetWriteVarint(p, snapshot->numPlayers);
+    int b = 0, previousId = 0;
+    for (int i = 0; i < snapshot->numPlayers; i++) {
+        const NetPlayerState *s = &snapshot->players[i];
+        // both lists are sorted by id, walk the baseline along
+        while (baseline && b < baseline->numPlayers && baseline->players[b].id < s->id) b++;
+        const NetPlayerState *base = baseline && b < baseline->numPlayers && baseline->players[b].id == s->id ? &baseline->players[b] : &zero;
+        NetWriteVarint(p, s->id - previousId);
+        previousId = s->id;
+        WriteNetPlayer(p, s, base, base == &zero ? 0 : snapshot->sequence - baseline->sequence);
+    }
+}
+
+// reads a snapshot after its type byte, history holds the snapshots received before for the baseline.
+// false if the packet is broken or its baseline isnt there anymore
+bool ReadNetSnapshot(NetReader *r, NetSnapshot *snapshot, NetSnapshot history[]) {
+    static const NetPlayerState zero = { 0 };
+    snapshot->sequence = NetReadU32(r);
+    unsigned int baseSequence = NetReadU32(r);
+    snapshot->lastCommand = NetReadU32(r);
+    unsigned int count = NetReadVarint(r);
+    if (r->error || snapshot->sequence == 0 || count > NET_SNAPSHOT_MAX_PLAYERS + 1) return false;
+    const NetSnapshot *baseline = NULL;
+    if (baseSequence != 0) {
+        baseline = NetSnapshotSlot(history, baseSequence);
+        if (baseline->sequence != baseSequence || baseSequence >= snapshot->sequence) return false;
+    }
+    snapshot->numPlayers = count;
+    int b = 0, previousId = 0;
+    for (int i = 0; i < snapshot->numPlayers; i++) {
+        NetPlayerState *s = &snapshot->players[i];
+        unsigned int step = NetReadVarint(r);
+        if (step == 0 || previousId + step > 0xFFFF) return false;
+        s->id = (unsigned short)(previousId + step);
+        previousId = s->id;
+        while (baseline && b < baseline->numPlayers && baseline->players[b].id < s->id) b++;
+        if (baseline && b < baseline->numPlayers && baseline->players[b].id == s->id)
+            ReadNetPlayer(r, s, &baseline->players[b], snapshot->sequence - baseline->sequence);
+        else ReadNetPlayer(r, s, &zero, 0);
+    }
+    return !r->error;
+}
+
+// sockets, non blocking. port 0 lets the system pick one
+static int OpenNetSocket(unsigned short port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Server */
+
+typedef struct {
+    long ticks;
+    long packetsReceived, packetsSent;
+    long long bytesReceived, bytesSent; // UDP payload, add 28 bytes of IP and UDP header per packet for the wire
+    long snapshots, deltaSnapshots; // sent, and the ones of them that had a baseline
+    long commands; // run
+    long badPackets; // too short, wrong token or from the wrong address
+} NetServerStats;
+
+typedef struct {
+    bool active;
+    struct sockaddr_in address;
+    unsigned int token; // random per connection, input needs it so nobody can drive someone elses player
+    double lastHeard;
+    Player player;
+    NetCommand commands[NET_COMMAND_HISTORY]; // by number, a slot is only valid if its number matches
+    unsigned int lastCommand; // newest one run
+    unsigned int ackedSnapshot; // newest snapshot the client has
+    int ran; // commands run this tick
+    NetSnapshot sent[NET_SNAPSHOT_HISTORY]; // by sequence, the baselines for the next ones
+    NetPacket packet; // snapshot going out this tick
+    bool delta; // packet has a baseline
+} NetServerClient;
+
+typedef struct {
+    int socket; // -1 if the port couldnt be opened
+    unsigned short port;
+    unsigned int tick;
+    int maxClients, numClients;
+    NetServerClient *clients;
+    Collider capsule; // every player collides as this
+    unsigned int seed; // for the tokens
+    JobSystem *jobs;
+    CollisionScratch scratch[JOBS_MAX_WORKERS];
+
+    // current tick
+    int *active; // slots of the connected clients, in order
+    int numActive;
+    NetPlayerState *states; // of the active players, taken once per snapshot tick
+    Vector3 *positions;
+    Collider *colliders;
+    const Broadphase *broadphase;
+
+    NetServerStats stats;
+} NetServer;
+
+// spread the spawns out a bit so a crowd doesnt start in one spot
+static Vector3 NetSpawnPosition(int slot) {
+    float angle = slot * 2.4f, radius = 0.5f + (slot % 5) * 0.5f;
+    return (Vector3){ cosf(angle) * radius, 6.0f, sinf(angle) * radius };
+}
+
+// jobs can be shared with anything else that doesnt run while the server ticks
+NetServer InitNetServer(unsigned short port, int maxClients, JobSystem *jobs) {
+    NetServer server = { 0 };
+    server.socket = OpenNetSocket(port);
+    server.maxClients = maxClients;
+    server.clients = calloc(maxClients, sizeof(NetServerClient));
+    server.active = malloc(maxClients * sizeof(int));
+    server.states = malloc(maxClients * sizeof(NetPlayerState));
+    server.positions = malloc(maxClients * sizeof(Vector3));
+    server.jobs = jobs;
+    server.seed = (unsigned int)time(NULL) ^ (unsigned int)getpid() << 16;
+    SetupColliderCapsule(&server.capsule, NET_PLAYER_CENTER, NET_PLAYER_RADIUS, NET_PLAYER_HALF_HEIGHT);
+    if (server.socket >= 0) {
+        // a tick worth of input from every client arrives at once
+        int size = 1 << 22;
+        setsockopt(server.socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        setsockopt(server.socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        struct sockaddr_in address;
+        socklen_t length = sizeof(address);
+        getsockname(server.socket, (struct sockaddr *)&address, &length);
+        server.port = ntohs(address.sin_port);
+    }
+    return server;
+}
+
+static void NetServerSend(NetServer *server, const NetServerClient *client, const NetPacket *p) {
+    if (p->overflow) return;
+    if (sendto(server->socket, p->data, p->size, 0, (const struct sockaddr *)&client->address, sizeof(client->address)) == p->size) {
+        server->stats.packetsSent++;
+        server->stats.bytesSent += p->size;
+        PROFILE_COUNT("net_bytes_sent", p->size);
+    }
+}
+
+static void SendNetAccept(NetServer *server, NetServerClient *client, int slot) {
+    static const NetPlayerState zero = { 0 };
+    NetPacket p = { 0 };
+    NetWriteByte(&p, NET_PACKET_ACCEPT);
+    NetWriteU16(&p, slot + 1);
+    NetWriteU32(&p, client->token);
+    NetWriteU32(&p, server->tick);
+    const ColliderPrimitive *capsule = &server->capsule.primitive;
+    NetWriteFloat(&p, capsule->center.x);
+    NetWriteFloat(&p, capsule->center.y);
+    NetWriteFloat(&p, capsule->center.z);
+    NetWriteFloat(&p, capsule->radius);
+    NetWriteFloat(&p, capsule->halfHeight);
+    NetPlayerState state = PackNetPlayer(&client->player, slot + 1);
+    WriteNetPlayer(&p, &state, &zero, 0);
+    NetServerSend(server, client, &p);
+}
+
+static void DropNetClient(NetServer *server, int slot) {
+    NetServerClient *client = &server->clients[slot];
+    UnloadPlayerPhysics(&client->player);
+    memset(client, 0, sizeof(*client));
+    server->numClients--;
+}
+
+static bool SameNetAddress(const struct sockaddr_in *a, const struct sockaddr_in *b) {
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+static void NetServerConnect(NetServer *server, const struct sockaddr_in *from, double now) {
+    // a resent request, the accept got lost
+    for (int i = 0; i < server->maxClients; i++)
+        if (server->clients[i].active && SameNetAddress(&server->clients[i].address, from)) {
+            SendNetAccept(server, &server->clients[i], i);
+            return;
+        }
+    int slot = 0;
+    while (slot < server->maxClients && server->clients[slot].active) slot++;
+    if (slot == server->maxClients) {
+        NetPacket p = { 0 };
+        NetWriteByte(&p, NET_PACKET_FULL);
+        NetServerSend(server, &(NetServerClient){ .address = *from }, &p);
+        return;
+    }
+    NetServerClient *client = &server->clients[slot];
+    memset(client, 0, sizeof(*client));
+    client->active = true;
+    client->address = *from;
+    server->seed = server->seed * 1664525u + 1013904223u;
+    client->token = server->seed ^ (unsigned int)slot * 0x9E3779B9u;
+    client->lastHeard = now;
+    SetupPlayerPhysics(&client->player, NetSpawnPosition(slot), server->capsule);
+    NetPlayerState spawn = PackNetPlayer(&client->player, 0);
+    UnpackNetPlayer(&client->player, &spawn);
+    server->numClients++;
+    SendNetAccept(server, client, slot);
+}
+
+// the client that sent it, NULL if the id, token or address dont match
+static NetServerClient *NetServerSender(NetServer *server, NetReader *r, const struct sockaddr_in *from) {
+    unsigned int id = NetReadU16(r), token = NetReadU32(r);
+    if (r->error || id == 0 || id > (unsigned int)server->maxClients) return NULL;
+    NetServerClient *client = &server->clients[id - 1];
+    if (!client->active || client->token != token || !SameNetAddress(&client->address, from)) return NULL;
+    return client;
+}
+
+static void NetServerInput(NetServerClient *client, NetReader *r) {
+    unsigned int acked = NetReadU32(r), newest = NetReadU32(r), count = NetReadByte(r);
+    if (r->error || count > NET_INPUT_REDUNDANCY || newest < count) return;
+    if (acked > client->ackedSnapshot) client->ackedSnapshot = acked;
+    for (unsigned int k = 0; k < count; k++) {
+        NetCommand command;
+        command.number = newest - k;
+        command.keys = (unsigned char)NetReadByte(r);
+        command.pressed = (unsigned char)NetReadByte(r);
+        command.yaw = (unsigned short)NetReadU16(r);
+        command.pitch = (short)NetReadU16(r);
+        if (r->error) return;
+        // already run, or so far ahead it would overwrite one that still has to run
+        if (command.number <= client->lastCommand || command.number > client->lastCommand + NET_COMMAND_HISTORY) continue;
+        client->commands[command.number & (NET_COMMAND_HISTORY - 1)] = command;
+    }
+}
+
+// reads everything waiting on the socket, NetServerTick calls it first. a busy loop can call it more often so the
+// socket buffer doesnt fill up
+void NetServerReceive(NetServer *server, double now) {
+    if (server->socket < 0) return;
+    unsigned char data[NET_MAX_PACKET];
+    for (;;) {
+        struct sockaddr_in from;
+        socklen_t length = sizeof(from);
+        int size = (int)recvfrom(server->socket, data, sizeof(data), 0, (struct sockaddr *)&from, &length);
+        if (size < 0) {
+            if (errno == EINTR) continue;
+            break; // EAGAIN, nothing left
+        }
+        server->stats.packetsReceived++;
+        server->stats.bytesReceived += size;
+        NetReader r = { data, size, 0, false };
+        unsigned int type = NetReadByte(&r);
+        if (type == NET_PACKET_CONNECT) {
+            if (NetReadU32(&r) == NET_PROTOCOL && !r.error) NetServerConnect(server, &from, now);
+            else server->stats.badPackets++;
+            continue;
+        }
+        NetServerClient *client = NetServerSender(server, &r, &from);
+        if (client == NULL) {
+            server->stats.badPackets++;
+            continue;
+        }
+        client->lastHeard = now;
+        if (type == NET_PACKET_INPUT) NetServerInput(client, &r);
+        else if (type == NET_PACKET_DISCONNECT) DropNetClient(server, (int)(client - server->clients));
+    }
+}
+
+static void RunNetCommandsJob(void *data, int index, int worker) {
+    NetServer *server = (NetServer *)data;
+    NetServerClient *client = &server->clients[server->active[index]];
+    client->ran = 0;
+    while (client->ran < NET_MAX_COMMANDS_PER_TICK) {
+        NetCommand *command = &client->commands[(client->lastCommand + 1) & (NET_COMMAND_HISTORY - 1)];
+        if (command->number != client->lastCommand + 1) break; // not here yet, the player waits for it
+        StepNetPlayer(&client->player, *command, server->colliders, server->broadphase, &server->scratch[worker]);
+        client->player.yaw = command->yaw / NET_ANGLE_SCALE;
+        client->player.pitch = command->pitch / NET_ANGLE_SCALE;
+        client->lastCommand++;
+        client->ran++;
+    }
+}
+
+// the client itself and the closest others, encoded against the newest snapshot the client has
+static void BuildNetSnapshotJob(void *data, int index, int worker) {
+    (void)worker; // writes only to the client's own buffer, no per worker scratch needed
+    NetServer *server = (NetServer *)data;
+    int slot = server->active[index];
+    NetServerClient *client = &server->clients[slot];
+    unsigned int tick = server->tick;
+
+    // closest first, an insertion sort into a list that stays short. goes over every player, fine for a few hundred
+    int closest[NET_SNAPSHOT_MAX_PLAYERS];
+    float distances[NET_SNAPSHOT_MAX_PLAYERS];
+    int n = 0;
+    Vector3 own = server->positions[index];
+    for (int k = 0; k < server->numActive; k++) {
+        if (k == index) continue;
+        float d = Vector3DistanceSqr(own, server->positions[k]);
+        if (d > NET_RELEVANT_DISTANCE * NET_RELEVANT_DISTANCE || (n == NET_SNAPSHOT_MAX_PLAYERS && d >= distances[n - 1])) continue;
+        int i = n < NET_SNAPSHOT_MAX_PLAYERS ? n++ : n - 1;
+        for (; i > 0 && distances[i - 1] > d; i--) {
+            distances[i] = distances[i - 1];
+            closest[i] = closest[i - 1];
+        }
+        distances[i] = d;
+        closest[i] = k;
+    }
+    closest[n] = index;
+    n++;
+    // back into id order, the active list is sorted by slot
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && closest[j - 1] > closest[j]; j--) {
+            int t = closest[j];
+            closest[j] = closest[j - 1];
+            closest[j - 1] = t;
+        }
+
+    // pick the baseline before its slot could get reused by this snapshot
+    const NetSnapshot *baseline = NULL;
+    if (client->ackedSnapshot != 0 && tick - client->ackedSnapshot < NET_SNAPSHOT_TICKS * NET_SNAPSHOT_HISTORY) {
+        baseline = NetSnapshotSlot(client->sent, client->ackedSnapshot);
+        if (baseline->sequence != client->ackedSnapshot) baseline = NULL;
+    }
+    NetSnapshot *snapshot = NetSnapshotSlot(client->sent, tick);
+    snapshot->sequence = tick;
+    snapshot->lastCommand = client->lastCommand;
+    snapshot->numPlayers = n;
+    for (int i = 0; i < n; i++) snapshot->players[i] = server->states[closest[i]];
+    WriteNetSnapshot(&client->packet, snapshot, baseline);
+    client->delta = baseline != NULL;
+}
+
+/* One server tick: read the input, run the commands that came in, every NET_SNAPSHOT_TICKS send the snapshots and
+drop clients that went quiet. The world colliders and broadphase are only read, like StepPlayerBatch does it */
+void NetServerTick(NetServer *server, double now, const int NumColliders, Collider colliders[], const Broadphase *broadphase) {
+    PROFILE_BEGIN("net_receive");
+    NetServerReceive(server, now);
+    for (int i = 0; i < server->maxClients; i++)
+        if (server->clients[i].active && now - server->clients[i].lastHeard > NET_CLIENT_TIMEOUT) DropNetClient(server, i);
+    PROFILE_END();
+    server->tick++;
+    server->stats.ticks++;
+    server->numActive = 0;
+    for (int i = 0; i < server->maxClients; i++)
+        if (server->clients[i].active) server->active[server->numActive++] = i;
+
+    PROFILE_BEGIN("net_step");
+    for (int i = 0; i < NumColliders; i++) PrepareCollider(&colliders[i]);
+    server->colliders = colliders;
+    server->broadphase = broadphase;
+    RunJobs(server->jobs, RunNetCommandsJob, server, server->numActive, NET_SERVER_GRAIN);
+    for (int k = 0; k < server->numActive; k++) server->stats.commands += server->clients[server->active[k]].ran;
+    PROFILE_END();
+
+    if (server->tick % NET_SNAPSHOT_TICKS != 0) return;
+    PROFILE_BEGIN("net_snapshot");
+    for (int k = 0; k < server->numActive; k++) {
+        int slot = server->active[k];
+        server->states[k] = PackNetPlayer(&server->clients[slot].player, slot + 1);
+        server->positions[k] = server->clients[slot].player.position;
+    }
+    RunJobs(server->jobs, BuildNetSnapshotJob, server, server->numActive, NET_SERVER_GRAIN);
+    for (int k = 0; k < server->numActive; k++) {
+        NetServerClient *client = &server->clients[server->active[k]];
+        NetServerSend(server, client, &client->packet);
+        server->stats.snapshots++;
+        if (client->delta) server->stats.deltaSnapshots++;
+    }
+    PROFILE_END();
+}
+
+void UnloadNetServer(NetServer *server) {
+    for (int i = 0; i < server->maxClients; i++)
+        if (server->clients[i].active) UnloadPlayerPhysics(&server->clients[i].player);
+    for (int i = 0; i < JOBS_MAX_WORKERS; i++) UnloadCollisionScratch(&server->scratch[i]);
+    if (server->socket >= 0) close(server->socket);
+    free(server->clients);
+    free(server->active);
+    free(server->states);
+    free(server->positions);
+    *server = (NetServer){ 0 };
+    server->socket = -1;
+}
+
+/* Client */
+
+typedef struct {
+    long packetsReceived, packetsSent;
+    long long bytesReceived, bytesSent;
+    long snapshots; // used
+    long staleSnapshots; // older then one already used, or their baseline was gone
+    long checked; // snapshots the own player could be compared against the prediction in
+    long corrections; // of them the prediction was off and the newer commands got replayed
+    float maxError; // meters the prediction was off by at most
+} NetClientStats;
+
+typedef struct {
+    int socket; // -1 if the server address couldnt be resolved
+    bool connected;
+    bool refused; // server was full
+    int id;
+    unsigned int token;
+    double lastConnect;
+    unsigned int tick; // server tick at the accept
+
+    unsigned int nextCommand; // number of the next one, from 1
+    NetCommand commands[NET_COMMAND_HISTORY]; // by number, kept for sending again and replaying
+    NetPlayerState predicted[NET_COMMAND_HISTORY]; // own state after each of them
+    NetPlayerState spawn; // own state before the first
+    NetSnapshot received[NET_SNAPSHOT_HISTORY]; // by sequence, the baselines of the next ones
+    unsigned int newestSnapshot; // sequence of the newest one, the other players in it are what to draw
+    CollisionScratch scratch;
+
+    bool jumpQueued; // pressed since the last command
+    float loss; // share of packets to drop on purpose both ways, for testing on loopback
+    unsigned int lossSeed;
+    NetClientStats stats;
+} NetClient;
+
+static bool NetLose(NetClient *client) {
+    if (client->loss <= 0.0f) return false;
+    client->lossSeed = client->lossSeed * 1664525u + 1013904223u;
+    return (client->lossSeed >> 8) < client->loss * 16777216.0f;
+}
+
+static void NetClientSend(NetClient *client, const NetPacket *p) {
+    if (client->socket < 0 || p->overflow || NetLose(client)) return;
+    if (send(client->socket, p->data, p->size, 0) == p->size) {
+        client->stats.packetsSent++;
+        client->stats.bytesSent += p->size;
+    }
+}
+
+// resolves host and points the socket at it, nothing is sent until PumpNetClient
+NetClient InitNetClient(const char *host, unsigned short port) {
+    NetClient client = { 0 };
+    client.nextCommand = 1;
+    client.lastConnect = -NET_CONNECT_RETRY;
+    client.socket = OpenNetSocket(0);
+    struct addrinfo hints = { 0 }, *found = NULL;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (client.socket >= 0 && (getaddrinfo(host, service, &hints, &found) != 0 || connect(client.socket, found->ai_addr, found->ai_addrlen) != 0)) {
+        close(client.socket);
+        client.socket = -1;
+    }
+    if (found) freeaddrinfo(found);
+    if (client.socket >= 0) {
+        int size = 1 << 18;
+        setsockopt(client.socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+    client.lossSeed = (unsigned int)client.socket * 2654435761u + 1;
+    return client;
+}
+
+static void SendNetInput(NetClient *client) {
+    NetPacket p = { 0 };
+    unsigned int newest = client->nextCommand - 1;
+    unsigned int count = newest < NET_INPUT_REDUNDANCY ? newest : NET_INPUT_REDUNDANCY;
+    NetWriteByte(&p, NET_PACKET_INPUT);
+    NetWriteU16(&p, client->id);
+    NetWriteU32(&p, client->token);
+    NetWriteU32(&p, client->newestSnapshot);
+    NetWriteU32(&p, newest);
+    NetWriteByte(&p, count);
+    for (unsigned int k = 0; k < count; k++) {
+        const NetCommand *command = &client->commands[(newest - k) & (NET_COMMAND_HISTORY - 1)];
+        NetWriteByte(&p, command->keys);
+        NetWriteByte(&p, command->pressed);
+        NetWriteU16(&p, command->yaw);
+        NetWriteU16(&p, (unsigned short)command->pitch);
+    }
+    NetClientSend(client, &p);
+}
+
+// runs the command on the player right away and sends it with the next input packet
+void SendNetCommand(NetClient *client, Player *player, NetCommand command, Collider colliders[], const Broadphase *broadphase) {
+    if (!client->connected) return;
+    command.number = client->nextCommand++;
+    int i = command.number & (NET_COMMAND_HISTORY - 1);
+    client->commands[i] = command;
+    StepNetPlayer(player, command, colliders, broadphase, &client->scratch);
+    client->predicted[i] = PackNetPlayer(player, client->id);
+    if (command.number % NET_INPUT_TICKS == 0) SendNetInput(client);
+}
+
+static void NetClientAccept(NetClient *client, Player *player, NetReader *r) {
+    static const NetPlayerState zero = { 0 };
+    int id = NetReadU16(r);
+    unsigned int token = NetReadU32(r), tick = NetReadU32(r);
+    Vector3 center;
+    center.x = NetReadFloat(r);
+    center.y = NetReadFloat(r);
+    center.z = NetReadFloat(r);
+    float radius = NetReadFloat(r), halfHeight = NetReadFloat(r);
+    NetPlayerState spawn = { 0 };
+    ReadNetPlayer(r, &spawn, &zero, 0);
+    if (r->error || client->connected) return;
+    client->connected = true;
+    client->id = id;
+    client->token = token;
+    client->tick = tick;
+    spawn.id = (unsigned short)id;
+    client->spawn = spawn;
+    // same capsule and tuning the server runs
+    Collider capsule;
+    SetupColliderCapsule(&capsule, center, radius, halfHeight);
+    SetupPlayerPhysics(player, NetPlayerPosition(&spawn), capsule);
+    UnpackNetPlayer(player, &spawn);
+    player->previousPosition = player->position;
+    ClearPairCache(&player->pairs);
+}
+
+// takes the own player from the snapshot if the prediction for that command was off, then runs the newer commands again
+static void ReconcileNetPlayer(NetClient *client, Player *player, const NetSnapshot *snapshot, Collider colliders[], const Broadphase *broadphase) {
+    const NetPlayerState *own = FindNetPlayer(snapshot, client->id);
+    unsigned int last = snapshot->lastCommand, newest = client->nextCommand - 1;
+    if (own == NULL || last > newest) return;
+    bool replayable = newest - last < NET_COMMAND_HISTORY;
+    const NetPlayerState *predicted = last == 0 ? &client->spawn : &client->predicted[last & (NET_COMMAND_HISTORY - 1)];
+    if (replayable) {
+        client->stats.checked++;
+        if (SameNetPlayer(predicted, own)) return;
+        float error = Vector3Distance(NetPlayerPosition(predicted), NetPlayerPosition(own));
+        if (error > client->stats.maxError) client->stats.maxError = error;
+    }
+    client->stats.corrections++;
+    UnpackNetPlayer(player, own);
+    player->previousPosition = player->position;
+    if (!replayable) return; // too far behind to replay, take the server state as it is
+    for (unsigned int n = last + 1; n <= newest; n++) {
+        int i = n & (NET_COMMAND_HISTORY - 1);
+        StepNetPlayer(player, client->commands[i], colliders, broadphase, &client->scratch);
+        client->predicted[i] = PackNetPlayer(player, client->id);
+    }
+}
+
+// sends connect requests until the server answers, then reads the snapshots and corrects the player with them
+void PumpNetClient(NetClient *client, Player *player, double now, Collider colliders[], const Broadphase *broadphase) {
+    if (client->socket < 0) return;
+    if (!client->connected && !client->refused && now - client->lastConnect >= NET_CONNECT_RETRY) {
+        NetPacket p = { 0 };
+        NetWriteByte(&p, NET_PACKET_CONNECT);
+        NetWriteU32(&p, NET_PROTOCOL);
+        NetClientSend(client, &p);
+        client->lastConnect = now;
+    }
+    unsigned char data[NET_MAX_PACKET];
+    for (;;) {
+        int size = (int)recv(client->socket, data, sizeof(data), 0);
+        if (size < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (NetLose(client)) continue;
+        client->stats.packetsReceived++;
+        client->stats.bytesReceived += size;
+        NetReader r = { data, size, 0, false };
+        unsigned int type = NetReadByte(&r);
+        if (type == NET_PACKET_ACCEPT) NetClientAccept(client, player, &r);
+        else if (type == NET_PACKET_FULL) client->refused = !client->connected;
+        else if (type == NET_PACKET_SNAPSHOT && client->connected) {
+            NetSnapshot snapshot;
+            if (!ReadNetSnapshot(&r, &snapshot, client->received) || snapshot.sequence <= client->newestSnapshot) {
+                client->stats.staleSnapshots++;
+                continue;
+            }
+            *NetSnapshotSlot(client->received, snapshot.sequence) = snapshot;
+            client->newestSnapshot = snapshot.sequence;
+            client->stats.snapshots++;
+            ReconcileNetPlayer(client, player, &snapshot, colliders, broadphase);
+        }
+    }
+}
+
+// newest snapshot, the other players to draw are in it. NULL before the first one
+const NetSnapshot *NetClientSnapshot(NetClient *client) {
+    if (client->newestSnapshot == 0) return NULL;
+    return NetSnapshotSlot(client->received, client->newestSnapshot);
+}
+
+// UpdatePlayer for a networked player, commands go out at the physics rate instead of stepping straight away
+void UpdateNetPlayer(NetClient *client, Player *player, PlayerInput input, double now, Collider colliders[], const Broadphase *broadphase) {
+    PROFILE_SCOPE("update_net_player");
+    PumpNetClient(client, player, now, colliders, broadphase);
+    if (input.pressed & PLAYER_PRESS_JUMP) client->jumpQueued = true;
+    ApplyPlayerLook(player, input); // the commands carry the look of this frame
+    if (client->connected) {
+        player->accumulator += input.frameTime;
+        int steps = 0;
+        while (player->accumulator >= NET_TICK_DT && steps < MAX_PHYSICS_STEPS) {
+            NetCommand command = MakeNetCommand(input.keys, client->jumpQueued ? PLAYER_PRESS_JUMP : 0, player->yaw, player->pitch);
+            SendNetCommand(client, player, command, colliders, broadphase);
+            client->jumpQueued = false;
+            player->accumulator -= NET_TICK_DT;
+            steps++;
+        }
+        if (player->accumulator >= NET_TICK_DT) player->accumulator = 0.0f;
+    }
+    UpdatePlayerView(player, input, player->accumulator / NET_TICK_DT);
+}
+
+// tells the server so the slot frees up right away instead of after the timeout
+void UnloadNetClient(NetClient *client) {
+    if (client->connected) {
+        NetPacket p = { 0 };
+        NetWriteByte(&p, NET_PACKET_DISCONNECT);
+        NetWriteU16(&p, client->id);
+        NetWriteU32(&p, client->token);
+        float loss = client->loss;
+        client->loss = 0.0f;
+        NetClientSend(client, &p);
+        client->loss = loss;
+    }
+    if (client->socket >= 0) close(client->socket);
+    UnloadCollisionScratch(&client->scratch);
+    client->socket = -1;
+    client->connected = false;
+}
+
+#endif
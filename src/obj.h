@@ -0,0 +1,126 @@
+#ifndef OBJ_H
+#define OBJ_H
+
+#include "raylib.h" //Mesh
+
+#include <stdio.h>
+#include <stdlib.h>//Memory operations
+
+/*Minimal OBJ reader, positions, texture coordinates, normals and faces, no materials. Polygons get fan triangulated
+into a triangle soup the same way raylib hands meshes to us, so a collider built from it matches the one the game builds.
+Nothing touches the GPU so it works on any thread, the asset loader uploads the result with UploadMesh.
+Free it with UnloadObjMeshData unless it was handed to a model, then the model frees it*/
+
+//Appends the numbers after the keyword (v, vt or vn) to an array of width wide entries
+static void ObjAppend(float **array, int *count, int *cap, int width, const char *numbers) {
+    if (*count == *cap) {
+        *cap = *cap ? *cap * 2 : 256;
+        *array = (float *)realloc(*array, *cap * width * sizeof(float));
+    }
+    float p[3] = { 0 }; //vt can have a third number, it gets dropped
+    if (sscanf(numbers, "%f %f %f", &p[0], &p[1], &p[2]) < width) return;
+    for (int i = 0; i < width; i++) (*array)[*count * width + i] = p[i];
+    (*count)++;
+}
+
+//1 based index to 0 based, negative ones count back from the last entry. -1 if it is outside the array
+static int ObjIndex(long index, int count) {
+    int i = index < 0 ? count + (int)index : (int)index - 1;
+    return i >= 0 && i < count ? i : -1;
+}
+
+//Returns a mesh with vertexCount 0 if the file cant be read. texcoords and normals are NULL if the file has none
+Mesh LoadObjMeshData(const char *path) {
+    Mesh mesh = { 0 };
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return mesh;
+
+    float *positions = NULL, *uvs = NULL, *normals = NULL;
+    int numPositions = 0, capPositions = 0, numUvs = 0, capUvs = 0, numNormals = 0, capNormals = 0;
+    int capVertices = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == 'v' && line[1] == ' ') {
+            ObjAppend(&positions, &numPositions, &capPositions, 3, line + 2);
+        } else if (line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
+            ObjAppend(&uvs, &numUvs, &capUvs, 2, line + 3);
+        } else if (line[0] == 'v' && line[1] == 'n' && line[2] == ' ') {
+            ObjAppend(&normals, &numNormals, &capNormals, 3, line + 3);
+        } else if (line[0] == 'f' && line[1] == ' ' && numPositions > 0) {
+            //Every corner is v, v/vt, v//vn or v/vt/vn, a missing or broken vt or vn is -1
+            int corners[64][3];
+            int numCorners = 0;
+            char *s = line + 2;
+            while (numCorners < 64) {
+                char *end;
+                long index = strtol(s, &end, 10);
+                if (end == s) break;
+                int *corner = corners[numCorners++];
+                corner[0] = ObjIndex(index, numPositions);
+                corner[1] = corner[2] = -1;
+                s = end;
+                if (*s == '/') {
+                    s++;
+                    index = strtol(s, &end, 10);
+                    if (end != s) corner[1] = ObjIndex(index, numUvs);
+                    s = end;
+                    if (*s == '/') {
+                        s++;
+                        index = strtol(s, &end, 10);
+                        if (end != s) corner[2] = ObjIndex(index, numNormals);
+                        s = end;
+                    }
+                }
+                while (*s != '\0' && *s != ' ' && *s != '\t') s++;
+                while (*s == ' ' || *s == '\t') s++;
+            }
+            for (int i = 1; i + 1 < numCorners; i++) {
+                if (mesh.vertexCount + 3 > capVertices) {
+                    capVertices = capVertices ? capVertices * 2 : 256;
+                    mesh.vertices = (float *)realloc(mesh.vertices, capVertices * 3 * sizeof(float));
+                    mesh.texcoords = (float *)realloc(mesh.texcoords, capVertices * 2 * sizeof(float));
+                    mesh.normals = (float *)realloc(mesh.normals, capVertices * 3 * sizeof(float));
+                }
+                int *tri[3] = { corners[0], corners[i], corners[i + 1] };
+                for (int k = 0; k < 3; k++) {
+                    int v = tri[k][0] >= 0 ? tri[k][0] : 0; //Broken index, dont read outside the array
+                    float *vertex = &mesh.vertices[mesh.vertexCount * 3];
+                    float *uv = &mesh.texcoords[mesh.vertexCount * 2];
+                    float *normal = &mesh.normals[mesh.vertexCount * 3];
+                    vertex[0] = positions[v * 3];
+                    vertex[1] = positions[v * 3 + 1];
+                    vertex[2] = positions[v * 3 + 2];
+                    uv[0] = tri[k][1] >= 0 ? uvs[tri[k][1] * 2] : 0.0f;
+                    uv[1] = tri[k][1] >= 0 ? 1.0f - uvs[tri[k][1] * 2 + 1] : 0.0f; //Flipped like raylib does, images start at the top
+                    normal[0] = tri[k][2] >= 0 ? normals[tri[k][2] * 3] : 0.0f;
+                    normal[1] = tri[k][2] >= 0 ? normals[tri[k][2] * 3 + 1] : 0.0f;
+                    normal[2] = tri[k][2] >= 0 ? normals[tri[k][2] * 3 + 2] : 0.0f;
+                    mesh.vertexCount++;
+                }
+                mesh.triangleCount++;
+            }
+        }
+    }
+    fclose(file);
+    free(positions);
+    free(uvs);
+    free(normals);
+    //Nothing to keep if the file didnt have them
+    if (numUvs == 0) {
+        free(mesh.texcoords);
+        mesh.texcoords = NULL;
+    }
+    if (numNormals == 0) {
+        free(mesh.normals);
+        mesh.normals = NULL;
+    }
+    return mesh;
+}
+
+void UnloadObjMeshData(Mesh mesh) {
+    free(mesh.vertices);
+    free(mesh.texcoords);
+    free(mesh.normals);
+}
+
+#endif
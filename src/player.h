@@ -0,0 +1,388 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include "raylib.h"
+#include "raymath.h"
+#include "collisions.h"
+#include "jobs.h"
+
+#include <math.h>
+
+// player movement, collision and camera, no window or input calls in here so it also runs headless
+
+#define PHYSICS_RATE 120 // physics steps per second, independent of the frame rate
+#define PHYSICS_DT (1.0f / PHYSICS_RATE)
+#define MAX_PHYSICS_STEPS 8 // steps per frame before the backlog gets dropped, stops a long hitch from snowballing
+#define PLAYER_SLIDE_ITERATIONS 4 // surfaces one step can slide along, floor wall and a corner is 3
+#define PLAYER_FLOOR_MIN_Y 0.01f // swept contacts pointing up less then this are walls, their normals come back a hair off level
+
+// movement keys held during a step, one bit each
+#define PLAYER_KEY_FORWARD (1 << 0)
+#define PLAYER_KEY_BACK (1 << 1)
+#define PLAYER_KEY_LEFT (1 << 2)
+#define PLAYER_KEY_RIGHT (1 << 3)
+#define PLAYER_KEY_SPRINT (1 << 4)
+#define PLAYER_KEY_CROUCH (1 << 5)
+
+// keys that only count on the frame they went down
+#define PLAYER_PRESS_JUMP (1 << 0)
+
+#define PLAYER_LOOK_SENSITIVITY 0.003f // radians per pixel of mouse movement
+
+// everything UpdatePlayer reads from the outside world in one frame, the game fills it from raylib
+// and the replayer from a recording, so the same inputs always give the same player
+typedef struct {
+    float frameTime; // seconds since the last frame
+    unsigned int keys; // PLAYER_KEY_* held this frame
+    unsigned int pressed; // PLAYER_PRESS_* that went down this frame
+    Vector2 mouseDelta; // mouse movement in pixels
+} PlayerInput;
+
+typedef enum {
+    IDLE,
+    WALKING,
+    RUNNING,
+    CROUCHING,
+    JUMPING,
+    FALLING
+} MovementState;
+
+typedef struct Player {
+    MovementState movementState;
+
+    Camera3D camera;
+    float yaw, pitch; // look angles in radians, the camera target follows them
+
+    Model model;
+
+    Vector3 position; // physics position at eye level, the camera gets interpolated from it
+    Vector3 previousPosition; // position before the last physics step
+    float accumulator; // frame time that hasnt been simulated yet
+    float stepTime; // seconds per physics step, PHYSICS_DT unless changed
+    bool continuous; // sweep the movement so it cant pass trough thin geometry, false moves straight to the end like before
+    bool jumpQueued; // jump pressed since the last step, a frame with no step would lose it otherwise
+
+    Vector3 velocity; 
+    bool isMoving;
+    bool isSprinting;
+    bool isCrouching;
+    bool isJumping;
+
+    float baseFOV;
+    float sprintFOV;
+    float crouchFOV;
+    float fovSpeed;// fov transition smoothing
+
+    float targetCrouchOffset;
+    float currentCrouchOffset;
+
+    float moveSpeed;
+    float sprintSpeed;
+    float crouchSpeed;
+    float acc; // acceleratio for smoothing between states
+    float g; // gravity
+    float jumpStrength;
+
+    float walkBobAmount;
+    float sprintBobAmount;
+    float crouchBobAmount;
+
+    Collider collider;
+    CollisionScratch scratch; // candidate list for StepPlayer, batches use the one of their worker instead
+    PairCache pairs; // what the last step found for every collider near the player, most of them stay apart
+
+    float bobbingTime;
+    float bobbingSpeed;
+    float bobbingAmount;
+    float swayAmount; // makes bobbing a bit more smooth
+} Player;
+
+// physics tuning and starting state, the camera and visual settings are left to the caller
+void SetupPlayerPhysics(Player *player, Vector3 position, Collider collider) {
+    player->camera.position = position;
+    player->camera.up = (Vector3){ 0.0f, 1.0f, 0.0f }; // up vector (rotation towards target)
+    player->position = position;
+    player->previousPosition = position;
+    player->stepTime = PHYSICS_DT;
+    player->continuous = true;
+
+    player->moveSpeed = 5.0f;
+    player->sprintSpeed = 7.0f;
+    player->crouchSpeed = 4.0f;
+    player->acc = 40.0f;
+
+    player->collider = collider;
+
+    player->g = 20.0f;
+    player->jumpStrength = 7.0f;
+}
+
+// unit vector the player looks along
+Vector3 PlayerLookDirection(const Player *player) {
+    return (Vector3){
+        cosf(player->pitch) * sinf(player->yaw),
+        sinf(player->pitch),
+        cosf(player->pitch) * cosf(player->yaw)
+    };
+}
+
+// frees what the physics side allocated
+void UnloadPlayerPhysics(Player *player) {
+    UnloadCollisionScratch(&player->scratch);
+    UnloadPairCache(&player->pairs);
+}
+
+// moves the player by motion and slides along whatever is in the way, the part of the motion going into a surface
+// gets dropped and the rest carries on along it. the velocity loses the same part so it doesnt build up against walls
+static void SlidePlayer(Player *player, Vector3 motion, Collider colliders[], const Broadphase *broadphase, CollisionScratch *scratch) {
+    PROFILE_SCOPE("slide_player");
+    for(int i = 0; i < PLAYER_SLIDE_ITERATIONS; i++) {
+        UpdateCollider(player->position, &player->collider);
+        float toi;
+        Vector3 normal;
+        if(!CastColliders(&player->collider, motion, colliders, broadphase, scratch, &player->pairs, &toi, &normal, NULL)) {
+            player->position = Vector3Add(player->position, motion);
+            break;
+        }
+        player->position = Vector3Add(player->position, Vector3Scale(motion, toi));
+        motion = Vector3Scale(motion, 1.0f - toi);
+        float into = Vector3DotProduct(motion, normal);
+        if(into < 0.0f) motion = Vector3Subtract(motion, Vector3Scale(normal, into));
+        into = Vector3DotProduct(player->velocity, normal);
+        if(into < 0.0f) player->velocity = Vector3Subtract(player->velocity, Vector3Scale(normal, into));
+        if(normal.y > PLAYER_FLOOR_MIN_Y) { // landed, same as the overlap test does it
+            player->velocity.y = 0;
+            player->isJumping = false;
+        }
+    }
+    // whatever is left after the last iteration is dropped, stuck in a corner
+}
+
+// one physics step of stepTime, only touches the simulation state so the same keys and forward always give the same result.
+// the world colliders and broadphase are only read (once their axes are prepared), scratch and the players own pair cache are the only other memory written
+static void StepPlayerScratch(Player *player, unsigned int keys, Vector3 forward, Collider colliders[], const Broadphase *broadphase, CollisionScratch *scratch) {
+    PROFILE_SCOPE("step_player");
+    // detect movement type (sprinting or crouch walking)
+    player->isSprinting = keys & PLAYER_KEY_SPRINT;
+    player->isCrouching = (keys & PLAYER_KEY_CROUCH) && !player->isJumping;
+
+    // detect movement direction
+    Vector3 dir = { 0 }; // direction
+    if(keys & PLAYER_KEY_FORWARD) // dont use else if here because can press two movement keys at once
+        dir.z += 1.0f; // forwards
+    if(keys & PLAYER_KEY_BACK)
+        dir.z -= 1.0f; // backwards
+    if(keys & PLAYER_KEY_LEFT)
+        dir.x -= 1.0f; // left
+    if(keys & PLAYER_KEY_RIGHT)
+        dir.x += 1.0f;
+
+    // normalise direction
+    float length = sqrtf(dir.x * dir.x + dir.z*dir.z);
+    if(length > 0.0f) {
+        dir.x /= length;
+        dir.z /= length;
+    }
+
+    // detect speed
+    float speed = player->moveSpeed;
+    if(player->isSprinting) speed = player->sprintSpeed;
+    if(player->isCrouching) speed = player->crouchSpeed;
+
+    // use horizontal components for world vector so speed doesnt change with camera rotation and yaw
+    Vector3 horizontalForward = Vector3Normalize((Vector3){
+        forward.x,
+        0.0f,
+        forward.z
+    });
+    // get correct horizontal value
+    Vector3 horizontalRight = Vector3Normalize(Vector3CrossProduct(horizontalForward, player->camera.up));
+    // calculate world direction using only horizontal components
+    Vector3 worldDirection = {
+        (horizontalRight.x * dir.x + horizontalForward.x * dir.z),
+        0.0f,
+        (horizontalRight.z * dir.x + horizontalForward.z * dir.z)
+    };
+    Vector3 targetVelocity = Vector3Scale(worldDirection, speed);
+
+    // make acceleration look nicer
+    // capped so a long step lands on the target speed instead of overshooting it
+    float dt = player->stepTime;
+    float blend = fminf(player->acc * dt, 1.0f);
+    player->velocity.x += (targetVelocity.x - player->velocity.x) * blend;
+    player->velocity.z += (targetVelocity.z - player->velocity.z) * blend;
+
+    // add gravity to movement
+    player->velocity.y -= player->g * dt;
+
+    // apply movement based on collision
+    UpdateCollider(player->position, &player->collider);
+    // only run the narrowphase on colliders whose bounds overlap the player, in the order of the collider array
+    int numCandidates = QueryColliders(broadphase, player->collider.boundsMin, player->collider.boundsMax, scratch);
+    for(int c = 0; c < numCandidates; c++) {
+        int i = scratch->candidates[c];
+        Vector3 collisionNormal = {0};
+        if(CheckCollisionCached(&player->pairs, &player->collider, &colliders[i], COLLISION_METHOD_AUTO, &collisionNormal)) {
+            player->position = Vector3Add(player->position, collisionNormal);
+            UpdateCollider(player->position, &player->collider);
+            if(collisionNormal.y > 0.0f) { //0.0f is 90 degree slope (wall) 
+                player->velocity.y = 0;
+                player->isJumping = false;
+            } else{
+                if(!player->isJumping) { //for some reason when spawned the collisionNormal.y is 0, this deals with that
+                    player->velocity.y = 0;
+                }
+            }
+        
+        }
+    }
+
+    // jumping, a press while in the air is dropped like before
+    if(player->jumpQueued && !(player->isJumping) && !(player->isCrouching)) {
+        player->velocity.y = player->jumpStrength;
+        player->isJumping = true;
+    }
+    player->jumpQueued = false;
+
+    Vector3 motion = Vector3Scale(player->velocity, dt);
+    if(player->continuous) SlidePlayer(player, motion, colliders, broadphase, scratch);
+    else player->position = Vector3Add(player->position, motion);
+
+    // detect movement
+    player->isMoving = keys & (PLAYER_KEY_FORWARD | PLAYER_KEY_BACK | PLAYER_KEY_LEFT | PLAYER_KEY_RIGHT);
+}
+
+void StepPlayer(Player *player, unsigned int keys, Vector3 forward, Collider colliders[], Broadphase *broadphase) {
+    StepPlayerScratch(player, keys, forward, colliders, broadphase, &player->scratch);
+}
+
+#define PLAYER_BATCH_GRAIN 8 // players per job, enough that a job is worth handing out
+
+// steps a crowd of players (AI agents) on a job system. they only collide with the world and not with each other,
+// so every player only depends on its own state and the result is the same for any worker count.
+// the players must not be registered in the broadphase, moving them would write to it from several threads
+typedef struct {
+    JobSystem *jobs;
+    CollisionScratch scratch[JOBS_MAX_WORKERS]; // one per worker, kept between steps
+
+    // current step
+    Player *players;
+    const unsigned int *keys;
+    const Vector3 *forwards;
+    Collider *colliders;
+    const Broadphase *broadphase;
+} PlayerBatch;
+
+PlayerBatch InitPlayerBatch(JobSystem *jobs) {
+    PlayerBatch batch = { 0 };
+    batch.jobs = jobs;
+    return batch;
+}
+
+void UnloadPlayerBatch(PlayerBatch *batch) {
+    for(int i = 0; i < JOBS_MAX_WORKERS; i++) UnloadCollisionScratch(&batch->scratch[i]);
+}
+
+static void StepPlayerJob(void *data, int index, int worker) {
+    PlayerBatch *batch = (PlayerBatch *)data;
+    StepPlayerScratch(&batch->players[index], batch->keys[index], batch->forwards[index], batch->colliders, batch->broadphase, &batch->scratch[worker]);
+}
+
+// one physics step for every player, keys and forwards hold one entry per player like StepPlayer takes them
+void StepPlayerBatch(PlayerBatch *batch, Player players[], const unsigned int keys[], const Vector3 forwards[], int count,
+                     const int NumColliders, Collider colliders[], const Broadphase *broadphase) {
+    // build any pending world axes now, the workers would all try to do it at once otherwise
+    for(int i = 0; i < NumColliders; i++) PrepareCollider(&colliders[i]);
+    batch->players = players;
+    batch->keys = keys;
+    batch->forwards = forwards;
+    batch->colliders = colliders;
+    batch->broadphase = broadphase;
+    RunJobs(batch->jobs, StepPlayerJob, batch, count, PLAYER_BATCH_GRAIN);
+}
+
+// turn the player by this frame's mouse movement. runs before the physics steps of the frame so they already move
+// where the player looks now instead of where it looked last frame
+static void ApplyPlayerLook(Player *player, PlayerInput input) {
+    player->yaw -= input.mouseDelta.x * PLAYER_LOOK_SENSITIVITY;
+    player->pitch -= input.mouseDelta.y * PLAYER_LOOK_SENSITIVITY;
+    player->pitch = Clamp(player->pitch, -89.0f*DEG2RAD, 89.0f*DEG2RAD);
+}
+
+// the visual side of a frame, fov, crouch height and head bob. alpha is how far between the last two
+// physics steps the frame is, the camera gets placed there. only reads the simulation state
+void UpdatePlayerView(Player *player, PlayerInput input, float alpha) {
+    float dTime = input.frameTime;
+    // detect speed and change fov accordingly
+    player->bobbingAmount = player->walkBobAmount;
+    float FOV = player->baseFOV;
+    if(player->isSprinting && player->isMoving) {
+        FOV = player->sprintFOV;
+        player->bobbingAmount = player->sprintBobAmount;
+    }
+    if(player->isCrouching) {
+        FOV = player->crouchFOV;
+        player->bobbingAmount = player->crouchBobAmount;
+    }
+
+    // smooth fov changing when changing movement speeds
+    player->camera.fovy += (FOV - player->camera.fovy) * player->fovSpeed * dTime;
+
+    // camera starts from the interpolated physics position, everything after this is only visual
+    player->camera.position = Vector3Lerp(player->previousPosition, player->position, alpha);
+
+    // apply crouch change to camera y position height
+    player->targetCrouchOffset = player->isCrouching ? -0.5f : 0.0f;
+    player->currentCrouchOffset += (player->targetCrouchOffset - player->currentCrouchOffset) * 10.0f * dTime;
+    player->camera.position.y += player->currentCrouchOffset;
+
+    // calculate head bobbing
+    float bobOff = 0.0f;
+    float swayOff = 0.0f;
+
+    if(player->isMoving) {
+        player->bobbingTime += dTime * player->bobbingSpeed;
+        bobOff = sinf(player->bobbingTime * 2.0f) * player->bobbingAmount;
+        swayOff = sinf(player->bobbingTime * 1.0f) * player->swayAmount;
+    }
+    else {
+        player->bobbingTime = 0.0f;
+    }
+    // apply head bobbing and swaying
+    if(!(player->isJumping) && !(player->isCrouching)) {
+        player->camera.position.x += swayOff;
+        player->camera.position.y += bobOff;
+    }
+
+    // end of sprinting jumping crouching section
+    player->camera.target = Vector3Add(player->camera.position, PlayerLookDirection(player));
+}
+
+// slide down ramp when crouch
+//
+// runs once per frame, moves the simulation forward in fixed steps and places the camera between the last two of them
+void UpdatePlayer(Player *player, PlayerInput input, Collider colliders[], Broadphase *broadphase) {
+    PROFILE_SCOPE("update_player");
+    float dTime = input.frameTime; //time in seconds for last frame drawn (delta time)
+    unsigned int keys = input.keys; // held keys for the steps of this frame
+
+    if(input.pressed & PLAYER_PRESS_JUMP) player->jumpQueued = true; // pressed only counts for one frame, keep it for the next step
+    ApplyPlayerLook(player, input);
+
+    // get forward vector from where the camera looks, the steps only use its horizontal part
+    Vector3 forward = PlayerLookDirection(player);
+
+    // fixed steps so physics behaves the same at any frame rate
+    player->accumulator += dTime;
+    int steps = 0;
+    while(player->accumulator >= player->stepTime && steps < MAX_PHYSICS_STEPS) {
+        player->previousPosition = player->position;
+        StepPlayer(player, keys, forward, colliders, broadphase);
+        player->accumulator -= player->stepTime;
+        steps++;
+    }
+    if(player->accumulator >= player->stepTime) player->accumulator = 0.0f; // too far behind, drop the rest instead of catching up
+    UpdatePlayerView(player, input, player->accumulator / player->stepTime);
+}
+
+#endif
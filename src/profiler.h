@@ -0,0 +1,260 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/*Frame profiler. Zones time a stretch of code, counters add up how often something happened (pair tests, points
+projected) and PROFILE_FRAME closes a frame so both can be looked at per frame. Every thread writes its zones into its
+own ring and its own counters, nothing is shared or locked on the way in. ProfilerWriteTrace saves the rings as
+Chrome trace JSON (chrome://tracing or ui.perfetto.dev), the game draws the last frame on an overlay.
+Only there with -DPROFILER (make PROFILE=1), without it every macro is empty and this header adds nothing.
+Needs no raylib so the benchmarks and bench/replay can use it too*/
+
+#ifdef PROFILER
+
+#include <stdio.h>
+#include <stdlib.h>//Memory operations
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define PROFILER_MAX_THREADS 64
+#define PROFILER_RING_SIZE 16384 //Zones kept per thread, the oldest get overwritten. Has to be a power of two
+#define PROFILER_MAX_DEPTH 32 //Zones open at once on one thread, deeper ones are dropped
+#define PROFILER_MAX_COUNTERS 32
+#define PROFILER_MAX_FRAMES 256 //Frames of counter history for the trace and the overlay
+#define PROFILER_MAX_FRAME_ZONES 32 //Different zone names the last frame gets summed up into
+
+typedef struct {
+    const char *name; //A string literal, compared by address
+    uint64_t begin, end; //ProfileNow
+    int depth; //Zones open around it on the same thread
+} ProfileZone;
+
+typedef struct {
+    ProfileZone ring[PROFILER_RING_SIZE];
+    uint64_t head; //Zones ever written, the ring holds the last PROFILER_RING_SIZE of them
+    const char *open[PROFILER_MAX_DEPTH];
+    uint64_t openBegin[PROFILER_MAX_DEPTH];
+    int depth;
+    int64_t counters[PROFILER_MAX_COUNTERS]; //Running totals, only this thread writes them
+    char name[32];
+} ProfileThread;
+
+typedef struct {
+    uint64_t begin, end;
+    int64_t counters[PROFILER_MAX_COUNTERS]; //What happened during the frame
+} ProfileFrame;
+
+//One zone name summed up over every thread for a frame
+typedef struct {
+    const char *name;
+    uint64_t time; //Nanoseconds
+    int calls;
+} ProfileZoneTotal;
+
+typedef struct {
+    pthread_mutex_t lock; //Only for registering threads and counters
+    ProfileThread *threads[PROFILER_MAX_THREADS];
+    int numThreads;
+    const char *counterNames[PROFILER_MAX_COUNTERS];
+    int numCounters;
+    uint64_t origin; //Time of the first zone, the trace starts there
+
+    //Written by PROFILE_FRAME
+    ProfileFrame frames[PROFILER_MAX_FRAMES];
+    uint64_t numFrames;
+    uint64_t frameBegin;
+    int64_t counterTotals[PROFILER_MAX_COUNTERS]; //Sum of every thread at the last frame
+    uint64_t frameHeads[PROFILER_MAX_THREADS]; //Ring heads at the last frame
+    ProfileZoneTotal frameZones[PROFILER_MAX_FRAME_ZONES]; //Last finished frame
+    int numFrameZones;
+} Profiler;
+
+static Profiler profiler = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static __thread ProfileThread *profileThread;
+
+static inline uint64_t ProfileNow(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+//The ring of the calling thread, made the first time a thread records anything. NULL once all slots are taken
+static ProfileThread *ProfileCurrentThread(void) {
+    if (profileThread != NULL) return profileThread;
+    pthread_mutex_lock(&profiler.lock);
+    if (profiler.numThreads < PROFILER_MAX_THREADS) {
+        ProfileThread *t = (ProfileThread *)calloc(1, sizeof(ProfileThread));
+        snprintf(t->name, sizeof(t->name), "thread %d", profiler.numThreads); //PROFILE_THREAD gives it a better one
+        if (profiler.numThreads == 0) profiler.origin = profiler.frameBegin = ProfileNow();
+        __atomic_store_n(&profiler.threads[profiler.numThreads], t, __ATOMIC_RELEASE);
+        __atomic_store_n(&profiler.numThreads, profiler.numThreads + 1, __ATOMIC_RELEASE);
+        profileThread = t;
+    }
+    pthread_mutex_unlock(&profiler.lock);
+    return profileThread;
+}
+
+void ProfileSetThreadName(const char *name) {
+    ProfileThread *t = ProfileCurrentThread();
+    if (t != NULL) snprintf(t->name, sizeof(t->name), "%s", name);
+}
+
+static inline void ProfileBegin(const char *name) {
+    ProfileThread *t = ProfileCurrentThread();
+    if (t == NULL) return;
+    if (t->depth < PROFILER_MAX_DEPTH) {
+        t->open[t->depth] = name;
+        t->openBegin[t->depth] = ProfileNow();
+    }
+    t->depth++;
+}
+
+static inline void ProfileEnd(void) {
+    ProfileThread *t = profileThread;
+    if (t == NULL || t->depth == 0) return;
+    int depth = --t->depth;
+    if (depth >= PROFILER_MAX_DEPTH) return;
+    ProfileZone *zone = &t->ring[t->head & (PROFILER_RING_SIZE - 1)];
+    zone->name = t->open[depth];
+    zone->begin = t->openBegin[depth];
+    zone->end = ProfileNow();
+    zone->depth = depth;
+    __atomic_store_n(&t->head, t->head + 1, __ATOMIC_RELEASE); //The zone is written before anyone reading head sees it
+}
+
+static inline void ProfileEndScope(int *scope) {
+    ProfileEnd();
+}
+
+//Index of the counter with this name, registers it the first time. -1 if there are too many
+int ProfileCounterId(const char *name) {
+    pthread_mutex_lock(&profiler.lock);
+    int id = -1;
+    for (int i = 0; i < profiler.numCounters && id < 0; i++)
+        if (strcmp(profiler.counterNames[i], name) == 0) id = i;
+    if (id < 0 && profiler.numCounters < PROFILER_MAX_COUNTERS) {
+        id = profiler.numCounters;
+        profiler.counterNames[id] = name;
+        __atomic_store_n(&profiler.numCounters, id + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&profiler.lock);
+    return id;
+}
+
+static inline void ProfileAdd(int id, int64_t amount) {
+    ProfileThread *t = ProfileCurrentThread();
+    if (t == NULL || id < 0) return;
+    //Only this thread writes it, relaxed atomics just keep the frame mark from reading half a value
+    __atomic_store_n(&t->counters[id], __atomic_load_n(&t->counters[id], __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+//Closes the frame, call it once per frame from one thread. Takes the counter deltas and sums up the zones that ended
+//since the last call by name for the overlay
+void ProfileFrameMark(void) {
+    ProfileCurrentThread();
+    uint64_t now = ProfileNow();
+    ProfileFrame *frame = &profiler.frames[profiler.numFrames % PROFILER_MAX_FRAMES];
+    frame->begin = profiler.frameBegin;
+    frame->end = now;
+    int numThreads = __atomic_load_n(&profiler.numThreads, __ATOMIC_ACQUIRE);
+    int numCounters = __atomic_load_n(&profiler.numCounters, __ATOMIC_ACQUIRE);
+    for (int c = 0; c < numCounters; c++) {
+        int64_t total = 0;
+        for (int i = 0; i < numThreads; i++) total += __atomic_load_n(&profiler.threads[i]->counters[c], __ATOMIC_RELAXED);
+        frame->counters[c] = total - profiler.counterTotals[c];
+        profiler.counterTotals[c] = total;
+    }
+
+    profiler.numFrameZones = 0;
+    for (int i = 0; i < numThreads; i++) {
+        ProfileThread *t = profiler.threads[i];
+        uint64_t head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+        uint64_t from = profiler.frameHeads[i];
+        if (head - from > PROFILER_RING_SIZE) from = head - PROFILER_RING_SIZE; //Overwritten already
+        for (uint64_t z = from; z < head; z++) {
+            const ProfileZone *zone = &t->ring[z & (PROFILER_RING_SIZE - 1)];
+            int k = 0;
+            while (k < profiler.numFrameZones && profiler.frameZones[k].name != zone->name) k++;
+            if (k == profiler.numFrameZones) {
+                if (k == PROFILER_MAX_FRAME_ZONES) continue;
+                profiler.frameZones[profiler.numFrameZones++] = (ProfileZoneTotal){ zone->name, 0, 0 };
+            }
+            profiler.frameZones[k].time += zone->end - zone->begin;
+            profiler.frameZones[k].calls++;
+        }
+        profiler.frameHeads[i] = head;
+    }
+    profiler.numFrames++;
+    profiler.frameBegin = now;
+}
+
+//The frame framesAgo frames before the last finished one, NULL if it isnt kept anymore
+const ProfileFrame *ProfileGetFrame(int framesAgo) {
+    if (framesAgo < 0 || (uint64_t)framesAgo >= profiler.numFrames || framesAgo >= PROFILER_MAX_FRAMES) return NULL;
+    return &profiler.frames[(profiler.numFrames - 1 - framesAgo) % PROFILER_MAX_FRAMES];
+}
+
+/*Saves every zone still in the rings and the counters of the kept frames as Chrome trace JSON. Threads that are still
+recording can overwrite the oldest zones while this runs, those come out garbled, so call it from a quiet spot*/
+bool ProfilerWriteTrace(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return false;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    int numThreads = __atomic_load_n(&profiler.numThreads, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < numThreads; i++) {
+        ProfileThread *t = profiler.threads[i];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", i, t->name);
+        first = false;
+        uint64_t head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+        uint64_t from = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+        for (uint64_t z = from; z < head; z++) {
+            const ProfileZone *zone = &t->ring[z & (PROFILER_RING_SIZE - 1)];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    zone->name, i, (zone->begin - profiler.origin) * 1e-3, (zone->end - zone->begin) * 1e-3);
+        }
+    }
+    uint64_t kept = profiler.numFrames < PROFILER_MAX_FRAMES ? profiler.numFrames : PROFILER_MAX_FRAMES;
+    for (uint64_t f = profiler.numFrames - kept; f < profiler.numFrames; f++) {
+        const ProfileFrame *frame = &profiler.frames[f % PROFILER_MAX_FRAMES];
+        for (int c = 0; c < profiler.numCounters; c++)
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%lld}}", first ? "" : ",\n",
+                    profiler.counterNames[c], (frame->begin - profiler.origin) * 1e-3, (long long)frame->counters[c]);
+        first = false;
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+//Times from here to PROFILE_END on the same thread, the pairs have to nest
+#define PROFILE_BEGIN(name) ProfileBegin(name)
+#define PROFILE_END() ProfileEnd()
+//Times from here to the end of the enclosing block
+#define PROFILE_SCOPE(name) __attribute__((cleanup(ProfileEndScope), unused)) int PROFILE_CONCAT(profileScope, __LINE__) = (ProfileBegin(name), 0)
+//Adds amount to the counter called name, the name gets looked up once per call site
+#define PROFILE_COUNT(name, amount) do { \
+        static int profileCounter = -2; \
+        int id = __atomic_load_n(&profileCounter, __ATOMIC_RELAXED); \
+        if (id == -2) __atomic_store_n(&profileCounter, id = ProfileCounterId(name), __ATOMIC_RELAXED); \
+        ProfileAdd(id, amount); \
+    } while (0)
+#define PROFILE_THREAD(name) ProfileSetThreadName(name)
+#define PROFILE_FRAME() ProfileFrameMark()
+
+#else
+
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(name, amount) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,348 @@
+#ifndef RENDERLIST_H
+#define RENDERLIST_H
+
+#include "raylib.h" //Mesh, Material, Camera
+#include "raymath.h"//Vector math
+#include "profiler.h"//Draw counters, empty unless PROFILER is defined
+
+#include <stdlib.h>//Memory operations
+#include <string.h>//memcpy
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/*Per frame list of what to draw. Everything gets added with its world bounds, CullRenderList drops what the camera
+cant see (SIMD box against frustum planes), SortRenderList orders the rest by shader, material and mesh and cuts it
+into batches of the same mesh and material, DrawRenderList submits them. Batches of a shader that was marked with
+AllowRenderInstancing go out as one DrawMeshInstanced, the rest as DrawMesh calls in material order.
+Only DrawRenderList touches the GPU, the other stages run headless (bench/render_bench)*/
+
+//Pick the widest vector unit the compiler targets like collisions.h, define RENDERLIST_SCALAR for the plain C cull
+#if !defined(RENDERLIST_SCALAR) && defined(__AVX__)
+    #include <immintrin.h>
+    #define RENDER_SIMD_WIDTH 8
+#elif !defined(RENDERLIST_SCALAR) && (defined(__SSE__) || defined(_M_X64))
+    #include <xmmintrin.h>
+    #define RENDER_SIMD_WIDTH 4
+#else
+    #define RENDER_SIMD_WIDTH 1
+#endif
+
+#define RENDER_CULL_NEAR 0.01 //Same clip planes as rlgl (RL_CULL_DISTANCE_NEAR/FAR) so nothing on screen gets culled
+#define RENDER_CULL_FAR 1000.0
+#define RENDER_MAX_SLOTS 1024 //Different meshes and different materials a frame can tell apart, the rest share the last slot
+#define RENDER_SLOT_TABLE 4096 //Pointer to slot hash table, power of two and well above 2 * RENDER_MAX_SLOTS
+#define RENDER_MAX_INSTANCING 16 //Shaders AllowRenderInstancing can mark
+
+//Inside where dot(normal, p) + distance >= 0
+typedef struct {
+    Vector3 normal;
+    float distance;
+} FrustumPlane;
+
+typedef struct {
+    FrustumPlane planes[6]; //Left, right, bottom, top, near, far
+} Frustum;
+
+typedef struct {
+    const Mesh *mesh;
+    const Material *material;
+    Matrix transform;
+} RenderItem;
+
+//Run of visible items with the same mesh and material
+typedef struct {
+    int first, count; //Into transforms
+    const Mesh *mesh;
+    const Material *material;
+    bool instanced;
+} RenderBatch;
+
+typedef struct {
+    int submitted; //Items added this frame
+    int culled; //Outside the frustum
+    int batches;
+    int drawCalls; //What DrawRenderList issues, one per instanced batch and one per item otherwise
+} RenderStats;
+
+typedef struct {
+    const void *key; //Mesh or material, NULL is empty
+    int slot;
+} RenderSlot;
+
+typedef struct {
+    RenderItem *items;
+    int numItems, capItems;
+    float *centerX, *centerY, *centerZ, *extentX, *extentY, *extentZ; //World bounds of the items, padded for the cull
+    uint64_t *keys; //Visible items: shader, material slot and mesh slot over the item index
+    uint64_t *sortScratch;
+    int numVisible;
+    RenderBatch *batches;
+    int numBatches;
+    Matrix *transforms; //Visible transforms in batch order, the instanced draws read them from here
+    RenderSlot *slotTable; //RENDER_SLOT_TABLE meshes and materials, numbered again every frame
+    int numSlots;
+    unsigned int instancing[RENDER_MAX_INSTANCING]; //Shader ids that can take DrawMeshInstanced
+    int numInstancing;
+    RenderStats stats;
+} RenderList;
+
+/*The planes of what camera sees on a target with this width / height, like BeginMode3D sets it up. Made straight from
+the camera basis, no matrices involved, so the normals come out unit length*/
+Frustum CameraFrustum(Camera camera, float aspect) {
+    Vector3 forward = Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, camera.up));
+    Vector3 up = Vector3CrossProduct(right, forward);
+    Vector3 p = camera.position;
+    Frustum f;
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        //A direction forward + x * right + y * up is on screen for |x| <= tanH and |y| <= tanV
+        float tanV = tanf(camera.fovy * 0.5f * DEG2RAD), tanH = tanV * aspect;
+        Vector3 n[4] = {
+            Vector3Add(Vector3Scale(forward, tanH), right), Vector3Subtract(Vector3Scale(forward, tanH), right),
+            Vector3Add(Vector3Scale(forward, tanV), up), Vector3Subtract(Vector3Scale(forward, tanV), up)
+        };
+        for (int i = 0; i < 4; i++) {
+            n[i] = Vector3Normalize(n[i]);
+            f.planes[i] = (FrustumPlane){ n[i], -Vector3DotProduct(n[i], p) };
+        }
+    } else {
+        float halfHeight = camera.fovy * 0.5f, halfWidth = halfHeight * aspect;
+        f.planes[0] = (FrustumPlane){ right, halfWidth - Vector3DotProduct(right, p) };
+        f.planes[1] = (FrustumPlane){ Vector3Negate(right), halfWidth + Vector3DotProduct(right, p) };
+        f.planes[2] = (FrustumPlane){ up, halfHeight - Vector3DotProduct(up, p) };
+        f.planes[3] = (FrustumPlane){ Vector3Negate(up), halfHeight + Vector3DotProduct(up, p) };
+    }
+    f.planes[4] = (FrustumPlane){ forward, -(Vector3DotProduct(forward, p) + (float)RENDER_CULL_NEAR) };
+    f.planes[5] = (FrustumPlane){ Vector3Negate(forward), Vector3DotProduct(forward, p) + (float)RENDER_CULL_FAR };
+    return f;
+}
+
+/*Writes the indices of the boxes (center and half extent, SoA) that are at least partly inside the frustum to visible and
+returns how many. A box is out if its whole extent is behind one plane, boxes next to a corner can stay in, which is
+the safe side. The arrays need room for count rounded up to RENDER_SIMD_WIDTH, the padding isnt read for the result*/
+int CullBoxes(const Frustum *f, const float *cx, const float *cy, const float *cz, const float *ex, const float *ey, const float *ez, int count, int *visible) {
+    int numVisible = 0;
+#if RENDER_SIMD_WIDTH == 8
+    __m256 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+    for (int k = 0; k < 6; k++) {//Broadcast the planes, and the absolute normals for the box radius
+        const FrustumPlane *p = &f->planes[k];
+        nx[k] = _mm256_set1_ps(p->normal.x); ny[k] = _mm256_set1_ps(p->normal.y); nz[k] = _mm256_set1_ps(p->normal.z);
+        ax[k] = _mm256_set1_ps(fabsf(p->normal.x)); ay[k] = _mm256_set1_ps(fabsf(p->normal.y)); az[k] = _mm256_set1_ps(fabsf(p->normal.z));
+        d[k] = _mm256_set1_ps(p->distance);
+    }
+    for (int i = 0; i < count; i += 8) {
+        __m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i), z = _mm256_loadu_ps(cz + i);
+        __m256 hx = _mm256_loadu_ps(ex + i), hy = _mm256_loadu_ps(ey + i), hz = _mm256_loadu_ps(ez + i);
+        __m256 out = _mm256_setzero_ps();
+        for (int k = 0; k < 6; k++) {
+            __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, nx[k]), _mm256_mul_ps(y, ny[k])), _mm256_mul_ps(z, nz[k])), d[k]);
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(hx, ax[k]), _mm256_mul_ps(hy, ay[k])), _mm256_mul_ps(hz, az[k]));
+            out = _mm256_or_ps(out, _mm256_cmp_ps(_mm256_add_ps(dist, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        int in = ~_mm256_movemask_ps(out) & 0xFF;
+        if (count - i < 8) in &= (1 << (count - i)) - 1; //Padding
+        for (; in != 0; in &= in - 1) visible[numVisible++] = i + __builtin_ctz(in);
+    }
+#elif RENDER_SIMD_WIDTH == 4
+    __m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+    for (int k = 0; k < 6; k++) {
+        const FrustumPlane *p = &f->planes[k];
+        nx[k] = _mm_set1_ps(p->normal.x); ny[k] = _mm_set1_ps(p->normal.y); nz[k] = _mm_set1_ps(p->normal.z);
+        ax[k] = _mm_set1_ps(fabsf(p->normal.x)); ay[k] = _mm_set1_ps(fabsf(p->normal.y)); az[k] = _mm_set1_ps(fabsf(p->normal.z));
+        d[k] = _mm_set1_ps(p->distance);
+    }
+    for (int i = 0; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i), z = _mm_loadu_ps(cz + i);
+        __m128 hx = _mm_loadu_ps(ex + i), hy = _mm_loadu_ps(ey + i), hz = _mm_loadu_ps(ez + i);
+        __m128 out = _mm_setzero_ps();
+        for (int k = 0; k < 6; k++) {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, nx[k]), _mm_mul_ps(y, ny[k])), _mm_mul_ps(z, nz[k])), d[k]);
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, ax[k]), _mm_mul_ps(hy, ay[k])), _mm_mul_ps(hz, az[k]));
+            out = _mm_or_ps(out, _mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+        }
+        int in = ~_mm_movemask_ps(out) & 0xF;
+        if (count - i < 4) in &= (1 << (count - i)) - 1;
+        for (; in != 0; in &= in - 1) visible[numVisible++] = i + __builtin_ctz(in);
+    }
+#else
+    //Scalar fallback, same sums in the same order
+    for (int i = 0; i < count; i++) {
+        bool out = false;
+        for (int k = 0; k < 6 && !out; k++) {
+            const FrustumPlane *p = &f->planes[k];
+            float dist = cx[i] * p->normal.x + cy[i] * p->normal.y + cz[i] * p->normal.z + p->distance;
+            float radius = ex[i] * fabsf(p->normal.x) + ey[i] * fabsf(p->normal.y) + ez[i] * fabsf(p->normal.z);
+            out = dist + radius < 0.0f;
+        }
+        if (!out) visible[numVisible++] = i;
+    }
+#endif
+    return numVisible;
+}
+
+RenderList InitRenderList(void) {
+    RenderList list = { 0 };
+    list.slotTable = (RenderSlot *)calloc(RENDER_SLOT_TABLE, sizeof(RenderSlot));
+    return list;
+}
+
+//Batches with this shader get drawn instanced, single items too. It needs the instanceTransform attribute set up like
+//raylib's instancing example does (locs[SHADER_LOC_MATRIX_MODEL] pointing at it), plain shaders would draw every instance
+//in the same spot and DrawMesh cant draw with it
+void AllowRenderInstancing(RenderList *list, Shader shader) {
+    for (int i = 0; i < list->numInstancing; i++) if (list->instancing[i] == shader.id) return;
+    if (list->numInstancing < RENDER_MAX_INSTANCING) list->instancing[list->numInstancing++] = shader.id;
+}
+
+//Clears the items and the slots of the last frame, the memory stays. Meshes and materials that went away (a sector
+//that got dropped) dont keep their slots
+void BeginRenderList(RenderList *list) {
+    if (list->numSlots > 0) memset(list->slotTable, 0, RENDER_SLOT_TABLE * sizeof(RenderSlot));
+    list->numSlots = 0;
+    list->numItems = 0;
+    list->numVisible = 0;
+    list->numBatches = 0;
+    list->stats = (RenderStats){ 0 };
+}
+
+//Small number for a mesh or material pointer so they fit in a sort key, the same pointer keeps its number for the frame
+static int RenderSlotOf(RenderList *list, const void *key) {
+    unsigned int h = (unsigned int)(((uintptr_t)key >> 4) * 2654435761u) & (RENDER_SLOT_TABLE - 1);
+    while (list->slotTable[h].key != NULL && list->slotTable[h].key != key) h = (h + 1) & (RENDER_SLOT_TABLE - 1);
+    if (list->slotTable[h].key == NULL) {
+        if (list->numSlots == RENDER_MAX_SLOTS) return RENDER_MAX_SLOTS - 1; //Full, SortRenderList still splits the shared slot by pointer
+        list->slotTable[h] = (RenderSlot){ key, list->numSlots++ };
+    }
+    return list->slotTable[h].slot;
+}
+
+/*Draw mesh with material at transform this frame. bounds is the box of the mesh in its own space, GetMeshBoundingBox
+once when it loads, not every frame. The mesh and material have to stay where they are until the list is drawn*/
+void AddRenderItem(RenderList *list, const Mesh *mesh, const Material *material, Matrix transform, BoundingBox bounds) {
+    if (list->numItems + RENDER_SIMD_WIDTH >= list->capItems) {//Keeps room for the cull padding
+        list->capItems = list->capItems ? list->capItems * 2 : 256;
+        list->items = (RenderItem *)realloc(list->items, list->capItems * sizeof(RenderItem));
+        float **soa[6] = { &list->centerX, &list->centerY, &list->centerZ, &list->extentX, &list->extentY, &list->extentZ };
+        for (int k = 0; k < 6; k++) *soa[k] = (float *)realloc(*soa[k], list->capItems * sizeof(float));
+        list->keys = (uint64_t *)realloc(list->keys, list->capItems * sizeof(uint64_t));
+        list->sortScratch = (uint64_t *)realloc(list->sortScratch, list->capItems * sizeof(uint64_t));
+        list->batches = (RenderBatch *)realloc(list->batches, list->capItems * sizeof(RenderBatch));
+        list->transforms = (Matrix *)realloc(list->transforms, list->capItems * sizeof(Matrix));
+    }
+    int i = list->numItems++;
+    list->items[i] = (RenderItem){ mesh, material, transform };
+    //World box around the transformed box, center moves, the extent grows by the absolute rotation and scale
+    Vector3 center = Vector3Transform(Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5f), transform);
+    Vector3 half = Vector3Scale(Vector3Subtract(bounds.max, bounds.min), 0.5f);
+    Matrix m = transform;
+    list->centerX[i] = center.x;
+    list->centerY[i] = center.y;
+    list->centerZ[i] = center.z;
+    list->extentX[i] = fabsf(m.m0) * half.x + fabsf(m.m4) * half.y + fabsf(m.m8) * half.z;
+    list->extentY[i] = fabsf(m.m1) * half.x + fabsf(m.m5) * half.y + fabsf(m.m9) * half.z;
+    list->extentZ[i] = fabsf(m.m2) * half.x + fabsf(m.m6) * half.y + fabsf(m.m10) * half.z;
+    list->stats.submitted++;
+}
+
+//Every mesh of the model, like DrawModelEx would place it. bounds is GetModelBoundingBox of the model
+void AddRenderModel(RenderList *list, const Model *model, Matrix transform, BoundingBox bounds) {
+    Matrix world = MatrixMultiply(model->transform, transform);
+    for (int i = 0; i < model->meshCount; i++)
+        AddRenderItem(list, &model->meshes[i], &model->materials[model->meshMaterial[i]], world, bounds);
+}
+
+//Keeps what the frustum can see, their sort keys are made on the way
+int CullRenderList(RenderList *list, const Frustum *frustum) {
+    PROFILE_SCOPE("cull_render_list");
+    int n = list->numItems;
+    for (int i = n; i < n + RENDER_SIMD_WIDTH && i < list->capItems; i++) {//Padding, read by the last SIMD group but never kept
+        list->centerX[i] = list->centerY[i] = list->centerZ[i] = 0.0f;
+        list->extentX[i] = list->extentY[i] = list->extentZ[i] = 0.0f;
+    }
+    int *visible = (int *)list->sortScratch; //Free until the sort, and as big as keys
+    int numVisible = CullBoxes(frustum, list->centerX, list->centerY, list->centerZ, list->extentX, list->extentY, list->extentZ, n, visible);
+    for (int v = 0; v < numVisible; v++) {
+        const RenderItem *item = &list->items[visible[v]];
+        uint64_t shader = item->material->shader.id & 0xFFF, material = RenderSlotOf(list, item->material), mesh = RenderSlotOf(list, item->mesh);
+        list->keys[v] = shader << 52 | material << 42 | mesh << 32 | (uint64_t)visible[v];
+    }
+    list->numVisible = numVisible;
+    list->stats.culled = n - numVisible;
+    PROFILE_COUNT("draws_submitted", n);
+    PROFILE_COUNT("draws_culled", n - numVisible);
+    return numVisible;
+}
+
+/*LSD radix sort of the visible keys, a byte per pass. Passes where every key has the same byte get skipped, with a
+handful of shaders and meshes most of the high bytes are like that*/
+static void SortRenderKeys(uint64_t *keys, uint64_t *scratch, int count) {
+    uint64_t *src = keys, *dst = scratch;
+    for (int shift = 0; shift < 64 && count > 0; shift += 8) {
+        int counts[256] = { 0 };
+        for (int i = 0; i < count; i++) counts[(src[i] >> shift) & 0xFF]++;
+        if (counts[(src[0] >> shift) & 0xFF] == count) continue;
+        int offset = 0;
+        for (int b = 0; b < 256; b++) {
+            int c = counts[b];
+            counts[b] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < count; i++) dst[counts[(src[i] >> shift) & 0xFF]++] = src[i];
+        uint64_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != keys) memcpy(keys, src, count * sizeof(uint64_t));
+}
+
+//Orders the visible items by shader, material and mesh and cuts them into batches. Same items in the same order
+//give the same batches. A batch never mixes meshes or materials, even when they ran out of slots and share one
+void SortRenderList(RenderList *list) {
+    PROFILE_SCOPE("sort_render_list");
+    int n = list->numVisible;
+    SortRenderKeys(list->keys, list->sortScratch, n);
+    list->numBatches = 0;
+    list->stats.drawCalls = 0;
+    for (int v = 0; v < n; v++) {
+        const RenderItem *item = &list->items[list->keys[v] & 0xFFFFFFFFu];
+        list->transforms[v] = item->transform;
+        if (v == 0 || (list->keys[v] >> 32) != (list->keys[v - 1] >> 32) || item->mesh != list->batches[list->numBatches - 1].mesh ||
+            item->material != list->batches[list->numBatches - 1].material) {
+            list->batches[list->numBatches++] = (RenderBatch){ v, 0, item->mesh, item->material, false };
+        }
+        list->batches[list->numBatches - 1].count++;
+    }
+    for (int b = 0; b < list->numBatches; b++) {
+        RenderBatch *batch = &list->batches[b];
+        for (int i = 0; i < list->numInstancing; i++)
+            if (list->instancing[i] == batch->material->shader.id) batch->instanced = true;
+        list->stats.drawCalls += batch->instanced ? 1 : batch->count;
+    }
+    list->stats.batches = list->numBatches;
+    PROFILE_COUNT("draw_calls", list->stats.drawCalls);
+}
+
+//Submits the sorted batches, between BeginMode3D and EndMode3D. Static so the headless benchmark links without raylib
+static void DrawRenderList(const RenderList *list) {
+    PROFILE_SCOPE("draw_render_list");
+    for (int b = 0; b < list->numBatches; b++) {
+        const RenderBatch *batch = &list->batches[b];
+        if (batch->instanced) DrawMeshInstanced(*batch->mesh, *batch->material, &list->transforms[batch->first], batch->count);
+        else for (int i = 0; i < batch->count; i++) DrawMesh(*batch->mesh, *batch->material, list->transforms[batch->first + i]);
+    }
+}
+
+void UnloadRenderList(RenderList *list) {
+    free(list->items);
+    free(list->centerX); free(list->centerY); free(list->centerZ);
+    free(list->extentX); free(list->extentY); free(list->extentZ);
+    free(list->keys);
+    free(list->sortScratch);
+    free(list->batches);
+    free(list->transforms);
+    free(list->slotTable);
+    *list = (RenderList){ 0 };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "raylib.h"
+#include "collisions.h"
+#include "player.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Input recordings, a small header with the player start state followed by one fixed size record per frame.
+ * header: "SCRP", version, start position, yaw, pitch, capsule center, radius, half height (48 bytes)
+ * frame: frame time, held keys, pressed keys, mouse delta x, y (14 bytes, about 3MB per hour at 60 fps)
+ * numbers are written as they are in memory, little endian on everything we build for.
+ * the world isnt in the file, the replayer rebuilds it from scene.h */
+
+#define REPLAY_MAGIC "SCRP"
+#define REPLAY_VERSION 1
+#define REPLAY_FRAME_SIZE 14
+
+typedef struct {
+    FILE *file; // NULL if the recording couldnt be opened
+    long frames; // frames written so far
+} InputRecording;
+
+typedef struct {
+    Vector3 position; // player start
+    float yaw, pitch;
+    ColliderPrimitive capsule; // player collider, only center, radius and halfHeight are stored
+    PlayerInput *frames;
+    int numFrames; // -1 if the file is missing or not a recording
+} InputReplay;
+
+static void WriteReplayFloats(FILE *file, const float *values, int count) {
+    fwrite(values, sizeof(float), count, file);
+}
+
+static bool ReadReplayFloats(FILE *file, float *values, int count) {
+    return fread(values, sizeof(float), count, file) == (size_t)count;
+}
+
+// call after the player is set up, everything the replay needs to start from the same state goes in the header
+InputRecording StartInputRecording(const char *path, const Player *player) {
+    InputRecording rec = { 0 };
+    rec.file = fopen(path, "wb");
+    if(rec.file == NULL) return rec;
+    unsigned int version = REPLAY_VERSION;
+    const ColliderPrimitive *capsule = &player->collider.primitive;
+    float header[10] = {
+        player->position.x, player->position.y, player->position.z, player->yaw, player->pitch,
+        capsule->center.x, capsule->center.y, capsule->center.z, capsule->radius, capsule->halfHeight
+    };
+    fwrite(REPLAY_MAGIC, 1, 4, rec.file);
+    fwrite(&version, sizeof(version), 1, rec.file);
+    WriteReplayFloats(rec.file, header, 10);
+    return rec;
+}
+
+void RecordInput(InputRecording *rec, PlayerInput input) {
+    if(rec->file == NULL) return;
+    unsigned char keys[2] = { (unsigned char)input.keys, (unsigned char)input.pressed };
+    WriteReplayFloats(rec->file, &input.frameTime, 1);
+    fwrite(keys, 1, 2, rec->file);
+    WriteReplayFloats(rec->file, (float[2]){ input.mouseDelta.x, input.mouseDelta.y }, 2);
+    rec->frames++;
+}
+
+void StopInputRecording(InputRecording *rec) {
+    if(rec->file) fclose(rec->file);
+    rec->file = NULL;
+}
+
+// reads the whole recording at once so playback never waits on the disk
+InputReplay LoadInputReplay(const char *path) {
+    InputReplay replay = { 0 };
+    replay.numFrames = -1;
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) return replay;
+
+    char magic[4];
+    unsigned int version;
+    float header[10];
+    if(fread(magic, 1, 4, file) != 4 || memcmp(magic, REPLAY_MAGIC, 4) != 0 ||
+       fread(&version, sizeof(version), 1, file) != 1 || version != REPLAY_VERSION || !ReadReplayFloats(file, header, 10)) {
+        fclose(file);
+        return replay;
+    }
+    replay.position = (Vector3){ header[0], header[1], header[2] };
+    replay.yaw = header[3];
+    replay.pitch = header[4];
+    replay.capsule.shape = COLLIDER_CAPSULE;
+    replay.capsule.center = (Vector3){ header[5], header[6], header[7] };
+    replay.capsule.radius = header[8];
+    replay.capsule.halfHeight = header[9];
+
+    // frame count from the file size, a cut off last frame (game killed mid write) gets dropped
+    long start = ftell(file);
+    fseek(file, 0, SEEK_END);
+    int numFrames = (int)((ftell(file) - start) / REPLAY_FRAME_SIZE);
+    fseek(file, start, SEEK_SET);
+
+    replay.frames = (PlayerInput *)malloc((numFrames > 0 ? numFrames : 1) * sizeof(PlayerInput));
+    replay.numFrames = 0;
+    for(int i = 0; i < numFrames; i++) {
+        unsigned char keys[2];
+        float mouse[2];
+        PlayerInput *input = &replay.frames[i];
+        if(!ReadReplayFloats(file, &input->frameTime, 1) || fread(keys, 1, 2, file) != 2 || !ReadReplayFloats(file, mouse, 2)) break;
+        input->keys = keys[0];
+        input->pressed = keys[1];
+        input->mouseDelta = (Vector2){ mouse[0], mouse[1] };
+        replay.numFrames++;
+    }
+    fclose(file);
+    return replay;
+}
+
+void UnloadInputReplay(InputReplay *replay) {
+    free(replay->frames);
+    replay->frames = NULL;
+    replay->numFrames = 0;
+}
+
+// the physics side of the player exactly like it was when the recording started, visual settings are left at zero
+void SetupReplayPlayer(Player *player, const InputReplay *replay) {
+    *player = (Player){ 0 };
+    Collider capsule;
+    SetupColliderCapsule(&capsule, replay->capsule.center, replay->capsule.radius, replay->capsule.halfHeight);
+    SetupPlayerPhysics(player, replay->position, capsule);
+    player->yaw = replay->yaw;
+    player->pitch = replay->pitch;
+}
+
+#endif
@@ -0,0 +1,781 @@
+#ifndef RIGIDBODY_H
+#define RIGIDBODY_H
+
+#include "raylib.h"
+#include "raymath.h"
+#include "collisions.h"
+#include "jobs.h"
+#include "profiler.h"
+
+#include <stdlib.h>//Memory operations
+#include <stdint.h>
+#include <string.h>
+
+/*Rigid bodies for props that get knocked around, crates and debris. Bodies are boxes or spheres (the collider
+primitives), they collide with each other and with the static level colliders of any shape.
+A step goes:
+ - narrowphase, every awake body against the bodies and level colliders its bounds touch, on the job system. Every
+   touching pair gives a manifold of up to RIGIDBODY_MAX_POINTS contact points, the MTV of the pair test is the normal
+   and the corners that dig in are the points. The manifolds get sorted by pair so the rest never depends on which
+   worker found what
+ - islands, bodies that touch each other (through other bodies, the level doesnt connect them) end up in one island.
+   A sleeping body an awake one runs into joins its island and wakes up
+ - solve, every island on its own on the job system: sequential impulses for the normal and the friction of every
+   point, warm started with what the same point took last step, then the positions move. An island that was slow
+   for RIGIDBODY_SLEEP_TIME goes to sleep as a whole
+Sleeping bodies arent integrated, moved in the broadphase or tested, a pile that settled costs nothing until
+something awake touches it. A body that goes to sleep wakes its neighbours only once something touches it again,
+so a wake spreads trough a sleeping pile one contact per step.
+The level colliders are only read, PrepareCollider runs on the ones the bodies touch before the workers start*/
+
+#define RIGIDBODY_MAX_POINTS 4
+#define RIGIDBODY_ITERATIONS 16 //Velocity iterations per step, under 14 a stack of six rocks itself awake
+#define RIGIDBODY_BAUMGARTE 0.2f //Fraction of the penetration pushed out per step
+#define RIGIDBODY_SLOP 0.005f //Penetration left alone so resting contacts dont jitter in and out
+#define RIGIDBODY_MAX_PUSH 2.0f //m/s, cap on the push out velocity so deep overlaps dont explode
+#define RIGIDBODY_FEATURE_BAND 0.02f //Corners this close to the deepest one along the normal touch too (a face or an edge)
+#define RIGIDBODY_MATCH_DISTANCE 0.05f //A new point this close to an old one on the same body is the same point, it keeps its impulses
+#define RIGIDBODY_BOUNCE_SPEED 1.0f //Restitution only for impacts faster then this, resting contacts dont bounce
+#define RIGIDBODY_LINEAR_DAMPING 0.05f
+#define RIGIDBODY_ANGULAR_DAMPING 0.1f
+#define RIGIDBODY_SLEEP_LINEAR 0.05f //m/s
+#define RIGIDBODY_SLEEP_ANGULAR 0.05f //rad/s
+#define RIGIDBODY_SLEEP_TIME 0.5f //Seconds a whole island has to stay under both before it sleeps
+#define RIGIDBODY_LEVEL_FRICTION 0.6f //Level colliders have no material
+#define RIGIDBODY_ROLLING_RESISTANCE 0.1f //Times the radius, without it a ball on flat ground never stops rolling and never sleeps
+#define RIGIDBODY_CELL_SIZE 2.0f //Grid cell of the body broadphase, about the size of a crate
+
+typedef struct {
+    Collider collider; //Box or sphere around the origin, its transform follows the body
+    Vector3 position;
+    Quaternion orientation;
+    Vector3 velocity, angularVelocity;
+    float invMass; //0 for a body that never moves, it still pushes the others
+    Vector3 invInertia; //Local, the diagonal of the inverse inertia tensor
+    float friction, restitution;
+    float sleepTime; //How long it has been slow
+    bool awake;
+    unsigned int stamp; //Step it joined an island in
+} RigidBody;
+
+typedef struct {
+    Vector3 position; //World, where the impulses go
+    Vector3 localA; //The same point in the local space of a, finds it again next step
+    float depth;
+    float normalImpulse, tangentImpulse[2]; //Accumulated over the iterations, the warm start of the next step
+    //Per direction (normal, two tangents): r cross the direction on a and b, the same trough the inverse inertia, and the effective mass
+    Vector3 crossA[3], crossB[3];
+    Vector3 turnA[3], turnB[3];
+    float mass[3];
+    float bias; //Target separating speed, the push out and the bounce
+} RigidContactPoint;
+
+typedef struct {
+    uint64_t key; //a in the high half, b or RIGIDBODY_LEVEL_KEY | collider in the low half
+    int a, b; //Bodies, b is -1 for a level collider
+    Vector3 normal; //Unit, pushes a out of b
+    Vector3 tangents[2];
+    float friction, restitution;
+    float rolling; //Most torque against rolling per normal impulse, 0 unless there is a sphere in it
+    float rollingMass;
+    Vector3 rollingImpulse; //Accumulated like the point impulses
+    int numPoints;
+    RigidContactPoint points[RIGIDBODY_MAX_POINTS];
+} RigidManifold;
+
+#define RIGIDBODY_LEVEL_KEY 0x80000000u
+
+typedef struct {
+    int firstBody, numBodies; //In islandBodies
+    int firstManifold, numManifolds; //In islandManifolds
+    bool asleep; //Went to sleep this step
+} RigidIsland;
+
+//Per worker narrowphase memory
+typedef struct {
+    CollisionScratch bodies, level;
+    RigidManifold *manifolds;
+    int numManifolds, capManifolds;
+} RigidWorker;
+
+typedef struct {
+    int awake, sleeping; //Bodies after the step
+    int islands, largestIsland;
+    int manifolds, points;
+    int warmStarted; //Points that found themselves from the step before
+} RigidWorldStats;
+
+typedef struct {
+    RigidBody *bodies;
+    int numBodies, capBodies;
+    int numFixed; //Bodies with mass 0
+    Broadphase broadphase; //Of the bodies, the ids are the body indices
+    Vector3 gravity;
+    JobSystem *jobs; //NULL runs everything on the calling thread
+    unsigned int step;
+
+    int *awake; //Awake bodies, the only ones a step looks at
+    int numAwake;
+
+    RigidWorker workers[JOBS_MAX_WORKERS];
+    RigidManifold *manifolds, *previous; //This step and the last one, sorted by key
+    int numManifolds, numPrevious, capManifolds, capPrevious;
+
+    int *parent; //Union find over the body indices
+    int *islandOf; //Island of every body in one, by body index
+    RigidIsland *islands;
+    int numIslands, capIslands;
+    int *islandBodies, *islandManifolds;
+    int capIslandBodies;
+    int *nodes; //Bodies in an island this step
+    int numNodes;
+
+    //What the jobs of the current step read
+    float dt;
+    Collider *level;
+    const Broadphase *levelBroadphase;
+
+    RigidWorldStats stats;
+} RigidWorld;
+
+//Takes a pointer since the body colliders keep one to the broadphase in it
+void InitRigidWorld(RigidWorld *world, Vector3 gravity, JobSystem *jobs) {
+    *world = (RigidWorld){ 0 };
+    world->gravity = gravity;
+    world->jobs = jobs;
+    world->broadphase = InitBroadphase(RIGIDBODY_CELL_SIZE, 1024);
+}
+
+Matrix RigidBodyTransform(const RigidBody *body) {
+    return MatrixMultiply(QuaternionToMatrix(body->orientation), MatrixTranslate(body->position.x, body->position.y, body->position.z));
+}
+
+//Local vector trough the inverse inertia in world space
+static Vector3 RigidInvInertia(const RigidBody *body, Vector3 v) {
+    Vector3 local = Vector3RotateByQuaternion(v, QuaternionInvert(body->orientation));
+    local = (Vector3){ local.x * body->invInertia.x, local.y * body->invInertia.y, local.z * body->invInertia.z };
+    return Vector3RotateByQuaternion(local, body->orientation);
+}
+
+void WakeRigidBody(RigidWorld *world, int index) {
+    RigidBody *body = &world->bodies[index];
+    body->sleepTime = 0.0f;
+    if (body->awake || body->invMass == 0.0f) return;
+    body->awake = true;
+    world->awake[world->numAwake++] = index;
+}
+
+static int AddRigidBody(RigidWorld *world, Vector3 position, Quaternion orientation, float mass, Vector3 inertia) {
+    if (world->numBodies == world->capBodies) {
+        world->capBodies = world->capBodies ? world->capBodies * 2 : 256;
+        world->bodies = (RigidBody *)realloc(world->bodies, world->capBodies * sizeof(RigidBody));
+        world->awake = (int *)realloc(world->awake, world->capBodies * sizeof(int));
+        world->parent = (int *)realloc(world->parent, world->capBodies * sizeof(int));
+        world->islandOf = (int *)realloc(world->islandOf, world->capBodies * sizeof(int));
+        world->nodes = (int *)realloc(world->nodes, world->capBodies * sizeof(int));
+    }
+    int index = world->numBodies++;
+    RigidBody *body = &world->bodies[index];
+    *body = (RigidBody){ 0 };
+    body->position = position;
+    body->orientation = QuaternionNormalize(orientation);
+    body->invMass = mass > 0.0f ? 1.0f / mass : 0.0f;
+    if (mass > 0.0f) body->invInertia = (Vector3){ 1.0f / inertia.x, 1.0f / inertia.y, 1.0f / inertia.z };
+    else world->numFixed++;
+    body->friction = 0.6f;
+    body->stamp = world->step;
+    return index;
+}
+
+//Puts the collider where the body is and into the broadphase, the collider has to be set up already
+static void PlaceRigidBody(RigidWorld *world, int index) {
+    RigidBody *body = &world->bodies[index];
+    SetColliderTransform(&body->collider, RigidBodyTransform(body));
+    RegisterCollider(&world->broadphase, &body->collider, index);
+    body->awake = false;
+    WakeRigidBody(world, index);
+}
+
+//Crate, halfExtents in its local space. Mass 0 makes a body that never moves. Returns the body index
+int AddRigidBox(RigidWorld *world, Vector3 position, Quaternion orientation, Vector3 halfExtents, float mass) {
+    Vector3 size = Vector3Scale(halfExtents, 2.0f);
+    Vector3 inertia = { mass / 12.0f * (size.y * size.y + size.z * size.z), mass / 12.0f * (size.x * size.x + size.z * size.z),
+                        mass / 12.0f * (size.x * size.x + size.y * size.y) };
+    int index = AddRigidBody(world, position, orientation, mass, inertia);
+    SetupColliderBox(&world->bodies[index].collider, (Vector3){ 0, 0, 0 }, halfExtents);
+    PlaceRigidBody(world, index);
+    return index;
+}
+
+int AddRigidSphere(RigidWorld *world, Vector3 position, float radius, float mass) {
+    float moment = 0.4f * mass * radius * radius;
+    int index = AddRigidBody(world, position, QuaternionIdentity(), mass, (Vector3){ moment, moment, moment });
+    SetupColliderSphere(&world->bodies[index].collider, (Vector3){ 0, 0, 0 }, radius);
+    PlaceRigidBody(world, index);
+    return index;
+}
+
+static Vector3 RigidBoxCorner(const ColliderPrimitive *box, int i) {
+    Vector3 p = box->center;
+    p = Vector3Add(p, Vector3Scale(box->axes[0], (i & 1) ? box->halfExtents.x : -box->halfExtents.x));
+    p = Vector3Add(p, Vector3Scale(box->axes[1], (i & 2) ? box->halfExtents.y : -box->halfExtents.y));
+    return Vector3Add(p, Vector3Scale(box->axes[2], (i & 4) ? box->halfExtents.z : -box->halfExtents.z));
+}
+
+//Face of a box whose outward normal is closest to dir, returns how close (1 is straight on)
+typedef struct {
+    Vector3 normal, center;
+    Vector3 sides[2];
+    float half[2];
+} RigidBoxFace;
+
+static float FindRigidBoxFace(const ColliderPrimitive *box, Vector3 dir, RigidBoxFace *face) {
+    float half[3] = { box->halfExtents.x, box->halfExtents.y, box->halfExtents.z };
+    int best = 0;
+    float alignment = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        float d = Vector3DotProduct(box->axes[i], dir);
+        if (fabsf(d) > fabsf(alignment)) { alignment = d; best = i; }
+    }
+    face->normal = alignment < 0.0f ? Vector3Negate(box->axes[best]) : box->axes[best];
+    face->center = Vector3Add(box->center, Vector3Scale(face->normal, half[best]));
+    face->sides[0] = box->axes[(best + 1) % 3];
+    face->sides[1] = box->axes[(best + 2) % 3];
+    face->half[0] = half[(best + 1) % 3];
+    face->half[1] = half[(best + 2) % 3];
+    return fabsf(alignment);
+}
+
+//Sutherland Hodgman, keeps the part of the polygon where dot(p, axis) <= limit
+static int ClipRigidPolygon(const Vector3 *in, int count, Vector3 axis, float limit, Vector3 *out) {
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        Vector3 p = in[i], q = in[(i + 1) % count];
+        float dp = Vector3DotProduct(p, axis) - limit, dq = Vector3DotProduct(q, axis) - limit;
+        if (dp <= 0.0f) out[kept++] = p;
+        if ((dp < 0.0f) != (dq < 0.0f) && dp != dq) out[kept++] = Vector3Lerp(p, q, dp / (dp - dq));
+    }
+    return kept;
+}
+
+static void AddRigidPoint(Vector3 *points, float *depths, int *count, Vector3 p, float depth) {
+    if (*count == 16) return;
+    points[*count] = p;
+    depths[*count] = depth;
+    (*count)++;
+}
+
+/*Keeps the four points that span the most area. Picked by where they are and not how deep, a flat contact has points
+about as deep as each other and which one is deepest changes every step, the kept points would hop around with it*/
+static void ReduceRigidPoints(RigidManifold *m, const Vector3 *points, const float *depths, int count) {
+    int keep[RIGIDBODY_MAX_POINTS];
+    int kept = 0;
+    if (count <= RIGIDBODY_MAX_POINTS) {
+        for (int i = 0; i < count; i++) keep[kept++] = i;
+    } else {
+        Vector3 n = m->normal;
+        Vector3 tangent = fabsf(n.x) > 0.57735f ? (Vector3){ n.y, -n.x, 0.0f } : (Vector3){ 0.0f, n.z, -n.y };
+        int first = 0, second = 0, left = 0, right = 0;
+        for (int i = 1; i < count; i++) if (Vector3DotProduct(points[i], tangent) > Vector3DotProduct(points[first], tangent)) first = i;
+        for (int i = 1; i < count; i++) if (Vector3DistanceSqr(points[i], points[first]) > Vector3DistanceSqr(points[second], points[first])) second = i;
+        //Biggest triangle on each side of the line trough the first two
+        Vector3 edge = Vector3Subtract(points[second], points[first]);
+        float most = 0.0f, least = 0.0f;
+        for (int i = 0; i < count; i++) {
+            float area = Vector3DotProduct(Vector3CrossProduct(edge, Vector3Subtract(points[i], points[first])), n);
+            if (area > most) { most = area; left = i; }
+            if (area < least) { least = area; right = i; }
+        }
+        keep[kept++] = first;
+        keep[kept++] = second;
+        if (most > 0.0f) keep[kept++] = left;
+        if (least < 0.0f) keep[kept++] = right;
+    }
+    m->numPoints = kept;
+    for (int i = 0; i < kept; i++) {
+        m->points[i] = (RigidContactPoint){ 0 };
+        m->points[i].position = points[keep[i]];
+        m->points[i].depth = fmaxf(depths[keep[i]], 0.0f);
+    }
+}
+
+/*Contact points of body collider a against b, a body or a level collider. The pair test gives the normal and
+the depth, the points are where the shapes dig into each other: the deepest point of a sphere, the face of one box
+clipped to the face of the other, or the corners of a box on its deepest face or edge against anything else*/
+static bool RigidContacts(Collider *a, Collider *b, RigidManifold *m) {
+    Vector3 push;
+    if (!CheckCollisionPair(a, b, COLLISION_METHOD_AUTO, &push)) return false;
+    float depth = Vector3Length(push);
+    if (depth < 1e-6f) return false;
+    Vector3 n = Vector3Scale(push, 1.0f / depth);
+    m->normal = n;
+
+    Vector3 points[16];
+    float depths[16];
+    int count = 0;
+    ColliderPrimitive worldA = TransformPrimitive(&a->primitive, a->transform);
+    ColliderPrimitive worldB = { 0 };
+    if (b->primitive.shape != COLLIDER_HULL) worldB = TransformPrimitive(&b->primitive, b->transform);
+    if (worldA.shape == COLLIDER_SPHERE) {
+        AddRigidPoint(points, depths, &count, Vector3Subtract(worldA.center, Vector3Scale(n, worldA.radius)), depth);
+    } else if (b->primitive.shape == COLLIDER_SPHERE) {
+        AddRigidPoint(points, depths, &count, Vector3Add(worldB.center, Vector3Scale(n, worldB.radius)), depth);
+    } else {
+        Vector3 cornersA[8];
+        float lowA = FLT_MAX;
+        for (int i = 0; i < 8; i++) {
+            cornersA[i] = RigidBoxCorner(&worldA, i);
+            lowA = fminf(lowA, Vector3DotProduct(cornersA[i], n));
+        }
+        if (b->primitive.shape == COLLIDER_BOX) {
+            //The face of either box that lies flattest against the normal is the reference, the face of the other
+            //one that faces it gets clipped to its sides and what is left under it are the points
+            RigidBoxFace faceA, faceB, reference, incident;
+            float alignA = FindRigidBoxFace(&worldA, Vector3Negate(n), &faceA), alignB = FindRigidBoxFace(&worldB, n, &faceB);
+            bool onA = alignA > 0.98f * alignB + 0.001f; //Leans to b so the reference doesnt flip back and forth
+            reference = onA ? faceA : faceB;
+            FindRigidBoxFace(onA ? &worldB : &worldA, Vector3Negate(reference.normal), &incident);
+            Vector3 polygon[8], clipped[8];
+            int corners = 0;
+            for (int i = 0; i < 4; i++) {
+                float u = (i == 1 || i == 2) ? 1.0f : -1.0f, v = i >= 2 ? 1.0f : -1.0f;
+                polygon[corners++] = Vector3Add(incident.center, Vector3Add(Vector3Scale(incident.sides[0], u * incident.half[0]),
+                                                                            Vector3Scale(incident.sides[1], v * incident.half[1])));
+            }
+            for (int k = 0; k < 2 && corners > 0; k++) {
+                float center = Vector3DotProduct(reference.center, reference.sides[k]);
+                corners = ClipRigidPolygon(polygon, corners, reference.sides[k], center + reference.half[k], clipped);
+                corners = ClipRigidPolygon(clipped, corners, Vector3Negate(reference.sides[k]), -center + reference.half[k], polygon);
+            }
+            for (int i = 0; i < corners; i++) {
+                float separation = Vector3DotProduct(Vector3Subtract(polygon[i], reference.center), reference.normal);
+                if (separation <= RIGIDBODY_SLOP) AddRigidPoint(points, depths, &count, polygon[i], fminf(-separation, depth));
+            }
+            if (count == 0) {//Edge on edge, halfway between the deepest corners
+                Vector3 cornerB = worldB.center;
+                int deepA = 0;
+                for (int i = 1; i < 8; i++) if (Vector3DotProduct(cornersA[i], n) < Vector3DotProduct(cornersA[deepA], n)) deepA = i;
+                float highB = -FLT_MAX;
+                for (int i = 0; i < 8; i++) {
+                    Vector3 corner = RigidBoxCorner(&worldB, i);
+                    if (Vector3DotProduct(corner, n) > highB) { highB = Vector3DotProduct(corner, n); cornerB = corner; }
+                }
+                AddRigidPoint(points, depths, &count, Vector3Lerp(cornersA[deepA], cornerB, 0.5f), depth);
+            }
+        } else {
+            for (int i = 0; i < 8; i++) {
+                float along = Vector3DotProduct(cornersA[i], n) - lowA;
+                if (along <= RIGIDBODY_FEATURE_BAND) AddRigidPoint(points, depths, &count, cornersA[i], depth - along);
+            }
+        }
+    }
+    ReduceRigidPoints(m, points, depths, count);
+    return true;
+}
+
+static float RigidRollingRadius(const Collider *c) {
+    return c->primitive.shape == COLLIDER_SPHERE ? c->primitive.radius : 0.0f;
+}
+
+static void PushRigidManifold(RigidWorker *worker, const RigidManifold *m) {
+    if (worker->numManifolds == worker->capManifolds) {
+        worker->capManifolds = worker->capManifolds ? worker->capManifolds * 2 : 256;
+        worker->manifolds = (RigidManifold *)realloc(worker->manifolds, worker->capManifolds * sizeof(RigidManifold));
+    }
+    worker->manifolds[worker->numManifolds++] = *m;
+}
+
+//One awake body against everything its bounds touch. Pairs of two awake bodies go to the lower index
+static void RigidNarrowphaseJob(void *data, int k, int workerIndex) {
+    RigidWorld *world = (RigidWorld *)data;
+    RigidWorker *worker = &world->workers[workerIndex];
+    int i = world->awake[k];
+    RigidBody *body = &world->bodies[i];
+    RigidManifold m;
+    int count = QueryColliders(&world->broadphase, body->collider.boundsMin, body->collider.boundsMax, &worker->bodies);
+    for (int c = 0; c < count; c++) {
+        int j = worker->bodies.candidates[c];
+        RigidBody *other = &world->bodies[j];
+        if (j == i || (other->awake && j < i)) continue;
+        if (!RigidContacts(&body->collider, &other->collider, &m)) continue;
+        m.key = (uint64_t)i << 32 | (uint32_t)j;
+        m.a = i;
+        m.b = j;
+        m.friction = sqrtf(body->friction * other->friction);
+        m.restitution = fmaxf(body->restitution, other->restitution);
+        m.rolling = RIGIDBODY_ROLLING_RESISTANCE * fmaxf(RigidRollingRadius(&body->collider), RigidRollingRadius(&other->collider));
+        PushRigidManifold(worker, &m);
+    }
+    if (world->levelBroadphase == NULL) return;
+    count = QueryColliders(world->levelBroadphase, body->collider.boundsMin, body->collider.boundsMax, &worker->level);
+    for (int c = 0; c < count; c++) {
+        int j = worker->level.candidates[c];
+        if (!RigidContacts(&body->collider, &world->level[j], &m)) continue;
+        m.key = (uint64_t)i << 32 | (RIGIDBODY_LEVEL_KEY | (uint32_t)j);
+        m.a = i;
+        m.b = -1;
+        m.friction = sqrtf(body->friction * RIGIDBODY_LEVEL_FRICTION);
+        m.restitution = body->restitution;
+        m.rolling = RIGIDBODY_ROLLING_RESISTANCE * RigidRollingRadius(&body->collider);
+        PushRigidManifold(worker, &m);
+    }
+}
+
+static int CompareRigidManifolds(const void *x, const void *y) {
+    uint64_t a = ((const RigidManifold *)x)->key, b = ((const RigidManifold *)y)->key;
+    return a < b ? -1 : a > b;
+}
+
+static const RigidManifold *FindPreviousManifold(const RigidWorld *world, uint64_t key) {
+    int lo = 0, hi = world->numPrevious - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint64_t k = world->previous[mid].key;
+        if (k == key) return &world->previous[mid];
+        if (k < key) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return NULL;
+}
+
+//Local points, tangents and the impulses the same points had last step
+static void WarmRigidManifold(RigidWorld *world, RigidManifold *m) {
+    const RigidBody *a = &world->bodies[m->a];
+    Quaternion inverse = QuaternionInvert(a->orientation);
+    Vector3 n = m->normal;
+    m->tangents[0] = Vector3Normalize(fabsf(n.x) > 0.57735f ? (Vector3){ n.y, -n.x, 0.0f } : (Vector3){ 0.0f, n.z, -n.y });
+    m->tangents[1] = Vector3CrossProduct(n, m->tangents[0]);
+    const RigidManifold *old = FindPreviousManifold(world, m->key);
+    m->rollingImpulse = old != NULL ? old->rollingImpulse : (Vector3){ 0, 0, 0 };
+    for (int p = 0; p < m->numPoints; p++) {
+        RigidContactPoint *point = &m->points[p];
+        point->localA = Vector3RotateByQuaternion(Vector3Subtract(point->position, a->position), inverse);
+        if (old == NULL) continue;
+        int match = -1;
+        float best = RIGIDBODY_MATCH_DISTANCE * RIGIDBODY_MATCH_DISTANCE;
+        for (int q = 0; q < old->numPoints; q++) {
+            float d = Vector3DistanceSqr(point->localA, old->points[q].localA);
+            if (d < best) { best = d; match = q; }
+        }
+        if (match < 0) continue;
+        //The tangents can turn a bit between steps, carry the friction over as a vector
+        const RigidContactPoint *from = &old->points[match];
+        Vector3 friction = Vector3Add(Vector3Scale(old->tangents[0], from->tangentImpulse[0]), Vector3Scale(old->tangents[1], from->tangentImpulse[1]));
+        point->normalImpulse = from->normalImpulse;
+        point->tangentImpulse[0] = Vector3DotProduct(friction, m->tangents[0]);
+        point->tangentImpulse[1] = Vector3DotProduct(friction, m->tangents[1]);
+        world->stats.warmStarted++;
+    }
+}
+
+static int FindRigidRoot(int *parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+//Adds a body to the islands of this step, sleeping ones get woken
+static void AddRigidNode(RigidWorld *world, int index) {
+    RigidBody *body = &world->bodies[index];
+    if (body->stamp == world->step) return;
+    body->stamp = world->step;
+    if (!body->awake) {
+        body->awake = true;
+        body->sleepTime = 0.0f;
+    }
+    world->parent[index] = index;
+    world->nodes[world->numNodes++] = index;
+}
+
+static int CompareInts(const void *x, const void *y) {
+    return *(const int *)x - *(const int *)y;
+}
+
+//Groups the nodes into islands, bodies in index order and manifolds in key order inside each one
+static void BuildRigidIslands(RigidWorld *world) {
+    world->numNodes = 0;
+    for (int i = 0; i < world->numAwake; i++) AddRigidNode(world, world->awake[i]);
+    for (int i = 0; i < world->numManifolds; i++) {
+        const RigidManifold *m = &world->manifolds[i];
+        if (m->b < 0 || world->bodies[m->b].invMass == 0.0f) continue; //Nothing moves trough the level or a fixed body
+        AddRigidNode(world, m->b);
+        int ra = FindRigidRoot(world->parent, m->a), rb = FindRigidRoot(world->parent, m->b);
+        if (ra != rb) world->parent[ra < rb ? rb : ra] = ra < rb ? ra : rb; //Lowest index is the root
+    }
+    qsort(world->nodes, world->numNodes, sizeof(int), CompareInts);
+
+    if (world->numNodes > world->capIslands) {
+        world->capIslands = world->numNodes;
+        world->islands = (RigidIsland *)realloc(world->islands, world->capIslands * sizeof(RigidIsland));
+    }
+    if (world->numNodes + world->numManifolds > world->capIslandBodies) {
+        world->capIslandBodies = (world->numNodes + world->numManifolds) * 2;
+        world->islandBodies = (int *)realloc(world->islandBodies, world->capIslandBodies * sizeof(int));
+        world->islandManifolds = (int *)realloc(world->islandManifolds, world->capIslandBodies * sizeof(int));
+    }
+    //Roots are the lowest index of their island, so they come first in the sorted nodes and number the islands in order
+    world->numIslands = 0;
+    for (int i = 0; i < world->numNodes; i++) {
+        int body = world->nodes[i];
+        int root = FindRigidRoot(world->parent, body);
+        if (root == body) {
+            world->islandOf[body] = world->numIslands;
+            world->islands[world->numIslands++] = (RigidIsland){ 0 };
+        }
+        world->islands[world->islandOf[body] = world->islandOf[root]].numBodies++;
+    }
+    for (int i = 0; i < world->numManifolds; i++) world->islands[world->islandOf[world->manifolds[i].a]].numManifolds++;
+    int bodies = 0, manifolds = 0;
+    world->stats.largestIsland = 0;
+    for (int i = 0; i < world->numIslands; i++) {
+        RigidIsland *island = &world->islands[i];
+        island->firstBody = bodies;
+        island->firstManifold = manifolds;
+        bodies += island->numBodies;
+        manifolds += island->numManifolds;
+        if (island->numBodies > world->stats.largestIsland) world->stats.largestIsland = island->numBodies;
+        island->numBodies = island->numManifolds = 0; //Counted again while filling
+    }
+    for (int i = 0; i < world->numNodes; i++) {
+        RigidIsland *island = &world->islands[world->islandOf[world->nodes[i]]];
+        world->islandBodies[island->firstBody + island->numBodies++] = world->nodes[i];
+    }
+    for (int i = 0; i < world->numManifolds; i++) {
+        RigidIsland *island = &world->islands[world->islandOf[world->manifolds[i].a]];
+        world->islandManifolds[island->firstManifold + island->numManifolds++] = i;
+    }
+}
+
+//Velocity of the point at r from the center of the body, zero for the level
+static Vector3 RigidPointVelocity(const RigidBody *body, Vector3 r) {
+    if (body == NULL) return (Vector3){ 0, 0, 0 };
+    return Vector3Add(body->velocity, Vector3CrossProduct(body->angularVelocity, r));
+}
+
+static void ApplyRigidImpulse(RigidBody *a, RigidBody *b, const RigidContactPoint *point, int direction, Vector3 axis, float impulse) {
+    a->velocity = Vector3Add(a->velocity, Vector3Scale(axis, impulse * a->invMass));
+    a->angularVelocity = Vector3Add(a->angularVelocity, Vector3Scale(point->turnA[direction], impulse));
+    if (b == NULL || b->invMass == 0.0f) return; //Fixed bodies are shared between islands, never write them
+    b->velocity = Vector3Subtract(b->velocity, Vector3Scale(axis, impulse * b->invMass));
+    b->angularVelocity = Vector3Subtract(b->angularVelocity, Vector3Scale(point->turnB[direction], impulse));
+}
+
+static void ApplyRigidTorque(RigidBody *a, RigidBody *b, Vector3 impulse) {
+    a->angularVelocity = Vector3Add(a->angularVelocity, RigidInvInertia(a, impulse));
+    if (b != NULL && b->invMass > 0.0f) b->angularVelocity = Vector3Subtract(b->angularVelocity, RigidInvInertia(b, impulse));
+}
+
+static float RigidRelativeSpeed(const RigidBody *a, const RigidBody *b, const RigidContactPoint *point, int direction, Vector3 axis) {
+    float speed = Vector3DotProduct(a->velocity, axis) + Vector3DotProduct(a->angularVelocity, point->crossA[direction]);
+    if (b != NULL) speed -= Vector3DotProduct(b->velocity, axis) + Vector3DotProduct(b->angularVelocity, point->crossB[direction]);
+    return speed;
+}
+
+static void SolveRigidIsland(void *data, int index, int worker) {
+    RigidWorld *world = (RigidWorld *)data;
+    RigidIsland *island = &world->islands[index];
+    const int *bodies = world->islandBodies + island->firstBody;
+    const int *manifolds = world->islandManifolds + island->firstManifold;
+    float dt = world->dt;
+
+    for (int i = 0; i < island->numBodies; i++) {
+        RigidBody *body = &world->bodies[bodies[i]];
+        body->velocity = Vector3Add(body->velocity, Vector3Scale(world->gravity, dt));
+    }
+    //Effective masses and targets, then the warm start
+    for (int k = 0; k < island->numManifolds; k++) {
+        RigidManifold *m = &world->manifolds[manifolds[k]];
+        RigidBody *a = &world->bodies[m->a], *b = m->b >= 0 ? &world->bodies[m->b] : NULL;
+        Vector3 axes[3] = { m->normal, m->tangents[0], m->tangents[1] };
+        for (int p = 0; p < m->numPoints; p++) {
+            RigidContactPoint *point = &m->points[p];
+            Vector3 rA = Vector3Subtract(point->position, a->position);
+            Vector3 rB = b != NULL ? Vector3Subtract(point->position, b->position) : (Vector3){ 0, 0, 0 };
+            for (int d = 0; d < 3; d++) {
+                point->crossA[d] = Vector3CrossProduct(rA, axes[d]);
+                point->turnA[d] = RigidInvInertia(a, point->crossA[d]);
+                float mass = a->invMass + Vector3DotProduct(point->crossA[d], point->turnA[d]);
+                if (b != NULL) {
+                    point->crossB[d] = Vector3CrossProduct(rB, axes[d]);
+                    point->turnB[d] = RigidInvInertia(b, point->crossB[d]);
+                    mass += b->invMass + Vector3DotProduct(point->crossB[d], point->turnB[d]);
+                }
+                point->mass[d] = mass > 0.0f ? 1.0f / mass : 0.0f;
+            }
+            float approach = Vector3DotProduct(Vector3Subtract(RigidPointVelocity(a, rA), RigidPointVelocity(b, rB)), m->normal);
+            point->bias = fminf(RIGIDBODY_BAUMGARTE / dt * fmaxf(point->depth - RIGIDBODY_SLOP, 0.0f), RIGIDBODY_MAX_PUSH);
+            if (approach < -RIGIDBODY_BOUNCE_SPEED) point->bias = fmaxf(point->bias, -m->restitution * approach);
+            for (int d = 0; d < 3; d++) {
+                float impulse = d == 0 ? point->normalImpulse : point->tangentImpulse[d - 1];
+                ApplyRigidImpulse(a, b, point, d, axes[d], impulse);
+            }
+        }
+        if (m->rolling > 0.0f) {//Balls are the same all around, the average turn is close enough for the box on the other side
+            float turn = (a->invInertia.x + a->invInertia.y + a->invInertia.z) / 3.0f;
+            if (b != NULL) turn += (b->invInertia.x + b->invInertia.y + b->invInertia.z) / 3.0f;
+            m->rollingMass = turn > 0.0f ? 1.0f / turn : 0.0f;
+            ApplyRigidTorque(a, b, m->rollingImpulse);
+        }
+    }
+    for (int iteration = 0; iteration < RIGIDBODY_ITERATIONS; iteration++) {
+        for (int k = 0; k < island->numManifolds; k++) {
+            RigidManifold *m = &world->manifolds[manifolds[k]];
+            RigidBody *a = &world->bodies[m->a], *b = m->b >= 0 ? &world->bodies[m->b] : NULL;
+            for (int p = 0; p < m->numPoints; p++) {
+                RigidContactPoint *point = &m->points[p];
+                //Friction first so the normal impulse, what matters most, gets the last word
+                for (int d = 1; d < 3; d++) {
+                    float limit = m->friction * point->normalImpulse;
+                    float impulse = -RigidRelativeSpeed(a, b, point, d, m->tangents[d - 1]) * point->mass[d];
+                    float total = Clamp(point->tangentImpulse[d - 1] + impulse, -limit, limit);
+                    ApplyRigidImpulse(a, b, point, d, m->tangents[d - 1], total - point->tangentImpulse[d - 1]);
+                    point->tangentImpulse[d - 1] = total;
+                }
+                float impulse = (point->bias - RigidRelativeSpeed(a, b, point, 0, m->normal)) * point->mass[0];
+                float total = fmaxf(point->normalImpulse + impulse, 0.0f);
+                ApplyRigidImpulse(a, b, point, 0, m->normal, total - point->normalImpulse);
+                point->normalImpulse = total;
+            }
+            if (m->rolling > 0.0f) {
+                float limit = 0.0f;
+                for (int p = 0; p < m->numPoints; p++) limit += m->rolling * m->points[p].normalImpulse;
+                Vector3 spin = b != NULL ? Vector3Subtract(a->angularVelocity, b->angularVelocity) : a->angularVelocity;
+                Vector3 total = Vector3Subtract(m->rollingImpulse, Vector3Scale(spin, m->rollingMass));
+                float length = Vector3Length(total);
+                if (length > limit) total = Vector3Scale(total, limit / length);
+                ApplyRigidTorque(a, b, Vector3Subtract(total, m->rollingImpulse));
+                m->rollingImpulse = total;
+            }
+        }
+    }
+
+    //Move, and sleep if every body in the island has been slow long enough
+    float sleepTime = FLT_MAX;
+    float linearDamping = 1.0f / (1.0f + dt * RIGIDBODY_LINEAR_DAMPING), angularDamping = 1.0f / (1.0f + dt * RIGIDBODY_ANGULAR_DAMPING);
+    for (int i = 0; i < island->numBodies; i++) {
+        RigidBody *body = &world->bodies[bodies[i]];
+        body->velocity = Vector3Scale(body->velocity, linearDamping);
+        body->angularVelocity = Vector3Scale(body->angularVelocity, angularDamping);
+        body->position = Vector3Add(body->position, Vector3Scale(body->velocity, dt));
+        Vector3 w = Vector3Scale(body->angularVelocity, 0.5f * dt);
+        Quaternion spin = QuaternionMultiply((Quaternion){ w.x, w.y, w.z, 0.0f }, body->orientation);
+        body->orientation = QuaternionNormalize((Quaternion){ body->orientation.x + spin.x, body->orientation.y + spin.y,
+                                                              body->orientation.z + spin.z, body->orientation.w + spin.w });
+        bool slow = Vector3LengthSqr(body->velocity) < RIGIDBODY_SLEEP_LINEAR * RIGIDBODY_SLEEP_LINEAR &&
+                    Vector3LengthSqr(body->angularVelocity) < RIGIDBODY_SLEEP_ANGULAR * RIGIDBODY_SLEEP_ANGULAR;
+        body->sleepTime = slow ? body->sleepTime + dt : 0.0f;
+        sleepTime = fminf(sleepTime, body->sleepTime);
+    }
+    island->asleep = sleepTime >= RIGIDBODY_SLEEP_TIME;
+    if (!island->asleep) return;
+    for (int i = 0; i < island->numBodies; i++) {
+        RigidBody *body = &world->bodies[bodies[i]];
+        body->awake = false;
+        body->velocity = body->angularVelocity = (Vector3){ 0, 0, 0 };
+    }
+}
+
+static void RunRigidJobs(RigidWorld *world, JobFunction fn, int count, int grain) {
+    if (world->jobs != NULL) RunJobs(world->jobs, fn, world, count, grain);
+    else for (int i = 0; i < count; i++) fn(world, i, 0);
+}
+
+/*Advance every awake body by dt against each other and the level colliders (same arrays as UpdatePlayer, NULL
+broadphase for none). The level is only read, the bodies move and sleep*/
+void StepRigidWorld(RigidWorld *world, float dt, const int NumColliders, Collider colliders[], const Broadphase *broadphase) {
+    world->step++;
+    world->dt = dt;
+    world->level = colliders;
+    world->levelBroadphase = broadphase;
+    world->stats.warmStarted = 0;
+    int numWorkers = world->jobs != NULL ? world->jobs->numWorkers : 1;
+
+    //Level colliders the bodies touch get their world axes now, the workers only read them
+    PROFILE_BEGIN("rigid_narrowphase");
+    for (int k = 0; k < world->numAwake && broadphase != NULL; k++) {
+        RigidBody *body = &world->bodies[world->awake[k]];
+        int count = QueryColliders(broadphase, body->collider.boundsMin, body->collider.boundsMax, &world->workers[0].level);
+        for (int c = 0; c < count; c++) PrepareCollider(&colliders[world->workers[0].level.candidates[c]]);
+    }
+    for (int w = 0; w < numWorkers; w++) world->workers[w].numManifolds = 0;
+    RunRigidJobs(world, RigidNarrowphaseJob, world->numAwake, 16);
+
+    //Swap the manifolds of the last step out and gather the new ones in key order
+    RigidManifold *swap = world->previous;
+    world->previous = world->manifolds;
+    world->numPrevious = world->numManifolds;
+    int swapCap = world->capPrevious;
+    world->capPrevious = world->capManifolds;
+    world->manifolds = swap;
+    world->capManifolds = swapCap;
+    int total = 0;
+    for (int w = 0; w < numWorkers; w++) total += world->workers[w].numManifolds;
+    if (total > world->capManifolds) {
+        world->capManifolds = total * 2;
+        world->manifolds = (RigidManifold *)realloc(world->manifolds, world->capManifolds * sizeof(RigidManifold));
+    }
+    world->numManifolds = 0;
+    for (int w = 0; w < numWorkers; w++) {
+        memcpy(world->manifolds + world->numManifolds, world->workers[w].manifolds, world->workers[w].numManifolds * sizeof(RigidManifold));
+        world->numManifolds += world->workers[w].numManifolds;
+    }
+    qsort(world->manifolds, world->numManifolds, sizeof(RigidManifold), CompareRigidManifolds);
+    world->stats.points = 0;
+    for (int i = 0; i < world->numManifolds; i++) {
+        WarmRigidManifold(world, &world->manifolds[i]);
+        world->stats.points += world->manifolds[i].numPoints;
+    }
+    PROFILE_END();
+
+    PROFILE_BEGIN("rigid_islands");
+    BuildRigidIslands(world);
+    PROFILE_END();
+    PROFILE_BEGIN("rigid_solve");
+    RunRigidJobs(world, SolveRigidIsland, world->numIslands, 1);
+    PROFILE_END();
+
+    //The broadphase isnt thread safe, the moved bodies go in here. Islands that stayed awake are the next awake list
+    PROFILE_BEGIN("rigid_move");
+    world->numAwake = 0;
+    for (int i = 0; i < world->numIslands; i++) {
+        const RigidIsland *island = &world->islands[i];
+        for (int k = 0; k < island->numBodies; k++) {
+            int index = world->islandBodies[island->firstBody + k];
+            SetColliderTransform(&world->bodies[index].collider, RigidBodyTransform(&world->bodies[index]));
+            if (!island->asleep) world->awake[world->numAwake++] = index;
+        }
+    }
+    PROFILE_END();
+    PROFILE_COUNT("rigid_awake", world->numAwake);
+    PROFILE_COUNT("rigid_manifolds", world->numManifolds);
+
+    world->stats.awake = world->numAwake;
+    world->stats.sleeping = world->numBodies - world->numFixed - world->numAwake;
+    world->stats.islands = world->numIslands;
+    world->stats.manifolds = world->numManifolds;
+}
+
+void UnloadRigidWorld(RigidWorld *world) {
+    for (int i = 0; i < world->numBodies; i++) UnloadCollider(&world->bodies[i].collider);
+    UnloadBroadphase(&world->broadphase);
+    for (int w = 0; w < JOBS_MAX_WORKERS; w++) {
+        UnloadCollisionScratch(&world->workers[w].bodies);
+        UnloadCollisionScratch(&world->workers[w].level);
+        free(world->workers[w].manifolds);
+    }
+    free(world->bodies);
+    free(world->awake);
+    free(world->manifolds);
+    free(world->previous);
+    free(world->parent);
+    free(world->islandOf);
+    free(world->islands);
+    free(world->islandBodies);
+    free(world->islandManifolds);
+    free(world->nodes);
+    *world = (RigidWorld){ 0 };
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "raylib.h"
+#include "collisions.h"
+#include "levelfile.h"
+
+// the test level, shared by the headless replayer, the server and the benchmarks so a recording always plays back in
+// the same world. the layout is in assets/levels/test.txt, make level cooks it into the file below and into the
+// sectored test.wld the game streams, one sector with the colliders in the same order
+
+#define SCENE_LEVEL_PATH "../assets/levels/test.lvl"
+
+// the broadphase ids are the collider indices
+void RegisterSceneColliders(LevelFile *level, Broadphase *broadphase) {
+    for(int i = 0; i < level->numColliders; i++) RegisterCollider(broadphase, &level->colliders[i], i);
+}
+
+// maps the cooked level into the store and registers every collider, the game does the same trough the asset loader.
+// numColliders is -1 if the level isnt cooked. teardown is unloading the broadphase, the level file, then the store
+LevelFile SetupSceneColliders(ColliderStore *store, Broadphase *broadphase) {
+    LevelFile level = LoadLevelFile(SCENE_LEVEL_PATH, store);
+    RegisterSceneColliders(&level, broadphase);
+    return level;
+}
+
+#endif
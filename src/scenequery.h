@@ -0,0 +1,853 @@
+#ifndef SCENEQUERY_H
+#define SCENEQUERY_H
+
+#include "raylib.h" //Mesh, Ray
+#include "raymath.h"//Vector math
+#include "collisions.h"//CastColliderShape for the swept shapes
+
+#include <stdlib.h>//Memory operations
+#include <stdbool.h>
+#include <float.h>//FLT_MAX
+#include <math.h>
+
+/*Ray queries against the world triangles, for hitscan, line of sight and the camera. Every mesh gets its own triangle
+BVH once (binned SAH build, 32 byte nodes with the children next to each other), the scene is a second BVH over the
+placed instances. Rays get moved into the local space of an instance instead of moving the triangles, so any number of
+instances can share one mesh BVH and moving an instance only means rebuilding the small top level.
+Colliders can be swept trough the same BVHs, the triangles their moving box reaches get the conservative advancement
+cast of collisions.h. Queries only read, any number of threads can run them at once. Directions are expected to be
+normalized so the distances come out in world units, like raylib's own ray functions*/
+
+//Packets trace this many rays at once, pick the widest vector unit the compiler targets like collisions.h does.
+//Define SCENEQUERY_SCALAR to trace packets one ray at a time
+#if !defined(SCENEQUERY_SCALAR) && defined(__AVX__)
+    #include <immintrin.h>
+    #define SCENE_PACKET_WIDTH 8
+    typedef __m256 PacketFloat;
+    #define PacketSet(x) _mm256_set1_ps(x)
+    #define PacketLoad(p) _mm256_loadu_ps(p)
+    #define PacketStore(p, v) _mm256_storeu_ps(p, v)
+    #define PacketAdd(a, b) _mm256_add_ps(a, b)
+    #define PacketSub(a, b) _mm256_sub_ps(a, b)
+    #define PacketMul(a, b) _mm256_mul_ps(a, b)
+    #define PacketDiv(a, b) _mm256_div_ps(a, b)
+    #define PacketMin(a, b) _mm256_min_ps(a, b)
+    #define PacketMax(a, b) _mm256_max_ps(a, b)
+    #define PacketLess(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+    #define PacketLessEqual(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+    #define PacketAnd(a, b) _mm256_and_ps(a, b)
+    #define PacketAndNot(a, b) _mm256_andnot_ps(a, b) //~a & b
+    #define PacketOr(a, b) _mm256_or_ps(a, b)
+    #define PacketMask(a) _mm256_movemask_ps(a)
+#elif !defined(SCENEQUERY_SCALAR) && (defined(__SSE__) || defined(_M_X64))
+    #include <xmmintrin.h>
+    #define SCENE_PACKET_WIDTH 4
+    typedef __m128 PacketFloat;
+    #define PacketSet(x) _mm_set1_ps(x)
+    #define PacketLoad(p) _mm_loadu_ps(p)
+    #define PacketStore(p, v) _mm_storeu_ps(p, v)
+    #define PacketAdd(a, b) _mm_add_ps(a, b)
+    #define PacketSub(a, b) _mm_sub_ps(a, b)
+    #define PacketMul(a, b) _mm_mul_ps(a, b)
+    #define PacketDiv(a, b) _mm_div_ps(a, b)
+    #define PacketMin(a, b) _mm_min_ps(a, b)
+    #define PacketMax(a, b) _mm_max_ps(a, b)
+    #define PacketLess(a, b) _mm_cmplt_ps(a, b)
+    #define PacketLessEqual(a, b) _mm_cmple_ps(a, b)
+    #define PacketAnd(a, b) _mm_and_ps(a, b)
+    #define PacketAndNot(a, b) _mm_andnot_ps(a, b)
+    #define PacketOr(a, b) _mm_or_ps(a, b)
+    #define PacketMask(a) _mm_movemask_ps(a)
+#else
+    #define SCENE_PACKET_WIDTH 1
+#endif
+
+#define BVH_BINS 12 //SAH split candidates per axis
+#define BVH_MAX_LEAF 4 //A leaf with more triangles then this gets split even when SAH would keep it
+#define BVH_MAX_DEPTH 64 //Deeper nodes become leaves, keeps the traversal stacks fixed size
+#define SCENE_RAY_EPSILON 1e-5f //Hits closer then this to the ray origin dont count, stops a ray from hitting where it starts
+#define SCENE_PARALLEL_EPSILON 1e-12f //Rays this close to the triangle plane miss it
+
+typedef struct {
+    Vector3 min;
+    int leftFirst; //Inner nodes: the first child, the second one comes right after it. Leaves: first triangle (or instance)
+    Vector3 max;
+    int count; //Triangles (or instances) in the leaf, 0 for inner nodes
+} BvhNode; //32 bytes, two to a cache line
+
+//Corner and the two edges from it, what the ray test wants
+typedef struct {
+    Vector3 v0, e1, e2;
+} BvhTriangle;
+
+typedef struct {
+    BvhNode *nodes;
+    int numNodes; //0 for a mesh without triangles
+    BvhTriangle *triangles; //In leaf order
+    int numTriangles;
+} MeshBvh;
+
+typedef struct {
+    const MeshBvh *mesh;
+    Matrix transform; //Local to world
+    Matrix inverse; //World to local, what the rays go trough
+    Vector3 min, max; //World bounds
+    int id; //Handed back with the hits, usually the collider index
+} SceneInstance;
+
+typedef struct {
+    SceneInstance *instances;
+    int numInstances, capInstances;
+    BvhNode *nodes; //Top level BVH over the instance bounds, built by BuildSceneQuery
+    int numNodes;
+    int *order; //Instance indices in leaf order
+} SceneQuery;
+
+typedef struct {
+    bool hit;
+    float distance; //Along the ray, world units for a normalized direction
+    Vector3 point;
+    Vector3 normal; //World space, facing the ray
+    int id; //Id of the instance that got hit, -1 for nothing
+} SceneRayHit;
+
+typedef struct {
+    bool hit;
+    float toi; //Fraction of the motion up to the contact, 1 for nothing
+    Vector3 normal; //Unit contact normal from the triangle to the collider
+    int id; //Id of the instance that got hit, -1 for nothing
+} SceneSweepHit;
+
+static inline float BvhAxis(Vector3 v, int axis) {
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+static inline float BvhBoxArea(Vector3 min, Vector3 max) {
+    Vector3 e = Vector3Subtract(max, min);
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+typedef struct {
+    Vector3 min, max;
+    int count;
+} BvhBin;
+
+/*Binned SAH build over count boxes. indices gets the order of the boxes the leaves point into, nodes needs room for
+2 * count - 1 of them. Every candidate split is scored by the surface area of both halves times the boxes in them,
+the cheapest one wins unless keeping a leaf of up to maxLeaf boxes is cheaper still. Returns how many nodes it used*/
+static int BuildBvhNodes(BvhNode *nodes, int *indices, const Vector3 *mins, const Vector3 *maxs, const Vector3 *centers, int count, int maxLeaf) {
+    for (int i = 0; i < count; i++) indices[i] = i;
+    if (count == 0) return 0;
+    int numNodes = 1;
+    nodes[0].leftFirst = 0;
+    nodes[0].count = count;
+    int stack[BVH_MAX_DEPTH], depths[BVH_MAX_DEPTH];
+    int sp = 0;
+    stack[sp] = 0;
+    depths[sp++] = 0;
+    while (sp > 0) {
+        sp--;
+        BvhNode *node = &nodes[stack[sp]];
+        int depth = depths[sp];
+        int first = node->leftFirst, n = node->count;
+        Vector3 bmin = { FLT_MAX, FLT_MAX, FLT_MAX }, bmax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        Vector3 cmin = bmin, cmax = bmax;
+        for (int i = first; i < first + n; i++) {
+            int b = indices[i];
+            bmin = Vector3Min(bmin, mins[b]);
+            bmax = Vector3Max(bmax, maxs[b]);
+            cmin = Vector3Min(cmin, centers[b]);
+            cmax = Vector3Max(cmax, centers[b]);
+        }
+        node->min = bmin;
+        node->max = bmax;
+        if (n == 1 || depth + 1 >= BVH_MAX_DEPTH || sp + 2 > BVH_MAX_DEPTH) continue; //Leaf
+
+        float bestCost = FLT_MAX;
+        int bestAxis = -1, bestSplit = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            float lo = BvhAxis(cmin, axis), hi = BvhAxis(cmax, axis);
+            if (hi <= lo) continue; //Every center in one plane, cant split along this axis
+            BvhBin bins[BVH_BINS];
+            for (int k = 0; k < BVH_BINS; k++) bins[k] = (BvhBin){ bmax, bmin, 0 };
+            float scale = BVH_BINS / (hi - lo);
+            for (int i = first; i < first + n; i++) {
+                int b = indices[i];
+                int k = (int)((BvhAxis(centers[b], axis) - lo) * scale);
+                if (k > BVH_BINS - 1) k = BVH_BINS - 1;
+                bins[k].count++;
+                bins[k].min = Vector3Min(bins[k].min, mins[b]);
+                bins[k].max = Vector3Max(bins[k].max, maxs[b]);
+            }
+            //Sweep from both ends, split s puts bins 0..s on the left
+            float leftArea[BVH_BINS - 1], rightArea[BVH_BINS - 1];
+            int leftCount[BVH_BINS - 1], rightCount[BVH_BINS - 1];
+            Vector3 lmin = bmax, lmax = bmin, rmin = bmax, rmax = bmin;
+            int lsum = 0, rsum = 0;
+            for (int s = 0; s < BVH_BINS - 1; s++) {
+                lsum += bins[s].count;
+                lmin = Vector3Min(lmin, bins[s].min);
+                lmax = Vector3Max(lmax, bins[s].max);
+                leftCount[s] = lsum;
+                leftArea[s] = lsum > 0 ? BvhBoxArea(lmin, lmax) : 0.0f;
+                int r = BVH_BINS - 1 - s;
+                rsum += bins[r].count;
+                rmin = Vector3Min(rmin, bins[r].min);
+                rmax = Vector3Max(rmax, bins[r].max);
+                rightCount[r - 1] = rsum;
+                rightArea[r - 1] = rsum > 0 ? BvhBoxArea(rmin, rmax) : 0.0f;
+            }
+            for (int s = 0; s < BVH_BINS - 1; s++) {
+                if (leftCount[s] == 0 || rightCount[s] == 0) continue;
+                float cost = leftCount[s] * leftArea[s] + rightCount[s] * rightArea[s];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = s;
+                }
+            }
+        }
+
+        //Visiting the two children costs about one more test of the whole box
+        float area = BvhBoxArea(bmin, bmax);
+        if (n <= maxLeaf && (bestAxis < 0 || bestCost + area >= n * area)) continue;
+        int leftCount;
+        if (bestAxis < 0) {
+            leftCount = n / 2; //All centers on one spot, any half is as good as the other
+        } else {
+            float lo = BvhAxis(cmin, bestAxis), scale = BVH_BINS / (BvhAxis(cmax, bestAxis) - lo);
+            int i = first, j = first + n - 1;
+            while (i <= j) {
+                int k = (int)((BvhAxis(centers[indices[i]], bestAxis) - lo) * scale);
+                if (k > BVH_BINS - 1) k = BVH_BINS - 1;
+                if (k <= bestSplit) i++;
+                else {
+                    int swap = indices[i];
+                    indices[i] = indices[j];
+                    indices[j--] = swap;
+                }
+            }
+            leftCount = i - first;
+        }
+        int left = numNodes;
+        numNodes += 2;
+        nodes[left] = (BvhNode){ .leftFirst = first, .count = leftCount };
+        nodes[left + 1] = (BvhNode){ .leftFirst = first + leftCount, .count = n - leftCount };
+        node->leftFirst = left;
+        node->count = 0;
+        stack[sp] = left + 1;
+        depths[sp++] = depth + 1;
+        stack[sp] = left;
+        depths[sp++] = depth + 1;
+    }
+    return numNodes;
+}
+
+/*Triangle BVH of a mesh, indexed or a plain triangle soup like LoadObjMeshData makes. Only reads the CPU side
+vertices, so it works on any thread and for meshes that never get uploaded. Free it with UnloadMeshBvh*/
+MeshBvh BuildMeshBvh(Mesh mesh) {
+    MeshBvh bvh = { 0 };
+    int count = mesh.indices != NULL ? mesh.triangleCount : mesh.vertexCount / 3;
+    if (mesh.vertices == NULL || count <= 0) return bvh;
+    BvhTriangle *soup = (BvhTriangle *)malloc(count * sizeof(BvhTriangle));
+    Vector3 *mins = (Vector3 *)malloc(count * 3 * sizeof(Vector3));
+    Vector3 *maxs = mins + count, *centers = maxs + count;
+    for (int i = 0; i < count; i++) {
+        Vector3 p[3];
+        for (int k = 0; k < 3; k++) {
+            int v = mesh.indices != NULL ? mesh.indices[i * 3 + k] : i * 3 + k;
+            p[k] = (Vector3){ mesh.vertices[v * 3], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2] };
+        }
+        soup[i] = (BvhTriangle){ p[0], Vector3Subtract(p[1], p[0]), Vector3Subtract(p[2], p[0]) };
+        mins[i] = Vector3Min(Vector3Min(p[0], p[1]), p[2]);
+        maxs[i] = Vector3Max(Vector3Max(p[0], p[1]), p[2]);
+        centers[i] = Vector3Scale(Vector3Add(mins[i], maxs[i]), 0.5f);
+    }
+    int *order = (int *)malloc(count * sizeof(int));
+    bvh.nodes = (BvhNode *)malloc((2 * count - 1) * sizeof(BvhNode));
+    bvh.numNodes = BuildBvhNodes(bvh.nodes, order, mins, maxs, centers, count, BVH_MAX_LEAF);
+    bvh.nodes = (BvhNode *)realloc(bvh.nodes, bvh.numNodes * sizeof(BvhNode));
+    bvh.triangles = (BvhTriangle *)malloc(count * sizeof(BvhTriangle));
+    for (int i = 0; i < count; i++) bvh.triangles[i] = soup[order[i]]; //Leaves point at runs of triangles
+    bvh.numTriangles = count;
+    free(order);
+    free(mins);
+    free(soup);
+    return bvh;
+}
+
+void UnloadMeshBvh(MeshBvh *bvh) {
+    free(bvh->nodes);
+    free(bvh->triangles);
+    *bvh = (MeshBvh){ 0 };
+}
+
+SceneQuery InitSceneQuery(int expectedInstances) {
+    SceneQuery scene = { 0 };
+    scene.capInstances = expectedInstances > 0 ? expectedInstances : 16;
+    scene.instances = (SceneInstance *)malloc(scene.capInstances * sizeof(SceneInstance));
+    return scene;
+}
+
+//World bounds of the mesh root box under the transform
+static void SceneInstanceBounds(SceneInstance *instance) {
+    const BvhNode *root = &instance->mesh->nodes[0];
+    Matrix m = instance->transform;
+    Vector3 center = Vector3Transform(Vector3Scale(Vector3Add(root->min, root->max), 0.5f), m);
+    Vector3 half = Vector3Scale(Vector3Subtract(root->max, root->min), 0.5f);
+    Vector3 extent = {
+        fabsf(m.m0) * half.x + fabsf(m.m4) * half.y + fabsf(m.m8) * half.z,
+        fabsf(m.m1) * half.x + fabsf(m.m5) * half.y + fabsf(m.m9) * half.z,
+        fabsf(m.m2) * half.x + fabsf(m.m6) * half.y + fabsf(m.m10) * half.z
+    };
+    instance->min = Vector3Subtract(center, extent);
+    instance->max = Vector3Add(center, extent);
+}
+
+/*Place a mesh in the scene, the mesh BVH has to outlive the scene. Returns the instance index for
+SetSceneInstanceTransform, id is what hits report. Nothing is found until the next BuildSceneQuery*/
+int AddSceneInstance(SceneQuery *scene, const MeshBvh *mesh, Matrix transform, int id) {
+    if (mesh->numNodes == 0) return -1; //Nothing to hit
+    if (scene->numInstances == scene->capInstances) {
+        scene->capInstances = scene->capInstances ? scene->capInstances * 2 : 16;
+        scene->instances = (SceneInstance *)realloc(scene->instances, scene->capInstances * sizeof(SceneInstance));
+    }
+    SceneInstance *instance = &scene->instances[scene->numInstances];
+    *instance = (SceneInstance){ .mesh = mesh, .transform = transform, .inverse = MatrixInvert(transform), .id = id };
+    SceneInstanceBounds(instance);
+    return scene->numInstances++;
+}
+
+//Move an instance, the top level has to be rebuilt with BuildSceneQuery before the next query sees it
+void SetSceneInstanceTransform(SceneQuery *scene, int index, Matrix transform) {
+    SceneInstance *instance = &scene->instances[index];
+    instance->transform = transform;
+    instance->inverse = MatrixInvert(transform);
+    SceneInstanceBounds(instance);
+}
+
+//(Re)build the top level BVH over the instances, after adding or moving them. Cheap next to the mesh BVHs
+void BuildSceneQuery(SceneQuery *scene) {
+    int count = scene->numInstances;
+    free(scene->nodes);
+    free(scene->order);
+    scene->nodes = NULL;
+    scene->order = NULL;
+    scene->numNodes = 0;
+    if (count == 0) return;
+    Vector3 *mins = (Vector3 *)malloc(count * 3 * sizeof(Vector3));
+    Vector3 *maxs = mins + count, *centers = maxs + count;
+    for (int i = 0; i < count; i++) {
+        mins[i] = scene->instances[i].min;
+        maxs[i] = scene->instances[i].max;
+        centers[i] = Vector3Scale(Vector3Add(mins[i], maxs[i]), 0.5f);
+    }
+    scene->order = (int *)malloc(count * sizeof(int));
+    scene->nodes = (BvhNode *)malloc((2 * count - 1) * sizeof(BvhNode));
+    scene->numNodes = BuildBvhNodes(scene->nodes, scene->order, mins, maxs, centers, count, 1); //An instance costs a transform and a mesh walk, not worth sharing leaves
+    free(mins);
+}
+
+void UnloadSceneQuery(SceneQuery *scene) {
+    free(scene->instances);
+    free(scene->nodes);
+    free(scene->order);
+    *scene = (SceneQuery){ 0 };
+}
+
+//1 / d without infinities, an axis parallel ray still gets a huge finite slope so the slab test never sees 0 * inf
+static inline float SafeInverse(float d) {
+    return fabsf(d) > 1e-20f ? 1.0f / d : (d < 0.0f ? -1e20f : 1e20f);
+}
+
+//World point or direction into the local space of an instance
+static inline Vector3 SceneToLocalDirection(Matrix inverse, Vector3 d) {
+    return (Vector3){
+        inverse.m0 * d.x + inverse.m4 * d.y + inverse.m8 * d.z,
+        inverse.m1 * d.x + inverse.m5 * d.y + inverse.m9 * d.z,
+        inverse.m2 * d.x + inverse.m6 * d.y + inverse.m10 * d.z
+    };
+}
+
+//fminf and fmaxf take care of NaN and end up as library calls, these are single min and max instructions
+static inline float SceneMin(float a, float b) { return a < b ? a : b; }
+static inline float SceneMax(float a, float b) { return a > b ? a : b; }
+
+//Distance to where the ray enters the box, FLT_MAX if it misses it or only gets there after tmax
+static inline float RayNodeDistance(const BvhNode *node, Vector3 o, Vector3 inv, float tmax) {
+    float t1 = (node->min.x - o.x) * inv.x, t2 = (node->max.x - o.x) * inv.x;
+    float tnear = SceneMin(t1, t2), tfar = SceneMax(t1, t2);
+    t1 = (node->min.y - o.y) * inv.y; t2 = (node->max.y - o.y) * inv.y;
+    tnear = SceneMax(tnear, SceneMin(t1, t2)); tfar = SceneMin(tfar, SceneMax(t1, t2));
+    t1 = (node->min.z - o.z) * inv.z; t2 = (node->max.z - o.z) * inv.z;
+    tnear = SceneMax(tnear, SceneMin(t1, t2)); tfar = SceneMin(tfar, SceneMax(t1, t2));
+    return tnear <= tfar && tnear < tmax && tfar > 0.0f ? tnear : FLT_MAX;
+}
+
+//Moller-Trumbore. True if the ray hits the triangle closer then tmax, t gets the distance
+static inline bool RayTriangle(const BvhTriangle *tri, Vector3 o, Vector3 d, float tmax, float *t) {
+    Vector3 h = Vector3CrossProduct(d, tri->e2);
+    float a = Vector3DotProduct(tri->e1, h);
+    if (fabsf(a) < SCENE_PARALLEL_EPSILON) return false;
+    float f = 1.0f / a;
+    Vector3 s = Vector3Subtract(o, tri->v0);
+    float u = f * Vector3DotProduct(s, h);
+    if (u < 0.0f || u > 1.0f) return false;
+    Vector3 q = Vector3CrossProduct(s, tri->e1);
+    float v = f * Vector3DotProduct(d, q);
+    if (v < 0.0f || u + v > 1.0f) return false;
+    float dist = f * Vector3DotProduct(tri->e2, q);
+    if (dist <= SCENE_RAY_EPSILON || dist >= tmax) return false;
+    *t = dist;
+    return true;
+}
+
+//Closest hit so far of one ray
+typedef struct {
+    float distance; //Starts at the max distance
+    int instance, triangle; //-1 until something is hit
+} SceneTrace;
+
+//Walks the mesh BVH near child first and skips anything further then the closest hit. any stops at the first hit
+static bool TraceMeshBvh(const MeshBvh *bvh, Vector3 o, Vector3 d, int instance, bool any, SceneTrace *trace) {
+    Vector3 inv = { SafeInverse(d.x), SafeInverse(d.y), SafeInverse(d.z) };
+    if (RayNodeDistance(&bvh->nodes[0], o, inv, trace->distance) == FLT_MAX) return false;
+    int stack[BVH_MAX_DEPTH];
+    float stackDistance[BVH_MAX_DEPTH];
+    int sp = 0, node = 0;
+    bool hit = false;
+    for (;;) {
+        const BvhNode *n = &bvh->nodes[node];
+        if (n->count > 0) {
+            for (int i = n->leftFirst; i < n->leftFirst + n->count; i++) {
+                float t;
+                if (RayTriangle(&bvh->triangles[i], o, d, trace->distance, &t)) {
+                    trace->distance = t;
+                    trace->instance = instance;
+                    trace->triangle = i;
+                    hit = true;
+                    if (any) return true;
+                }
+            }
+        } else {
+            int nearNode = n->leftFirst, farNode = nearNode + 1;
+            float nearDistance = RayNodeDistance(&bvh->nodes[nearNode], o, inv, trace->distance);
+            float farDistance = RayNodeDistance(&bvh->nodes[farNode], o, inv, trace->distance);
+            if (nearDistance > farDistance) {
+                int swapNode = nearNode; nearNode = farNode; farNode = swapNode;
+                float swapDistance = nearDistance; nearDistance = farDistance; farDistance = swapDistance;
+            }
+            if (nearDistance != FLT_MAX) {
+                if (farDistance != FLT_MAX) {
+                    stack[sp] = farNode;
+                    stackDistance[sp++] = farDistance;
+                }
+                node = nearNode;
+                continue;
+            }
+        }
+        //Next node that could still hold something closer then the best hit
+        do {
+            if (sp == 0) return hit;
+            sp--;
+        } while (stackDistance[sp] >= trace->distance);
+        node = stack[sp];
+    }
+}
+
+//Same walk over the top level, every instance leaf sends the ray into its mesh in local space
+static bool TraceScene(const SceneQuery *scene, Vector3 o, Vector3 d, bool any, SceneTrace *trace) {
+    if (scene->numNodes == 0) return false;
+    Vector3 inv = { SafeInverse(d.x), SafeInverse(d.y), SafeInverse(d.z) };
+    if (RayNodeDistance(&scene->nodes[0], o, inv, trace->distance) == FLT_MAX) return false;
+    int stack[BVH_MAX_DEPTH];
+    float stackDistance[BVH_MAX_DEPTH];
+    int sp = 0, node = 0;
+    bool hit = false;
+    for (;;) {
+        const BvhNode *n = &scene->nodes[node];
+        if (n->count > 0) {
+            for (int i = n->leftFirst; i < n->leftFirst + n->count; i++) {
+                int index = scene->order[i];
+                const SceneInstance *instance = &scene->instances[index];
+                Vector3 lo = Vector3Transform(o, instance->inverse), ld = SceneToLocalDirection(instance->inverse, d);
+                if (TraceMeshBvh(instance->mesh, lo, ld, index, any, trace)) {
+                    hit = true;
+                    if (any) return true;
+                }
+            }
+        } else {
+            int nearNode = n->leftFirst, farNode = nearNode + 1;
+            float nearDistance = RayNodeDistance(&scene->nodes[nearNode], o, inv, trace->distance);
+            float farDistance = RayNodeDistance(&scene->nodes[farNode], o, inv, trace->distance);
+            if (nearDistance > farDistance) {
+                int swapNode = nearNode; nearNode = farNode; farNode = swapNode;
+                float swapDistance = nearDistance; nearDistance = farDistance; farDistance = swapDistance;
+            }
+            if (nearDistance != FLT_MAX) {
+                if (farDistance != FLT_MAX) {
+                    stack[sp] = farNode;
+                    stackDistance[sp++] = farDistance;
+                }
+                node = nearNode;
+                continue;
+            }
+        }
+        do {
+            if (sp == 0) return hit;
+            sp--;
+        } while (stackDistance[sp] >= trace->distance);
+        node = stack[sp];
+    }
+}
+
+//Fills in the hit from what the trace found, the normal goes to world space trough the inverse transpose
+static SceneRayHit SceneTraceHit(const SceneQuery *scene, Ray ray, const SceneTrace *trace) {
+    SceneRayHit hit = { .id = -1 };
+    if (trace->instance < 0) return hit;
+    const SceneInstance *instance = &scene->instances[trace->instance];
+    const BvhTriangle *tri = &instance->mesh->triangles[trace->triangle];
+    Vector3 n = Vector3CrossProduct(tri->e1, tri->e2);
+    Matrix inv = instance->inverse;
+    n = Vector3Normalize((Vector3){
+        inv.m0 * n.x + inv.m1 * n.y + inv.m2 * n.z,
+        inv.m4 * n.x + inv.m5 * n.y + inv.m6 * n.z,
+        inv.m8 * n.x + inv.m9 * n.y + inv.m10 * n.z
+    });
+    if (Vector3DotProduct(n, ray.direction) > 0.0f) n = Vector3Negate(n); //Back faces count too, the normal faces the ray
+    hit.hit = true;
+    hit.distance = trace->distance;
+    hit.point = Vector3Add(ray.position, Vector3Scale(ray.direction, trace->distance));
+    hit.normal = n;
+    hit.id = instance->id;
+    return hit;
+}
+
+//Closest hit along the ray up to maxDistance
+SceneRayHit RaycastScene(const SceneQuery *scene, Ray ray, float maxDistance) {
+    SceneTrace trace = { maxDistance, -1, -1 };
+    TraceScene(scene, ray.position, ray.direction, false, &trace);
+    return SceneTraceHit(scene, ray, &trace);
+}
+
+//True if nothing is between the two points. Stops at the first hit instead of looking for the closest one
+bool SceneLineOfSight(const SceneQuery *scene, Vector3 from, Vector3 to) {
+    Vector3 d = Vector3Subtract(to, from);
+    float length = Vector3Length(d);
+    if (length <= SCENE_RAY_EPSILON) return true;
+    SceneTrace trace = { length - SCENE_RAY_EPSILON, -1, -1 }; //A target standing on a surface doesnt block itself
+    return !TraceScene(scene, from, Vector3Scale(d, 1.0f / length), true, &trace);
+}
+
+//Where a box of half size extent moving from o along d starts to touch the node, in units of d. FLT_MAX like RayNodeDistance
+static inline float SweptNodeDistance(const BvhNode *node, Vector3 o, Vector3 inv, Vector3 extent, float tmax) {
+    BvhNode grown = { Vector3Subtract(node->min, extent), 0, Vector3Add(node->max, extent), 0 };
+    return RayNodeDistance(&grown, o, inv, tmax);
+}
+
+//One world space triangle as a GJK shape
+typedef struct {
+    Vector3 points[3];
+} SceneSweepTriangle;
+
+static Vector3 SceneTriangleSupport(void *shape, Vector3 dir) {
+    const Vector3 *p = ((SceneSweepTriangle *)shape)->points;
+    float d0 = Vector3DotProduct(p[0], dir), d1 = Vector3DotProduct(p[1], dir), d2 = Vector3DotProduct(p[2], dir);
+    return d0 >= d1 && d0 >= d2 ? p[0] : (d1 >= d2 ? p[1] : p[2]);
+}
+
+//Earliest contact of one sweep so far
+typedef struct {
+    Collider *collider;
+    Vector3 motion;
+    Vector3 center, extent; //Box of the collider at the start, grown by the cast skin
+    Vector3 min, max; //World box the whole move covers
+    SceneSweepHit hit; //toi starts at 1
+} SceneSweep;
+
+//The mesh BVH in local space like the rays, the moving box goes there as a bigger box. Leaf triangles go back to world
+//space and get cast against, nodes the box only reaches after the best contact are skipped
+static void SweepMeshBvh(const SceneInstance *instance, SceneSweep *sweep) {
+    const MeshBvh *bvh = instance->mesh;
+    Matrix inverse = instance->inverse, m = instance->transform;
+    Vector3 o = Vector3Transform(sweep->center, inverse), d = SceneToLocalDirection(inverse, sweep->motion), e = sweep->extent;
+    Vector3 extent = {
+        fabsf(inverse.m0) * e.x + fabsf(inverse.m4) * e.y + fabsf(inverse.m8) * e.z,
+        fabsf(inverse.m1) * e.x + fabsf(inverse.m5) * e.y + fabsf(inverse.m9) * e.z,
+        fabsf(inverse.m2) * e.x + fabsf(inverse.m6) * e.y + fabsf(inverse.m10) * e.z
+    };
+    Vector3 inv = { SafeInverse(d.x), SafeInverse(d.y), SafeInverse(d.z) };
+    if (SweptNodeDistance(&bvh->nodes[0], o, inv, extent, sweep->hit.toi) == FLT_MAX) return;
+    int stack[BVH_MAX_DEPTH];
+    float stackDistance[BVH_MAX_DEPTH];
+    int sp = 0, node = 0;
+    for (;;) {
+        const BvhNode *n = &bvh->nodes[node];
+        if (n->count > 0) {
+            for (int i = n->leftFirst; i < n->leftFirst + n->count; i++) {
+                const BvhTriangle *tri = &bvh->triangles[i];
+                SceneSweepTriangle world = { {
+                    Vector3Transform(tri->v0, m), Vector3Transform(Vector3Add(tri->v0, tri->e1), m), Vector3Transform(Vector3Add(tri->v0, tri->e2), m)
+                } };
+                Vector3 triMin = Vector3Min(world.points[0], Vector3Min(world.points[1], world.points[2]));
+                Vector3 triMax = Vector3Max(world.points[0], Vector3Max(world.points[1], world.points[2]));
+                if (triMin.x > sweep->max.x || triMin.y > sweep->max.y || triMin.z > sweep->max.z ||
+                    triMax.x < sweep->min.x || triMax.y < sweep->min.y || triMax.z < sweep->min.z) continue;
+                Vector3 center = Vector3Scale(Vector3Add(world.points[0], Vector3Add(world.points[1], world.points[2])), 1.0f / 3.0f);
+                SupportShape shape = { &world, SceneTriangleSupport, center };
+                float t;
+                Vector3 normal;
+                if (CastColliderShape(sweep->collider, sweep->motion, &shape, 0.0f, &t, &normal, NULL) && (!sweep->hit.hit || t < sweep->hit.toi)) {
+                    sweep->hit = (SceneSweepHit){ true, t, normal, instance->id };
+                }
+            }
+        } else {
+            int nearNode = n->leftFirst, farNode = nearNode + 1;
+            float nearDistance = SweptNodeDistance(&bvh->nodes[nearNode], o, inv, extent, sweep->hit.toi);
+            float farDistance = SweptNodeDistance(&bvh->nodes[farNode], o, inv, extent, sweep->hit.toi);
+            if (nearDistance > farDistance) {
+                int swapNode = nearNode; nearNode = farNode; farNode = swapNode;
+                float swapDistance = nearDistance; nearDistance = farDistance; farDistance = swapDistance;
+            }
+            if (nearDistance != FLT_MAX) {
+                if (farDistance != FLT_MAX) {
+                    stack[sp] = farNode;
+                    stackDistance[sp++] = farDistance;
+                }
+                node = nearNode;
+                continue;
+            }
+        }
+        do {
+            if (sp == 0) return;
+            sp--;
+        } while (stackDistance[sp] >= sweep->hit.toi);
+        node = stack[sp];
+    }
+}
+
+/*Earliest contact of the collider moving by motion (without rotating) with the scene triangles, CastCollider against
+every triangle its moving box reaches, nearest nodes first. toi and normal like CastColliders, the contact stops
+COLLISION_CAST_SKIN short. The collider bounds have to be up to date (SetColliderTransform). Only the collider is
+written (its support hint), threads can sweep their own colliders at once*/
+SceneSweepHit SweepColliderScene(const SceneQuery *scene, Collider *collider, Vector3 motion) {
+    SceneSweep sweep = { .collider = collider, .motion = motion, .hit = { false, 1.0f, { 0, 0, 0 }, -1 } };
+    if (scene->numNodes == 0) return sweep.hit;
+    //The cast stops once the shapes are a skin apart, a box grown by it reaches a node no later then that happens
+    Vector3 skin = { COLLISION_CAST_SKIN, COLLISION_CAST_SKIN, COLLISION_CAST_SKIN };
+    Vector3 min = Vector3Subtract(collider->boundsMin, skin), max = Vector3Add(collider->boundsMax, skin);
+    sweep.center = Vector3Scale(Vector3Add(min, max), 0.5f);
+    sweep.extent = Vector3Scale(Vector3Subtract(max, min), 0.5f);
+    sweep.min = Vector3Min(min, Vector3Add(min, motion));
+    sweep.max = Vector3Max(max, Vector3Add(max, motion));
+    Vector3 inv = { SafeInverse(motion.x), SafeInverse(motion.y), SafeInverse(motion.z) };
+    if (SweptNodeDistance(&scene->nodes[0], sweep.center, inv, sweep.extent, sweep.hit.toi) == FLT_MAX) return sweep.hit;
+    int stack[BVH_MAX_DEPTH];
+    float stackDistance[BVH_MAX_DEPTH];
+    int sp = 0, node = 0;
+    for (;;) {
+        const BvhNode *n = &scene->nodes[node];
+        if (n->count > 0) {
+            for (int i = n->leftFirst; i < n->leftFirst + n->count; i++) SweepMeshBvh(&scene->instances[scene->order[i]], &sweep);
+        } else {
+            int nearNode = n->leftFirst, farNode = nearNode + 1;
+            float nearDistance = SweptNodeDistance(&scene->nodes[nearNode], sweep.center, inv, sweep.extent, sweep.hit.toi);
+            float farDistance = SweptNodeDistance(&scene->nodes[farNode], sweep.center, inv, sweep.extent, sweep.hit.toi);
+            if (nearDistance > farDistance) {
+                int swapNode = nearNode; nearNode = farNode; farNode = swapNode;
+                float swapDistance = nearDistance; nearDistance = farDistance; farDistance = swapDistance;
+            }
+            if (nearDistance != FLT_MAX) {
+                if (farDistance != FLT_MAX) {
+                    stack[sp] = farNode;
+                    stackDistance[sp++] = farDistance;
+                }
+                node = nearNode;
+                continue;
+            }
+        }
+        do {
+            if (sp == 0) return sweep.hit;
+            sp--;
+        } while (stackDistance[sp] >= sweep.hit.toi);
+        node = stack[sp];
+    }
+}
+
+#if SCENE_PACKET_WIDTH > 1
+//SCENE_PACKET_WIDTH rays in structure of arrays form, one lane per ray
+typedef struct {
+    PacketFloat ox, oy, oz;
+    PacketFloat dx, dy, dz;
+    PacketFloat ix, iy, iz; //SafeInverse of the direction
+    Vector3 lead; //Direction of the first ray, picks which child the packet visits first
+} RayPacket;
+
+static void SetupRayPacket(RayPacket *packet, const Vector3 *o, const Vector3 *d) {
+    float ox[SCENE_PACKET_WIDTH], oy[SCENE_PACKET_WIDTH], oz[SCENE_PACKET_WIDTH];
+    float dx[SCENE_PACKET_WIDTH], dy[SCENE_PACKET_WIDTH], dz[SCENE_PACKET_WIDTH];
+    float ix[SCENE_PACKET_WIDTH], iy[SCENE_PACKET_WIDTH], iz[SCENE_PACKET_WIDTH];
+    for (int k = 0; k < SCENE_PACKET_WIDTH; k++) {
+        ox[k] = o[k].x; oy[k] = o[k].y; oz[k] = o[k].z;
+        dx[k] = d[k].x; dy[k] = d[k].y; dz[k] = d[k].z;
+        ix[k] = SafeInverse(d[k].x); iy[k] = SafeInverse(d[k].y); iz[k] = SafeInverse(d[k].z);
+    }
+    packet->ox = PacketLoad(ox); packet->oy = PacketLoad(oy); packet->oz = PacketLoad(oz);
+    packet->dx = PacketLoad(dx); packet->dy = PacketLoad(dy); packet->dz = PacketLoad(dz);
+    packet->ix = PacketLoad(ix); packet->iy = PacketLoad(iy); packet->iz = PacketLoad(iz);
+    packet->lead = d[0];
+}
+
+//True if any ray of the packet enters the box before its own tmax, same test as RayNodeDistance
+static inline bool PacketHitsNode(const BvhNode *node, const RayPacket *r, PacketFloat tmax) {
+    PacketFloat t1 = PacketMul(PacketSub(PacketSet(node->min.x), r->ox), r->ix);
+    PacketFloat t2 = PacketMul(PacketSub(PacketSet(node->max.x), r->ox), r->ix);
+    PacketFloat tnear = PacketMin(t1, t2), tfar = PacketMax(t1, t2);
+    t1 = PacketMul(PacketSub(PacketSet(node->min.y), r->oy), r->iy);
+    t2 = PacketMul(PacketSub(PacketSet(node->max.y), r->oy), r->iy);
+    tnear = PacketMax(tnear, PacketMin(t1, t2));
+    tfar = PacketMin(tfar, PacketMax(t1, t2));
+    t1 = PacketMul(PacketSub(PacketSet(node->min.z), r->oz), r->iz);
+    t2 = PacketMul(PacketSub(PacketSet(node->max.z), r->oz), r->iz);
+    tnear = PacketMax(tnear, PacketMin(t1, t2));
+    tfar = PacketMin(tfar, PacketMax(t1, t2));
+    PacketFloat mask = PacketAnd(PacketAnd(PacketLessEqual(tnear, tfar), PacketLess(tnear, tmax)), PacketLess(PacketSet(0.0f), tfar));
+    return PacketMask(mask) != 0;
+}
+
+//One triangle against every ray of the packet, RayTriangle with the lanes side by side
+static inline void PacketTriangle(const BvhTriangle *tri, const RayPacket *r, PacketFloat *tmax, int *instances, int *triangles, int instance, int index) {
+    PacketFloat e1x = PacketSet(tri->e1.x), e1y = PacketSet(tri->e1.y), e1z = PacketSet(tri->e1.z);
+    PacketFloat e2x = PacketSet(tri->e2.x), e2y = PacketSet(tri->e2.y), e2z = PacketSet(tri->e2.z);
+    //h = d x e2
+    PacketFloat hx = PacketSub(PacketMul(r->dy, e2z), PacketMul(r->dz, e2y));
+    PacketFloat hy = PacketSub(PacketMul(r->dz, e2x), PacketMul(r->dx, e2z));
+    PacketFloat hz = PacketSub(PacketMul(r->dx, e2y), PacketMul(r->dy, e2x));
+    PacketFloat a = PacketAdd(PacketAdd(PacketMul(e1x, hx), PacketMul(e1y, hy)), PacketMul(e1z, hz));
+    PacketFloat absA = PacketAndNot(PacketSet(-0.0f), a);
+    PacketFloat f = PacketDiv(PacketSet(1.0f), a); //A real divide, not the rcp estimate, so the lanes agree with RayTriangle
+    //s = o - v0
+    PacketFloat sx = PacketSub(r->ox, PacketSet(tri->v0.x)), sy = PacketSub(r->oy, PacketSet(tri->v0.y)), sz = PacketSub(r->oz, PacketSet(tri->v0.z));
+    PacketFloat u = PacketMul(f, PacketAdd(PacketAdd(PacketMul(sx, hx), PacketMul(sy, hy)), PacketMul(sz, hz)));
+    //q = s x e1
+    PacketFloat qx = PacketSub(PacketMul(sy, e1z), PacketMul(sz, e1y));
+    PacketFloat qy = PacketSub(PacketMul(sz, e1x), PacketMul(sx, e1z));
+    PacketFloat qz = PacketSub(PacketMul(sx, e1y), PacketMul(sy, e1x));
+    PacketFloat v = PacketMul(f, PacketAdd(PacketAdd(PacketMul(r->dx, qx), PacketMul(r->dy, qy)), PacketMul(r->dz, qz)));
+    PacketFloat t = PacketMul(f, PacketAdd(PacketAdd(PacketMul(e2x, qx), PacketMul(e2y, qy)), PacketMul(e2z, qz)));
+    PacketFloat zero = PacketSet(0.0f), one = PacketSet(1.0f);
+    PacketFloat mask = PacketLessEqual(PacketSet(SCENE_PARALLEL_EPSILON), absA);
+    mask = PacketAnd(mask, PacketAnd(PacketLessEqual(zero, u), PacketLessEqual(u, one)));
+    mask = PacketAnd(mask, PacketAnd(PacketLessEqual(zero, v), PacketLessEqual(PacketAdd(u, v), one)));
+    mask = PacketAnd(mask, PacketAnd(PacketLess(PacketSet(SCENE_RAY_EPSILON), t), PacketLess(t, *tmax)));
+    int bits = PacketMask(mask);
+    if (bits == 0) return;
+    *tmax = PacketOr(PacketAnd(mask, t), PacketAndNot(mask, *tmax));
+    for (; bits != 0; bits &= bits - 1) {
+        int k = __builtin_ctz(bits);
+        instances[k] = instance;
+        triangles[k] = index;
+    }
+}
+
+/*The packet walks the tree together, a node gets opened if any of its rays reaches it. Children are visited near first
+by the direction of the first ray, the rays of a packet usually point about the same way*/
+static void TracePacketMesh(const MeshBvh *bvh, const RayPacket *r, PacketFloat *tmax, int *instances, int *triangles, int instance) {
+    int stack[BVH_MAX_DEPTH * 2];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const BvhNode *n = &bvh->nodes[stack[--sp]];
+        if (!PacketHitsNode(n, r, *tmax)) continue;
+        if (n->count > 0) {
+            for (int i = n->leftFirst; i < n->leftFirst + n->count; i++) PacketTriangle(&bvh->triangles[i], r, tmax, instances, triangles, instance, i);
+            continue;
+        }
+        const BvhNode *left = &bvh->nodes[n->leftFirst], *right = left + 1;
+        Vector3 gap = Vector3Subtract(Vector3Add(right->min, right->max), Vector3Add(left->min, left->max));
+        float along = fabsf(gap.x) > fabsf(gap.y) ? (fabsf(gap.x) > fabsf(gap.z) ? gap.x * r->lead.x : gap.z * r->lead.z)
+                                                    : (fabsf(gap.y) > fabsf(gap.z) ? gap.y * r->lead.y : gap.z * r->lead.z);
+        if (along >= 0.0f) {//Right child is further along the rays, left goes on top
+            stack[sp++] = n->leftFirst + 1;
+            stack[sp++] = n->leftFirst;
+        } else {
+            stack[sp++] = n->leftFirst;
+            stack[sp++] = n->leftFirst + 1;
+        }
+    }
+}
+
+static void TracePacketScene(const SceneQuery *scene, const RayPacket *r, const Vector3 *o, const Vector3 *d, PacketFloat *tmax, int *instances, int *triangles) {
+    int stack[BVH_MAX_DEPTH * 2];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const BvhNode *n = &scene->nodes[stack[--sp]];
+        if (!PacketHitsNode(n, r, *tmax)) continue;
+        if (n->count > 0) {
+            for (int i = n->leftFirst; i < n->leftFirst + n->count; i++) {
+                int index = scene->order[i];
+                const SceneInstance *instance = &scene->instances[index];
+                Vector3 lo[SCENE_PACKET_WIDTH], ld[SCENE_PACKET_WIDTH];
+                for (int k = 0; k < SCENE_PACKET_WIDTH; k++) {
+                    lo[k] = Vector3Transform(o[k], instance->inverse);
+                    ld[k] = SceneToLocalDirection(instance->inverse, d[k]);
+                }
+                RayPacket local;
+                SetupRayPacket(&local, lo, ld);
+                TracePacketMesh(instance->mesh, &local, tmax, instances, triangles, index);
+            }
+            continue;
+        }
+        const BvhNode *left = &scene->nodes[n->leftFirst], *right = left + 1;
+        Vector3 gap = Vector3Subtract(Vector3Add(right->min, right->max), Vector3Add(left->min, left->max));
+        float along = fabsf(gap.x) > fabsf(gap.y) ? (fabsf(gap.x) > fabsf(gap.z) ? gap.x * r->lead.x : gap.z * r->lead.z)
+                                                    : (fabsf(gap.y) > fabsf(gap.z) ? gap.y * r->lead.y : gap.z * r->lead.z);
+        if (along >= 0.0f) {
+            stack[sp++] = n->leftFirst + 1;
+            stack[sp++] = n->leftFirst;
+        } else {
+            stack[sp++] = n->leftFirst;
+            stack[sp++] = n->leftFirst + 1;
+        }
+    }
+}
+#endif
+
+/*Up to SCENE_PACKET_WIDTH rays traced together, hits gets one result per ray. Pays off for rays that start close
+together and point about the same way (a spread of pellets, the rays of a camera), scattered rays are better off alone*/
+void RaycastScenePacket(const SceneQuery *scene, const Ray *rays, int count, float maxDistance, SceneRayHit *hits) {
+#if SCENE_PACKET_WIDTH > 1
+    if (scene->numNodes == 0) {
+        for (int k = 0; k < count; k++) hits[k] = (SceneRayHit){ .id = -1 };
+        return;
+    }
+    Vector3 o[SCENE_PACKET_WIDTH], d[SCENE_PACKET_WIDTH];
+    int instances[SCENE_PACKET_WIDTH], triangles[SCENE_PACKET_WIDTH];
+    for (int k = 0; k < SCENE_PACKET_WIDTH; k++) {//Spare lanes repeat the first ray and get dropped at the end
+        o[k] = rays[k < count ? k : 0].position;
+        d[k] = rays[k < count ? k : 0].direction;
+        instances[k] = triangles[k] = -1;
+    }
+    RayPacket packet;
+    SetupRayPacket(&packet, o, d);
+    PacketFloat tmax = PacketSet(maxDistance);
+    TracePacketScene(scene, &packet, o, d, &tmax, instances, triangles);
+    float distances[SCENE_PACKET_WIDTH];
+    PacketStore(distances, tmax);
+    for (int k = 0; k < count; k++) {
+        SceneTrace trace = { distances[k], instances[k], triangles[k] };
+        hits[k] = SceneTraceHit(scene, rays[k], &trace);
+    }
+#else
+    for (int k = 0; k < count; k++) hits[k] = RaycastScene(scene, rays[k], maxDistance);
+#endif
+}
+
+//Any number of rays, in packets of SCENE_PACKET_WIDTH in the order given. Put rays that go together next to each other
+void RaycastSceneRays(const SceneQuery *scene, const Ray *rays, int count, float maxDistance, SceneRayHit *hits) {
+    for (int i = 0; i < count; i += SCENE_PACKET_WIDTH)
+        RaycastScenePacket(scene, rays + i, count - i < SCENE_PACKET_WIDTH ? count - i : SCENE_PACKET_WIDTH, maxDistance, hits + i);
+}
+
+#endif
@@ -0,0 +1,711 @@
+#ifndef SECTORS_H
+#define SECTORS_H
+
+#include "raylib.h"
+#include "raymath.h"
+#include "collisions.h"
+#include "levelfile.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>//INT_MAX
+#include <stdlib.h>//Memory operations
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>//stat
+
+/* World files, a level cut into square sectors on the XZ plane that get loaded and dropped while the player moves.
+ * header: "SCWD", version, sector size, the table counts and offsets and the size of the file
+ * sector table: one WorldSectorRecord per cell that has anything in it, its cell, bounds and where its level is
+ * prop table: one WorldPropRecord per placed model, the props of a sector are next to each other
+ * resource table: one WorldResourceRecord per model or texture the props use, models point at their texture
+ * strings: the resource paths, zero terminated, as the game opens them (relative to src/)
+ * after that every sector has a normal cooked level (levelfile.h) of its own colliders, starting on a page so it
+ * can be mapped by itself. Written by bench/cook -sectors, the tables get read in whole when the world is opened.
+ *
+ * The streamer keeps the sectors within loadRadius of a focus point (the camera) in memory and drops the ones
+ * further out then loadRadius + hysteresis, so walking along a sector edge doesnt load and drop the same sector
+ * every few frames. A thread of its own maps the levels, the colliders go into the broadphase on the main thread
+ * in UpdateSectorStreamer. Models and textures go trough a callback, the game loads them however it likes (the
+ * asset loader). Everything that is in counts against the memory budget, when a new sector doesnt fit the ones
+ * further away then it go, furthest first, and if that isnt enough the loading waits until the player moved on */
+
+#define WORLD_FILE_MAGIC "SCWD"
+#define WORLD_FILE_VERSION 1
+#define WORLD_FILE_PAGE 4096 //Sector levels start on this, mmap offsets have to be page aligned
+#define SECTOR_MAX_LOADING 4 //Sectors queued on the I/O thread at once, the nearest get asked for first
+#define SECTOR_STORE_BLOCK (64 * 1024) //Arena block of a sectors collider store, a sector is a lot smaller then a level
+#define SECTOR_PATH_LENGTH 256
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    float sectorSize;
+    uint32_t numSectors, numProps, numResources;
+    uint32_t stringsSize;
+    uint64_t sectors, props, resources, strings; //Offsets of the tables
+    uint64_t size; //Of the whole file, a cut off file gets refused
+} WorldFileHeader;
+
+typedef struct {
+    int32_t x, z; //Cell, centered on x * sectorSize so the origin is in the middle of one
+    Vector3 boundsMin, boundsMax; //Everything in it, props and colliders
+    uint64_t level, levelSize; //The cooked level of its colliders
+    uint32_t firstProp, numProps;
+    uint32_t numColliders;
+    uint32_t padding;
+} WorldSectorRecord;
+
+typedef struct {
+    Matrix transform; //Local to world, the same one its collider has
+    Vector3 boundsMin, boundsMax; //Local AABB of the model
+    int32_t resource; //Model, -1 for a collider you cant see
+    int32_t collider; //Index in the sector level, -1 if it is only for show
+} WorldPropRecord;
+
+typedef enum {
+    WORLD_RESOURCE_MODEL,
+    WORLD_RESOURCE_TEXTURE
+} WorldResourceType;
+
+typedef struct {
+    uint32_t type; //WorldResourceType
+    uint32_t path; //Offset in the strings
+    int32_t texture; //Models, the diffuse texture resource or -1
+    Color tint; //Models, diffuse color
+    uint64_t bytes; //File size, what it gets counted as against the budget
+} WorldResourceRecord;
+
+//One thing to place, what the cooker reads from a layout line
+typedef struct {
+    int shape; //Index in the shapes for a collider, -1 for none
+    Matrix transform;
+    const char *model; //NULL for a collider you cant see
+    const char *texture; //NULL for none
+    Color tint;
+    BoundingBox bounds; //Local AABB of the model
+} WorldObject;
+
+typedef struct {
+    int index, x, z;
+} WorldCellKey;
+
+static int CompareWorldCells(const void *a, const void *b) {
+    const WorldCellKey *x = (const WorldCellKey *)a, *y = (const WorldCellKey *)b;
+    if (x->z != y->z) return x->z < y->z ? -1 : 1;
+    if (x->x != y->x) return x->x < y->x ? -1 : 1;
+    return x->index - y->index; //Layout order within a sector
+}
+
+//Cell a world coordinate falls in
+static int SectorCell(float coordinate, float sectorSize) {
+    return (int)floorf(coordinate / sectorSize + 0.5f);
+}
+
+static uint64_t WorldFileSize(const char *path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? (uint64_t)info.st_size : 0;
+}
+
+//Index of the resource, added if it isnt there yet
+static int AddWorldResource(WorldResourceRecord **resources, int *count, int *cap, char **strings, uint32_t *stringsSize,
+                            WorldResourceType type, const char *path, int texture, Color tint) {
+    for (int i = 0; i < *count; i++) {
+        const WorldResourceRecord *r = &(*resources)[i];
+        if (r->type == type && r->texture == texture && memcmp(&r->tint, &tint, sizeof(Color)) == 0 && strcmp(*strings + r->path, path) == 0) return i;
+    }
+    if (*count == *cap) {
+        *cap = *cap ? *cap * 2 : 32;
+        *resources = (WorldResourceRecord *)realloc(*resources, *cap * sizeof(WorldResourceRecord));
+    }
+    size_t length = strlen(path) + 1;
+    *strings = (char *)realloc(*strings, *stringsSize + length);
+    memcpy(*strings + *stringsSize, path, length);
+    WorldResourceRecord *r = &(*resources)[*count];
+    *r = (WorldResourceRecord){ 0 };
+    r->type = type;
+    r->path = *stringsSize;
+    r->texture = texture;
+    r->tint = tint;
+    r->bytes = WorldFileSize(path);
+    *stringsSize += (uint32_t)length;
+    return (*count)++;
+}
+
+static void PadWorldFile(FILE *file, long alignment) {
+    static const char zeros[WORLD_FILE_PAGE] = { 0 };
+    long pad = (alignment - ftell(file) % alignment) % alignment;
+    fwrite(zeros, 1, pad, file);
+}
+
+/*Cut the objects into sectors of sectorSize by where their transform puts them and write the world file. Every
+sector gets a level with only its colliders and the shapes they use, objects keep their order inside a sector.
+The model and texture paths get stored as they are and their files are looked at for the sizes*/
+bool SaveWorldFile(const char *path, float sectorSize, const CookedShape *const shapes[], int numShapes, const WorldObject objects[], int numObjects) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+    WorldCellKey *keys = (WorldCellKey *)malloc((numObjects + 1) * sizeof(WorldCellKey));
+    for (int i = 0; i < numObjects; i++) {
+        keys[i].index = i;
+        keys[i].x = SectorCell(objects[i].transform.m12, sectorSize);
+        keys[i].z = SectorCell(objects[i].transform.m14, sectorSize);
+    }
+    qsort(keys, numObjects, sizeof(WorldCellKey), CompareWorldCells);
+
+    WorldSectorRecord *sectors = (WorldSectorRecord *)calloc(numObjects + 1, sizeof(WorldSectorRecord));
+    WorldPropRecord *props = (WorldPropRecord *)calloc(numObjects + 1, sizeof(WorldPropRecord));
+    WorldResourceRecord *resources = NULL;
+    int numSectors = 0, numResources = 0, capResources = 0;
+    char *strings = NULL;
+    uint32_t stringsSize = 0;
+    Collider *colliders = (Collider *)calloc(numObjects + 1, sizeof(Collider));
+    int *colliderShapes = (int *)malloc((numObjects + 1) * sizeof(int));
+    const CookedShape **sectorShapes = (const CookedShape **)malloc((numShapes + 1) * sizeof(CookedShape *));
+    int *shapeRemap = (int *)malloc((numShapes + 1) * sizeof(int));
+
+    WorldFileHeader header = { 0 };
+    fwrite(&header, sizeof(header), 1, file); //Filled in at the end
+    bool ok = true;
+    for (int first = 0; first < numObjects && ok;) {
+        int last = first;
+        while (last < numObjects && keys[last].x == keys[first].x && keys[last].z == keys[first].z) last++;
+        WorldSectorRecord *sector = &sectors[numSectors++];
+        sector->x = keys[first].x;
+        sector->z = keys[first].z;
+        sector->boundsMin = (Vector3){ FLT_MAX, FLT_MAX, FLT_MAX };
+        sector->boundsMax = (Vector3){ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        sector->firstProp = (uint32_t)first;
+        sector->numProps = (uint32_t)(last - first);
+        int numColliders = 0, numSectorShapes = 0;
+        for (int i = 0; i < numShapes; i++) shapeRemap[i] = -1;
+        for (int k = first; k < last; k++) {
+            const WorldObject *o = &objects[keys[k].index];
+            WorldPropRecord *p = &props[k];
+            p->transform = o->transform;
+            p->boundsMin = o->bounds.min;
+            p->boundsMax = o->bounds.max;
+            p->resource = -1;
+            p->collider = -1;
+            if (o->model != NULL) {
+                int texture = o->texture != NULL ? AddWorldResource(&resources, &numResources, &capResources, &strings, &stringsSize, WORLD_RESOURCE_TEXTURE, o->texture, -1, (Color){ 0 }) : -1;
+                p->resource = AddWorldResource(&resources, &numResources, &capResources, &strings, &stringsSize, WORLD_RESOURCE_MODEL, o->model, texture, o->tint);
+                //World box of the model, the same way the colliders get theirs
+                Collider box = { 0 };
+                box.localMin = o->bounds.min;
+                box.localMax = o->bounds.max;
+                SetColliderTransform(&box, o->transform);
+                sector->boundsMin = Vector3Min(sector->boundsMin, box.boundsMin);
+                sector->boundsMax = Vector3Max(sector->boundsMax, box.boundsMax);
+            }
+            if (o->shape >= 0 && o->shape < numShapes) {
+                if (shapeRemap[o->shape] < 0) {
+                    shapeRemap[o->shape] = numSectorShapes;
+                    sectorShapes[numSectorShapes++] = shapes[o->shape];
+                }
+                Collider *c = &colliders[numColliders];
+                SetupColliderShape(c, shapes[o->shape], NULL);
+                SetColliderTransform(c, o->transform);
+                PrepareCollider(c); //World axes of rotated colliders go in the file
+                sector->boundsMin = Vector3Min(sector->boundsMin, c->boundsMin);
+                sector->boundsMax = Vector3Max(sector->boundsMax, c->boundsMax);
+                colliderShapes[numColliders] = shapeRemap[o->shape];
+                p->collider = numColliders++;
+            }
+        }
+        sector->numColliders = (uint32_t)numColliders;
+        PadWorldFile(file, WORLD_FILE_PAGE);
+        sector->level = (uint64_t)ftell(file);
+        ok = WriteLevelFile(file, sectorShapes, numSectorShapes, colliders, colliderShapes, numColliders);
+        sector->levelSize = (uint64_t)ftell(file) - sector->level;
+        for (int i = 0; i < numColliders; i++) UnloadCollider(&colliders[i]);
+        first = last;
+    }
+
+    PadWorldFile(file, LEVEL_FILE_ALIGNMENT);
+    header.sectors = (uint64_t)ftell(file);
+    fwrite(sectors, sizeof(WorldSectorRecord), numSectors, file);
+    PadWorldFile(file, LEVEL_FILE_ALIGNMENT);
+    header.props = (uint64_t)ftell(file);
+    fwrite(props, sizeof(WorldPropRecord), numObjects, file);
+    PadWorldFile(file, LEVEL_FILE_ALIGNMENT);
+    header.resources = (uint64_t)ftell(file);
+    fwrite(resources, sizeof(WorldResourceRecord), numResources, file);
+    header.strings = (uint64_t)ftell(file);
+    fwrite(strings, 1, stringsSize, file);
+    memcpy(header.magic, WORLD_FILE_MAGIC, 4);
+    header.version = WORLD_FILE_VERSION;
+    header.sectorSize = sectorSize;
+    header.numSectors = (uint32_t)numSectors;
+    header.numProps = (uint32_t)numObjects;
+    header.numResources = (uint32_t)numResources;
+    header.stringsSize = stringsSize;
+    header.size = (uint64_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+
+    free(keys);
+    free(sectors);
+    free(props);
+    free(resources);
+    free(strings);
+    free(colliders);
+    free(colliderShapes);
+    free(sectorShapes);
+    free(shapeRemap);
+    ok = ok && !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+typedef enum {
+    SECTOR_OUT,
+    SECTOR_LOADING, //Queued or being mapped on the I/O thread, only the I/O thread touches level and store
+    SECTOR_IN, //Colliders in the broadphase, props can be drawn
+    SECTOR_FAILED //Level didnt map, not tried again
+} SectorState;
+
+typedef struct {
+    const WorldSectorRecord *record;
+    SectorState state;
+    ColliderStore store; //Own one so a sector goes without touching the others
+    LevelFile level;
+    int *slots; //Slot of level collider i in the streamer colliders
+    size_t bytes; //Counted against the budget, the resources arent in it
+    double requested; //When the load went out
+} Sector;
+
+typedef struct {
+    int sectorsIn, sectorsLoading;
+    long loads, evictions, failures;
+    long budgetStalls; //Updates where the nearest missing sector didnt fit in the budget
+    size_t residentBytes, peakBytes;
+    double loadTime, maxLoadTime; //Seconds from the request to the colliders going in
+} SectorStreamerStats;
+
+//resource is the index in streamer->resources, acquire is false once nothing in uses it anymore. Main thread, from UpdateSectorStreamer
+typedef void (*SectorResourceCallback)(int resource, bool acquire, void *user);
+
+typedef struct {
+    char path[SECTOR_PATH_LENGTH];
+    float sectorSize;
+    float loadRadius, evictRadius;
+    size_t budget;
+    Broadphase *broadphase;
+    SectorResourceCallback onResource;
+    void *user;
+
+    //The tables, read in whole
+    WorldSectorRecord *records;
+    WorldPropRecord *props;
+    WorldResourceRecord *resources;
+    char *strings;
+    int numSectors, numProps, numResources;
+    int *resourceRefs; //Props in that use it, textures count the models in that use them
+    int *resourceMarks; //Scratch for the budget check
+    int mark;
+
+    Sector *sectors;
+    int *grid; //Sector index of every cell in the box around them, -1 for an empty one
+    int gridMinX, gridMinZ, gridWidth, gridDepth;
+    int *resident; //Sectors that are loading or in
+    int numResident;
+    int *candidates; //Scratch
+    float *distances; //Of every sector to the focus, scratch
+
+    //The colliders of every sector that is in, the broadphase ids are the indices. Slots of dropped sectors are
+    //zeroed and reused, numColliders is the highest one used so far
+    Collider *colliders;
+    int numColliders, capColliders;
+    int *freeSlots;
+    int numFree;
+
+    //I/O thread
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake, done;
+    bool quit, working;
+    int queue[SECTOR_MAX_LOADING];
+    int numQueued;
+    int *finished; //Mapped or failed, waiting for UpdateSectorStreamer
+    int numFinished;
+
+    SectorStreamerStats stats;
+} SectorStreamer;
+
+static double SectorNow(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void *SectorThreadMain(void *arg) {
+    SectorStreamer *s = (SectorStreamer *)arg;
+    pthread_mutex_lock(&s->lock);
+    while (true) {
+        while (!s->quit && s->numQueued == 0) pthread_cond_wait(&s->wake, &s->lock);
+        if (s->quit) break;
+        int index = s->queue[0];
+        memmove(s->queue, s->queue + 1, --s->numQueued * sizeof(int));
+        s->working = true;
+        pthread_mutex_unlock(&s->lock);
+
+        Sector *sector = &s->sectors[index];
+        sector->level = LoadLevelFileRange(s->path, sector->record->level, sector->record->levelSize, &sector->store);
+
+        pthread_mutex_lock(&s->lock);
+        s->finished[s->numFinished++] = index;
+        s->working = false;
+        pthread_cond_broadcast(&s->done);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+/*Open a world file and start the I/O thread, nothing gets loaded before the first UpdateSectorStreamer. budget is
+in bytes, sectors closer then loadRadius to the focus come in and the ones further then loadRadius + hysteresis go.
+onResource can be NULL. Returns false if the file isnt a world file. Takes a pointer since the thread keeps it*/
+bool InitSectorStreamer(SectorStreamer *s, const char *path, Broadphase *broadphase, size_t budget, float loadRadius, float hysteresis,
+                        SectorResourceCallback onResource, void *user) {
+    *s = (SectorStreamer){ 0 };
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    WorldFileHeader header;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, WORLD_FILE_MAGIC, 4) == 0 &&
+              header.version == WORLD_FILE_VERSION && header.size == (uint64_t)size && header.sectorSize > 0.0f;
+    if (ok) {
+        s->records = (WorldSectorRecord *)malloc((header.numSectors + 1) * sizeof(WorldSectorRecord));
+        s->props = (WorldPropRecord *)malloc((header.numProps + 1) * sizeof(WorldPropRecord));
+        s->resources = (WorldResourceRecord *)malloc((header.numResources + 1) * sizeof(WorldResourceRecord));
+        s->strings = (char *)malloc(header.stringsSize + 1);
+        ok = fseek(file, (long)header.sectors, SEEK_SET) == 0 && fread(s->records, sizeof(WorldSectorRecord), header.numSectors, file) == header.numSectors &&
+             fseek(file, (long)header.props, SEEK_SET) == 0 && fread(s->props, sizeof(WorldPropRecord), header.numProps, file) == header.numProps &&
+             fseek(file, (long)header.resources, SEEK_SET) == 0 && fread(s->resources, sizeof(WorldResourceRecord), header.numResources, file) == header.numResources &&
+             fseek(file, (long)header.strings, SEEK_SET) == 0 && fread(s->strings, 1, header.stringsSize, file) == header.stringsSize;
+        s->strings[header.stringsSize] = '\0';
+    }
+    fclose(file);
+    //Everything the tables point at has to be inside them
+    for (uint32_t i = 0; ok && i < header.numSectors; i++) {
+        const WorldSectorRecord *r = &s->records[i];
+        ok = r->level % WORLD_FILE_PAGE == 0 && r->level < header.size && r->levelSize <= header.size - r->level &&
+             r->firstProp <= header.numProps && r->numProps <= header.numProps - r->firstProp;
+    }
+    for (uint32_t i = 0; ok && i < header.numProps; i++) ok = s->props[i].resource >= -1 && s->props[i].resource < (int32_t)header.numResources;
+    //A texture comes before the models that use it, so following them always ends (acquiring and SectorCost walk them)
+    for (uint32_t i = 0; ok && i < header.numResources; i++)
+        ok = s->resources[i].path < header.stringsSize && s->resources[i].texture >= -1 && s->resources[i].texture < (int32_t)i;
+    //Cell to sector lookup over the box the sectors are in. A grid with more cells then the file has bytes gets refused,
+    //a broken cell number would otherwise have it allocate gigabytes
+    int32_t minX = 0, minZ = 0, maxX = -1, maxZ = -1;
+    for (uint32_t i = 0; ok && i < header.numSectors; i++) {
+        const WorldSectorRecord *r = &s->records[i];
+        if (i == 0 || r->x < minX) minX = r->x;
+        if (i == 0 || r->z < minZ) minZ = r->z;
+        if (i == 0 || r->x > maxX) maxX = r->x;
+        if (i == 0 || r->z > maxZ) maxZ = r->z;
+    }
+    size_t gridWidth = (size_t)((int64_t)maxX - minX + 1), gridDepth = (size_t)((int64_t)maxZ - minZ + 1);
+    if (ok && header.numSectors > 0) ok = gridWidth <= (size_t)size / gridDepth && gridWidth * gridDepth < INT_MAX;
+    if (!ok) {
+        free(s->records);
+        free(s->props);
+        free(s->resources);
+        free(s->strings);
+        *s = (SectorStreamer){ 0 };
+        return false;
+    }
+
+    snprintf(s->path, sizeof(s->path), "%s", path);
+    s->sectorSize = header.sectorSize;
+    s->loadRadius = loadRadius;
+    s->evictRadius = loadRadius + hysteresis;
+    s->budget = budget;
+    s->broadphase = broadphase;
+    s->onResource = onResource;
+    s->user = user;
+    s->numSectors = (int)header.numSectors;
+    s->numProps = (int)header.numProps;
+    s->numResources = (int)header.numResources;
+    s->resourceRefs = (int *)calloc(s->numResources + 1, sizeof(int));
+    s->resourceMarks = (int *)calloc(s->numResources + 1, sizeof(int));
+    s->sectors = (Sector *)calloc(s->numSectors + 1, sizeof(Sector));
+    s->resident = (int *)malloc((s->numSectors + 1) * sizeof(int));
+    s->candidates = (int *)malloc((s->numSectors + 1) * sizeof(int));
+    s->distances = (float *)malloc((s->numSectors + 1) * sizeof(float));
+    s->finished = (int *)malloc((s->numSectors + 1) * sizeof(int));
+
+    for (int i = 0; i < s->numSectors; i++) {
+        s->sectors[i].record = &s->records[i];
+        s->sectors[i].level.numColliders = -1;
+    }
+    s->gridMinX = minX;
+    s->gridMinZ = minZ;
+    s->gridWidth = (int)gridWidth;
+    s->gridDepth = (int)gridDepth;
+    s->grid = (int *)malloc((gridWidth * gridDepth + 1) * sizeof(int));
+    for (int i = 0; i < s->gridWidth * s->gridDepth; i++) s->grid[i] = -1;
+    for (int i = 0; i < s->numSectors; i++) s->grid[(s->records[i].z - minZ) * s->gridWidth + s->records[i].x - minX] = i;
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->wake, NULL);
+    pthread_cond_init(&s->done, NULL);
+    pthread_create(&s->thread, NULL, SectorThreadMain, s);
+    return true;
+}
+
+//Path of a model or texture as the game should open it
+const char *SectorResourcePath(const SectorStreamer *s, int resource) {
+    return s->strings + s->resources[resource].path;
+}
+
+//Distance on the XZ plane from the focus to the cell of the sector
+static float SectorDistance(const SectorStreamer *s, const WorldSectorRecord *r, Vector3 focus) {
+    float x0 = (r->x - 0.5f) * s->sectorSize, z0 = (r->z - 0.5f) * s->sectorSize;
+    float dx = fmaxf(fmaxf(x0 - focus.x, focus.x - (x0 + s->sectorSize)), 0.0f);
+    float dz = fmaxf(fmaxf(z0 - focus.z, focus.z - (z0 + s->sectorSize)), 0.0f);
+    return sqrtf(dx * dx + dz * dz);
+}
+
+static void AcquireSectorResource(SectorStreamer *s, int resource) {
+    if (s->resourceRefs[resource]++ > 0) return;
+    const WorldResourceRecord *r = &s->resources[resource];
+    if (r->texture >= 0) AcquireSectorResource(s, r->texture);
+    s->stats.residentBytes += r->bytes;
+    if (s->onResource != NULL) s->onResource(resource, true, s->user);
+}
+
+static void ReleaseSectorResource(SectorStreamer *s, int resource) {
+    if (--s->resourceRefs[resource] > 0) return;
+    const WorldResourceRecord *r = &s->resources[resource];
+    s->stats.residentBytes -= r->bytes;
+    if (s->onResource != NULL) s->onResource(resource, false, s->user);
+    if (r->texture >= 0) ReleaseSectorResource(s, r->texture);
+}
+
+//What loading the sector would add, its level, the colliders twice (store and slots) and the resources that arent in yet
+static size_t SectorCost(SectorStreamer *s, const WorldSectorRecord *r) {
+    size_t bytes = (size_t)r->levelSize + 2 * (size_t)r->numColliders * sizeof(Collider);
+    s->mark++;
+    for (uint32_t i = r->firstProp; i < r->firstProp + r->numProps; i++) {
+        for (int resource = s->props[i].resource; resource >= 0; resource = s->resources[resource].texture) {
+            if (s->resourceRefs[resource] > 0 || s->resourceMarks[resource] == s->mark) break;
+            s->resourceMarks[resource] = s->mark;
+            bytes += s->resources[resource].bytes;
+        }
+    }
+    return bytes;
+}
+
+static void RemoveResidentSector(SectorStreamer *s, int index) {
+    for (int i = 0; i < s->numResident; i++) {
+        if (s->resident[i] != index) continue;
+        s->resident[i] = s->resident[--s->numResident];
+        return;
+    }
+}
+
+static void ReleaseSector(SectorStreamer *s, Sector *sector) {
+    const WorldSectorRecord *r = sector->record;
+    for (uint32_t i = r->firstProp; i < r->firstProp + r->numProps; i++)
+        if (s->props[i].resource >= 0) ReleaseSectorResource(s, s->props[i].resource);
+    s->stats.residentBytes -= sector->bytes;
+    sector->bytes = 0;
+}
+
+//Takes the colliders out of the broadphase and gives back the memory, only for sectors that are in
+static void EvictSector(SectorStreamer *s, int index) {
+    Sector *sector = &s->sectors[index];
+    for (int i = 0; i < sector->level.numColliders; i++) {
+        int slot = sector->slots[i];
+        UnloadCollider(&s->colliders[slot]);
+        s->colliders[slot] = (Collider){ 0 };
+        s->freeSlots[s->numFree++] = slot;
+    }
+    free(sector->slots);
+    sector->slots = NULL;
+    UnloadLevelFile(&sector->level);
+    UnloadColliderStore(&sector->store);
+    ReleaseSector(s, sector);
+    sector->state = SECTOR_OUT;
+    RemoveResidentSector(s, index);
+    s->stats.evictions++;
+}
+
+//A mapped level from the I/O thread, its colliders get copied into slots and go in the broadphase
+static void FinishSectorLoad(SectorStreamer *s, int index) {
+    Sector *sector = &s->sectors[index];
+    s->stats.sectorsLoading--;
+    if (sector->level.numColliders < 0) {
+        UnloadColliderStore(&sector->store);
+        ReleaseSector(s, sector);
+        sector->state = SECTOR_FAILED;
+        RemoveResidentSector(s, index);
+        s->stats.failures++;
+        return;
+    }
+    int count = sector->level.numColliders;
+    sector->slots = (int *)malloc((count + 1) * sizeof(int));
+    if (s->numColliders + count > s->capColliders) {
+        int cap = s->capColliders ? s->capColliders : 256;
+        while (cap < s->numColliders + count) cap *= 2;
+        s->colliders = (Collider *)realloc(s->colliders, cap * sizeof(Collider));
+        s->freeSlots = (int *)realloc(s->freeSlots, cap * sizeof(int));
+        s->capColliders = cap;
+    }
+    for (int i = 0; i < count; i++) {
+        int slot = s->numFree > 0 ? s->freeSlots[--s->numFree] : s->numColliders++;
+        s->colliders[slot] = sector->level.colliders[i];
+        RegisterCollider(s->broadphase, &s->colliders[slot], slot);
+        sector->slots[i] = slot;
+    }
+    sector->state = SECTOR_IN;
+    double time = SectorNow() - sector->requested;
+    s->stats.loads++;
+    s->stats.loadTime += time;
+    if (time > s->stats.maxLoadTime) s->stats.maxLoadTime = time;
+}
+
+static void DrainSectorLoads(SectorStreamer *s) {
+    int finished[SECTOR_MAX_LOADING];
+    pthread_mutex_lock(&s->lock);
+    int count = s->numFinished;
+    memcpy(finished, s->finished, count * sizeof(int));
+    s->numFinished = 0;
+    pthread_mutex_unlock(&s->lock);
+    for (int i = 0; i < count; i++) FinishSectorLoad(s, finished[i]);
+}
+
+static void RequestSectorLoad(SectorStreamer *s, int index) {
+    Sector *sector = &s->sectors[index];
+    const WorldSectorRecord *r = sector->record;
+    sector->store = InitColliderStore();
+    sector->store.arena = InitArena(SECTOR_STORE_BLOCK);
+    for (uint32_t i = r->firstProp; i < r->firstProp + r->numProps; i++)
+        if (s->props[i].resource >= 0) AcquireSectorResource(s, s->props[i].resource);
+    sector->bytes = (size_t)r->levelSize + 2 * (size_t)r->numColliders * sizeof(Collider);
+    s->stats.residentBytes += sector->bytes;
+    sector->state = SECTOR_LOADING;
+    sector->requested = SectorNow();
+    s->resident[s->numResident++] = index;
+    s->stats.sectorsLoading++;
+    pthread_mutex_lock(&s->lock);
+    s->queue[s->numQueued++] = index;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+}
+
+//Drops the furthest sector that is in and further then distance, false if there is none
+static bool EvictFurthestSector(SectorStreamer *s, float distance) {
+    int furthest = -1;
+    for (int i = 0; i < s->numResident; i++) {
+        int index = s->resident[i];
+        if (s->sectors[index].state != SECTOR_IN || s->distances[index] <= distance) continue;
+        if (furthest < 0 || s->distances[index] > s->distances[furthest]) furthest = index;
+    }
+    if (furthest < 0) return false;
+    EvictSector(s, furthest);
+    return true;
+}
+
+/*Once a frame on the main thread with the camera position. Puts the sectors the I/O thread finished in, drops the
+ones that got too far and asks for the nearest missing ones. The colliders array can move, take it again after this*/
+void UpdateSectorStreamer(SectorStreamer *s, Vector3 focus) {
+    DrainSectorLoads(s);
+    for (int i = s->numResident - 1; i >= 0; i--) {
+        int index = s->resident[i];
+        s->distances[index] = SectorDistance(s, s->records + index, focus);
+        if (s->sectors[index].state == SECTOR_IN && s->distances[index] > s->evictRadius) EvictSector(s, index);
+    }
+
+    //Missing sectors in reach, nearest first
+    int numCandidates = 0;
+    int x0 = SectorCell(focus.x - s->loadRadius, s->sectorSize) - s->gridMinX, x1 = SectorCell(focus.x + s->loadRadius, s->sectorSize) - s->gridMinX;
+    int z0 = SectorCell(focus.z - s->loadRadius, s->sectorSize) - s->gridMinZ, z1 = SectorCell(focus.z + s->loadRadius, s->sectorSize) - s->gridMinZ;
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 >= s->gridWidth) x1 = s->gridWidth - 1;
+    if (z1 >= s->gridDepth) z1 = s->gridDepth - 1;
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            int index = s->grid[z * s->gridWidth + x];
+            if (index < 0 || s->sectors[index].state != SECTOR_OUT) continue;
+            s->distances[index] = SectorDistance(s, s->records + index, focus);
+            if (s->distances[index] > s->loadRadius) continue;
+            //Insertion sort, only the few cells around the focus get here
+            int at = numCandidates++;
+            while (at > 0 && s->distances[s->candidates[at - 1]] > s->distances[index]) {
+                s->candidates[at] = s->candidates[at - 1];
+                at--;
+            }
+            s->candidates[at] = index;
+        }
+    }
+    for (int i = 0; i < numCandidates && s->stats.sectorsLoading < SECTOR_MAX_LOADING; i++) {
+        int index = s->candidates[i];
+        //Dropping a sector can drop resources this one needs too, so the cost goes again after every one
+        size_t cost = SectorCost(s, s->records + index);
+        while (s->stats.residentBytes + cost > s->budget && EvictFurthestSector(s, s->distances[index])) cost = SectorCost(s, s->records + index);
+        if (s->stats.residentBytes + cost > s->budget) {
+            s->stats.budgetStalls++;
+            break;
+        }
+        RequestSectorLoad(s, index);
+    }
+
+    s->stats.sectorsIn = s->numResident - s->stats.sectorsLoading;
+    if (s->stats.residentBytes > s->stats.peakBytes) s->stats.peakBytes = s->stats.residentBytes;
+}
+
+//Blocks until the I/O thread is done with everything queued and puts it in, for a loading screen or a teleport
+void FinishSectorLoads(SectorStreamer *s) {
+    pthread_mutex_lock(&s->lock);
+    while (s->numQueued > 0 || s->working) pthread_cond_wait(&s->done, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+    DrainSectorLoads(s);
+    s->stats.sectorsIn = s->numResident - s->stats.sectorsLoading;
+}
+
+/*Stops the thread and drops every sector, the colliders leave the broadphase so it has to still be there. The
+resource callback isnt called, the game unloads its models and textures with everything else*/
+void UnloadSectorStreamer(SectorStreamer *s) {
+    if (s->sectors == NULL) return;
+    pthread_mutex_lock(&s->lock);
+    s->quit = true;
+    pthread_cond_broadcast(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+    for (int i = 0; i < s->numSectors; i++) {
+        Sector *sector = &s->sectors[i];
+        if (sector->state == SECTOR_IN) {
+            for (int k = 0; k < sector->level.numColliders; k++) UnloadCollider(&s->colliders[sector->slots[k]]);
+        }
+        if (sector->state == SECTOR_IN || sector->state == SECTOR_LOADING) {
+            UnloadLevelFile(&sector->level); //A load still in the queue never mapped anything
+            UnloadColliderStore(&sector->store);
+        }
+        free(sector->slots);
+    }
+    pthread_cond_destroy(&s->done);
+    pthread_cond_destroy(&s->wake);
+    pthread_mutex_destroy(&s->lock);
+    free(s->records);
+    free(s->props);
+    free(s->resources);
+    free(s->strings);
+    free(s->resourceRefs);
+    free(s->resourceMarks);
+    free(s->sectors);
+    free(s->grid);
+    free(s->resident);
+    free(s->candidates);
+    free(s->distances);
+    free(s->colliders);
+    free(s->freeSlots);
+    free(s->finished);
+    *s = (SectorStreamer){ 0 };
+}
+
+#endif
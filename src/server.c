@@ -0,0 +1,104 @@
+// Headless game server, runs the players of every connected client against the test level at the physics rate and
+// sends them snapshots. no window, GPU or X11, only the raylib headers like the benchmarks.
+// build: make server, run from src/ after make level: ./server [port] [max clients]
+// every few seconds it prints one key=value line with the tick time and the traffic, ctrl+c stops it
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+
+#include "collisions.h"
+#include "player.h"
+#include "scene.h"
+#include "jobs.h"
+#include "net.h"
+
+#define BROADPHASE_CELL_SIZE 4.0f // same as the game
+#define DEFAULT_MAX_CLIENTS 64
+#define REPORT_SECONDS 5.0
+
+static volatile sig_atomic_t quit = 0;
+
+static void Quit(int signal) {
+    quit = 1;
+}
+
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void SleepUntil(double time) {
+    struct timespec t = { (time_t)time, (long)((time - (time_t)time) * 1e9) };
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) != 0 && !quit);
+}
+
+int main(int argc, char **argv) {
+    int port = argc > 1 ? atoi(argv[1]) : NET_DEFAULT_PORT;
+    int maxClients = argc > 2 ? atoi(argv[2]) : DEFAULT_MAX_CLIENTS;
+    if(port <= 0 || port > 65535 || maxClients <= 0 || maxClients > 0xFFFF) {
+        fprintf(stderr, "usage: server [port] [max clients]\n");
+        return 1;
+    }
+    signal(SIGINT, Quit);
+    signal(SIGTERM, Quit);
+    PROFILE_THREAD("main");
+
+    ColliderStore store = InitColliderStore();
+    Broadphase broadphase = InitBroadphase(BROADPHASE_CELL_SIZE, 16);
+    LevelFile level = SetupSceneColliders(&store, &broadphase);
+    if(level.numColliders < 0) {
+        fprintf(stderr, "server: cant load %s, run make level\n", SCENE_LEVEL_PATH);
+        return 1;
+    }
+    JobSystem jobs;
+    InitJobSystem(&jobs, 0);
+    NetServer server = InitNetServer((unsigned short)port, maxClients, &jobs);
+    if(server.socket < 0) {
+        fprintf(stderr, "server: cant open udp port %d\n", port);
+        return 1;
+    }
+    printf("server op=start port=%d max_clients=%d workers=%d colliders=%d tick_rate=%d\n", server.port, maxClients, jobs.numWorkers, level.numColliders, PHYSICS_RATE);
+    fflush(stdout);
+
+    // fixed ticks on the clock, a tick that runs long is caught up by the next ones unless it is far behind
+    double next = Now(), reportStart = next, tickTime = 0.0, maxTickTime = 0.0;
+    NetServerStats reported = server.stats;
+    while(!quit) {
+        SleepUntil(next);
+        double t0 = Now();
+        NetServerTick(&server, t0, level.numColliders, level.colliders, &broadphase);
+        PROFILE_FRAME();
+        double t1 = Now();
+        tickTime += t1 - t0;
+        if(t1 - t0 > maxTickTime) maxTickTime = t1 - t0;
+        next += NET_TICK_DT;
+        if(t1 - next > 0.25) next = t1; // stalled, dont spin trough the backlog
+
+        if(t1 - reportStart >= REPORT_SECONDS) {
+            double seconds = t1 - reportStart;
+            long ticks = server.stats.ticks - reported.ticks;
+            long packetsIn = server.stats.packetsReceived - reported.packetsReceived, packetsOut = server.stats.packetsSent - reported.packetsSent;
+            long snapshots = server.stats.snapshots - reported.snapshots;
+            printf("server op=report clients=%d tick_us=%.1f max_tick_us=%.1f load=%.3f down_kbps=%.1f up_kbps=%.1f delta_share=%.3f commands=%ld bad_packets=%ld\n",
+                   server.numClients, tickTime * 1e6 / (ticks > 0 ? ticks : 1), maxTickTime * 1e6, tickTime / seconds,
+                   (server.stats.bytesSent - reported.bytesSent + 28.0 * packetsOut) * 8e-3 / seconds,
+                   (server.stats.bytesReceived - reported.bytesReceived + 28.0 * packetsIn) * 8e-3 / seconds,
+                   snapshots > 0 ? (double)(server.stats.deltaSnapshots - reported.deltaSnapshots) / snapshots : 0.0,
+                   server.stats.commands - reported.commands, server.stats.badPackets - reported.badPackets);
+            fflush(stdout);
+            reported = server.stats;
+            reportStart = t1;
+            tickTime = maxTickTime = 0.0;
+        }
+    }
+
+    printf("server op=stop ticks=%ld clients=%d\n", server.stats.ticks, server.numClients);
+    UnloadNetServer(&server);
+    UnloadJobSystem(&jobs);
+    UnloadBroadphase(&broadphase);
+    UnloadLevelFile(&level);
+    UnloadColliderStore(&store);
+    return 0;
+}